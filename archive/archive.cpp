@@ -0,0 +1,315 @@
+/**
+ * @file archive.cpp
+ * @brief Moving completed tasks to the archive database and reading them back.
+ *
+ * A chunk is picked into a temp table first, then copied and deleted by id,
+ * so the copy and the delete always agree on the rows. The hot database and
+ * the archive are both in WAL mode, where SQLite commits attached databases
+ * one after the other: a crash between the two can leave a task in both, but
+ * never in neither. listHistory() hides such duplicates and the next run
+ * replaces the archived copy.
+ *
+ * Text is compressed by two SQL functions registered on each connection:
+ * ehs_deflate(text) returns a BLOB holding the 4-byte big-endian length and
+ * the zlib stream, ehs_inflate(blob) reverses it. NULL stays NULL.
+ */
+
+#include "archive.h"
+#include "../db/ConnectionPool.h"
+#include "../logging/logging.h"
+#include "../metrics/metrics.h"
+#include "../trace/trace.h"
+#include <zlib.h>
+#include <algorithm>
+#include <ctime>
+#include <vector>
+
+namespace archive {
+
+namespace {
+
+void deflateFunction(sqlite3_context* context, int, sqlite3_value** argv) {
+    if (sqlite3_value_type(argv[0]) == SQLITE_NULL) {
+        sqlite3_result_null(context);
+        return;
+    }
+    const Bytef* text = static_cast<const Bytef*>(sqlite3_value_text(argv[0]));
+    uLong size = static_cast<uLong>(sqlite3_value_bytes(argv[0]));
+    std::vector<unsigned char> out(4 + compressBound(size));
+    uLongf packed = static_cast<uLongf>(out.size() - 4);
+    if (compress2(out.data() + 4, &packed, text, size, Z_DEFAULT_COMPRESSION) != Z_OK) {
+        sqlite3_result_error(context, "ehs_deflate: compression failed", -1);
+        return;
+    }
+    out[0] = static_cast<unsigned char>(size >> 24);
+    out[1] = static_cast<unsigned char>(size >> 16);
+    out[2] = static_cast<unsigned char>(size >> 8);
+    out[3] = static_cast<unsigned char>(size);
+    sqlite3_result_blob(context, out.data(), static_cast<int>(4 + packed), SQLITE_TRANSIENT);
+}
+
+void inflateFunction(sqlite3_context* context, int, sqlite3_value** argv) {
+    if (sqlite3_value_type(argv[0]) == SQLITE_NULL) {
+        sqlite3_result_null(context);
+        return;
+    }
+    const unsigned char* blob = static_cast<const unsigned char*>(sqlite3_value_blob(argv[0]));
+    int bytes = sqlite3_value_bytes(argv[0]);
+    if (bytes < 4) {
+        sqlite3_result_error(context, "ehs_inflate: truncated value", -1);
+        return;
+    }
+    uLongf size = (uLongf(blob[0]) << 24) | (uLongf(blob[1]) << 16) | (uLongf(blob[2]) << 8) | uLongf(blob[3]);
+    std::vector<char> out(size ? size : 1);
+    if (uncompress(reinterpret_cast<Bytef*>(out.data()), &size, blob + 4, static_cast<uLong>(bytes - 4)) != Z_OK) {
+        sqlite3_result_error(context, "ehs_inflate: corrupt value", -1);
+        return;
+    }
+    sqlite3_result_text(context, out.data(), static_cast<int>(size), SQLITE_TRANSIENT);
+}
+
+/// @brief Local time @p days ago in the core timestamp format.
+std::string timestampDaysAgo(int days) {
+    std::time_t then = std::time(nullptr) - static_cast<std::time_t>(days) * 86400;
+    std::tm local;
+    localtime_r(&then, &local);
+    char timestamp[32];
+    std::strftime(timestamp, sizeof(timestamp), "%Y-%m-%d %H:%M:%S", &local);
+    return timestamp;
+}
+
+core::Result failure(sqlite3* db, const std::string& what) {
+    core::Result result;
+    result.ok = false;
+    result.error = what + ": " + sqlite3_errmsg(db);
+    return result;
+}
+
+std::string columnText(sqlite3_stmt* stmt, int col) {
+    const unsigned char* text = sqlite3_column_text(stmt, col);
+    return text ? reinterpret_cast<const char*>(text) : "";
+}
+
+/// @brief True if archive.tasks has @p column.
+bool hasColumn(sqlite3* db, const char* column) {
+    sqlite3_stmt* stmt = nullptr;
+    bool found = false;
+    if (sqlite3_prepare_v2(db, "SELECT 1 FROM pragma_table_info('tasks', 'archive') WHERE name = ?;", -1, &stmt,
+                           nullptr) == SQLITE_OK) {
+        sqlite3_bind_text(stmt, 1, column, -1, SQLITE_STATIC);
+        found = sqlite3_step(stmt) == SQLITE_ROW;
+    }
+    sqlite3_finalize(stmt);
+    return found;
+}
+
+}  // namespace
+
+std::string defaultPath(const std::string& dbPath) {
+    bool dbSuffix = dbPath.size() > 3 && dbPath.compare(dbPath.size() - 3, 3, ".db") == 0;
+    return (dbSuffix ? dbPath.substr(0, dbPath.size() - 3) : dbPath) + "_archive.db";
+}
+
+bool attach(sqlite3* db, const std::string& path, bool create, std::string& error) {
+    int flags = SQLITE_UTF8 | SQLITE_DETERMINISTIC;
+    if (sqlite3_create_function(db, "ehs_deflate", 1, flags, nullptr, deflateFunction, nullptr, nullptr) !=
+            SQLITE_OK ||
+        sqlite3_create_function(db, "ehs_inflate", 1, flags, nullptr, inflateFunction, nullptr, nullptr) !=
+            SQLITE_OK) {
+        error = std::string("Failed to register archive functions: ") + sqlite3_errmsg(db);
+        return false;
+    }
+
+    sqlite3_stmt* stmt = nullptr;
+    bool ok = sqlite3_prepare_v2(db, "ATTACH DATABASE ? AS archive;", -1, &stmt, nullptr) == SQLITE_OK;
+    if (ok) {
+        sqlite3_bind_text(stmt, 1, path.c_str(), -1, SQLITE_TRANSIENT);
+        ok = sqlite3_step(stmt) == SQLITE_DONE;
+    }
+    sqlite3_finalize(stmt);
+    if (!ok) {
+        error = "Failed to attach archive " + path + ": " + sqlite3_errmsg(db);
+        return false;
+    }
+
+    const char* schema = "PRAGMA archive.journal_mode = WAL;"
+                         "CREATE TABLE IF NOT EXISTS archive.tasks ("
+                         "id INTEGER PRIMARY KEY, "
+                         "worker_id TEXT, "
+                         "worker_username TEXT, "
+                         "task_description BLOB, "
+                         "status TEXT, "
+                         "violation_comment TEXT, "
+                         "violation_timestamp TEXT, "
+                         "worker_report BLOB, "
+                         "worker_media TEXT, "
+                         "completed_at TEXT, "
+                         "archived_at TEXT, "
+                         "due_at INTEGER, "
+                         "priority INTEGER NOT NULL DEFAULT 2);"
+                         "CREATE INDEX IF NOT EXISTS archive.idx_tasks_worker ON tasks(worker_id, id);";
+    // Archives created before deadlines lack due_at and priority; the tasks in them had neither
+    const char* migrate = "ALTER TABLE archive.tasks ADD COLUMN due_at INTEGER;"
+                          "ALTER TABLE archive.tasks ADD COLUMN priority INTEGER NOT NULL DEFAULT 2;";
+    if (create && (sqlite3_exec(db, schema, nullptr, nullptr, nullptr) != SQLITE_OK ||
+                   (!hasColumn(db, "due_at") && sqlite3_exec(db, migrate, nullptr, nullptr, nullptr) != SQLITE_OK))) {
+        error = "Failed to create archive schema in " + path + ": " + sqlite3_errmsg(db);
+        sqlite3_exec(db, "DETACH DATABASE archive;", nullptr, nullptr, nullptr);
+        return false;
+    }
+    return true;
+}
+
+bool attached(sqlite3* db) {
+    return sqlite3_db_filename(db, "archive") != nullptr;
+}
+
+core::Result moveChunk(sqlite3* db, const std::string& cutoff, int rows) {
+    EHS_MEASURE("archive.moveChunk");
+    trace::Span span("archive.moveChunk", "archive");
+    if (!attached(db)) {
+        core::Result result;
+        result.ok = false;
+        result.error = "No archive database is attached.";
+        return result;
+    }
+
+    // A savepoint commits the copy and the delete together, whether or not the writer grouped this job
+    if (sqlite3_exec(db, "SAVEPOINT move_chunk;", nullptr, nullptr, nullptr) != SQLITE_OK) {
+        return failure(db, "Failed to start the archive chunk");
+    }
+    auto rollback = [db](core::Result result) {
+        sqlite3_exec(db, "ROLLBACK TO move_chunk; RELEASE move_chunk;", nullptr, nullptr, nullptr);
+        return result;
+    };
+
+    if (sqlite3_exec(db, "CREATE TEMP TABLE IF NOT EXISTS archive_chunk (id INTEGER PRIMARY KEY);"
+                         "DELETE FROM temp.archive_chunk;", nullptr, nullptr, nullptr) != SQLITE_OK) {
+        return rollback(failure(db, "Failed to prepare archive chunk"));
+    }
+
+    // Oldest completions first, through idx_tasks_completed
+    const char* pick = "INSERT INTO temp.archive_chunk (id) SELECT id FROM main.tasks "
+                       "WHERE status = 'completed' AND completed_at < ?1 ORDER BY completed_at LIMIT ?2;";
+    sqlite3_stmt* stmt = nullptr;
+    if (sqlite3_prepare_v2(db, pick, -1, &stmt, nullptr) != SQLITE_OK) {
+        return rollback(failure(db, "Failed to select archive chunk"));
+    }
+    sqlite3_bind_text(stmt, 1, cutoff.c_str(), -1, SQLITE_TRANSIENT);
+    sqlite3_bind_int(stmt, 2, rows);
+    int rc = sqlite3_step(stmt);
+    sqlite3_finalize(stmt);
+    if (rc != SQLITE_DONE) {
+        return rollback(failure(db, "Failed to select archive chunk"));
+    }
+
+    const char* move =
+        "INSERT OR REPLACE INTO archive.tasks (id, worker_id, worker_username, task_description, status, "
+        "violation_comment, violation_timestamp, worker_report, worker_media, completed_at, archived_at, due_at, "
+        "priority) "
+        "SELECT id, worker_id, worker_username, ehs_deflate(task_description), status, violation_comment, "
+        "violation_timestamp, ehs_deflate(worker_report), worker_media, completed_at, "
+        "strftime('%Y-%m-%d %H:%M:%S', 'now', 'localtime'), due_at, priority "
+        "FROM main.tasks WHERE id IN temp.archive_chunk;";
+    if (sqlite3_exec(db, move, nullptr, nullptr, nullptr) != SQLITE_OK) {
+        return rollback(failure(db, "Failed to copy tasks to the archive"));
+    }
+    if (sqlite3_exec(db, "DELETE FROM main.tasks WHERE id IN temp.archive_chunk;", nullptr, nullptr, nullptr) !=
+        SQLITE_OK) {
+        return rollback(failure(db, "Failed to remove archived tasks"));
+    }
+
+    core::Result result;
+    result.changes = sqlite3_changes(db);
+    if (sqlite3_exec(db, "RELEASE move_chunk;", nullptr, nullptr, nullptr) != SQLITE_OK) {
+        return rollback(failure(db, "Failed to commit archive chunk"));
+    }
+    return result;
+}
+
+Summary run(ConnectionPool& pool, const Policy& policy) {
+    trace::Span span("archive.run", "archive");
+    Summary summary;
+    std::string cutoff = timestampDaysAgo(policy.windowDays);
+    int chunkRows = policy.chunkRows > 0 ? policy.chunkRows : 5000;
+
+    while (true) {
+        core::Result chunk = pool.write([&](sqlite3* db) { return moveChunk(db, cutoff, chunkRows); });
+        if (!chunk.ok) {
+            summary.ok = false;
+            summary.error = chunk.error;
+            break;
+        }
+        if (chunk.changes == 0) {
+            break;
+        }
+        summary.moved += chunk.changes;
+        ++summary.chunks;
+        if (chunk.changes < chunkRows) {
+            break;
+        }
+    }
+
+    if (summary.ok) {
+        logging::info("Archived {} tasks completed before {} in {} chunks", summary.moved, cutoff, summary.chunks);
+    } else {
+        logging::error("Archiving stopped after {} tasks: {}", summary.moved, summary.error);
+    }
+    return summary;
+}
+
+core::Rows<core::TaskRecord> listHistory(sqlite3* db, int workerId, int afterId, int limit) {
+    EHS_MEASURE("archive.listHistory");
+    if (!attached(db)) {
+        return core::listTasks(db, workerId, afterId, limit);
+    }
+
+    std::string byWorker = workerId >= 0 ? "worker_id = ?1 AND id > ?2" : "id > ?2";
+    std::string sql =
+        "SELECT id, worker_id, worker_username, task_description, status, violation_comment, "
+        "violation_timestamp, worker_report, worker_media, IFNULL(due_at, 0), priority FROM main.tasks WHERE " +
+        byWorker +
+        " UNION ALL "
+        "SELECT id, worker_id, worker_username, ehs_inflate(task_description), status, violation_comment, "
+        "violation_timestamp, ehs_inflate(worker_report), worker_media, IFNULL(due_at, 0), priority "
+        "FROM archive.tasks a WHERE " + byWorker +
+        " AND NOT EXISTS (SELECT 1 FROM main.tasks t WHERE t.id = a.id) ORDER BY id LIMIT ?3;";
+
+    core::Rows<core::TaskRecord> result;
+    sqlite3_stmt* stmt = nullptr;
+    if (sqlite3_prepare_v2(db, sql.c_str(), -1, &stmt, nullptr) != SQLITE_OK) {
+        result.ok = false;
+        result.error = std::string("Failed to prepare history query: ") + sqlite3_errmsg(db);
+        return result;
+    }
+    if (workerId >= 0) {
+        sqlite3_bind_int(stmt, 1, workerId);
+    }
+    sqlite3_bind_int(stmt, 2, std::max(afterId, 0));
+    sqlite3_bind_int(stmt, 3, limit);
+
+    int rc;
+    while ((rc = sqlite3_step(stmt)) == SQLITE_ROW) {
+        core::TaskRecord task;
+        task.id = sqlite3_column_int(stmt, 0);
+        task.workerId = sqlite3_column_int(stmt, 1);
+        task.workerUsername = columnText(stmt, 2);
+        task.description = columnText(stmt, 3);
+        task.status = columnText(stmt, 4);
+        task.violationComment = columnText(stmt, 5);
+        task.violationTimestamp = columnText(stmt, 6);
+        task.workerReport = columnText(stmt, 7);
+        task.workerMedia = columnText(stmt, 8);
+        task.dueAt = sqlite3_column_int64(stmt, 9);
+        task.priority = sqlite3_column_int(stmt, 10);
+        result.rows.push_back(std::move(task));
+    }
+    if (rc != SQLITE_DONE) {
+        result.ok = false;
+        result.error = std::string("Failed to read task history: ") + sqlite3_errmsg(db);
+    }
+    sqlite3_finalize(stmt);
+    return result;
+}
+
+}  // namespace archive
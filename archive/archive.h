@@ -0,0 +1,102 @@
+#ifndef ARCHIVE_H_
+#define ARCHIVE_H_
+
+#include "../core/core.h"
+#include <sqlite3.h>
+#include <string>
+
+class ConnectionPool;
+
+/**
+ * @namespace archive
+ * @brief Cold tier for completed tasks, kept in a separate archive database.
+ *
+ * run() moves tasks completed longer ago than a policy window out of the hot
+ * tasks table into archive.tasks, a chunk per write transaction, so the hot
+ * table and its indexes only hold recent and open work. The long text
+ * columns (description and report) are stored zlib-compressed.
+ *
+ * The archive is ATTACHed as "archive" to the writer and to every read
+ * connection. Listing tasks never reads it; listHistory() does, and shows
+ * archived tasks exactly like hot ones. Archived tasks leave the full-text
+ * search index.
+ */
+namespace archive {
+
+/**
+ * @brief Default archive file of the database @p dbPath: its stem plus "_archive.db".
+ *
+ * ehs.db archives to ehs_archive.db and hamburg.db to hamburg_archive.db, so
+ * every program opening a plant's database finds the same archive.
+ */
+std::string defaultPath(const std::string& dbPath);
+
+/**
+ * @brief Attaches the archive database to @p db as "archive".
+ *
+ * Registers the compression functions used by the archive queries on the
+ * connection. With @p create, the archive file and its schema are created if
+ * missing; read-only connections attach an existing archive.
+ *
+ * Must be called outside a transaction, i.e. before the connection is handed
+ * to a ConnectionPool.
+ */
+bool attach(sqlite3* db, const std::string& path, bool create, std::string& error);
+
+/**
+ * @brief True if the archive is attached to @p db.
+ */
+bool attached(sqlite3* db);
+
+/**
+ * @struct Policy
+ * @brief Which completed tasks to archive, and how much per transaction.
+ */
+struct Policy {
+    int windowDays = 365;         ///< Archive tasks completed more than this many days ago
+    int chunkRows = 5000;         ///< Tasks moved per write transaction
+};
+
+/**
+ * @struct Summary
+ * @brief Outcome of an archive run.
+ */
+struct Summary {
+    bool ok = true;               ///< True if every chunk was moved
+    std::string error;            ///< Error message when ok is false
+    long long moved = 0;          ///< Tasks moved to the archive
+    int chunks = 0;               ///< Write transactions used
+};
+
+/**
+ * @brief Moves up to @p rows tasks completed before @p cutoff into the archive.
+ *
+ * The copy and the delete run in one savepoint, so they commit together
+ * whether the job runs alone or inside the caller's transaction.
+ *
+ * @param db Writer connection with the archive attached.
+ * @param cutoff Timestamp in the core format ("YYYY-MM-DD HH:MM:SS").
+ * @param rows Maximum number of tasks to move.
+ * @return Result whose changes is the number of tasks moved.
+ */
+core::Result moveChunk(sqlite3* db, const std::string& cutoff, int rows);
+
+/**
+ * @brief Moves every task outside the policy window, one chunk per writer job.
+ *
+ * Other writes interleave between chunks, so a large backlog never holds the
+ * writer for long.
+ */
+Summary run(ConnectionPool& pool, const Policy& policy);
+
+/**
+ * @brief Lists tasks including archived ones, all or those of one worker, in id order.
+ *
+ * Pages like core::listTasks (@p afterId, @p limit), and falls back to it if
+ * no archive is attached.
+ */
+core::Rows<core::TaskRecord> listHistory(sqlite3* db, int workerId = -1, int afterId = 0, int limit = -1);
+
+}  // namespace archive
+
+#endif  // ARCHIVE_H_
@@ -0,0 +1,479 @@
+/**
+ * @file backup.cpp
+ * @brief Online backup, the WAL archiver and restore.
+ *
+ * A WAL file is a 32-byte header followed by frames of a 24-byte header and
+ * one page. The frame header starts with the page number and, on the last
+ * frame of a commit, the database size in pages (both big-endian). The
+ * header's salts change whenever SQLite starts the WAL over, which it only
+ * does once every frame has been checkpointed, and the archiver only lets
+ * that happen after archiving them.
+ *
+ * Replaying a commit writes its page images into the database file and
+ * truncates it to the committed size. Commits already contained in the base
+ * backup may be replayed again: each page ends up with the image of the last
+ * replayed commit that wrote it, which is what it held at that time.
+ */
+
+#include "backup.h"
+#include "../db/ConnectionPool.h"
+#include "../logging/logging.h"
+#include "../metrics/metrics.h"
+#include "../trace/trace.h"
+#include <zlib.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <filesystem>
+#include <fstream>
+#include <thread>
+
+namespace backup {
+
+namespace {
+
+const std::uint32_t kRecordMagic = 0x57534845;           ///< "EHSW"
+const std::uint64_t kSegmentBytes = 64ull * 1024 * 1024;  ///< A new segment past this size
+const int kCheckpointFrames = 1000;                       ///< SQLite's default autocheckpoint
+const size_t kWalHeader = 32;
+const size_t kFrameHeader = 24;
+
+/// @brief Precedes the frames of one commit in a segment file (host byte order).
+struct RecordHeader {
+    std::uint32_t magic;
+    std::uint32_t pageSize;
+    std::uint32_t frames;
+    std::uint32_t crc;            ///< CRC-32 of this header (crc = 0) and the frames
+    std::int64_t timeMs;          ///< Commit time, Unix milliseconds
+};
+
+std::uint32_t bigEndian32(const unsigned char* p) {
+    return (std::uint32_t(p[0]) << 24) | (std::uint32_t(p[1]) << 16) | (std::uint32_t(p[2]) << 8) | p[3];
+}
+
+std::int64_t nowMs() {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(
+               std::chrono::system_clock::now().time_since_epoch())
+        .count();
+}
+
+/// @brief Local "YYYY-MM-DD HH:MM:SS" for error messages.
+std::string formatLocalTime(std::int64_t unixMs) {
+    std::time_t seconds = static_cast<std::time_t>(unixMs / 1000);
+    std::tm local = {};
+    localtime_r(&seconds, &local);
+    char text[32];
+    std::strftime(text, sizeof(text), "%Y-%m-%d %H:%M:%S", &local);
+    return text;
+}
+
+std::string segmentPath(const std::string& dir, int segment) {
+    char name[32];
+    std::snprintf(name, sizeof(name), "wal-%06d.ehsw", segment);
+    return dir + "/" + name;
+}
+
+/// @brief Highest segment number in @p dir, 0 if there is none.
+int lastSegment(const std::string& dir) {
+    int last = 0;
+    std::error_code ec;
+    for (const auto& entry : std::filesystem::directory_iterator(dir, ec)) {
+        int number = 0;
+        if (std::sscanf(entry.path().filename().c_str(), "wal-%d.ehsw", &number) == 1 && number > last) {
+            last = number;
+        }
+    }
+    return last;
+}
+
+bool readFully(int fd, unsigned char* data, size_t size, off_t offset) {
+    while (size > 0) {
+        ssize_t n = pread(fd, data, size, offset);
+        if (n <= 0) return false;
+        data += n;
+        size -= static_cast<size_t>(n);
+        offset += n;
+    }
+    return true;
+}
+
+bool writeFully(int fd, const unsigned char* data, size_t size) {
+    while (size > 0) {
+        ssize_t n = write(fd, data, size);
+        if (n <= 0) return false;
+        data += n;
+        size -= static_cast<size_t>(n);
+    }
+    return true;
+}
+
+std::uint32_t recordCrc(RecordHeader header, const unsigned char* frames, size_t size) {
+    header.crc = 0;
+    uLong crc = crc32(0L, reinterpret_cast<const Bytef*>(&header), sizeof(header));
+    return static_cast<std::uint32_t>(crc32(crc, frames, static_cast<uInt>(size)));
+}
+
+/// @brief fsyncs a file by name (the backup, the restored database).
+bool syncFile(const std::string& path) {
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) return false;
+    bool ok = fsync(fd) == 0;
+    close(fd);
+    return ok;
+}
+
+}  // namespace
+
+Summary run(const std::string& dbPath, const std::string& destPath, const Options& options) {
+    EHS_MEASURE("backup.run");
+    trace::Span span("backup.run", "db");
+    Summary summary;
+    auto started = std::chrono::steady_clock::now();
+
+    // Commits after this segment starts may be missing from the snapshot; replaying earlier ones is harmless
+    int firstSegment = options.walArchiveDir.empty() ? 0 : lastSegment(options.walArchiveDir);
+
+    std::string tmp = destPath + ".tmp";
+    std::remove(tmp.c_str());
+    sqlite3* source = nullptr;
+    sqlite3* dest = nullptr;
+    auto fail = [&](const std::string& what, sqlite3* db) {
+        summary.ok = false;
+        summary.error = what + ": " + (db ? sqlite3_errmsg(db) : "out of memory");
+        sqlite3_close(dest);
+        sqlite3_close(source);
+        std::remove(tmp.c_str());
+        logging::error("Backup to {} failed: {}", destPath, summary.error);
+        return summary;
+    };
+
+    if (sqlite3_open_v2(dbPath.c_str(), &source, SQLITE_OPEN_READONLY, nullptr) != SQLITE_OK) {
+        return fail("Cannot open " + dbPath, source);
+    }
+    sqlite3_busy_timeout(source, 5000);
+    // Holding a read transaction pins one WAL snapshot for every step, so commits never restart the copy
+    if (sqlite3_exec(source, "BEGIN; SELECT count(*) FROM sqlite_schema;", nullptr, nullptr, nullptr) != SQLITE_OK) {
+        return fail("Cannot start a read transaction on " + dbPath, source);
+    }
+    // The backup holds every commit up to here, so a restore cannot target an earlier time
+    std::int64_t snapshotMs = nowMs();
+    // The temporary file is synced once at the end instead of at every step
+    if (sqlite3_open_v2(tmp.c_str(), &dest, SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE, nullptr) != SQLITE_OK ||
+        sqlite3_exec(dest, "PRAGMA journal_mode = OFF; PRAGMA synchronous = OFF;", nullptr, nullptr, nullptr) !=
+            SQLITE_OK) {
+        return fail("Cannot create " + tmp, dest);
+    }
+
+    sqlite3_backup* copy = sqlite3_backup_init(dest, "main", source, "main");
+    if (!copy) {
+        return fail("Cannot start the backup", dest);
+    }
+    int rc;
+    while (true) {
+        rc = sqlite3_backup_step(copy, options.pagesPerStep > 0 ? options.pagesPerStep : -1);
+        ++summary.steps;
+        if (rc == SQLITE_DONE || (rc != SQLITE_OK && rc != SQLITE_BUSY && rc != SQLITE_LOCKED)) {
+            break;
+        }
+        if (options.pauseMs > 0) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(options.pauseMs));
+        }
+    }
+    summary.pages = sqlite3_backup_pagecount(copy);
+    sqlite3_backup_finish(copy);
+    if (rc != SQLITE_DONE) {
+        return fail("Backup step failed", dest);
+    }
+    sqlite3_close(dest);
+    dest = nullptr;
+    sqlite3_exec(source, "COMMIT;", nullptr, nullptr, nullptr);
+    sqlite3_close(source);
+    source = nullptr;
+
+    if (!syncFile(tmp) || std::rename(tmp.c_str(), destPath.c_str()) != 0) {
+        summary.ok = false;
+        summary.error = "Cannot move the backup into place at " + destPath;
+        std::remove(tmp.c_str());
+        return summary;
+    }
+    std::string marker = destPath + ".wal-segment";
+    std::remove(marker.c_str());
+    if (!options.walArchiveDir.empty()) {
+        std::ofstream(marker) << firstSegment << " " << snapshotMs << "\n";
+    }
+
+    summary.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+    logging::info("Backed up {} to {}: {} pages in {} steps, {} s", dbPath, destPath, summary.pages, summary.steps,
+                  summary.seconds);
+    return summary;
+}
+
+WalArchiver::WalArchiver(const std::string& dir) : dir(dir) {}
+
+WalArchiver::~WalArchiver() {
+    stop();
+}
+
+bool WalArchiver::start(ConnectionPool& pool, std::string& error) {
+    std::error_code ec;
+    std::filesystem::create_directories(dir, ec);
+    segment = lastSegment(dir);
+    if (!openSegment()) {
+        error = "Cannot create a WAL archive segment in " + dir;
+        return false;
+    }
+
+    error = pool.exclusive([this](sqlite3* db) -> std::string {
+        int frames = -1;
+        if (sqlite3_wal_checkpoint_v2(db, "main", SQLITE_CHECKPOINT_PASSIVE, &frames, nullptr) != SQLITE_OK ||
+            frames < 0) {
+            return "The database is not in WAL mode.";
+        }
+        walPath = sqlite3_filename_wal(sqlite3_db_filename(db, "main"));
+        // Frames already in the WAL predate the archive
+        unsigned char header[kWalHeader];
+        if (frames > 0 && openWal() && readFully(walFd, header, sizeof(header), 0)) {
+            salt[0] = bigEndian32(header + 16);
+            salt[1] = bigEndian32(header + 20);
+            archivedFrames = frames;
+        }
+        sqlite3_wal_hook(db, &WalArchiver::walHook, this);
+        return "";
+    });
+    if (!error.empty()) {
+        close(segmentFd);
+        segmentFd = -1;
+        return false;
+    }
+    this->pool = &pool;
+    logging::info("Archiving WAL frames to {}", segmentPath(dir, segment));
+    return true;
+}
+
+void WalArchiver::stop() {
+    if (!pool) return;
+    pool->exclusive([](sqlite3* db) { return sqlite3_wal_autocheckpoint(db, kCheckpointFrames); });
+    pool = nullptr;
+    sync();
+    close(segmentFd);
+    close(walFd);
+    segmentFd = walFd = -1;
+}
+
+long long WalArchiver::commits() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return committed;
+}
+
+int WalArchiver::walHook(void* context, sqlite3* db, const char* database, int frames) {
+    if (std::strcmp(database, "main") == 0) {
+        static_cast<WalArchiver*>(context)->archive(frames);
+    }
+    // What sqlite3_wal_autocheckpoint(db, 1000) would have done, now that the frames are archived
+    if (frames >= kCheckpointFrames) {
+        sqlite3_wal_checkpoint_v2(db, database, SQLITE_CHECKPOINT_PASSIVE, nullptr, nullptr);
+    }
+    return SQLITE_OK;
+}
+
+bool WalArchiver::openWal() {
+    if (walFd < 0) {
+        walFd = open(walPath.c_str(), O_RDONLY | O_CLOEXEC);
+    }
+    return walFd >= 0;
+}
+
+void WalArchiver::archive(int frames) {
+    trace::Span span("backup.archiveWal", "db");
+    unsigned char walHeader[kWalHeader];
+    if (!openWal() || !readFully(walFd, walHeader, sizeof(walHeader), 0)) {
+        logging::error("Cannot read the WAL header; the WAL archive has a gap");
+        return;
+    }
+    std::uint32_t pageSize = bigEndian32(walHeader + 8);
+    if (bigEndian32(walHeader + 16) != salt[0] || bigEndian32(walHeader + 20) != salt[1]) {
+        salt[0] = bigEndian32(walHeader + 16);
+        salt[1] = bigEndian32(walHeader + 20);
+        archivedFrames = 0;  // SQLite started the WAL over
+    }
+    if (frames <= archivedFrames) {
+        return;
+    }
+
+    size_t frameSize = kFrameHeader + pageSize;
+    size_t size = static_cast<size_t>(frames - archivedFrames) * frameSize;
+    buffer.resize(sizeof(RecordHeader) + size);
+    RecordHeader header = {kRecordMagic, pageSize, static_cast<std::uint32_t>(frames - archivedFrames), 0, nowMs()};
+    unsigned char* data = buffer.data() + sizeof(RecordHeader);
+    if (!readFully(walFd, data, size, static_cast<off_t>(kWalHeader + archivedFrames * frameSize))) {
+        logging::error("Cannot read {} WAL frames; the WAL archive has a gap", frames - archivedFrames);
+        return;
+    }
+    header.crc = recordCrc(header, data, size);
+    std::memcpy(buffer.data(), &header, sizeof(header));
+    if (!writeFully(segmentFd, buffer.data(), buffer.size())) {
+        logging::error("Cannot append to WAL archive segment {}; the WAL archive has a gap", segment);
+        return;
+    }
+    archivedFrames = frames;
+    segmentBytes += buffer.size();
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        ++committed;
+    }
+
+    if (segmentBytes >= kSegmentBytes) {
+        sync();
+        close(segmentFd);
+        openSegment();
+    } else if (header.timeMs - lastSyncMs >= 1000) {
+        sync();
+    }
+}
+
+bool WalArchiver::openSegment() {
+    ++segment;
+    segmentBytes = 0;
+    segmentFd = open(segmentPath(dir, segment).c_str(), O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+    if (segmentFd < 0) {
+        logging::error("Cannot create {}", segmentPath(dir, segment));
+        return false;
+    }
+    return true;
+}
+
+void WalArchiver::sync() {
+    if (segmentFd >= 0) {
+        fdatasync(segmentFd);
+    }
+    lastSyncMs = nowMs();
+}
+
+RestoreSummary restore(const std::string& backupPath, const std::string& archiveDir, const std::string& outPath,
+                       std::int64_t untilMs) {
+    trace::Span span("backup.restore", "db");
+    RestoreSummary summary;
+    auto started = std::chrono::steady_clock::now();
+    auto fail = [&](const std::string& error) {
+        summary.ok = false;
+        summary.error = error;
+        return summary;
+    };
+
+    std::error_code ec;
+    for (const std::string& file : {outPath, outPath + "-wal", outPath + "-shm"}) {
+        std::filesystem::remove(file, ec);
+    }
+    if (!std::filesystem::copy_file(backupPath, outPath, ec)) {
+        return fail("Cannot copy " + backupPath + " to " + outPath + ": " + ec.message());
+    }
+
+    int firstSegment = 0;
+    std::int64_t snapshotMs = -1;
+    std::ifstream marker(backupPath + ".wal-segment");
+    if (!archiveDir.empty() && !(marker >> firstSegment)) {
+        return fail("No WAL archive position for " + backupPath + " (was it taken with EHS_WAL_ARCHIVE set?)");
+    }
+    // Replaying only commits older than the backup would write old pages over newer ones
+    if (!archiveDir.empty() && untilMs >= 0) {
+        if (!(marker >> snapshotMs)) {
+            return fail(backupPath + " does not record when it was taken; restore it without a target time.");
+        }
+        if (untilMs < snapshotMs) {
+            return fail(backupPath + " was taken at " + formatLocalTime(snapshotMs) +
+                        "; the target time cannot be earlier.");
+        }
+    }
+
+    int fd = open(outPath.c_str(), O_RDWR);
+    unsigned char dbHeader[100];
+    if (fd < 0 || !readFully(fd, dbHeader, sizeof(dbHeader), 0)) {
+        if (fd >= 0) close(fd);
+        return fail("Cannot read " + outPath);
+    }
+    std::uint32_t pageSize = (std::uint32_t(dbHeader[16]) << 8) | dbHeader[17];
+    if (pageSize == 1) pageSize = 65536;
+
+    // Replay segment by segment until the target time, the end of the archive or a damaged record
+    std::vector<unsigned char> frames;
+    bool done = archiveDir.empty();
+    for (int segment = firstSegment; !done; ++segment) {
+        std::string path = segmentPath(archiveDir, segment);
+        int in = open(path.c_str(), O_RDONLY);
+        if (in < 0) {
+            // Segment numbers start at 1: a backup taken before the first segment starts from there
+            if (segment == 0) continue;
+            break;
+        }
+        off_t offset = 0;
+        RecordHeader header;
+        while (readFully(in, reinterpret_cast<unsigned char*>(&header), sizeof(header), offset)) {
+            if (header.magic != kRecordMagic || header.pageSize != pageSize) {
+                logging::warn("Restore stopped at a damaged record in {}", path);
+                done = true;
+                break;
+            }
+            if (untilMs >= 0 && header.timeMs > untilMs) {
+                done = true;
+                break;
+            }
+            size_t frameSize = kFrameHeader + pageSize;
+            frames.resize(static_cast<size_t>(header.frames) * frameSize);
+            if (!readFully(in, frames.data(), frames.size(), offset + static_cast<off_t>(sizeof(header))) ||
+                recordCrc(header, frames.data(), frames.size()) != header.crc) {
+                logging::warn("Restore stopped at a damaged record in {}", path);
+                done = true;
+                break;
+            }
+            std::uint32_t commitPages = 0;
+            for (std::uint32_t i = 0; i < header.frames; ++i) {
+                const unsigned char* frame = frames.data() + i * frameSize;
+                std::uint32_t page = bigEndian32(frame);
+                if (pwrite(fd, frame + kFrameHeader, pageSize, static_cast<off_t>(page - 1) * pageSize) !=
+                    static_cast<ssize_t>(pageSize)) {
+                    close(in);
+                    close(fd);
+                    return fail("Cannot write page " + std::to_string(page) + " of " + outPath);
+                }
+                commitPages = bigEndian32(frame + 4);
+            }
+            if (commitPages > 0 && ftruncate(fd, static_cast<off_t>(commitPages) * pageSize) != 0) {
+                close(in);
+                close(fd);
+                return fail("Cannot truncate " + outPath);
+            }
+            summary.frames += header.frames;
+            ++summary.commits;
+            summary.lastCommitMs = header.timeMs;
+            offset += static_cast<off_t>(sizeof(header) + frames.size());
+        }
+        close(in);
+    }
+    bool synced = fsync(fd) == 0;
+    close(fd);
+    if (!synced) {
+        return fail("Cannot sync " + outPath);
+    }
+
+    sqlite3* db = nullptr;
+    std::string check;
+    if (sqlite3_open_v2(outPath.c_str(), &db, SQLITE_OPEN_READWRITE, nullptr) == SQLITE_OK) {
+        sqlite3_stmt* stmt = nullptr;
+        if (sqlite3_prepare_v2(db, "PRAGMA quick_check;", -1, &stmt, nullptr) == SQLITE_OK &&
+            sqlite3_step(stmt) == SQLITE_ROW) {
+            check = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 0));
+        }
+        sqlite3_finalize(stmt);
+    }
+    sqlite3_close(db);
+    summary.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+    if (check != "ok") {
+        return fail("Restored database failed quick_check: " + (check.empty() ? "cannot open it" : check));
+    }
+    return summary;
+}
+
+}  // namespace backup
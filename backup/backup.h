@@ -0,0 +1,151 @@
+#ifndef BACKUP_H_
+#define BACKUP_H_
+
+#include <sqlite3.h>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <vector>
+
+class ConnectionPool;
+
+/**
+ * @namespace backup
+ * @brief Online backups, WAL archiving and point-in-time restore.
+ *
+ * run() copies the database with the SQLite backup API from its own
+ * read-only connection, a few hundred pages per step with a pause between
+ * steps. The whole copy reads one WAL snapshot, so it is consistent, and
+ * writers are never blocked by it.
+ *
+ * A WalArchiver on the process that owns the writer connection copies the
+ * WAL frames of every commit, with the commit time, into segment files in
+ * an archive directory. restore() takes a backup and rolls it forward
+ * through those frames up to a given time, replaying each commit whole.
+ *
+ * Only commits made through the archiving process are captured, as with
+ * compaction: the ConnectionPool must be the only writer.
+ */
+namespace backup {
+
+/**
+ * @struct Options
+ * @brief Pace of an online backup.
+ */
+struct Options {
+    int pagesPerStep = 256;       ///< Pages copied per backup step
+    int pauseMs = 5;              ///< Sleep between steps, leaving the disk to the application
+    std::string walArchiveDir;    ///< WAL archive the backup can be rolled forward with, if any
+};
+
+/**
+ * @struct Summary
+ * @brief Outcome of an online backup.
+ */
+struct Summary {
+    bool ok = true;               ///< True if the backup file was written
+    std::string error;            ///< Error message when ok is false
+    long long pages = 0;          ///< Pages copied
+    int steps = 0;                ///< Backup steps taken
+    double seconds = 0;           ///< Wall time of the copy
+};
+
+/**
+ * @brief Writes a consistent copy of @p dbPath to @p destPath while the database is in use.
+ *
+ * The copy is written under a temporary name, synced and renamed into place.
+ * With a WAL archive directory, "<destPath>.wal-segment" records the first
+ * archive segment restore() has to replay on top of this backup and the
+ * time of the backup's snapshot.
+ */
+Summary run(const std::string& dbPath, const std::string& destPath, const Options& options = Options());
+
+/**
+ * @class WalArchiver
+ * @brief Copies the WAL frames of every commit on the writer connection into an archive.
+ *
+ * start() replaces SQLite's automatic checkpoint with a WAL hook on the
+ * writer: after each commit, the frames it appended are copied from the
+ * -wal file into the current segment ("wal-NNNNNN.ehsw", a new one per
+ * process start and every 64 MB), and then the usual passive checkpoint runs
+ * once the WAL holds 1000 frames. A frame is never checkpointed away before
+ * it is archived. Segments are synced at most a second apart, so a power
+ * loss costs at most the last second of the archive.
+ *
+ * Each record holds the commit time in milliseconds, the page size, the
+ * frame count, the raw frames and a CRC-32; restore() stops at the first
+ * damaged record.
+ */
+class WalArchiver {
+public:
+    explicit WalArchiver(const std::string& dir);
+    ~WalArchiver();
+    WalArchiver(const WalArchiver&) = delete;
+    WalArchiver& operator=(const WalArchiver&) = delete;
+
+    /**
+     * @brief Starts archiving the commits made through @p pool.
+     *
+     * Commits made before are not in the archive, so take the base backup
+     * after this returns.
+     */
+    bool start(ConnectionPool& pool, std::string& error);
+
+    /**
+     * @brief Stops archiving, syncs the segment and restores automatic checkpoints.
+     */
+    void stop();
+
+    /// @brief Commits archived since start().
+    long long commits() const;
+
+private:
+    static int walHook(void* context, sqlite3* db, const char* database, int frames);
+    void archive(int frames);
+    bool openWal();
+    bool openSegment();
+    void sync();
+
+    std::string dir;
+    ConnectionPool* pool = nullptr;
+    std::string walPath;
+    int walFd = -1;               ///< Opened at the first commit if the -wal file did not exist yet
+    int segmentFd = -1;
+    int segment = 0;
+    std::uint64_t segmentBytes = 0;
+    int archivedFrames = 0;           ///< Frames of the current WAL generation already archived
+    std::uint32_t salt[2] = {0, 0};   ///< Identifies the WAL generation
+    std::int64_t lastSyncMs = 0;
+    std::vector<unsigned char> buffer;
+    mutable std::mutex mutex;         ///< Guards committed, read outside the writer thread
+    long long committed = 0;
+};
+
+/**
+ * @struct RestoreSummary
+ * @brief Outcome of a restore.
+ */
+struct RestoreSummary {
+    bool ok = true;               ///< True if the restored database passed quick_check
+    std::string error;            ///< Error message when ok is false
+    long long commits = 0;        ///< Archived commits replayed
+    long long frames = 0;         ///< Pages written by the replay
+    std::int64_t lastCommitMs = 0;  ///< Time of the last replayed commit (Unix ms), 0 if none
+    double seconds = 0;           ///< Wall time of the copy and the replay
+};
+
+/**
+ * @brief Restores @p backupPath into @p outPath, rolled forward to @p untilMs.
+ *
+ * Replays every archived commit made at or before @p untilMs (Unix time in
+ * milliseconds; -1 for all of them), starting at the segment recorded for
+ * the backup. @p untilMs cannot be earlier than the time the backup was
+ * taken, which is recorded next to it. @p outPath must not be in use; its
+ * -wal and -shm files are removed first.
+ */
+RestoreSummary restore(const std::string& backupPath, const std::string& archiveDir, const std::string& outPath,
+                       std::int64_t untilMs = -1);
+
+}  // namespace backup
+
+#endif  // BACKUP_H_
@@ -0,0 +1,810 @@
+/**
+ * @file batch.cpp
+ * @brief Pipelined NDJSON batch mode.
+ *
+ * Three threads cooperate: a reader fills a bounded line queue from the
+ * input, the calling thread parses commands and starts them on the
+ * AsyncService, and a printer writes results as soon as the oldest
+ * unanswered command completes. Results are filled in by the commands'
+ * continuations on the executor.
+ *
+ */
+
+#include "batch.h"
+#include "../json/json.h"
+#include "../logging/logging.h"
+#include <chrono>
+#include <condition_variable>
+#include <ctime>
+#include <deque>
+#include <istream>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace batch {
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+/// @brief The result line of one command, filled in when it completes.
+struct Slot {
+    bool done = false;
+    std::string line;
+};
+
+/// @brief Result lines in input order, written by a printer thread.
+class Output {
+public:
+    explicit Output(std::ostream& out) : out(out) {}
+
+    bool full(size_t depth) {
+        std::lock_guard<std::mutex> lock(mutex);
+        return pending.size() >= depth;
+    }
+
+    /// @brief Adds a slot for the next command, waiting while @p depth commands are unanswered.
+    std::shared_ptr<Slot> push(size_t depth) {
+        std::unique_lock<std::mutex> lock(mutex);
+        changed.wait(lock, [&] { return pending.size() < depth; });
+        pending.push_back(std::make_shared<Slot>());
+        ++commands;
+        return pending.back();
+    }
+
+    void fill(const std::shared_ptr<Slot>& slot, bool ok, std::string line) {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            slot->line = std::move(line);
+            slot->done = true;
+            if (!ok) ++failed;
+        }
+        changed.notify_all();
+    }
+
+    /// @brief Lets the printer exit once every slot is written.
+    void finish() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            ended = true;
+        }
+        changed.notify_all();
+    }
+
+    void print() {
+        std::vector<std::shared_ptr<Slot>> ready;
+        while (true) {
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                changed.wait(lock, [&] { return (!pending.empty() && pending.front()->done) || (ended && pending.empty()); });
+                if (pending.empty()) {
+                    return;
+                }
+                while (!pending.empty() && pending.front()->done) {
+                    ready.push_back(std::move(pending.front()));
+                    pending.pop_front();
+                }
+            }
+            changed.notify_all();
+            for (const std::shared_ptr<Slot>& slot : ready) {
+                out << slot->line << '\n';
+            }
+            out.flush();
+            ready.clear();
+        }
+    }
+
+    Summary summary() {
+        std::lock_guard<std::mutex> lock(mutex);
+        Summary result;
+        result.commands = commands;
+        result.failed = failed;
+        return result;
+    }
+
+private:
+    std::ostream& out;
+    std::mutex mutex;
+    std::condition_variable changed;
+    std::deque<std::shared_ptr<Slot>> pending;
+    size_t commands = 0;
+    size_t failed = 0;
+    bool ended = false;
+};
+
+/// @brief Input lines read ahead by a reader thread.
+class Input {
+public:
+    enum class Status { Line, Timeout, End };
+
+    Input(std::istream& in, size_t limit) : limit(limit), reader([this, &in]() { read(in); }) {}
+
+    ~Input() { reader.join(); }
+
+    /// @brief Takes the next line, waiting at most until @p deadline when @p timed is set.
+    Status next(std::string& line, bool timed, Clock::time_point deadline) {
+        std::unique_lock<std::mutex> lock(mutex);
+        auto ready = [&] { return !lines.empty() || eof; };
+        if (timed) {
+            if (!changed.wait_until(lock, deadline, ready)) return Status::Timeout;
+        } else {
+            changed.wait(lock, ready);
+        }
+        if (lines.empty()) {
+            return Status::End;
+        }
+        line = std::move(lines.front());
+        lines.pop_front();
+        changed.notify_all();
+        return Status::Line;
+    }
+
+private:
+    void read(std::istream& in) {
+        std::string line;
+        while (std::getline(in, line)) {
+            std::unique_lock<std::mutex> lock(mutex);
+            changed.wait(lock, [&] { return lines.size() < limit; });
+            lines.push_back(std::move(line));
+            changed.notify_all();
+        }
+        std::lock_guard<std::mutex> lock(mutex);
+        eof = true;
+        changed.notify_all();
+    }
+
+    size_t limit;
+    std::mutex mutex;
+    std::condition_variable changed;
+    std::deque<std::string> lines;
+    bool eof = false;
+    std::thread reader;
+};
+
+void field(std::string& out, const char* name, const std::string& value) {
+    out += ",\"";
+    out += name;
+    out += "\":";
+    out += json::quote(value);
+}
+
+void field(std::string& out, const char* name, sqlite3_int64 value) {
+    out += ",\"";
+    out += name;
+    out += "\":";
+    out += std::to_string(value);
+}
+
+/// @brief Appends a record's members, each preceded by a comma.
+void members(std::string& out, const core::TaskRecord& task) {
+    field(out, "id", task.id);
+    field(out, "worker_id", task.workerId);
+    field(out, "worker_username", task.workerUsername);
+    field(out, "description", task.description);
+    field(out, "status", task.status);
+    field(out, "violation_comment", task.violationComment);
+    field(out, "violation_timestamp", task.violationTimestamp);
+    field(out, "worker_report", task.workerReport);
+    field(out, "worker_media", task.workerMedia);
+    field(out, "due_at", task.dueAt ? core::formatLocalTime(task.dueAt) : std::string());
+    field(out, "priority", core::priorityName(task.priority));
+}
+
+void members(std::string& out, const core::RuleRecord& rule) {
+    field(out, "id", rule.id);
+    field(out, "text", rule.text);
+    field(out, "timestamp", rule.timestamp);
+}
+
+void members(std::string& out, const core::WorkerRecord& worker) {
+    field(out, "id", worker.id);
+    field(out, "username", worker.username);
+}
+
+void members(std::string& out, const core::WorkerLoad& load) {
+    field(out, "worker_id", load.workerId);
+    field(out, "username", load.username);
+    field(out, "open_tasks", load.openTasks);
+    field(out, "weight", load.weight);
+    out += load.available ? ",\"available\":true" : ",\"available\":false";
+}
+
+void members(std::string& out, const core::FeedbackSummary& summary) {
+    field(out, "rule_id", summary.ruleId);
+    field(out, "rule_text", summary.ruleText);
+    field(out, "feedback_count", summary.feedbackCount);
+    field(out, "rating_count", summary.ratingCount);
+    field(out, "rating_sum", summary.ratingSum);
+}
+
+void members(std::string& out, const core::FeedbackRecord& feedback) {
+    field(out, "id", feedback.id);
+    field(out, "rule_id", feedback.ruleId);
+    field(out, "worker_id", feedback.workerId);
+    field(out, "created_at", feedback.createdAt);
+    field(out, "rating", feedback.rating);
+    field(out, "text", feedback.text);
+}
+
+void members(std::string& out, const core::ScheduleRecord& schedule) {
+    field(out, "id", schedule.id);
+    field(out, "worker_id", schedule.workerId);
+    field(out, "worker_username", schedule.workerUsername);
+    field(out, "description", schedule.description);
+    field(out, "interval_seconds", schedule.intervalSeconds);
+    field(out, "next_due", core::formatLocalTime(schedule.nextDue));
+}
+
+void members(std::string& out, const core::ShiftRecord& shift) {
+    field(out, "id", shift.id);
+    field(out, "worker_id", shift.workerId);
+    field(out, "worker_username", shift.workerUsername);
+    field(out, "site", shift.site);
+    field(out, "starts_at", core::formatLocalTime(shift.startsAt));
+    field(out, "ends_at", core::formatLocalTime(shift.endsAt));
+}
+
+void members(std::string& out, const core::SearchHit& hit) {
+    field(out, "id", hit.id);
+    field(out, "snippet", hit.snippet);
+}
+
+/// @brief Appends ,"name":[{...},...].
+template <typename T>
+void array(std::string& out, const char* name, const std::vector<T>& rows) {
+    out += ",\"";
+    out += name;
+    out += "\":[";
+    for (size_t i = 0; i < rows.size(); ++i) {
+        std::string record;
+        members(record, rows[i]);
+        out += i ? ",{" : "{";
+        out.append(record, 1, std::string::npos);  // Drop the leading comma
+        out += '}';
+    }
+    out += ']';
+}
+
+void status(std::string& out, bool ok, const std::string& error) {
+    out += ok ? ",\"ok\":true" : ",\"ok\":false";
+    if (!ok) field(out, "error", error);
+}
+
+/// @brief Appends the members of a result after the command's seq, op and ref.
+void body(std::string& out, const core::Result& result) {
+    status(out, result.ok, result.error);
+    if (!result.ok) return;
+    if (result.id > 0) field(out, "id", result.id);  // Only inserts report one
+    field(out, "changes", result.changes);
+}
+
+template <typename T>
+void body(std::string& out, const core::Rows<T>& rows) {
+    status(out, rows.ok, rows.error);
+    if (rows.ok) array(out, "rows", rows.rows);
+}
+
+void body(std::string& out, const core::SearchResult& result) {
+    status(out, result.ok, result.error);
+    if (!result.ok) return;
+    array(out, "rules", result.rules);
+    array(out, "tasks", result.tasks);
+}
+
+/// @brief Reads an integer member; a missing optional member keeps @p value.
+template <typename T>
+bool integer(const json::Object& command, const char* name, T& value, bool required, std::string& error) {
+    auto found = command.find(name);
+    if (found == command.end() || found->second.type == json::Value::Type::Null) {
+        if (required) error = std::string("Missing \"") + name + "\".";
+        return !required;
+    }
+    const json::Value& member = found->second;
+    if (member.type != json::Value::Type::Number || member.number < std::numeric_limits<T>::min() ||
+        member.number > std::numeric_limits<T>::max() || member.number != static_cast<double>(static_cast<T>(member.number))) {
+        error = std::string("\"") + name + "\" must be an integer.";
+        return false;
+    }
+    value = static_cast<T>(member.number);
+    return true;
+}
+
+bool text(const json::Object& command, const char* name, std::string& value, bool required, std::string& error) {
+    auto found = command.find(name);
+    if (found == command.end() || found->second.type == json::Value::Type::Null) {
+        if (required) error = std::string("Missing \"") + name + "\".";
+        return !required;
+    }
+    if (found->second.type != json::Value::Type::String) {
+        error = std::string("\"") + name + "\" must be a string.";
+        return false;
+    }
+    value = found->second.text;
+    return true;
+}
+
+bool boolean(const json::Object& command, const char* name, bool& value, bool required, std::string& error) {
+    auto found = command.find(name);
+    if (found == command.end() || found->second.type == json::Value::Type::Null) {
+        if (required) error = std::string("Missing \"") + name + "\".";
+        return !required;
+    }
+    if (found->second.type != json::Value::Type::Bool) {
+        error = std::string("\"") + name + "\" must be true or false.";
+        return false;
+    }
+    value = found->second.boolean;
+    return true;
+}
+
+class Runner {
+public:
+    Runner(AsyncService& service, std::ostream& out, const Options& options)
+        : service(service), options(options), output(out) {}
+
+    Summary run(std::istream& in) {
+        std::thread printer([this]() { output.print(); });
+        {
+            Input input(in, options.depth);
+            size_t seq = 0;
+            std::string line;
+            while (true) {
+                bool timed = !writes.empty();
+                Clock::time_point deadline = firstWrite + std::chrono::milliseconds(options.windowMs);
+                Input::Status status = input.next(line, timed, deadline);
+                if (status == Input::Status::Timeout) {
+                    flush();
+                    continue;
+                }
+                if (status == Input::Status::End) {
+                    break;
+                }
+                if (line.find_first_not_of(" \t\r") == std::string::npos) {
+                    continue;
+                }
+                command(line, ++seq);
+            }
+            flush();
+        }
+        waitWrites();
+        output.finish();
+        printer.join();
+        return output.summary();
+    }
+
+private:
+    struct Session {
+        int userId = -1;
+        std::string role;
+    };
+
+    struct PendingWrite {
+        LocalService::WriteOp write;
+        std::shared_ptr<Slot> slot;
+        std::string prefix;
+    };
+
+    void command(const std::string& line, size_t seq) {
+        if (output.full(options.depth)) {
+            flush();  // The oldest unanswered command may be a queued write
+        }
+        std::shared_ptr<Slot> slot = output.push(options.depth);
+        std::string prefix = "{\"seq\":" + std::to_string(seq);
+
+        json::Object command;
+        std::string error;
+        if (!json::parseObject(line, command, error)) {
+            reject(slot, prefix, "Malformed command: " + error);
+            return;
+        }
+        std::string op;
+        if (!text(command, "op", op, true, error)) {
+            reject(slot, prefix, error);
+            return;
+        }
+        field(prefix, "op", op);
+        auto ref = command.find("ref");
+        if (ref != command.end()) {
+            const json::Value& value = ref->second;
+            prefix += ",\"ref\":";
+            switch (value.type) {
+                case json::Value::Type::String: prefix += json::quote(value.text); break;
+                case json::Value::Type::Number: prefix += value.text; break;
+                case json::Value::Type::Bool: prefix += value.boolean ? "true" : "false"; break;
+                case json::Value::Type::Null: prefix += "null"; break;
+            }
+        }
+
+        if (!dispatch(op, command, slot, prefix, error)) {
+            reject(slot, prefix, error);
+        }
+    }
+
+    /// @brief Starts one command; returns false with @p error if it is rejected outright.
+    bool dispatch(const std::string& op, const json::Object& command, const std::shared_ptr<Slot>& slot,
+                  const std::string& prefix, std::string& error) {
+        bool manager = session.role == "manager";
+        bool worker = session.role == "worker";
+        bool loggedIn = manager || worker;
+        int workerId = session.userId;
+        std::string a, b, c;
+        int x = 0, y = 0;
+        sqlite3_int64 wide = 0;
+
+        auto requireManager = [&] { return manager || (error = "Only managers can do this.", false); };
+        auto requireWorker = [&] { return worker || (error = "Only workers can do this.", false); };
+        auto requireLogin = [&] { return loggedIn || (error = "Not logged in.", false); };
+
+        if (op == "login") {
+            if (!text(command, "username", a, true, error) || !text(command, "password", b, true, error)) return false;
+            barrier();  // A register still queued must commit before its user can log in
+            core::LoginResult result = service.login(a, b).get();
+            session = Session();
+            if (result.ok) {
+                session.userId = result.userId;
+                session.role = result.role;
+            }
+            std::string line = prefix;
+            status(line, result.ok, result.error.empty() ? "Invalid credentials." : result.error);
+            if (result.ok) {
+                field(line, "user_id", result.userId);
+                field(line, "role", result.role);
+            }
+            output.fill(slot, result.ok, line + "}");
+            return true;
+        }
+        if (op == "logout") {
+            session = Session();
+            output.fill(slot, true, prefix + ",\"ok\":true}");
+            return true;
+        }
+        if (op == "register") {
+            if (!text(command, "username", a, true, error) || !text(command, "password", b, true, error) ||
+                !text(command, "role", c, true, error)) return false;
+            // As in ehsd: anyone may sign up as a worker; only a manager can add another manager
+            if (c != "worker" && !manager) {
+                error = "Only a manager can register a manager.";
+                return false;
+            }
+            queue([a, b, c](sqlite3* db) { return core::registerUser(db, a, b, c); }, slot, prefix);
+            return true;
+        }
+        if (op == "assign") {
+            b = "normal";
+            if (!requireManager() || !integer(command, "worker_id", x, true, error) ||
+                !text(command, "description", a, true, error) || !text(command, "priority", b, false, error) ||
+                !text(command, "due", c, false, error)) return false;
+            if (!core::parsePriority(b, y)) {
+                error = "\"priority\" must be high, normal or low.";
+                return false;
+            }
+            if (!c.empty() && !core::parseLocalTime(c, wide)) {
+                error = "\"due\" must be YYYY-MM-DD or YYYY-MM-DD HH:MM.";
+                return false;
+            }
+            queue([x, a, wide, y](sqlite3* db) { return core::assignTask(db, x, a, wide, y); }, slot, prefix);
+            return true;
+        }
+        if (op == "auto_assign") {
+            b = "normal";
+            std::string site;
+            if (!requireManager() || !text(command, "description", a, true, error) ||
+                !text(command, "priority", b, false, error) || !text(command, "due", c, false, error) ||
+                !text(command, "site", site, false, error)) return false;
+            if (!core::parsePriority(b, y)) {
+                error = "\"priority\" must be high, normal or low.";
+                return false;
+            }
+            if (!c.empty() && !core::parseLocalTime(c, wide)) {
+                error = "\"due\" must be YYYY-MM-DD or YYYY-MM-DD HH:MM.";
+                return false;
+            }
+            // Each command is one index seek, so a batch of them balances as well as one bulk call
+            sqlite3_int64 now = std::time(nullptr);
+            sqlite3_int64 until = wide > now ? wide : now + 1;
+            queue([a, wide, y, site, now, until](sqlite3* db) {
+                core::Rows<core::TaskRecord> assigned = core::autoAssignTasks(db, {a}, wide, y, site, now, until);
+                core::Result result;
+                result.ok = assigned.ok;
+                result.error = assigned.error;
+                if (assigned.ok) {
+                    result.id = assigned.rows[0].id;
+                    result.changes = 1;
+                }
+                return result;
+            }, slot, prefix);
+            return true;
+        }
+        if (op == "set_availability") {
+            bool available = true;
+            y = 0;
+            if (!requireManager() || !integer(command, "worker_id", x, true, error) ||
+                !boolean(command, "available", available, true, error) || !integer(command, "weight", y, false, error)) {
+                return false;
+            }
+            queue([x, available, y](sqlite3* db) { return core::setWorkerAvailability(db, x, available, y); }, slot,
+                  prefix);
+            return true;
+        }
+        if (op == "violation") {
+            b = "violation";
+            if (!requireManager() || !integer(command, "task_id", x, true, error) ||
+                !text(command, "status", b, false, error) || !text(command, "comment", a, true, error)) return false;
+            queue([x, a, b](sqlite3* db) { return core::reportViolation(db, x, b, a); }, slot, prefix);
+            return true;
+        }
+        if (op == "add_rule") {
+            if (!requireManager() || !text(command, "text", a, true, error)) return false;
+            queue([a](sqlite3* db) { return core::addRule(db, a); }, slot, prefix);
+            return true;
+        }
+        if (op == "delete_rule") {
+            if (!requireManager() || !integer(command, "rule_id", x, true, error)) return false;
+            queue([x](sqlite3* db) { return core::deleteRule(db, x); }, slot, prefix);
+            return true;
+        }
+        if (op == "delete_task") {
+            if (!requireManager() || !integer(command, "task_id", x, true, error)) return false;
+            queue([x](sqlite3* db) { return core::deleteTask(db, x); }, slot, prefix);
+            return true;
+        }
+        if (op == "add_schedule") {
+            if (!requireManager() || !integer(command, "worker_id", x, true, error) ||
+                !text(command, "description", a, true, error) || !text(command, "interval", b, true, error) ||
+                !text(command, "first_due", c, false, error)) return false;
+            sqlite3_int64 interval = 0;
+            wide = std::time(nullptr);
+            if (!core::parseInterval(b, interval)) {
+                error = "\"interval\" must be hourly, daily, weekly or a count with m, h, d or w.";
+                return false;
+            }
+            if (!c.empty() && !core::parseLocalTime(c, wide)) {
+                error = "\"first_due\" must be YYYY-MM-DD or YYYY-MM-DD HH:MM.";
+                return false;
+            }
+            queue([x, a, interval, wide](sqlite3* db) { return core::addSchedule(db, x, a, interval, wide); }, slot,
+                  prefix);
+            return true;
+        }
+        if (op == "add_shift") {
+            sqlite3_int64 startsAt = 0;
+            sqlite3_int64 endsAt = 0;
+            if (!requireManager() || !integer(command, "worker_id", x, true, error) ||
+                !text(command, "site", a, true, error) || !text(command, "start", b, true, error) ||
+                !text(command, "end", c, true, error)) return false;
+            if (!core::parseLocalTime(b, startsAt) || !core::parseLocalTime(c, endsAt)) {
+                error = "\"start\" and \"end\" must be YYYY-MM-DD or YYYY-MM-DD HH:MM.";
+                return false;
+            }
+            queue([x, a, startsAt, endsAt](sqlite3* db) { return core::addShift(db, x, a, startsAt, endsAt); }, slot,
+                  prefix);
+            return true;
+        }
+        if (op == "delete_shift") {
+            if (!requireManager() || !integer(command, "shift_id", x, true, error)) return false;
+            queue([x](sqlite3* db) { return core::deleteShift(db, x); }, slot, prefix);
+            return true;
+        }
+        if (op == "delete_schedule") {
+            if (!requireManager() || !integer(command, "schedule_id", x, true, error)) return false;
+            queue([x](sqlite3* db) { return core::deleteSchedule(db, x); }, slot, prefix);
+            return true;
+        }
+        if (op == "feedback") {
+            if (!requireWorker() || !integer(command, "rule_id", x, true, error) ||
+                !integer(command, "rating", y, false, error) || !text(command, "text", a, true, error)) return false;
+            if (y < 0 || y > 5) {
+                error = "\"rating\" must be 1-5, or 0 for none.";
+                return false;
+            }
+            queue([x, y, a, workerId](sqlite3* db) { return core::submitRuleFeedback(db, x, workerId, y, a); }, slot, prefix);
+            return true;
+        }
+        if (op == "report") {
+            if (!requireWorker() || !integer(command, "task_id", x, true, error) ||
+                !text(command, "report", a, true, error) || !text(command, "media_path", b, true, error)) return false;
+            // The media copy runs on a blocking thread, not inside the write transaction
+            flush();
+            beginWrite();
+            respond(service.submitTaskReport(x, workerId, a, b), slot, prefix, true);
+            return true;
+        }
+
+        // Reads see every write before them
+        if (op.compare(0, 5, "list_") == 0 || op == "feedback_summaries" || op == "rule_feedback" || op == "search") {
+            barrier();
+        }
+        if (op == "list_tasks") {
+            x = -1;
+            if (!requireLogin() || !integer(command, "worker_id", x, false, error)) return false;
+            return read(service.listTasks(manager ? x : workerId), slot, prefix);
+        }
+        if (op == "list_task_history") {
+            x = -1;
+            if (!requireLogin() || !integer(command, "worker_id", x, false, error)) return false;
+            return read(service.listTaskHistory(manager ? x : workerId), slot, prefix);
+        }
+        if (op == "list_open_tasks") {
+            if (!requireWorker()) return false;
+            return read(service.listOpenTasks(workerId), slot, prefix);
+        }
+        if (op == "list_tasks_by_status") {
+            if (!requireManager() || !text(command, "status", a, true, error)) return false;
+            return read(service.listTasksByStatus(a), slot, prefix);
+        }
+        if (op == "list_workers") {
+            if (!requireManager()) return false;
+            return read(service.listWorkers(), slot, prefix);
+        }
+        if (op == "list_worker_loads") {
+            if (!requireManager()) return false;
+            return read(service.listWorkerLoads(), slot, prefix);
+        }
+        if (op == "list_rules") {
+            if (!requireLogin()) return false;
+            return read(service.listRules(), slot, prefix);
+        }
+        if (op == "list_schedules") {
+            if (!requireManager()) return false;
+            return read(service.listSchedules(), slot, prefix);
+        }
+        if (op == "list_shifts") {
+            x = -1;
+            if (!requireLogin() || !integer(command, "worker_id", x, manager, error)) return false;
+            return read(service.listShifts(manager ? x : workerId), slot, prefix);
+        }
+        if (op == "list_on_shift") {
+            sqlite3_int64 from = std::time(nullptr);
+            sqlite3_int64 to = 0;
+            if (!requireManager() || !text(command, "site", a, true, error) || !text(command, "from", b, false, error) ||
+                !text(command, "to", c, false, error)) return false;
+            if ((!b.empty() && !core::parseLocalTime(b, from)) || (!c.empty() && !core::parseLocalTime(c, to))) {
+                error = "\"from\" and \"to\" must be YYYY-MM-DD or YYYY-MM-DD HH:MM.";
+                return false;
+            }
+            return read(service.listOnShift(a, from, c.empty() ? from + 1 : to), slot, prefix);
+        }
+        if (op == "list_overdue") {
+            y = 100;
+            if (!requireManager() || !integer(command, "limit", y, false, error)) return false;
+            if (y < 1 || y > 1000) {
+                error = "\"limit\" must be 1-1000.";
+                return false;
+            }
+            return read(service.listOverdue(0, 0, 0, y), slot, prefix);
+        }
+        if (op == "feedback_summaries") {
+            if (!requireLogin()) return false;
+            return read(service.listFeedbackSummaries(), slot, prefix);
+        }
+        if (op == "rule_feedback") {
+            y = 20;
+            if (!requireLogin() || !integer(command, "rule_id", x, true, error) ||
+                !integer(command, "before_id", wide, false, error) || !integer(command, "limit", y, false, error)) {
+                return false;
+            }
+            if (y < 1 || y > 1000) {
+                error = "\"limit\" must be 1-1000.";
+                return false;
+            }
+            return read(service.listRuleFeedback(x, wide, y), slot, prefix);
+        }
+        if (op == "search") {
+            x = -1;
+            if (!requireLogin() || !text(command, "query", a, true, error) ||
+                !integer(command, "worker_id", x, false, error)) return false;
+            return read(service.search(a, manager ? x : workerId), slot, prefix);
+        }
+
+        error = "Unknown op \"" + op + "\".";
+        return false;
+    }
+
+    void reject(const std::shared_ptr<Slot>& slot, std::string prefix, const std::string& error) {
+        status(prefix, false, error);
+        output.fill(slot, false, prefix + "}");
+    }
+
+    /// @brief Adds a write to the current batch.
+    void queue(LocalService::WriteOp write, const std::shared_ptr<Slot>& slot, const std::string& prefix) {
+        if (writes.empty()) {
+            firstWrite = Clock::now();
+        }
+        writes.push_back({std::move(write), slot, prefix});
+        if (writes.size() >= options.maxBatch) {
+            flush();
+        }
+    }
+
+    /// @brief Commits the current batch of writes in one transaction.
+    void flush() {
+        if (writes.empty()) {
+            return;
+        }
+        std::vector<LocalService::WriteOp> ops;
+        auto batch = std::make_shared<std::vector<PendingWrite>>(std::move(writes));
+        writes.clear();
+        ops.reserve(batch->size());
+        for (PendingWrite& pending : *batch) {
+            ops.push_back(std::move(pending.write));
+        }
+
+        beginWrite();
+        service.writeAll(std::move(ops)).then([this, batch](std::vector<core::Result> results) {
+            for (size_t i = 0; i < batch->size(); ++i) {
+                std::string line = (*batch)[i].prefix;
+                body(line, results[i]);
+                output.fill((*batch)[i].slot, results[i].ok, line + "}");
+            }
+            endWrite();
+        });
+    }
+
+    template <typename T>
+    bool read(executor::Task<T> task, const std::shared_ptr<Slot>& slot, const std::string& prefix) {
+        respond(std::move(task), slot, prefix, false);
+        return true;
+    }
+
+    /// @brief Commits pending writes and waits for them, so the next read sees them.
+    void barrier() {
+        flush();
+        waitWrites();
+    }
+
+    template <typename T>
+    void respond(executor::Task<T> task, const std::shared_ptr<Slot>& slot, const std::string& prefix, bool write) {
+        task.then([this, slot, prefix, write](T result) {
+            std::string line = prefix;
+            body(line, result);
+            output.fill(slot, result.ok, line + "}");
+            if (write) endWrite();
+        });
+    }
+
+    void beginWrite() {
+        std::lock_guard<std::mutex> lock(writeMutex);
+        ++writesInFlight;
+    }
+
+    void endWrite() {
+        {
+            std::lock_guard<std::mutex> lock(writeMutex);
+            --writesInFlight;
+        }
+        writesDone.notify_all();
+    }
+
+    void waitWrites() {
+        std::unique_lock<std::mutex> lock(writeMutex);
+        writesDone.wait(lock, [&] { return writesInFlight == 0; });
+    }
+
+    AsyncService& service;
+    Options options;
+    Output output;
+    Session session;
+
+    std::vector<PendingWrite> writes;   ///< Current batch, not yet committed
+    Clock::time_point firstWrite;
+
+    std::mutex writeMutex;
+    std::condition_variable writesDone;
+    int writesInFlight = 0;             ///< Committed batches and reports not yet answered
+};
+
+}  // namespace
+
+Summary run(AsyncService& service, std::istream& in, std::ostream& out, const Options& options) {
+    Runner runner(service, out, options);
+    Summary summary = runner.run(in);
+    logging::info("Batch finished: {} commands, {} failed", summary.commands, summary.failed);
+    return summary;
+}
+
+}  // namespace batch
@@ -0,0 +1,73 @@
+#ifndef BATCH_H_
+#define BATCH_H_
+
+#include "../service/async_service.h"
+#include <cstddef>
+#include <iosfwd>
+
+/**
+ * @namespace batch
+ * @brief Non-interactive batch mode: NDJSON commands in, NDJSON results out.
+ *
+ * Each input line is one command object, e.g.
+ * @code
+ * {"op":"login","username":"erp","password":"..."}
+ * {"op":"assign","worker_id":12,"description":"Inspect boiler 3","ref":"WO-1881"}
+ * {"op":"list_tasks","worker_id":12}
+ * @endcode
+ * and each produces one result line, in input order:
+ * @code
+ * {"seq":2,"op":"assign","ref":"WO-1881","ok":true,"id":5012,"changes":1}
+ * @endcode
+ *
+ * Commands are pipelined: reading continues while earlier commands run.
+ * Consecutive writes are collected for up to the batching window and
+ * committed in one transaction. A read waits only for the writes before it,
+ * so it always sees them; reads between two writes run concurrently. Roles
+ * are enforced as in ehsd: log in first (login and logout apply to the
+ * commands after them), and worker commands act as the logged-in worker.
+ *
+ * Commands: login, logout, register, assign, violation, report, add_rule,
+ * delete_rule, delete_task, feedback, list_tasks, list_task_history, list_open_tasks,
+ * list_tasks_by_status, list_workers, list_rules, feedback_summaries,
+ * rule_feedback, search, add_schedule, list_schedules, delete_schedule,
+ * list_overdue, auto_assign, list_worker_loads, set_availability, add_shift,
+ * delete_shift, list_shifts, list_on_shift. Field names follow the result
+ * structs in core/core.h (worker_id, task_id, rule_id, schedule_id,
+ * shift_id, description, status, comment, report, media_path, text, rating,
+ * before_id, limit, query, available, weight, site); assign and auto_assign
+ * also take an optional local "due" and a "priority" of high, normal
+ * (default) or low, and add_schedule an "interval" such as "daily" or "12h"
+ * and an optional local "first_due" (default now). auto_assign gives the
+ * task to the least-loaded available worker, with a "site" only among those
+ * on shift there between now and the deadline, and returns its ID;
+ * set_availability keeps the worker's weight unless "weight" is given.
+ * add_shift takes local "start" and "end" times at most a day apart, and
+ * list_on_shift a local "from" (default now) and "to" (default the same
+ * instant). list_overdue returns the first "limit" (default 100) overdue
+ * tasks, most urgent first. An optional "ref" of any scalar type is echoed
+ * back unchanged.
+ */
+namespace batch {
+
+/// @brief Batch mode settings.
+struct Options {
+    int windowMs = 0;            ///< Wait this long for more writes; 0 commits whatever has already arrived
+    size_t maxBatch = 500;       ///< Writes committed together at most
+    size_t depth = 1024;         ///< Commands read ahead of the oldest unanswered one
+};
+
+/// @brief Totals for a batch run.
+struct Summary {
+    size_t commands = 0;
+    size_t failed = 0;           ///< Commands whose result has ok=false, malformed ones included
+};
+
+/**
+ * @brief Runs commands from @p in until end of input, writing results to @p out.
+ */
+Summary run(AsyncService& service, std::istream& in, std::ostream& out, const Options& options = Options());
+
+}  // namespace batch
+
+#endif  // BATCH_H_
@@ -0,0 +1,418 @@
+/**
+ * @file bench.cpp
+ * @brief Non-interactive benchmark suite for the EHS management system.
+ *
+ * Seeds a database per requested size (10k, 1M and 10M tasks by default) and
+ * measures throughput and p50/p99 latency of:
+ * - core::hashPassword
+ * - the login path (core::login)
+ * - core::assignTask
+ * - core::autoAssignTasks, one task to the least-loaded worker
+ * - core::reportViolation
+ * - the worker report update (core::submitTaskReport)
+ * - User::viewTaskDetails for one worker and for the manager, with std::cout sent to /dev/null
+ * - the first page of the overdue list (core::listOverdue), every open task being overdue
+ * - task assignment through the ConnectionPool while idle, while online
+ *   backups run back to back, and with the WAL archiver on (backup/backup.h)
+ * - restoring a backup rolled forward through the archived commits
+ *
+ * Read operations are measured with a warm page cache and with a cold one
+ * (the database file is evicted with posix_fadvise and the connection reopened
+ * before every sample). Results are written as JSON.
+ *
+ * Compile from the repository root:
+ * @code
+ * g++ -std=c++20 -O2 bench/bench.cpp datagen/datagen.cpp core/core.cpp metrics/metrics.cpp trace/trace.cpp logging/logging.cpp executor/executor.cpp db/Database.cpp db/ConnectionPool.cpp db/SlowQueryLog.cpp service/service.cpp archive/archive.cpp backup/backup.cpp user/user.cpp -lsqlite3 -lssl -lcrypto -lz -pthread -o ehs_bench
+ * @endcode
+ *
+ * Usage:
+ * @code
+ * ./ehs_bench [--sizes 10000,1000000,10000000] [--dir DIR] [--out results.json]
+ *             [--iterations N] [--list-iterations N] [--cold-iterations N]
+ *             [--seed-threads N] [--no-cold]
+ * @endcode
+ *
+ * Fixtures are produced by the synthetic data generator (datagen/datagen.h),
+ * kept in DIR as bench_<size>.db and reused when they already hold at least
+ * the requested number of tasks.
+ */
+
+#include "../backup/backup.h"
+#include "../core/core.h"
+#include "../datagen/datagen.h"
+#include "../db/ConnectionPool.h"
+#include "../db/Database.h"
+#include "../service/service.h"
+#include "../user/user.h"
+#include <sqlite3.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <ctime>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+/// @brief Benchmark settings taken from the command line.
+struct Options {
+    std::vector<long long> sizes = {10000, 1000000, 10000000};
+    std::string dir = ".";
+    std::string out = "bench_results.json";
+    int iterations = 1000;        ///< Samples for point operations
+    int listIterations = 50;      ///< Samples for per-worker listings
+    int coldIterations = 20;      ///< Samples for cold-cache runs
+    int seedThreads = 4;          ///< Producer threads used to generate fixtures
+    bool cold = true;
+};
+
+/// @brief Latency summary of one benchmarked operation.
+struct Measurement {
+    std::string name;
+    std::string cache;            ///< "warm" or "cold"
+    long long tasks = 0;
+    int samples = 0;
+    double opsPerSec = 0;
+    double p50Us = 0;
+    double p99Us = 0;
+    double maxUs = 0;
+};
+
+/// @brief Fixture shape used for a benchmark size; the generator also sets every password.
+GeneratorConfig fixtureConfig(const Options& options, long long tasks) {
+    GeneratorConfig config;
+    config.tasks = tasks;
+    config.feedback = tasks / 10;
+    config.threads = options.seedThreads;
+    config.password = "bench-password";
+    return config;
+}
+
+/// @brief Counts the rows of a table, or -1 if the database is not usable.
+long long countRows(sqlite3* db, const char* table) {
+    std::string sql = std::string("SELECT count(*) FROM ") + table + ";";
+    sqlite3_stmt* stmt = nullptr;
+    long long count = -1;
+    if (sqlite3_prepare_v2(db, sql.c_str(), -1, &stmt, nullptr) == SQLITE_OK && sqlite3_step(stmt) == SQLITE_ROW) {
+        count = sqlite3_column_int64(stmt, 0);
+    }
+    sqlite3_finalize(stmt);
+    return count;
+}
+
+/// @brief Looks up the worker a task is assigned to (untimed helper).
+int taskWorker(sqlite3* db, int taskId) {
+    sqlite3_stmt* stmt = nullptr;
+    int workerId = -1;
+    if (sqlite3_prepare_v2(db, "SELECT worker_id FROM tasks WHERE id = ?;", -1, &stmt, nullptr) == SQLITE_OK) {
+        sqlite3_bind_int(stmt, 1, taskId);
+        if (sqlite3_step(stmt) == SQLITE_ROW) {
+            workerId = sqlite3_column_int(stmt, 0);
+        }
+    }
+    sqlite3_finalize(stmt);
+    return workerId;
+}
+
+/// @brief Evicts a file from the OS page cache.
+void evictFromPageCache(const std::string& path) {
+    for (const std::string& file : {path, path + "-wal"}) {
+        int fd = open(file.c_str(), O_RDONLY);
+        if (fd < 0) continue;
+        fdatasync(fd);
+        posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+        close(fd);
+    }
+}
+
+/// @brief Turns raw per-sample latencies into a Measurement.
+Measurement summarize(const std::string& name, const std::string& cache, long long tasks,
+                      std::vector<double>& latenciesUs, double totalSeconds) {
+    Measurement m;
+    m.name = name;
+    m.cache = cache;
+    m.tasks = tasks;
+    m.samples = static_cast<int>(latenciesUs.size());
+    if (latenciesUs.empty()) return m;
+
+    std::sort(latenciesUs.begin(), latenciesUs.end());
+    auto percentile = [&](double p) {
+        size_t index = static_cast<size_t>(p * (latenciesUs.size() - 1) + 0.5);
+        return latenciesUs[index];
+    };
+    m.p50Us = percentile(0.50);
+    m.p99Us = percentile(0.99);
+    m.maxUs = latenciesUs.back();
+    m.opsPerSec = totalSeconds > 0 ? latenciesUs.size() / totalSeconds : 0;
+    return m;
+}
+
+/**
+ * @brief Runs an operation a number of times and records each call's latency.
+ *
+ * @param op Operation to time; receives the sample index.
+ * @param before Optional untimed step run before every sample (cold-cache reset).
+ */
+Measurement measure(const std::string& name, const std::string& cache, long long tasks, int samples,
+                    const std::function<void(int)>& op, const std::function<void()>& before = nullptr) {
+    using Clock = std::chrono::steady_clock;
+    std::vector<double> latencies;
+    latencies.reserve(samples);
+    double total = 0;
+
+    for (int i = 0; i < samples; ++i) {
+        if (before) before();
+        auto start = Clock::now();
+        op(i);
+        double us = std::chrono::duration<double, std::micro>(Clock::now() - start).count();
+        latencies.push_back(us);
+        total += us / 1e6;
+    }
+
+    Measurement m = summarize(name, cache, tasks, latencies, total);
+    std::cerr << "  " << name << " [" << cache << "] p50=" << m.p50Us << "us p99=" << m.p99Us
+              << "us ops/s=" << m.opsPerSec << "\n";
+    return m;
+}
+
+/// @brief Benchmarks every operation against one seeded database.
+void runSize(const Options& options, long long tasks, std::vector<Measurement>& results) {
+    std::string path = options.dir + "/bench_" + std::to_string(tasks) + ".db";
+    GeneratorConfig fixture = fixtureConfig(options, tasks);
+    int workers = generatedWorkerCount(fixture);
+    const std::string password = fixture.password;
+
+    auto* dbManager = new DatabaseManager(path);
+    dbManager->setupTables();
+    sqlite3* db = dbManager->getDB();
+
+    // Benchmarked writes add tasks, so a previously seeded file may hold a few more
+    if (countRows(db, "tasks") < tasks) {
+        delete dbManager;
+        std::filesystem::remove(path);
+        std::filesystem::remove(path + "-wal");
+        std::filesystem::remove(path + "-shm");
+        std::cerr << "Seeding " << path << " with " << tasks << " tasks\n";
+        if (!generateDataset(path, fixture)) {
+            return;
+        }
+        dbManager = new DatabaseManager(path);
+        dbManager->setupTables();
+        db = dbManager->getDB();
+    }
+
+    std::cerr << "Benchmarking " << tasks << " tasks (" << workers << " workers)\n";
+    std::mt19937 rng(42);
+    auto randomTask = [&]() { return static_cast<int>(rng() % tasks) + 1; };
+    int reportTask = 0;
+    int reportWorker = 0;
+    auto pickReportTask = [&]() {
+        reportTask = randomTask();
+        reportWorker = taskWorker(db, reportTask);
+    };
+
+    std::ofstream devNull("/dev/null");
+    std::streambuf* savedCout = std::cout.rdbuf();
+    User viewer;
+    // The menus read through a LocalService over a ConnectionPool, so the listing benchmarks do too
+    std::unique_ptr<ConnectionPool> pool(new ConnectionPool(db, path));
+    std::unique_ptr<LocalService> service(new LocalService(*pool));
+
+    // Read-only operations, warm cache
+    results.push_back(measure("hashPassword", "warm", tasks, options.iterations * 10,
+                              [&](int) { core::hashPassword(password); }));
+    results.push_back(measure("login", "warm", tasks, options.iterations, [&](int i) {
+        core::login(db, generatedWorkerName(i % workers + 1), password);
+    }));
+    std::cout.rdbuf(devNull.rdbuf());
+    results.push_back(measure("viewTaskDetails.worker", "warm", tasks, options.listIterations, [&](int i) {
+        viewer.viewTaskDetails(*service, i % workers + 1, false);
+    }));
+    results.push_back(measure("viewTaskDetails.manager", "warm", tasks, std::max(1, options.listIterations / 10),
+                              [&](int) { viewer.viewTaskDetails(*service, 0, true); }));
+    std::cout.rdbuf(savedCout);
+    results.push_back(measure("listOverdue", "warm", tasks, options.listIterations, [&](int) {
+        core::listOverdue(db, std::time(nullptr), 0, 0, 0, 20);
+    }));
+
+    // Write operations
+    std::string mediaPath = options.dir + "/bench_media.jpg";
+    std::ofstream(mediaPath) << std::string(64 * 1024, 'x');
+
+    results.push_back(measure("assignTask", "warm", tasks, options.iterations, [&](int i) {
+        core::assignTask(db, i % workers + 1, "Benchmark task " + std::to_string(i));
+    }));
+    results.push_back(measure("autoAssignTasks", "warm", tasks, options.iterations, [&](int i) {
+        core::autoAssignTasks(db, {"Benchmark task " + std::to_string(i)});
+    }));
+    results.push_back(measure("reportViolation", "warm", tasks, options.iterations, [&](int) {
+        core::reportViolation(db, randomTask(), "violation", "No harness worn on platform");
+    }));
+    results.push_back(measure("submitTaskReport", "warm", tasks, options.iterations, [&](int) {
+        core::submitTaskReport(db, reportTask, reportWorker, "Completed inspection, all clear.", mediaPath);
+    }, pickReportTask));
+
+    // Backup impact on the write path, which the menus reach through the pool
+    results.push_back(measure("assignTask.pool", "warm", tasks, options.iterations, [&](int i) {
+        service->assignTask(i % workers + 1, "Benchmark task " + std::to_string(i));
+    }));
+    std::string backupPath = options.dir + "/bench_backup.db";
+    std::atomic<bool> backingUp(true);
+    int backups = 0;
+    std::thread backupThread([&]() {
+        while (backingUp.load()) {
+            if (backup::run(path, backupPath).ok) ++backups;
+        }
+    });
+    results.push_back(measure("assignTask.pool.duringBackup", "warm", tasks, options.iterations, [&](int i) {
+        service->assignTask(i % workers + 1, "Benchmark task " + std::to_string(i));
+    }));
+    backingUp = false;
+    backupThread.join();
+    std::cerr << "  (" << backups << " backups completed meanwhile)\n";
+
+    std::string archiveDir = options.dir + "/bench_wal_archive";
+    std::filesystem::remove_all(archiveDir);
+    backup::WalArchiver archiver(archiveDir);
+    std::string archiveError;
+    if (archiver.start(*pool, archiveError)) {
+        backup::Options backupOptions;
+        backupOptions.walArchiveDir = archiveDir;
+        backup::run(path, backupPath, backupOptions);
+        results.push_back(measure("assignTask.pool.walArchive", "warm", tasks, options.iterations, [&](int i) {
+            service->assignTask(i % workers + 1, "Benchmark task " + std::to_string(i));
+        }));
+        archiver.stop();
+        std::string restorePath = options.dir + "/bench_restored.db";
+        results.push_back(measure("restore", "warm", tasks, 1, [&](int) {
+            backup::RestoreSummary restored = backup::restore(backupPath, archiveDir, restorePath);
+            std::cerr << "  restore replayed " << restored.commits << " commits, " << restored.frames
+                      << " pages" << (restored.ok ? "" : " (failed: " + restored.error + ")") << "\n";
+        }));
+        std::filesystem::remove(restorePath);
+    } else {
+        std::cerr << "  WAL archiver not started: " << archiveError << "\n";
+    }
+    std::filesystem::remove(backupPath);
+    std::filesystem::remove(backupPath + ".wal-segment");
+    std::filesystem::remove_all(archiveDir);
+
+    // Read-only operations, cold cache: evict and reopen before every sample
+    if (options.cold) {
+        auto reopenCold = [&]() {
+            service.reset();
+            pool.reset();
+            delete dbManager;
+            evictFromPageCache(path);
+            dbManager = new DatabaseManager(path);
+            db = dbManager->getDB();
+            pool.reset(new ConnectionPool(db, path));
+            service.reset(new LocalService(*pool));
+        };
+        results.push_back(measure("login", "cold", tasks, options.coldIterations, [&](int i) {
+            core::login(db, generatedWorkerName(i % workers + 1), password);
+        }, reopenCold));
+        std::cout.rdbuf(devNull.rdbuf());
+        results.push_back(measure("viewTaskDetails.worker", "cold", tasks, options.coldIterations, [&](int i) {
+            viewer.viewTaskDetails(*service, i % workers + 1, false);
+        }, reopenCold));
+        results.push_back(measure("viewTaskDetails.manager", "cold", tasks, std::max(1, options.coldIterations / 10),
+                                  [&](int) { viewer.viewTaskDetails(*service, 0, true); }, reopenCold));
+        std::cout.rdbuf(savedCout);
+    }
+
+    service.reset();
+    pool.reset();
+    delete dbManager;
+}
+
+std::vector<long long> parseSizes(const std::string& list) {
+    std::vector<long long> sizes;
+    std::stringstream ss(list);
+    std::string item;
+    while (std::getline(ss, item, ',')) {
+        if (!item.empty()) sizes.push_back(std::atoll(item.c_str()));
+    }
+    return sizes;
+}
+
+bool parseOptions(int argc, char** argv, Options& options) {
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (arg == "--sizes" && hasValue) {
+            options.sizes = parseSizes(argv[++i]);
+        } else if (arg == "--dir" && hasValue) {
+            options.dir = argv[++i];
+        } else if (arg == "--out" && hasValue) {
+            options.out = argv[++i];
+        } else if (arg == "--iterations" && hasValue) {
+            options.iterations = std::atoi(argv[++i]);
+        } else if (arg == "--list-iterations" && hasValue) {
+            options.listIterations = std::atoi(argv[++i]);
+        } else if (arg == "--cold-iterations" && hasValue) {
+            options.coldIterations = std::atoi(argv[++i]);
+        } else if (arg == "--seed-threads" && hasValue) {
+            options.seedThreads = std::atoi(argv[++i]);
+        } else if (arg == "--no-cold") {
+            options.cold = false;
+        } else {
+            std::cerr << "Unknown or incomplete option: " << arg << "\n";
+            return false;
+        }
+    }
+    return !options.sizes.empty() && options.iterations > 0 && options.listIterations > 0 && options.coldIterations > 0;
+}
+
+void writeJson(const std::string& path, const std::vector<Measurement>& results) {
+    std::ofstream out(path);
+    out << "{\n  \"results\": [\n";
+    for (size_t i = 0; i < results.size(); ++i) {
+        const Measurement& m = results[i];
+        out << "    {\"operation\": \"" << m.name << "\", \"cache\": \"" << m.cache << "\", \"tasks\": " << m.tasks
+            << ", \"samples\": " << m.samples << ", \"ops_per_sec\": " << m.opsPerSec
+            << ", \"p50_us\": " << m.p50Us << ", \"p99_us\": " << m.p99Us << ", \"max_us\": " << m.maxUs << "}"
+            << (i + 1 < results.size() ? "," : "") << "\n";
+    }
+    out << "  ]\n}\n";
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    Options options;
+    if (!parseOptions(argc, argv, options)) {
+        std::cerr << "Usage: ehs_bench [--sizes 10000,1000000,10000000] [--dir DIR] [--out FILE]\n"
+                     "                 [--iterations N] [--list-iterations N] [--cold-iterations N]\n"
+                     "                 [--seed-threads N] [--no-cold]\n";
+        return 1;
+    }
+
+    std::filesystem::create_directories(options.dir);
+    std::string out = std::filesystem::absolute(options.out).string();
+    options.dir = std::filesystem::absolute(options.dir).string();
+
+    // core::submitTaskReport copies media into ./uploads, keep it inside the bench directory
+    std::filesystem::current_path(options.dir);
+
+    std::vector<Measurement> results;
+    for (long long tasks : options.sizes) {
+        runSize(options, tasks, results);
+    }
+
+    writeJson(out, results);
+    std::cerr << "Results written to " << out << "\n";
+    return 0;
+}
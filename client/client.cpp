@@ -0,0 +1,380 @@
+/**
+ * @file client.cpp
+ * @brief Implementation of RemoteService (the ehsd client side of protocol/protocol.h).
+ *
+ */
+
+#include "client.h"
+#include "../protocol/protocol.h"
+#include <algorithm>
+#include <arpa/inet.h>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+namespace {
+
+template <typename T>
+T lost(const std::string& error) {
+    T result;
+    result.ok = false;
+    result.error = error;
+    return result;
+}
+
+}  // namespace
+
+RemoteService::~RemoteService() {
+    if (fd >= 0) {
+        close(fd);
+    }
+}
+
+bool RemoteService::connectUnix(const std::string& path) {
+    sockaddr_un address{};
+    if (path.size() >= sizeof(address.sun_path)) {
+        return false;
+    }
+    address.sun_family = AF_UNIX;
+    std::strcpy(address.sun_path, path.c_str());
+
+    int socketFd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (socketFd < 0 || connect(socketFd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0) {
+        if (socketFd >= 0) close(socketFd);
+        return false;
+    }
+    std::lock_guard<std::mutex> lock(mutex);
+    fd = socketFd;
+    return true;
+}
+
+bool RemoteService::connectTcp(const std::string& host, int port) {
+    addrinfo hints{};
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    addrinfo* found = nullptr;
+    if (getaddrinfo(host.c_str(), std::to_string(port).c_str(), &hints, &found) != 0) {
+        return false;
+    }
+
+    int socketFd = -1;
+    for (addrinfo* candidate = found; candidate; candidate = candidate->ai_next) {
+        socketFd = socket(candidate->ai_family, candidate->ai_socktype | SOCK_CLOEXEC, candidate->ai_protocol);
+        if (socketFd >= 0 && connect(socketFd, candidate->ai_addr, candidate->ai_addrlen) == 0) {
+            break;
+        }
+        if (socketFd >= 0) close(socketFd);
+        socketFd = -1;
+    }
+    freeaddrinfo(found);
+    if (socketFd < 0) {
+        return false;
+    }
+    int on = 1;
+    setsockopt(socketFd, IPPROTO_TCP, TCP_NODELAY, &on, sizeof(on));
+    std::lock_guard<std::mutex> lock(mutex);
+    fd = socketFd;
+    return true;
+}
+
+template <typename T>
+T RemoteService::call(const std::string& request) {
+    std::lock_guard<std::mutex> lock(mutex);
+    std::string response;
+    if (fd < 0 || !protocol::sendFrame(fd, request) || !protocol::recvFrame(fd, response)) {
+        if (fd >= 0) {
+            close(fd);
+            fd = -1;
+        }
+        return lost<T>("Connection to ehsd lost.");
+    }
+    T result;
+    protocol::Reader in(response);
+    if (!protocol::get(in, result) || !in.done()) {
+        return lost<T>("Malformed response from ehsd.");
+    }
+    return result;
+}
+
+core::Result RemoteService::registerUser(const std::string& username, const std::string& password,
+                                         const std::string& role) {
+    protocol::Writer out;
+    out.putOp(protocol::Op::Register);
+    out.putString(username);
+    out.putString(password);
+    out.putString(role);
+    return call<core::Result>(out.data());
+}
+
+core::LoginResult RemoteService::login(const std::string& username, const std::string& password) {
+    protocol::Writer out;
+    out.putOp(protocol::Op::Login);
+    out.putString(username);
+    out.putString(password);
+    return call<core::LoginResult>(out.data());
+}
+
+void RemoteService::logout() {
+    protocol::Writer out;
+    out.putOp(protocol::Op::Logout);
+    call<core::Result>(out.data());
+}
+
+core::Rows<core::TaskRecord> RemoteService::listTaskPages(protocol::Op op, int workerId, int afterId, int limit) {
+    core::Rows<core::TaskRecord> result;
+    while (limit < 0 || static_cast<int>(result.rows.size()) < limit) {
+        int pageRows = limit < 0 ? protocol::kMaxPage : limit - static_cast<int>(result.rows.size());
+        protocol::Writer out;
+        out.putOp(op);
+        out.putInt(workerId);
+        out.putInt(afterId);
+        out.putInt(std::min(pageRows, protocol::kMaxPage));
+        core::Rows<core::TaskRecord> page = call<core::Rows<core::TaskRecord>>(out.data());
+        if (!page.ok) {
+            return page;
+        }
+        bool full = page.rows.size() == static_cast<size_t>(std::min(pageRows, protocol::kMaxPage));
+        if (!page.rows.empty()) {
+            afterId = page.rows.back().id;
+        }
+        result.rows.insert(result.rows.end(), std::make_move_iterator(page.rows.begin()),
+                           std::make_move_iterator(page.rows.end()));
+        if (!full) {
+            break;
+        }
+    }
+    return result;
+}
+
+core::Rows<core::TaskRecord> RemoteService::listTasks(int workerId, int afterId, int limit) {
+    return listTaskPages(protocol::Op::ListTasks, workerId, afterId, limit);
+}
+
+core::Rows<core::TaskRecord> RemoteService::listTaskHistory(int workerId, int afterId, int limit) {
+    return listTaskPages(protocol::Op::ListTaskHistory, workerId, afterId, limit);
+}
+
+core::Rows<core::TaskRecord> RemoteService::listOpenTasks(int workerId) {
+    protocol::Writer out;
+    out.putOp(protocol::Op::ListOpenTasks);
+    out.putInt(workerId);
+    return call<core::Rows<core::TaskRecord>>(out.data());
+}
+
+core::Rows<core::TaskRecord> RemoteService::listTasksByStatus(const std::string& status) {
+    protocol::Writer out;
+    out.putOp(protocol::Op::ListTasksByStatus);
+    out.putString(status);
+    return call<core::Rows<core::TaskRecord>>(out.data());
+}
+
+core::Rows<core::WorkerRecord> RemoteService::listWorkers() {
+    protocol::Writer out;
+    out.putOp(protocol::Op::ListWorkers);
+    return call<core::Rows<core::WorkerRecord>>(out.data());
+}
+
+core::Rows<core::RuleRecord> RemoteService::listRules() {
+    protocol::Writer out;
+    out.putOp(protocol::Op::ListRules);
+    return call<core::Rows<core::RuleRecord>>(out.data());
+}
+
+core::Result RemoteService::assignTask(int workerId, const std::string& description, sqlite3_int64 dueAt,
+                                       int priority) {
+    protocol::Writer out;
+    out.putOp(protocol::Op::AssignTask);
+    out.putInt(workerId);
+    out.putString(description);
+    out.putInt(dueAt);
+    out.putInt(priority);
+    return call<core::Result>(out.data());
+}
+
+core::Result RemoteService::reportViolation(int taskId, const std::string& status, const std::string& comment) {
+    protocol::Writer out;
+    out.putOp(protocol::Op::ReportViolation);
+    out.putInt(taskId);
+    out.putString(status);
+    out.putString(comment);
+    return call<core::Result>(out.data());
+}
+
+core::Result RemoteService::submitTaskReport(int taskId, int workerId, const std::string& report,
+                                             const std::string& mediaPath) {
+    std::ifstream media(mediaPath, std::ios::binary);
+    if (!media) {
+        return lost<core::Result>("Failed to save media: could not read " + mediaPath);
+    }
+    std::string data((std::istreambuf_iterator<char>(media)), std::istreambuf_iterator<char>());
+    if (data.size() + report.size() + 64 > protocol::kMaxFrame) {
+        return lost<core::Result>("Failed to save media: file is larger than the upload limit.");
+    }
+
+    protocol::Writer out;
+    out.putOp(protocol::Op::SubmitTaskReport);
+    out.putInt(taskId);
+    out.putInt(workerId);
+    out.putString(report);
+    out.putString(data);
+    return call<core::Result>(out.data());
+}
+
+core::Result RemoteService::addRule(const std::string& text) {
+    protocol::Writer out;
+    out.putOp(protocol::Op::AddRule);
+    out.putString(text);
+    return call<core::Result>(out.data());
+}
+
+core::Result RemoteService::deleteRule(int ruleId) {
+    protocol::Writer out;
+    out.putOp(protocol::Op::DeleteRule);
+    out.putInt(ruleId);
+    return call<core::Result>(out.data());
+}
+
+core::Result RemoteService::deleteTask(int taskId) {
+    protocol::Writer out;
+    out.putOp(protocol::Op::DeleteTask);
+    out.putInt(taskId);
+    return call<core::Result>(out.data());
+}
+
+core::Result RemoteService::submitRuleFeedback(int ruleId, int workerId, int rating, const std::string& text) {
+    protocol::Writer out;
+    out.putOp(protocol::Op::SubmitRuleFeedback);
+    out.putInt(ruleId);
+    out.putInt(workerId);
+    out.putInt(rating);
+    out.putString(text);
+    return call<core::Result>(out.data());
+}
+
+core::Rows<core::FeedbackSummary> RemoteService::listFeedbackSummaries() {
+    protocol::Writer out;
+    out.putOp(protocol::Op::ListFeedbackSummaries);
+    return call<core::Rows<core::FeedbackSummary>>(out.data());
+}
+
+core::Rows<core::FeedbackRecord> RemoteService::listRuleFeedback(int ruleId, sqlite3_int64 beforeId, int limit) {
+    protocol::Writer out;
+    out.putOp(protocol::Op::ListRuleFeedback);
+    out.putInt(ruleId);
+    out.putInt(beforeId);
+    out.putInt(limit);
+    return call<core::Rows<core::FeedbackRecord>>(out.data());
+}
+
+core::SearchResult RemoteService::search(const std::string& query, int workerId) {
+    protocol::Writer out;
+    out.putOp(protocol::Op::Search);
+    out.putString(query);
+    out.putInt(workerId);
+    return call<core::SearchResult>(out.data());
+}
+
+core::Result RemoteService::addSchedule(int workerId, const std::string& description, sqlite3_int64 intervalSeconds,
+                                        sqlite3_int64 firstDue) {
+    protocol::Writer out;
+    out.putOp(protocol::Op::AddSchedule);
+    out.putInt(workerId);
+    out.putString(description);
+    out.putInt(intervalSeconds);
+    out.putInt(firstDue);
+    return call<core::Result>(out.data());
+}
+
+core::Rows<core::ScheduleRecord> RemoteService::listSchedules() {
+    protocol::Writer out;
+    out.putOp(protocol::Op::ListSchedules);
+    return call<core::Rows<core::ScheduleRecord>>(out.data());
+}
+
+core::Result RemoteService::deleteSchedule(int scheduleId) {
+    protocol::Writer out;
+    out.putOp(protocol::Op::DeleteSchedule);
+    out.putInt(scheduleId);
+    return call<core::Result>(out.data());
+}
+
+core::Rows<core::TaskRecord> RemoteService::listOverdue(int afterPriority, sqlite3_int64 afterDue, int afterId,
+                                                        int limit) {
+    protocol::Writer out;
+    out.putOp(protocol::Op::ListOverdue);
+    out.putInt(afterPriority);
+    out.putInt(afterDue);
+    out.putInt(afterId);
+    out.putInt(limit);
+    return call<core::Rows<core::TaskRecord>>(out.data());
+}
+
+core::Rows<core::TaskRecord> RemoteService::autoAssignTasks(const std::vector<std::string>& descriptions,
+                                                            sqlite3_int64 dueAt, int priority, const std::string& site) {
+    protocol::Writer out;
+    out.putOp(protocol::Op::AutoAssignTasks);
+    out.putInt(static_cast<sqlite3_int64>(descriptions.size()));
+    for (const std::string& description : descriptions) {
+        out.putString(description);
+    }
+    out.putInt(dueAt);
+    out.putInt(priority);
+    out.putString(site);
+    return call<core::Rows<core::TaskRecord>>(out.data());
+}
+
+core::Rows<core::WorkerLoad> RemoteService::listWorkerLoads() {
+    protocol::Writer out;
+    out.putOp(protocol::Op::ListWorkerLoads);
+    return call<core::Rows<core::WorkerLoad>>(out.data());
+}
+
+core::Result RemoteService::setWorkerAvailability(int workerId, bool available, int weight) {
+    protocol::Writer out;
+    out.putOp(protocol::Op::SetWorkerAvailability);
+    out.putInt(workerId);
+    out.putBool(available);
+    out.putInt(weight);
+    return call<core::Result>(out.data());
+}
+
+core::Result RemoteService::addShift(int workerId, const std::string& site, sqlite3_int64 startsAt,
+                                     sqlite3_int64 endsAt) {
+    protocol::Writer out;
+    out.putOp(protocol::Op::AddShift);
+    out.putInt(workerId);
+    out.putString(site);
+    out.putInt(startsAt);
+    out.putInt(endsAt);
+    return call<core::Result>(out.data());
+}
+
+core::Result RemoteService::deleteShift(int shiftId) {
+    protocol::Writer out;
+    out.putOp(protocol::Op::DeleteShift);
+    out.putInt(shiftId);
+    return call<core::Result>(out.data());
+}
+
+core::Rows<core::ShiftRecord> RemoteService::listShifts(int workerId) {
+    protocol::Writer out;
+    out.putOp(protocol::Op::ListShifts);
+    out.putInt(workerId);
+    return call<core::Rows<core::ShiftRecord>>(out.data());
+}
+
+core::Rows<core::ShiftRecord> RemoteService::listOnShift(const std::string& site, sqlite3_int64 from,
+                                                         sqlite3_int64 to) {
+    protocol::Writer out;
+    out.putOp(protocol::Op::ListOnShift);
+    out.putString(site);
+    out.putInt(from);
+    out.putInt(to);
+    return call<core::Rows<core::ShiftRecord>>(out.data());
+}
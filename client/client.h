@@ -0,0 +1,88 @@
+#ifndef CLIENT_H_
+#define CLIENT_H_
+
+#include "../protocol/protocol.h"
+#include "../service/service.h"
+#include <mutex>
+#include <string>
+
+/**
+ * @class RemoteService
+ * @brief Service that forwards every call to ehsd over one socket.
+ *
+ * Calls are serialized on the connection, so the background report job and
+ * the menu can share it. If the connection breaks, every call fails with
+ * "Connection to ehsd lost." and the menus report it like any other error.
+ */
+class RemoteService : public Service {
+public:
+    RemoteService() = default;
+    ~RemoteService() override;
+
+    RemoteService(const RemoteService&) = delete;
+    RemoteService& operator=(const RemoteService&) = delete;
+
+    /**
+     * @brief Connects to ehsd's Unix domain socket.
+     */
+    bool connectUnix(const std::string& path);
+
+    /**
+     * @brief Connects to ehsd over TCP, e.g. ("127.0.0.1", 7878).
+     */
+    bool connectTcp(const std::string& host, int port);
+
+    core::Result registerUser(const std::string& username, const std::string& password,
+                              const std::string& role) override;
+    core::LoginResult login(const std::string& username, const std::string& password) override;
+    core::Rows<core::TaskRecord> listTasks(int workerId, int afterId = 0, int limit = -1) override;
+    core::Rows<core::TaskRecord> listTaskHistory(int workerId, int afterId = 0, int limit = -1) override;
+    core::Rows<core::TaskRecord> listOpenTasks(int workerId) override;
+    core::Rows<core::TaskRecord> listTasksByStatus(const std::string& status) override;
+    core::Rows<core::WorkerRecord> listWorkers() override;
+    core::Rows<core::RuleRecord> listRules() override;
+    core::Result assignTask(int workerId, const std::string& description, sqlite3_int64 dueAt = 0,
+                            int priority = 2) override;
+    core::Result reportViolation(int taskId, const std::string& status, const std::string& comment) override;
+
+    /**
+     * @brief Reads the media file locally and uploads it with the report.
+     */
+    core::Result submitTaskReport(int taskId, int workerId, const std::string& report,
+                                  const std::string& mediaPath) override;
+    core::Result addRule(const std::string& text) override;
+    core::Result deleteRule(int ruleId) override;
+    core::Result deleteTask(int taskId) override;
+    core::Result submitRuleFeedback(int ruleId, int workerId, int rating, const std::string& text) override;
+    core::Rows<core::FeedbackSummary> listFeedbackSummaries() override;
+    core::Rows<core::FeedbackRecord> listRuleFeedback(int ruleId, sqlite3_int64 beforeId, int limit) override;
+    core::SearchResult search(const std::string& query, int workerId) override;
+    core::Result addSchedule(int workerId, const std::string& description, sqlite3_int64 intervalSeconds,
+                             sqlite3_int64 firstDue) override;
+    core::Rows<core::ScheduleRecord> listSchedules() override;
+    core::Result deleteSchedule(int scheduleId) override;
+    core::Rows<core::TaskRecord> listOverdue(int afterPriority, sqlite3_int64 afterDue, int afterId,
+                                             int limit) override;
+    core::Rows<core::TaskRecord> autoAssignTasks(const std::vector<std::string>& descriptions, sqlite3_int64 dueAt = 0,
+                                                 int priority = 2, const std::string& site = std::string()) override;
+    core::Rows<core::WorkerLoad> listWorkerLoads() override;
+    core::Result setWorkerAvailability(int workerId, bool available, int weight) override;
+    core::Result addShift(int workerId, const std::string& site, sqlite3_int64 startsAt, sqlite3_int64 endsAt) override;
+    core::Result deleteShift(int shiftId) override;
+    core::Rows<core::ShiftRecord> listShifts(int workerId) override;
+    core::Rows<core::ShiftRecord> listOnShift(const std::string& site, sqlite3_int64 from, sqlite3_int64 to) override;
+    void logout() override;
+
+private:
+    /// @brief Sends a request and decodes the response into result.
+    template <typename T>
+    T call(const std::string& request);
+
+    /// @brief Lists tasks with a paged op; with limit -1, fetches kMaxPage rows at a time until the last page.
+    core::Rows<core::TaskRecord> listTaskPages(protocol::Op op, int workerId, int afterId, int limit);
+
+    std::mutex mutex;
+    int fd = -1;
+};
+
+#endif  // CLIENT_H_
@@ -0,0 +1,77 @@
+/**
+ * @file ehs_client.cpp
+ * @brief Thin terminal client for ehsd with the same menus as the local program.
+ *
+ * Compile from the repository root:
+ * @code
+ * g++ -std=c++20 client/ehs_client.cpp client/client.cpp protocol/protocol.cpp menu/menu.cpp core/core.cpp metrics/metrics.cpp trace/trace.cpp logging/logging.cpp executor/executor.cpp manager/manager.cpp user/user.cpp worker/worker.cpp -lsqlite3 -lssl -lcrypto -pthread -o ehs_client
+ * @endcode
+ *
+ * Usage:
+ * @code
+ * ./ehs_client [--socket ehsd.sock | --tcp HOST:PORT]
+ * @endcode
+ */
+
+#include "client.h"
+#include "../executor/executor.h"
+#include "../logging/logging.h"
+#include "../menu/menu.h"
+#include "../metrics/metrics.h"
+#include "../trace/trace.h"
+#include <cstdlib>
+#include <iostream>
+#include <string>
+
+int main(int argc, char** argv) {
+    const char* socketEnv = std::getenv("EHSD_SOCKET");
+    std::string socketPath = socketEnv ? socketEnv : "ehsd.sock";
+    std::string tcp;
+
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--socket" && i + 1 < argc) {
+            socketPath = argv[++i];
+        } else if (arg == "--tcp" && i + 1 < argc) {
+            tcp = argv[++i];
+        } else {
+            std::cerr << "Usage: " << argv[0] << " [--socket ehsd.sock | --tcp HOST:PORT]\n";
+            return 2;
+        }
+    }
+
+    const char* metricsFile = std::getenv("EHS_METRICS_FILE");
+    metrics::setDumpPath(metricsFile ? metricsFile : "ehs_metrics.prom");
+    metrics::installDumpSignalHandler();
+
+    const char* traceFile = std::getenv("EHS_TRACE_FILE");
+    trace::setExportPath(traceFile ? traceFile : "ehs_trace.json");
+    trace::installExportSignalHandler();
+    trace::setThreadName("main");
+
+    const char* logFile = std::getenv("EHS_LOG_FILE");
+    const char* logLevel = std::getenv("EHS_LOG_LEVEL");
+    logging::start(logFile ? logFile : "ehs_client.log",
+                   logging::parseLevel(logLevel ? logLevel : "", logging::Level::Info));
+
+    const char* threads = std::getenv("EHS_THREADS");
+    executor::start(threads ? std::atoi(threads) : 0);
+
+    RemoteService service;
+    size_t colon = tcp.rfind(':');
+    bool connected = tcp.empty() ? service.connectUnix(socketPath)
+                                 : colon != std::string::npos &&
+                                       service.connectTcp(tcp.substr(0, colon), std::atoi(tcp.c_str() + colon + 1));
+    if (!connected) {
+        logging::error("Cannot connect to ehsd at {}", tcp.empty() ? socketPath : tcp);
+        executor::shutdown();
+        logging::stop();
+        return 1;
+    }
+
+    runMainMenu(service);
+
+    executor::shutdown();
+    logging::stop();
+    return 0;
+}
@@ -1,10 +1,27 @@
 #include <iostream>
 #include "db/Database.h"
-#include "manager/manager.h"
-#include "worker/worker.h"
-#include "user/user.h"
+#include "db/ConnectionPool.h"
+#include "archive/archive.h"
+#include "backup/backup.h"
+#include "batch/batch.h"
+#include "compaction/compaction.h"
+#include "exporter/exporter.h"
+#include "json/json.h"
+#include "menu/menu.h"
+#include "scheduler/deadlines.h"
+#include "scheduler/scheduler.h"
+#include "service/service.h"
+#include "shard/shard.h"
+#include "executor/executor.h"
+#include "logging/logging.h"
+#include "metrics/metrics.h"
+#include "trace/trace.h"
 #include <unistd.h>
 #include <fstream>
+#include <cstdlib>
+#include <algorithm>
+#include <ctime>
+#include <string>
 
 /**
  * @mainpage Environment, Health, and Safety (EHS) Management System
@@ -19,10 +36,48 @@
  * - Task assignment and reporting
  * - Violation reporting
  * - Rule addition, viewing, and feedback
+ * - Full-text search over rules, tasks and worker reports
  * - Multithreading support
+ * - Per-operation latency histograms, dumped in Prometheus text format
+ * - Slow-query log with expanded SQL and query plans
+ * - Asynchronous structured logging to a rotating file
+ * - Trace spans exported as Chrome trace JSON (Perfetto)
+ * - ehsd daemon serving many terminals over a Unix socket or TCP
+ * - Pipelined NDJSON batch mode for scripted clients
+ * - Streaming NDJSON/CSV export of tasks, rules and feedback, optionally gzipped
+ * - Cold archive database for completed tasks, attached for task history
+ * - Online compaction of ehs.db (VACUUM INTO, replay, swap) without downtime
+ * - Online backups and WAL archiving for point-in-time restore
+ * - One database per plant, with violations listed across plants in one merged stream
+ * - Columnar, memory-mapped task snapshots for analytics (ehs_snapshot)
+ * - Federated, I/O-throttled reports over many archived databases (ehs_federate)
+ * - Recurring inspections created by a timer-wheel scheduler (in ehsd, or --run-schedules)
+ * - Task deadlines and priorities; late tasks marked overdue from a deadline heap (in ehsd, or --mark-overdue)
  *
  * @section structure_sec Folder Structure
- * - `db/`: Database connection and setup
+ * - `archive/`: Cold archive of completed tasks (--archive-days)
+ * - `backup/`: Online backup, WAL archiver and point-in-time restore (--backup, --restore)
+ * - `batch/`: NDJSON batch mode (--batch)
+ * - `bench/`: Non-interactive benchmark suite
+ * - `client/`: RemoteService and the ehsd terminal client
+ * - `compaction/`: Online compaction of the database file (--compact)
+ * - `datagen/`: Synthetic production-scale data generator
+ * - `core/`: Headless operations (typed parameters in, result structs out)
+ * - `daemon/`: ehsd, the multi-session server
+ * - `db/`: Database setup, slow-query log and the reader/writer connection pool
+ * - `exporter/`: Streaming NDJSON/CSV export (--export)
+ * - `executor/`: Work-stealing thread pool for background work
+ * - `federation/`: Read-only aggregate reports over many database files (ehs_federate)
+ * - `json/`: Flat JSON parsing and escaping
+ * - `logging/`: Asynchronous ring-buffer logger
+ * - `menu/`: Interactive register/login, worker and manager menus
+ * - `metrics/`: Thread-local latency histograms
+ * - `protocol/`: ehsd request/response encoding
+ * - `scheduler/`: Timer wheel that creates recurring tasks when due (--run-schedules), and the deadline watcher (--mark-overdue)
+ * - `snapshot/`: Columnar task snapshot writer and query engine
+ * - `service/`: The Service interface behind the menus, and LocalService
+ * - `shard/`: Plant-to-database map and cross-plant listings (--plant, --violations)
+ * - `trace/`: Per-thread trace spans and Chrome trace export
  * - `manager/`: Manager class and functions
  * - `worker/`: Worker class and functions
  * - `user/`: Base User class
@@ -30,222 +85,353 @@
  * @section howto_sec How to Compile
  * Compile using:
  * @code
- * g++ code.cpp db/Database.cpp manager/manager.cpp user/user.cpp worker/worker.cpp -lsqlite3 -lssl -lcrypto
+ * g++ -std=c++20 code.cpp core/core.cpp metrics/metrics.cpp trace/trace.cpp logging/logging.cpp executor/executor.cpp db/Database.cpp db/ConnectionPool.cpp db/SlowQueryLog.cpp service/service.cpp service/async_service.cpp batch/batch.cpp json/json.cpp exporter/exporter.cpp archive/archive.cpp compaction/compaction.cpp backup/backup.cpp shard/shard.cpp scheduler/scheduler.cpp scheduler/deadlines.cpp menu/menu.cpp manager/manager.cpp user/user.cpp worker/worker.cpp -lsqlite3 -lssl -lcrypto -lz -pthread
  * @endcode
  *
  * @section usage_sec Usage
- * Run the app and follow the terminal prompts to register/login and perform role-based actions.
+ * Run the app and follow the terminal prompts to register/login and perform role-based actions,
+ * pass `--batch FILE` to run NDJSON commands non-interactively (see batch/batch.h), or
+ * `--export TABLE` to stream a table to standard output (see exporter/exporter.h).
  */
 
 
-void handleWorkerMenu(sqlite3* db, const std::string& username, const std::string& password) {
-    Worker w;
-    int choice;
-    int userId;
-    userId = w.getUserId(db, username, password);
-
-    do {
-        std::cout << "\n--- Worker Menu ---\n";
-        std::cout << "1. View Assigned Tasks\n";
-        std::cout << "2. Report Task Work\n";
-        std::cout << "3. View Safety Rules\n";
-        std::cout << "4. Give Feedback for Rules\n";
-        std::cout << "5. View Feedback of Rules\n";
-        std::cout << "0. Logout\n";
-        std::cout << "Enter choice: ";
-        std::cin >> choice;
-        std::cin.ignore();
-
-        switch (choice) {
-            case 1:
-                w.viewTaskDetails(db, userId);
-                break;
-            case 2:
-                w.reportTaskWork(db, userId);
-                break;
-            case 3:
-                w.viewRules(db);
-                break;
-            case 4:
-                w.GiveRuleFeedback(db);
-                break;
-            case 5:
-                w.ViewRuleFeedback(db);
-                break;
-            case 0:
-                std::cout << "Logging out...\n";
-                break;
-            default:
-                std::cout << "Invalid choice!\n";
+int main(int argc, char** argv) {
+    // --batch FILE (or -) runs NDJSON commands instead of the menus; --export TABLE streams a table out
+    const char* batchFile = nullptr;
+    batch::Options batchOptions;
+    bool exportMode = false;
+    exporter::Options exportOptions;
+    std::string exportPath = "-";
+    bool archiveMode = false;
+    archive::Policy archivePolicy;
+    bool compactMode = false;
+    compaction::Options compactOptions;
+    std::string backupPath, restorePath, restoreTo;
+    std::int64_t restoreUntil = -1;
+    sqlite3_int64 untilSeconds = 0;
+    const char* shardsEnv = std::getenv("EHS_SHARDS");
+    std::string shardMap = shardsEnv ? shardsEnv : "ehs_shards.conf";
+    std::string plant;
+    bool violationsMode = false;
+    shard::ViolationQuery violationQuery;
+    bool schedulesMode = false;
+    scheduler::Options schedulerOptions;
+    bool overdueMode = false;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--batch" && i + 1 < argc) {
+            batchFile = argv[++i];
+        } else if (arg == "--batch-window-ms" && i + 1 < argc) {
+            batchOptions.windowMs = std::atoi(argv[++i]);
+        } else if (arg == "--batch-max" && i + 1 < argc) {
+            batchOptions.maxBatch = static_cast<size_t>(std::max(1, std::atoi(argv[++i])));
+        } else if (arg == "--export" && i + 1 < argc && exporter::parseTable(argv[i + 1], exportOptions.table)) {
+            exportMode = true;
+            ++i;
+        } else if (arg == "--format" && i + 1 < argc && exporter::parseFormat(argv[i + 1], exportOptions.format)) {
+            ++i;
+        } else if (arg == "--gzip") {
+            exportOptions.gzip = true;
+        } else if (arg == "--out" && i + 1 < argc) {
+            exportPath = argv[++i];
+        } else if (arg == "--worker" && i + 1 < argc) {
+            exportOptions.workerId = std::atoi(argv[++i]);
+        } else if (arg == "--status" && i + 1 < argc) {
+            exportOptions.status = argv[++i];
+        } else if (arg == "--rule" && i + 1 < argc) {
+            exportOptions.ruleId = std::atoi(argv[++i]);
+        } else if (arg == "--after-id" && i + 1 < argc) {
+            exportOptions.afterId = std::atoll(argv[++i]);
+        } else if (arg == "--archive-days" && i + 1 < argc) {
+            archiveMode = true;
+            archivePolicy.windowDays = std::max(0, std::atoi(argv[++i]));
+        } else if (arg == "--archive-chunk" && i + 1 < argc) {
+            archivePolicy.chunkRows = std::max(1, std::atoi(argv[++i]));
+        } else if (arg == "--compact") {
+            compactMode = true;
+        } else if (arg == "--incremental-vacuum") {
+            compactOptions.incrementalVacuum = true;
+        } else if (arg == "--backup" && i + 1 < argc) {
+            backupPath = argv[++i];
+        } else if (arg == "--restore" && i + 1 < argc) {
+            restorePath = argv[++i];
+        } else if (arg == "--restore-to" && i + 1 < argc) {
+            restoreTo = argv[++i];
+        } else if (arg == "--until" && i + 1 < argc && core::parseLocalTime(argv[i + 1], untilSeconds)) {
+            restoreUntil = untilSeconds * 1000;
+            ++i;
+        } else if (arg == "--shards" && i + 1 < argc) {
+            shardMap = argv[++i];
+        } else if (arg == "--plant" && i + 1 < argc) {
+            plant = argv[++i];
+        } else if (arg == "--violations") {
+            violationsMode = true;
+        } else if (arg == "--from" && i + 1 < argc) {
+            violationQuery.from = argv[++i];
+        } else if (arg == "--to" && i + 1 < argc) {
+            violationQuery.to = argv[++i];
+        } else if (arg == "--limit" && i + 1 < argc) {
+            violationQuery.limit = std::atoll(argv[++i]);
+        } else if (arg == "--run-schedules") {
+            schedulesMode = true;
+        } else if (arg == "--catch-up" && i + 1 < argc) {
+            schedulerOptions.maxCatchUp = std::max(1, std::atoi(argv[++i]));
+        } else if (arg == "--mark-overdue") {
+            overdueMode = true;
+        } else {
+            std::cerr << "Usage: " << argv[0] << " [--plant NAME] [--shards FILE] ...\n"
+                      << "       " << argv[0] << " [--batch FILE|- [--batch-window-ms N] [--batch-max N]]\n"
+                      << "       " << argv[0] << " --export tasks|rules|feedback [--format ndjson|csv] [--gzip]\n"
+                      << "           [--out FILE] [--worker ID] [--status STATUS] [--rule ID] [--after-id ID]\n"
+                      << "       " << argv[0] << " --archive-days N [--archive-chunk N]\n"
+                      << "       " << argv[0] << " --compact [--incremental-vacuum]\n"
+                      << "       " << argv[0] << " --backup FILE\n"
+                      << "       " << argv[0] << " --restore BACKUP --restore-to FILE [--until TIME]\n"
+                      << "       " << argv[0] << " --violations [--shards FILE] [--from TIME] [--to TIME] [--limit N]\n"
+                      << "       " << argv[0] << " [--run-schedules [--catch-up N]] [--mark-overdue]\n";
+            return 2;
         }
-    } while (choice != 0);
-}
+    }
 
-void handleManagerMenu(sqlite3* db) {
-    Manager m;
-    int choice;
-
-    do {
-        std::cout << "\n--- Manager Menu ---\n";
-        std::cout << "1. Assign Task\n";
-        std::cout << "2. Report Violation\n";
-        std::cout << "3. View Rules\n";
-        std::cout << "4. Add Rule\n";
-        std::cout << "5. View Feedback of rules\n";
-        std::cout << "6. View Assigned Tasks\n";
-        std::cout << "7. Delete the task\n";
-        std::cout << "8. Delete rules\n";
-        std::cout << "0. Logout\n";
-        std::cout << "Enter choice: ";
-        std::cin >> choice;
-        std::cin.ignore();
-
-        switch (choice) {
-            case 1:
-                m.assignTask(db);
-                break;
-            case 2:
-                m.reportViolation(db);
-                break;
-            case 3:
-                m.viewRules(db);
-                break;
-            case 4:
-                m.addRule(db);
-                break;
-            case 5:
-                m.ViewRuleFeedback(db);
-                break;
-            case 6:
-                m.viewTaskDetails(db, 0, true);
-                break;
-            case 7:
-                m.deleteTask(db);
-                break;
-            case 8:
-                m.deleteRule(db);
-                break;
-            case 0:
-                std::cout << "Logging out...\n";
-                break;
-            default:
-                std::cout << "Invalid choice!\n";
-        }
-    } while (choice != 0);
-}
+    // Latency histograms are dumped on demand and on SIGUSR1 (kill -USR1 <pid>)
+    const char* metricsFile = std::getenv("EHS_METRICS_FILE");
+    metrics::setDumpPath(metricsFile ? metricsFile : "ehs_metrics.prom");
+    metrics::installDumpSignalHandler();
 
-void handleRegistration(sqlite3* db, const std::string& username, const std::string& password) {
-    std::string role;
-    while (true) {
-        std::cout << "Enter role (worker/manager): ";
-        std::getline(std::cin, role);
-        if (role.empty()) {
-            std::cout << "Role cannot be empty. Please enter a valid role.\n";
-        } else if (role != "worker" && role != "manager") {
-            std::cout << "Invalid role. Please enter 'worker' or 'manager'.\n";
-        } else {
-            break;
+    // Trace spans are exported as Chrome trace JSON on demand and on SIGUSR2
+    const char* traceFile = std::getenv("EHS_TRACE_FILE");
+    trace::setExportPath(traceFile ? traceFile : "ehs_trace.json");
+    trace::installExportSignalHandler();
+    trace::setThreadName("main");
+
+    // Log records are written by a background thread to EHS_LOG_FILE; errors are also shown on stderr
+    const char* logFile = std::getenv("EHS_LOG_FILE");
+    const char* logLevel = std::getenv("EHS_LOG_LEVEL");
+    logging::start(logFile ? logFile : "ehs.log", logging::parseLevel(logLevel ? logLevel : "", logging::Level::Info));
+
+    // Background work shares one pool; EHS_THREADS caps it (default: one thread per core)
+    const char* threads = std::getenv("EHS_THREADS");
+    executor::start(threads ? std::atoi(threads) : 0);
+
+    // Plants map to database files in the shard map (--shards, EHS_SHARDS, default ehs_shards.conf)
+    std::string dbPath = "ehs.db";
+    std::vector<shard::Plant> plants;
+    if (!plant.empty() || violationsMode) {
+        std::string shardError;
+        if (!shard::loadMap(shardMap, plants, shardError)) {
+            std::cerr << shardError << "\n";
+            executor::shutdown();
+            logging::stop();
+            return 1;
         }
     }
-
-    if (role == "worker") {
-        Worker w;
-        if (w.userExists(db, username, password))
-            std::cout << "User already exists with these credentials!\n";
-        else if (w.registerUser(db, username, password))
-            std::cout << "Registration Successfull!\n";
-        else
-            std::cout << "Registration failed!\n";
-
-    } else if (role == "manager") {
-        Manager m;
-        if (m.userExists(db, username, password))
-            std::cout << "User already exists with these credentials!\n";
-        else if (m.registerUser(db, username, password))
-            std::cout << "Registration Successfull!\n";
-        else
-            std::cout << "Registration failed!\n";
-
-    } else {
-        std::cout << "Invalid role entered!\n";
+    if (!plant.empty()) {
+        auto found = std::find_if(plants.begin(), plants.end(), [&plant](const shard::Plant& p) { return p.name == plant; });
+        if (found == plants.end()) {
+            std::cerr << "Plant " << plant << " is not in " << shardMap << "\n";
+            executor::shutdown();
+            logging::stop();
+            return 1;
+        }
+        dbPath = found->path;
     }
-}
 
-void handleLogin(sqlite3* db, const std::string& username, const std::string& password) {
-    User u;
-    std::string role = u.getUserRole(db, username, password);
-    if (role == "worker") {
-        Worker w;
-        if (w.loginUser(db, username, password)) {
-            std::cout << "Logged in successfully!\n";
-            handleWorkerMenu(db, username, password);
-        } else {
-            std::cout << "Login failed!\n";
+    // --violations lists every plant's violations, newest first, as NDJSON
+    if (violationsMode) {
+        shard::ShardSet shards(plants);
+        std::string shardError;
+        bool ok = shards.open(shardError);
+        if (ok) {
+            shard::ListSummary summary = shard::listViolations(
+                shards, violationQuery, [](const shard::Plant& rowPlant, const core::TaskRecord& task) {
+                    std::cout << "{\"plant\":" << json::quote(rowPlant.name) << ",\"id\":" << task.id
+                              << ",\"worker_id\":" << task.workerId
+                              << ",\"worker_username\":" << json::quote(task.workerUsername)
+                              << ",\"description\":" << json::quote(task.description)
+                              << ",\"violation_timestamp\":" << json::quote(task.violationTimestamp)
+                              << ",\"violation_comment\":" << json::quote(task.violationComment) << "}\n";
+                    return static_cast<bool>(std::cout);
+                });
+            ok = summary.ok;
+            shardError = summary.error;
         }
-    } else if (role == "manager") {
-        Manager m;
-        if (m.loginUser(db, username, password)) {
-            std::cout << "Logged in successfully!\n";
-            handleManagerMenu(db);
+        std::cout.flush();
+        if (!ok) {
+            std::cerr << shardError << "\n";
+        }
+        executor::shutdown();
+        logging::stop();
+        return ok ? 0 : 1;
+    }
+
+    // Commits are archived to EHS_WAL_ARCHIVE, if set, so backups can be rolled forward to a point in time
+    const char* walArchiveEnv = std::getenv("EHS_WAL_ARCHIVE");
+    std::string walArchiveDir = walArchiveEnv ? walArchiveEnv : "";
+
+    // --backup and --restore work on files and never open the database for writing
+    if (!backupPath.empty() || !restorePath.empty()) {
+        bool ok;
+        if (!backupPath.empty()) {
+            backup::Options backupOptions;
+            backupOptions.walArchiveDir = walArchiveDir;
+            backup::Summary summary = backup::run(dbPath, backupPath, backupOptions);
+            ok = summary.ok;
+            if (ok) {
+                std::cout << "Backed up " << summary.pages << " pages to " << backupPath << " in " << summary.seconds
+                          << " s.\n";
+            } else {
+                std::cerr << summary.error << "\n";
+            }
+        } else if (restoreTo.empty()) {
+            std::cerr << "--restore needs --restore-to FILE\n";
+            ok = false;
         } else {
-            std::cout << "Login failed!\n";
+            backup::RestoreSummary summary = backup::restore(restorePath, walArchiveDir, restoreTo, restoreUntil);
+            ok = summary.ok;
+            if (ok) {
+                std::cout << "Restored " << restoreTo << ": replayed " << summary.commits << " commits ("
+                          << summary.frames << " pages) in " << summary.seconds << " s.\n";
+            } else {
+                std::cerr << summary.error << "\n";
+            }
         }
-    } else {
-        std::cout << "Invalid credentials!\n";
+        executor::shutdown();
+        logging::stop();
+        return ok ? 0 : 1;
     }
-}
 
-int main() {
-    DatabaseManager dbManager("ehs.db");
+    DatabaseManager dbManager(dbPath);
     dbManager.setupTables();
-    sqlite3* db = dbManager.getDB();
 
-    int choice;
+    // Statements slower than EHS_SLOW_QUERY_MS go to EHS_SLOW_QUERY_LOG
+    const char* slowQueryMs = std::getenv("EHS_SLOW_QUERY_MS");
+    if (slowQueryMs) {
+        const char* slowQueryLog = std::getenv("EHS_SLOW_QUERY_LOG");
+        dbManager.enableSlowQueryLog(slowQueryLog ? slowQueryLog : "ehs_slow_queries.log", std::atof(slowQueryMs));
+    }
 
-    while (true) {
-        std::cout << "\n=== EHS System ===\n";
-        std::cout << "1. Register\n2. Login\n0. Exit\nChoice: ";
-        std::cin >> choice;
-        std::cin.ignore();
+    // Completed tasks moved out by --archive-days live in EHS_ARCHIVE_DB (default: ehs_archive.db next to
+    // ehs.db, <plant db>_archive.db for a plant), attached to every connection
+    const char* archiveEnv = std::getenv("EHS_ARCHIVE_DB");
+    std::string archiveFile = archiveEnv ? archiveEnv : archive::defaultPath(dbPath);
+    std::string archiveError;
+    bool archived = archive::attach(dbManager.getDB(), archiveFile, true, archiveError);
+    if (!archived) {
+        logging::error("{}", archiveError);
+    }
 
-        if (choice == 0) {
-            std::cout << "Exiting...\n";
-            break;
+    // Read connections, and the slow-query log's plan connection, see the archive too
+    auto attachArchive = [archived, archiveFile](sqlite3* connection) {
+        std::string error;
+        if (archived && !archive::attach(connection, archiveFile, false, error)) {
+            logging::error("{}", error);
         }
+    };
+    dbManager.preparePlanConnection(attachArchive);
 
-        std::string username, password;
+    // Writes run on one writer thread; reads borrow one of the WAL read connections for each call
+    const char* readers = std::getenv("EHS_DB_READERS");
+    ConnectionPool db(dbManager.getDB(), dbPath, readers ? std::atoi(readers) : 8,
+                      [&dbManager, attachArchive](sqlite3* reader) {
+                          dbManager.traceConnection(reader);
+                          attachArchive(reader);
+                      });
+
+    backup::WalArchiver walArchiver(walArchiveDir);
+    std::string walArchiveError;
+    if (!walArchiveDir.empty() && !walArchiver.start(db, walArchiveError)) {
+        logging::error("{}", walArchiveError);
+    }
+
+    if (archiveMode) {
+        archive::Summary summary = archive::run(db, archivePolicy);
+        std::cout << "Archived " << summary.moved << " tasks in " << summary.chunks << " chunks.\n";
+        if (!summary.ok) {
+            std::cerr << summary.error << "\n";
+        }
+        executor::shutdown();
+        logging::stop();
+        return summary.ok ? 0 : 1;
+    }
 
-        while (true) {
-            std::cout << "Username: ";
-            std::getline(std::cin, username);
-            if (username.empty()) {
-                std::cout << "Username cannot be empty. Please enter a valid username.\n";
+    if (compactMode) {
+        compaction::Summary summary = compaction::run(db, compactOptions);
+        if (summary.ok) {
+            std::cout << "Compacted " << dbPath << " from " << summary.bytesBefore << " to " << summary.bytesAfter
+                      << " bytes; writes were held for " << summary.quiesceMs << " ms.\n";
+        } else {
+            std::cerr << summary.error << "\n";
+        }
+        executor::shutdown();
+        logging::stop();
+        return summary.ok ? 0 : 1;
+    }
+
+    if (exportMode) {
+        exporter::Summary summary = exporter::run(db.reader(), exportOptions, exportPath);
+        if (!summary.ok) {
+            std::cerr << summary.error << "\n";
+        }
+        executor::shutdown();
+        logging::stop();
+        return summary.ok ? 0 : 1;
+    }
+
+    LocalService service(db);
+    if (schedulesMode || overdueMode) {
+        // Without ehsd, cron runs this to create the recurring tasks that are due and mark late tasks
+        bool ok = true;
+        std::string error;
+        if (schedulesMode) {
+            scheduler::Scheduler schedules(service, schedulerOptions);
+            ok = schedules.load(error);
+            if (ok) {
+                schedules.runDue(std::time(nullptr));
+                scheduler::Stats stats = schedules.stats();
+                std::cout << "Created " << stats.tasksCreated << " recurring tasks";
+                if (stats.skipped > 0) {
+                    std::cout << "; skipped " << stats.skipped << " missed occurrences beyond --catch-up";
+                }
+                std::cout << ".\n";
+                ok = stats.failures == 0;
             } else {
-                break; // Exit the loop if the username is valid
+                std::cerr << error << "\n";
             }
         }
-        
-        while (true) {
-            std::cout << "Password: ";
-            std::getline(std::cin, password);
-            if (password.empty()) {
-                std::cout << "Password cannot be empty. Please enter a valid password.\n";
+        if (overdueMode) {
+            scheduler::DeadlineWatcher deadlines(db);
+            if (deadlines.load(error)) {
+                std::cout << "Marked " << deadlines.markDue(std::time(nullptr)) << " tasks overdue.\n";
+                ok = ok && deadlines.stats().failures == 0;
             } else {
-                break; // Exit the loop if the password is valid
+                std::cerr << error << "\n";
+                ok = false;
             }
         }
-        switch (choice) {
-            case 1:
-                handleRegistration(db, username, password);
-                break;
-            case 2:
-                handleLogin(db, username, password);
-                break;
-            default:
-                std::cout << "Invalid choice!\n";
-                break;
+        executor::shutdown();
+        logging::stop();
+        return ok ? 0 : 1;
+    }
+    if (batchFile) {
+        AsyncService async(service);
+        std::ifstream file;
+        if (std::string(batchFile) != "-") {
+            file.open(batchFile);
+            if (!file) {
+                logging::error("Cannot open batch file {}", batchFile);
+                executor::shutdown();
+                logging::stop();
+                return 1;
+            }
         }
+        batch::Summary summary = batch::run(async, file.is_open() ? file : std::cin, std::cout, batchOptions);
+        executor::shutdown();
+        logging::stop();
+        return summary.failed == 0 ? 0 : 1;
     }
+    runMainMenu(service);
 
+    executor::shutdown();
+    logging::stop();
     return 0;
 }
@@ -0,0 +1,461 @@
+/**
+ * @file compaction.cpp
+ * @brief VACUUM INTO, replay of the rows changed meanwhile, and the swap.
+ *
+ * The update hook records (table, rowid) for every row the writer inserts,
+ * updates or deletes in the ordinary tables; the FTS shadow tables and
+ * sqlite_sequence are left out. Only the writer thread touches the recorded
+ * sets: the hook runs there, and the sets are taken in exclusive writer jobs,
+ * after which every recorded change is committed (or rolled back, which only
+ * makes the replay redundant). A round replays the current live row into the
+ * copy: updated if the copy has it, inserted if not, deleted if the live row
+ * is gone. The copy's own triggers keep its FTS indexes in step.
+ *
+ * Tables that triggers write to (rule_feedback_stats, say) are replayed after
+ * the tables whose triggers write them. Whatever such a trigger changes in
+ * the copy, the same trigger changed in the live table too, so the replay of
+ * that table overwrites it with the live value.
+ */
+
+#include "compaction.h"
+#include "../db/ConnectionPool.h"
+#include "../logging/logging.h"
+#include "../metrics/metrics.h"
+#include "../trace/trace.h"
+#include <sqlite3.h>
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <cstring>
+#include <filesystem>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+namespace compaction {
+
+namespace {
+
+/// @brief An ordinary table whose changed rows are replayed into the copy.
+struct Table {
+    std::string name;             ///< Quoted for SQL
+    std::string columns;          ///< Quoted column list
+    std::string insertColumns;    ///< columns, preceded by rowid if no column aliases it
+};
+
+using RowSets = std::vector<std::unordered_set<sqlite3_int64>>;
+
+/// @brief Tables in replay order and the rows changed since the sets were last taken.
+struct Tracker {
+    std::vector<Table> tables;
+    std::unordered_map<std::string, size_t> index;  ///< Unquoted table name to position in tables
+    RowSets changed;
+};
+
+void recordChange(Tracker& tracker, const char* database, const char* table, sqlite3_int64 rowid) {
+    if (std::strcmp(database, "main") != 0) {
+        return;
+    }
+    auto it = tracker.index.find(table);
+    if (it != tracker.index.end()) {
+        tracker.changed[it->second].insert(rowid);
+    }
+}
+
+/// @brief Removes the update hook when compaction ends, however it ends.
+struct HookGuard {
+    ConnectionPool& pool;
+    int id = 0;               ///< From ConnectionPool::addUpdateHook(); 0 once removed
+
+    ~HookGuard() {
+        if (id) {
+            pool.removeUpdateHook(id);
+        }
+    }
+};
+
+std::string quote(const std::string& identifier) {
+    std::string quoted = "\"";
+    for (char c : identifier) {
+        quoted += c;
+        if (c == '"') quoted += '"';
+    }
+    return quoted + "\"";
+}
+
+std::string lower(std::string text) {
+    std::transform(text.begin(), text.end(), text.begin(), [](unsigned char c) { return std::tolower(c); });
+    return text;
+}
+
+/// @brief True if @p word occurs in @p text as a whole identifier (both lower case).
+bool mentions(const std::string& text, const std::string& word) {
+    auto identifierChar = [](char c) { return std::isalnum(static_cast<unsigned char>(c)) || c == '_'; };
+    for (size_t at = text.find(word); at != std::string::npos; at = text.find(word, at + 1)) {
+        size_t end = at + word.size();
+        if ((at == 0 || !identifierChar(text[at - 1])) && (end == text.size() || !identifierChar(text[end]))) {
+            return true;
+        }
+    }
+    return false;
+}
+
+long long pragmaInt(sqlite3* db, const char* sql) {
+    sqlite3_stmt* stmt = nullptr;
+    long long value = -1;
+    if (sqlite3_prepare_v2(db, sql, -1, &stmt, nullptr) == SQLITE_OK && sqlite3_step(stmt) == SQLITE_ROW) {
+        value = sqlite3_column_int64(stmt, 0);
+    }
+    sqlite3_finalize(stmt);
+    return value;
+}
+
+std::string columnText(sqlite3_stmt* stmt, int col) {
+    const unsigned char* text = sqlite3_column_text(stmt, col);
+    return text ? reinterpret_cast<const char*>(text) : "";
+}
+
+/// @brief Lists the ordinary rowid tables of main and orders them so trigger targets come last.
+bool loadTables(sqlite3* db, Tracker& tracker, std::string& error) {
+    std::vector<std::string> names;
+    sqlite3_stmt* stmt = nullptr;
+    if (sqlite3_prepare_v2(db,
+                           "SELECT name FROM pragma_table_list WHERE schema = 'main' AND type = 'table' "
+                           "AND wr = 0 AND name NOT LIKE 'sqlite_%' ORDER BY name;",
+                           -1, &stmt, nullptr) != SQLITE_OK) {
+        error = std::string("Failed to list tables: ") + sqlite3_errmsg(db);
+        return false;
+    }
+    while (sqlite3_step(stmt) == SQLITE_ROW) {
+        names.push_back(columnText(stmt, 0));
+    }
+    sqlite3_finalize(stmt);
+
+    // An edge a -> b: a trigger on a writes to b, so b is replayed after a
+    std::vector<std::vector<size_t>> after(names.size());
+    std::vector<int> before(names.size(), 0);
+    if (sqlite3_prepare_v2(db, "SELECT tbl_name, sql FROM sqlite_schema WHERE type = 'trigger';", -1, &stmt,
+                           nullptr) != SQLITE_OK) {
+        error = std::string("Failed to list triggers: ") + sqlite3_errmsg(db);
+        return false;
+    }
+    while (sqlite3_step(stmt) == SQLITE_ROW) {
+        std::string source = lower(columnText(stmt, 0));
+        std::string sql = lower(columnText(stmt, 1));
+        auto from = std::find_if(names.begin(), names.end(), [&](const std::string& n) { return lower(n) == source; });
+        if (from == names.end()) continue;
+        for (size_t to = 0; to < names.size(); ++to) {
+            if (names[to] != *from && mentions(sql, lower(names[to]))) {
+                after[from - names.begin()].push_back(to);
+                ++before[to];
+            }
+        }
+    }
+    sqlite3_finalize(stmt);
+
+    std::vector<size_t> order;
+    std::vector<bool> placed(names.size(), false);
+    for (bool progress = true; progress;) {
+        progress = false;
+        for (size_t i = 0; i < names.size(); ++i) {
+            if (placed[i] || before[i] > 0) continue;
+            placed[i] = progress = true;
+            order.push_back(i);
+            for (size_t next : after[i]) --before[next];
+        }
+    }
+    for (size_t i = 0; i < names.size(); ++i) {
+        if (!placed[i]) order.push_back(i);  // Triggers in a cycle: keep name order
+    }
+
+    for (size_t i : order) {
+        Table table;
+        table.name = quote(names[i]);
+        int keyColumns = 0;
+        bool integerKey = false;
+        if (sqlite3_prepare_v2(db, "SELECT name, type, pk FROM pragma_table_info(?1);", -1, &stmt, nullptr) !=
+            SQLITE_OK) {
+            error = std::string("Failed to read columns: ") + sqlite3_errmsg(db);
+            return false;
+        }
+        sqlite3_bind_text(stmt, 1, names[i].c_str(), -1, SQLITE_TRANSIENT);
+        while (sqlite3_step(stmt) == SQLITE_ROW) {
+            table.columns += (table.columns.empty() ? "" : ", ") + quote(columnText(stmt, 0));
+            if (sqlite3_column_int(stmt, 2) > 0) {
+                ++keyColumns;
+                integerKey = lower(columnText(stmt, 1)) == "integer";
+            }
+        }
+        sqlite3_finalize(stmt);
+        table.insertColumns = keyColumns == 1 && integerKey ? table.columns : "rowid, " + table.columns;
+        tracker.index[names[i]] = tracker.tables.size();
+        tracker.tables.push_back(std::move(table));
+    }
+    tracker.changed.assign(tracker.tables.size(), {});
+    return true;
+}
+
+RowSets take(Tracker& tracker) {
+    RowSets taken(tracker.changed.size());
+    taken.swap(tracker.changed);
+    return taken;
+}
+
+bool step(sqlite3_stmt* stmt, sqlite3_int64 rowid, int expected) {
+    sqlite3_reset(stmt);
+    sqlite3_bind_int64(stmt, 1, rowid);
+    return sqlite3_step(stmt) == expected;
+}
+
+/**
+ * @brief Copies the live state of the @p rows into the copy, in one transaction.
+ *
+ * @return Rows replayed, or -1 with @p error set.
+ */
+long long replay(sqlite3* copy, const Tracker& tracker, const RowSets& rows, std::string& error) {
+    trace::Span span("compaction.replay", "db");
+    if (sqlite3_exec(copy, "BEGIN;", nullptr, nullptr, nullptr) != SQLITE_OK) {
+        error = std::string("Failed to start replay: ") + sqlite3_errmsg(copy);
+        return -1;
+    }
+
+    long long replayed = 0;
+    bool ok = true;
+    for (size_t i = 0; ok && i < tracker.tables.size(); ++i) {
+        if (rows[i].empty()) continue;
+        const Table& table = tracker.tables[i];
+        std::string sql[4] = {
+            "SELECT 1 FROM live." + table.name + " WHERE rowid = ?1;",
+            "UPDATE main." + table.name + " SET (" + table.columns + ") = (SELECT " + table.columns + " FROM live." +
+                table.name + " WHERE rowid = ?1) WHERE rowid = ?1;",
+            "INSERT INTO main." + table.name + " (" + table.insertColumns + ") SELECT " + table.insertColumns +
+                " FROM live." + table.name + " WHERE rowid = ?1;",
+            "DELETE FROM main." + table.name + " WHERE rowid = ?1;",
+        };
+        sqlite3_stmt* stmts[4] = {};
+        for (int s = 0; ok && s < 4; ++s) {
+            ok = sqlite3_prepare_v2(copy, sql[s].c_str(), -1, &stmts[s], nullptr) == SQLITE_OK;
+        }
+        sqlite3_stmt *exists = stmts[0], *update = stmts[1], *insert = stmts[2], *remove = stmts[3];
+        for (auto it = rows[i].begin(); ok && it != rows[i].end(); ++it) {
+            sqlite3_reset(exists);
+            sqlite3_bind_int64(exists, 1, *it);
+            int rc = sqlite3_step(exists);
+            if (rc == SQLITE_ROW) {
+                ok = step(update, *it, SQLITE_DONE) && (sqlite3_changes(copy) > 0 || step(insert, *it, SQLITE_DONE));
+            } else {
+                ok = rc == SQLITE_DONE && step(remove, *it, SQLITE_DONE);
+            }
+            ++replayed;
+        }
+        if (!ok) {
+            error = "Failed to replay " + table.name + ": " + sqlite3_errmsg(copy);
+        }
+        for (sqlite3_stmt* stmt : stmts) {
+            sqlite3_finalize(stmt);
+        }
+    }
+
+    if (ok && sqlite3_exec(copy, "COMMIT;", nullptr, nullptr, nullptr) != SQLITE_OK) {
+        ok = false;
+        error = std::string("Failed to commit replay: ") + sqlite3_errmsg(copy);
+    }
+    if (!ok) {
+        sqlite3_exec(copy, "ROLLBACK;", nullptr, nullptr, nullptr);
+        return -1;
+    }
+    return replayed;
+}
+
+std::uintmax_t fileSize(const std::string& path) {
+    std::error_code ec;
+    std::uintmax_t size = std::filesystem::file_size(path, ec);
+    return ec ? 0 : size;
+}
+
+void removeCopy(const std::string& path) {
+    std::error_code ec;
+    std::filesystem::remove(path, ec);
+    std::filesystem::remove(path + "-journal", ec);
+}
+
+Summary failed(Summary summary, const std::string& error) {
+    summary.ok = false;
+    summary.error = error;
+    logging::error("Compaction failed: {}", error);
+    return summary;
+}
+
+}  // namespace
+
+Summary run(ConnectionPool& pool, const Options& options) {
+    EHS_MEASURE("compaction.run");
+    trace::Span span("compaction.run", "db");
+    Summary summary;
+    Tracker tracker;
+    HookGuard hook{pool};
+
+    // Start recording changes before the copy's snapshot is taken; rows changed in between are replayed redundantly
+    struct Start {
+        std::string error;
+        std::string path;
+        long long dataVersion = -1;
+        long long schemaVersion = -1;
+    };
+    Start start = pool.exclusive([&](sqlite3* db) {
+        Start result;
+        const char* path = sqlite3_db_filename(db, "main");
+        if (!path || !*path) {
+            result.error = "The database has no file to compact.";
+        } else if (loadTables(db, tracker, result.error)) {
+            result.path = path;
+            result.dataVersion = pragmaInt(db, "PRAGMA main.data_version;");
+            result.schemaVersion = pragmaInt(db, "PRAGMA main.schema_version;");
+            hook.id = pool.addUpdateHook([&tracker](int, const char* database, const char* table, sqlite3_int64 rowid) {
+                recordChange(tracker, database, table, rowid);
+            });
+        }
+        return result;
+    });
+    if (start.path.empty()) {
+        return failed(summary, start.error);
+    }
+    summary.bytesBefore = fileSize(start.path);
+
+    std::string copyPath = start.path + ".compact";
+    removeCopy(copyPath);
+    {
+        trace::Span vacuumSpan("compaction.vacuumInto", "db");
+        sqlite3* source = nullptr;
+        bool ok = sqlite3_open_v2(start.path.c_str(), &source, SQLITE_OPEN_READONLY, nullptr) == SQLITE_OK;
+        sqlite3_stmt* stmt = nullptr;
+        if (ok) {
+            sqlite3_busy_timeout(source, 5000);
+            // Takes effect in the file VACUUM INTO writes; the live file cannot change mode in place
+            ok = !options.incrementalVacuum ||
+                 sqlite3_exec(source, "PRAGMA auto_vacuum = INCREMENTAL;", nullptr, nullptr, nullptr) == SQLITE_OK;
+        }
+        if (ok) {
+            ok = sqlite3_prepare_v2(source, "VACUUM main INTO ?1;", -1, &stmt, nullptr) == SQLITE_OK;
+        }
+        if (ok) {
+            sqlite3_bind_text(stmt, 1, copyPath.c_str(), -1, SQLITE_TRANSIENT);
+            ok = sqlite3_step(stmt) == SQLITE_DONE;
+        }
+        std::string error = ok ? "" : std::string("VACUUM INTO failed: ") + sqlite3_errmsg(source);
+        sqlite3_finalize(stmt);
+        sqlite3_close(source);
+        if (!ok) {
+            removeCopy(copyPath);
+            return failed(summary, error);
+        }
+    }
+
+    // The copy is scratch until the swap: no journal on disk, no syncs
+    sqlite3* copy = nullptr;
+    std::string error;
+    if (sqlite3_open_v2(copyPath.c_str(), &copy, SQLITE_OPEN_READWRITE, nullptr) != SQLITE_OK ||
+        sqlite3_exec(copy, "PRAGMA journal_mode = MEMORY; PRAGMA synchronous = OFF;", nullptr, nullptr, nullptr) !=
+            SQLITE_OK) {
+        error = std::string("Failed to open the compact copy: ") + sqlite3_errmsg(copy);
+    } else {
+        sqlite3_busy_timeout(copy, 5000);
+        sqlite3_stmt* stmt = nullptr;
+        if (sqlite3_prepare_v2(copy, "ATTACH DATABASE ?1 AS live;", -1, &stmt, nullptr) == SQLITE_OK) {
+            sqlite3_bind_text(stmt, 1, start.path.c_str(), -1, SQLITE_TRANSIENT);
+            sqlite3_step(stmt);
+        }
+        sqlite3_finalize(stmt);
+        if (!sqlite3_db_filename(copy, "live")) {
+            error = std::string("Failed to attach the live database: ") + sqlite3_errmsg(copy);
+        }
+    }
+    auto abandon = [&](const std::string& why) {
+        sqlite3_close(copy);
+        removeCopy(copyPath);
+        return failed(summary, why);
+    };
+    if (!error.empty()) {
+        return abandon(error);
+    }
+
+    // Replay in the background until a round is small enough to finish while writes wait
+    for (int round = 0; round < options.maxCatchUpRounds; ++round) {
+        RowSets rows = pool.exclusive([&](sqlite3*) { return take(tracker); });
+        long long replayed = replay(copy, tracker, rows, error);
+        if (replayed < 0) {
+            return abandon(error);
+        }
+        summary.rowsReplayed += replayed;
+        ++summary.catchUpRounds;
+        if (replayed <= options.quiesceRows) {
+            break;
+        }
+    }
+
+    error = pool.exclusive([&](sqlite3* db) -> std::string {
+        trace::Span swapSpan("compaction.swap", "db");
+        auto quiesced = std::chrono::steady_clock::now();
+        std::string why;
+        if (pragmaInt(db, "PRAGMA main.data_version;") != start.dataVersion) {
+            return "Another connection wrote to the database during compaction; nothing was changed.";
+        }
+        if (pragmaInt(db, "PRAGMA main.schema_version;") != start.schemaVersion) {
+            return "The schema changed during compaction; nothing was changed.";
+        }
+        long long replayed = replay(copy, tracker, take(tracker), why);
+        if (replayed < 0) {
+            return why;
+        }
+        summary.rowsReplayed += replayed;
+        ++summary.catchUpRounds;
+        pool.removeUpdateHook(hook.id);
+        hook.id = 0;
+
+        // AUTOINCREMENT counters are not rows the hook sees
+        if (sqlite3_exec(copy,
+                         "DELETE FROM main.sqlite_sequence; "
+                         "INSERT INTO main.sqlite_sequence (name, seq) SELECT name, seq FROM live.sqlite_sequence; "
+                         "DETACH DATABASE live;",
+                         nullptr, nullptr, nullptr) != SQLITE_OK &&
+            sqlite3_exec(copy, "DETACH DATABASE live;", nullptr, nullptr, nullptr) != SQLITE_OK) {
+            return std::string("Failed to detach the live database: ") + sqlite3_errmsg(copy);
+        }
+
+        // One write transaction: readers see the old pages or the compact ones, never a mix
+        sqlite3_backup* backup = sqlite3_backup_init(db, "main", copy, "main");
+        if (!backup) {
+            return std::string("Failed to start the swap: ") + sqlite3_errmsg(db);
+        }
+        int rc = sqlite3_backup_step(backup, -1);
+        sqlite3_backup_finish(backup);
+        if (rc != SQLITE_DONE) {
+            return std::string("Failed to swap in the compact copy: ") + sqlite3_errstr(rc);
+        }
+        // The backup commit does not call the WAL hook; the next statement does, so a WAL archiver sees the frames
+        sqlite3_exec(db, "SELECT 1;", nullptr, nullptr, nullptr);
+
+        // The file only shrinks once the WAL is checkpointed; readers on the old pages may delay that
+        summary.checkpointed = sqlite3_wal_checkpoint_v2(db, "main", SQLITE_CHECKPOINT_TRUNCATE, nullptr, nullptr) ==
+                               SQLITE_OK;
+        summary.quiesceMs =
+            std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - quiesced).count();
+        return why;
+    });
+    if (!error.empty()) {
+        return abandon(error);
+    }
+
+    sqlite3_close(copy);
+    removeCopy(copyPath);
+    summary.bytesAfter = fileSize(start.path);
+    logging::info("Compacted {}: {} -> {} bytes, {} rows replayed in {} rounds, writes held for {} ms", start.path,
+                  summary.bytesBefore, summary.bytesAfter, summary.rowsReplayed, summary.catchUpRounds,
+                  summary.quiesceMs);
+    if (!summary.checkpointed) {
+        logging::warn("Readers held the WAL; {} shrinks at the next checkpoint", start.path);
+    }
+    return summary;
+}
+
+}  // namespace compaction
@@ -0,0 +1,65 @@
+#ifndef COMPACTION_H_
+#define COMPACTION_H_
+
+#include <cstdint>
+#include <string>
+
+class ConnectionPool;
+
+/**
+ * @namespace compaction
+ * @brief Online compaction of the database file while it is being used.
+ *
+ * A plain VACUUM holds the write lock for as long as it rebuilds the file.
+ * run() rebuilds it in the background instead: VACUUM INTO writes a compact
+ * copy from a read snapshot, and the rows written since the snapshot are then
+ * replayed into the copy. Only the final step quiesces the writer: it replays
+ * the last few changed rows and copies the compact pages over the live
+ * database in one write transaction (the SQLite backup API), so open read
+ * connections switch over at their next transaction and nothing is renamed
+ * under them. The checkpoint that follows shrinks the file.
+ *
+ * Changed rows are found with an update hook on the writer connection
+ * (ConnectionPool::addUpdateHook()), so the database must only be written
+ * through this process's ConnectionPool while a compaction runs; a commit
+ * from any other connection makes it fail without touching the database.
+ */
+namespace compaction {
+
+/**
+ * @struct Options
+ * @brief How to compact.
+ */
+struct Options {
+    bool incrementalVacuum = false;  ///< Switch the database to auto_vacuum = INCREMENTAL
+    int maxCatchUpRounds = 10;       ///< Background replay rounds before quiescing regardless
+    int quiesceRows = 1000;          ///< Quiesce once a round replays at most this many rows
+};
+
+/**
+ * @struct Summary
+ * @brief Outcome of a compaction.
+ */
+struct Summary {
+    bool ok = true;                  ///< True if the database was replaced by the compact copy
+    std::string error;               ///< Error message when ok is false
+    std::uintmax_t bytesBefore = 0;  ///< Database file size before
+    std::uintmax_t bytesAfter = 0;   ///< Database file size after the checkpoint
+    int catchUpRounds = 0;           ///< Replay rounds, including the one while quiesced
+    long long rowsReplayed = 0;      ///< Rows replayed into the copy
+    double quiesceMs = 0;            ///< Time writes were held back for the swap
+    bool checkpointed = true;        ///< False if readers kept the WAL from being truncated yet
+};
+
+/**
+ * @brief Compacts the database behind @p pool.
+ *
+ * Blocks the calling thread for the whole compaction; writes through the
+ * pool go on except during the final swap. The copy is built next to the
+ * database as "<database>.compact" and removed afterwards.
+ */
+Summary run(ConnectionPool& pool, const Options& options = Options());
+
+}  // namespace compaction
+
+#endif  // COMPACTION_H_
@@ -0,0 +1,1438 @@
+/**
+ * @file core.cpp
+ * @brief Implementation of the headless EHS operations.
+ *
+ * Each function prepares its statements, binds the typed parameters and
+ * returns a result struct. Errors are reported through the struct, never
+ * printed, so the interactive menus decide how to present them. Every
+ * operation records its latency under "core.<function>" (metrics/metrics.h),
+ * and every statement records "db.prepare", "db.step" and "db.finalize" trace
+ * spans (trace/trace.h).
+ *
+ */
+
+#include "core.h"
+#include "../metrics/metrics.h"
+#include "../trace/trace.h"
+#include <openssl/sha.h>
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <ctime>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <queue>
+#include <unordered_map>
+
+namespace core {
+
+namespace {
+
+/// @brief When each live statement on this thread finished preparing, for its "db.step" span.
+thread_local std::unordered_map<sqlite3_stmt*, uint64_t> preparedAt;
+
+/// @brief sqlite3_prepare_v2 recorded as a "db.prepare" span.
+int prepare(sqlite3* db, const char* sql, sqlite3_stmt** stmt) {
+    uint64_t start = trace::nowMicros();
+    int rc = sqlite3_prepare_v2(db, sql, -1, stmt, nullptr);
+    uint64_t end = trace::nowMicros();
+    trace::recordSpan("db.prepare", "db", start, end - start);
+    if (*stmt) {
+        preparedAt[*stmt] = end;
+    }
+    return rc;
+}
+
+/// @brief sqlite3_finalize recorded as a "db.finalize" span, preceded by a
+///        "db.step" span covering binding and stepping since prepare().
+void finalize(sqlite3_stmt* stmt) {
+    uint64_t start = trace::nowMicros();
+    auto it = preparedAt.find(stmt);
+    if (it != preparedAt.end()) {
+        trace::recordSpan("db.step", "db", it->second, start - it->second);
+        preparedAt.erase(it);
+    }
+    sqlite3_finalize(stmt);
+    trace::recordSpan("db.finalize", "db", start, trace::nowMicros() - start);
+}
+
+/// @brief Returns a column as a string, or an empty string for NULL.
+std::string columnText(sqlite3_stmt* stmt, int col) {
+    const unsigned char* text = sqlite3_column_text(stmt, col);
+    return text ? reinterpret_cast<const char*>(text) : "";
+}
+
+/// @brief Builds a failed Result carrying the connection's last error.
+Result failure(sqlite3* db, const std::string& what) {
+    Result result;
+    result.ok = false;
+    result.error = what + ": " + sqlite3_errmsg(db);
+    return result;
+}
+
+/// @brief Builds a failed Result with a plain message.
+Result failure(const std::string& message) {
+    Result result;
+    result.ok = false;
+    result.error = message;
+    return result;
+}
+
+/**
+ * @brief Steps a prepared write statement to completion and finalizes it.
+ *
+ * Result::id is only set when @p inserts and a row went in: on the shared
+ * writer connection sqlite3_last_insert_rowid() is otherwise whatever another
+ * job inserted last.
+ */
+Result runWrite(sqlite3* db, sqlite3_stmt* stmt, const std::string& what, bool inserts = false) {
+    Result result;
+    if (sqlite3_step(stmt) != SQLITE_DONE) {
+        result = failure(db, what);
+    } else {
+        result.changes = sqlite3_changes(db);
+        if (inserts && result.changes > 0) {
+            result.id = sqlite3_last_insert_rowid(db);
+        }
+    }
+    finalize(stmt);
+    return result;
+}
+
+/// @brief Reads the columns of the shared task SELECT list into a record.
+TaskRecord readTask(sqlite3_stmt* stmt) {
+    TaskRecord task;
+    task.id = sqlite3_column_int(stmt, 0);
+    task.workerId = sqlite3_column_int(stmt, 1);
+    task.workerUsername = columnText(stmt, 2);
+    task.description = columnText(stmt, 3);
+    task.status = columnText(stmt, 4);
+    task.violationComment = columnText(stmt, 5);
+    task.violationTimestamp = columnText(stmt, 6);
+    task.workerReport = columnText(stmt, 7);
+    task.workerMedia = columnText(stmt, 8);
+    task.dueAt = sqlite3_column_int64(stmt, 9);
+    task.priority = sqlite3_column_int(stmt, 10);
+    return task;
+}
+
+const char* kTaskColumns = "SELECT id, worker_id, worker_username, task_description, status, "
+                           "violation_comment, violation_timestamp, worker_report, worker_media, "
+                           "IFNULL(due_at, 0), priority FROM tasks ";
+
+/// @brief Runs a task query with an optional int or text parameter, and ?2/?3 bound to a page when afterId >= 0.
+Rows<TaskRecord> queryTasks(sqlite3* db, const std::string& where, int intParam, const std::string* textParam,
+                            int afterId = -1, int limit = -1) {
+    Rows<TaskRecord> result;
+    std::string sql = kTaskColumns + where + ";";
+    sqlite3_stmt* stmt = nullptr;
+
+    if (prepare(db, sql.c_str(), &stmt) != SQLITE_OK) {
+        result.ok = false;
+        result.error = std::string("Failed to prepare task query: ") + sqlite3_errmsg(db);
+        return result;
+    }
+
+    if (textParam) {
+        sqlite3_bind_text(stmt, 1, textParam->c_str(), -1, SQLITE_TRANSIENT);
+    } else if (intParam >= 0) {
+        sqlite3_bind_int(stmt, 1, intParam);
+    }
+    if (afterId >= 0) {
+        sqlite3_bind_int(stmt, 2, afterId);
+        sqlite3_bind_int(stmt, 3, limit);
+    }
+
+    int rc;
+    while ((rc = sqlite3_step(stmt)) == SQLITE_ROW) {
+        result.rows.push_back(readTask(stmt));
+    }
+    if (rc != SQLITE_DONE) {
+        result.ok = false;
+        result.error = std::string("Failed to read tasks: ") + sqlite3_errmsg(db);
+    }
+
+    finalize(stmt);
+    return result;
+}
+
+/// @brief Collects ranked FTS5 matches; returns the SQLite code of the last step.
+int searchMatches(sqlite3* db, const char* sql, const std::string& query, int workerId, int limit,
+                  std::vector<SearchHit>& hits) {
+    sqlite3_stmt* stmt = nullptr;
+    if (prepare(db, sql, &stmt) != SQLITE_OK) {
+        return SQLITE_ERROR;
+    }
+
+    sqlite3_bind_text(stmt, 1, query.c_str(), -1, SQLITE_TRANSIENT);
+    sqlite3_bind_int(stmt, 2, limit);
+    if (workerId >= 0) {
+        sqlite3_bind_int(stmt, 3, workerId);
+    }
+
+    int rc;
+    while ((rc = sqlite3_step(stmt)) == SQLITE_ROW) {
+        SearchHit hit;
+        hit.id = sqlite3_column_int(stmt, 0);
+        hit.snippet = columnText(stmt, 1);
+        hits.push_back(hit);
+    }
+
+    finalize(stmt);
+    return rc;
+}
+
+/// @brief Reads the columns of kShiftColumns into a record.
+ShiftRecord readShift(sqlite3_stmt* stmt) {
+    ShiftRecord shift;
+    shift.id = sqlite3_column_int(stmt, 0);
+    shift.workerId = sqlite3_column_int(stmt, 1);
+    shift.workerUsername = columnText(stmt, 2);
+    shift.site = columnText(stmt, 3);
+    shift.startsAt = sqlite3_column_int64(stmt, 4);
+    shift.endsAt = sqlite3_column_int64(stmt, 5);
+    return shift;
+}
+
+const char* kShiftColumns = "SELECT s.id, s.worker_id, IFNULL(u.username, ''), s.site, s.starts_at, s.ends_at "
+                            "FROM shifts s LEFT JOIN users u ON u.id = s.worker_id ";
+
+/// @brief A worker on shift in the heap of autoAssignTasks().
+struct Candidate {
+    sqlite3_int64 openTasks = 0;
+    int weight = 100;
+    int workerId = 0;
+    /// @brief More loaded than @p other; greater() on it makes std::priority_queue a min-heap.
+    bool operator>(const Candidate& other) const {
+        // open / weight compared by cross-multiplying, ties going to the lower ID as in the load index
+        sqlite3_int64 mine = openTasks * other.weight;
+        sqlite3_int64 theirs = other.openTasks * weight;
+        return mine != theirs ? mine > theirs : workerId > other.workerId;
+    }
+};
+
+/// @brief Reads the available workers with a shift at @p site overlapping [from, to); false and @p error on failure.
+bool readCandidates(sqlite3* db, const std::string& site, sqlite3_int64 from, sqlite3_int64 to,
+                    std::vector<Candidate>& candidates, std::string& error) {
+    // CROSS JOIN keeps the shift index range as the outer loop; each worker is then one rowid lookup
+    const char* sql = "SELECT DISTINCT l.worker_id, l.open_tasks, l.weight "
+                      "FROM shifts s CROSS JOIN worker_load l ON l.worker_id = s.worker_id "
+                      "WHERE s.site = ? AND s.starts_at > ? AND s.starts_at < ? AND s.ends_at > ? AND l.available = 1;";
+    sqlite3_stmt* stmt = nullptr;
+    if (prepare(db, sql, &stmt) != SQLITE_OK) {
+        error = std::string("Failed to read workers on shift: ") + sqlite3_errmsg(db);
+        return false;
+    }
+
+    sqlite3_bind_text(stmt, 1, site.c_str(), -1, SQLITE_STATIC);
+    sqlite3_bind_int64(stmt, 2, from - kMaxShiftSeconds);
+    sqlite3_bind_int64(stmt, 3, to);
+    sqlite3_bind_int64(stmt, 4, from);
+
+    int rc;
+    while ((rc = sqlite3_step(stmt)) == SQLITE_ROW) {
+        Candidate candidate;
+        candidate.workerId = sqlite3_column_int(stmt, 0);
+        candidate.openTasks = sqlite3_column_int64(stmt, 1);
+        candidate.weight = sqlite3_column_int(stmt, 2);
+        candidates.push_back(candidate);
+    }
+    if (rc != SQLITE_DONE) {
+        error = std::string("Failed to read workers on shift: ") + sqlite3_errmsg(db);
+    }
+
+    finalize(stmt);
+    return rc == SQLITE_DONE;
+}
+
+}  // namespace
+
+std::string hashPassword(const std::string& password) {
+    EHS_MEASURE("core.hashPassword");
+    static const char* hexDigits = "0123456789abcdef";
+    unsigned char hash[SHA256_DIGEST_LENGTH];
+    SHA256(reinterpret_cast<const unsigned char*>(password.c_str()), password.size(), hash);
+
+    std::string hex(SHA256_DIGEST_LENGTH * 2, '0');
+    for (int i = 0; i < SHA256_DIGEST_LENGTH; ++i) {
+        hex[2 * i] = hexDigits[hash[i] >> 4];
+        hex[2 * i + 1] = hexDigits[hash[i] & 0x0f];
+    }
+    return hex;
+}
+
+std::string currentTimestamp() {
+    std::time_t now = std::time(nullptr);
+    std::tm local;
+    localtime_r(&now, &local);
+    char timestamp[100];
+    std::strftime(timestamp, sizeof(timestamp), "%Y-%m-%d %H:%M:%S", &local);
+    return timestamp;
+}
+
+std::string formatLocalTime(sqlite3_int64 time) {
+    std::time_t value = static_cast<std::time_t>(time);
+    std::tm local;
+    localtime_r(&value, &local);
+    char text[32];
+    std::strftime(text, sizeof(text), "%Y-%m-%d %H:%M", &local);
+    return text;
+}
+
+bool parseLocalTime(const std::string& text, sqlite3_int64& time) {
+    std::tm local = {};
+    const char* input = text.c_str();
+    int length = static_cast<int>(text.size());
+    // %n records how far each form got; anything left after it ("2026-01-01x") is not a time
+    int consumed = -1;
+    bool parsed = std::sscanf(input, "%d-%d-%d %d:%d:%d%n", &local.tm_year, &local.tm_mon, &local.tm_mday,
+                              &local.tm_hour, &local.tm_min, &local.tm_sec, &consumed) == 6 &&
+                  consumed == length;
+    if (!parsed) {
+        local.tm_sec = 0;
+        consumed = -1;
+        parsed = std::sscanf(input, "%d-%d-%d %d:%d%n", &local.tm_year, &local.tm_mon, &local.tm_mday,
+                             &local.tm_hour, &local.tm_min, &consumed) == 5 &&
+                 consumed == length;
+    }
+    if (!parsed) {
+        local.tm_hour = local.tm_min = 0;
+        consumed = -1;
+        parsed = std::sscanf(input, "%d-%d-%d%n", &local.tm_year, &local.tm_mon, &local.tm_mday, &consumed) == 3 &&
+                 consumed == length;
+    }
+    if (!parsed || local.tm_mon < 1 || local.tm_mon > 12 || local.tm_mday < 1 || local.tm_mday > 31 ||
+        local.tm_hour < 0 || local.tm_hour > 23 || local.tm_min < 0 || local.tm_min > 59 || local.tm_sec < 0 ||
+        local.tm_sec > 59) {
+        return false;
+    }
+    local.tm_year -= 1900;
+    local.tm_mon -= 1;
+    local.tm_isdst = -1;
+    int year = local.tm_year, month = local.tm_mon, day = local.tm_mday;
+    std::time_t value = std::mktime(&local);
+    // mktime rolls a day past the end of the month (2026-02-31) into the next; that is not a date
+    if (value == static_cast<std::time_t>(-1) || local.tm_year != year || local.tm_mon != month ||
+        local.tm_mday != day) {
+        return false;
+    }
+    time = value;
+    return true;
+}
+
+bool parseInterval(const std::string& text, sqlite3_int64& seconds) {
+    if (text == "hourly") {
+        seconds = 3600;
+        return true;
+    }
+    if (text == "daily") {
+        seconds = 86400;
+        return true;
+    }
+    if (text == "weekly") {
+        seconds = 7 * 86400;
+        return true;
+    }
+
+    long long count = 0;
+    char unit = 0;
+    char rest = 0;
+    if (std::sscanf(text.c_str(), "%lld%c%c", &count, &unit, &rest) != 2 || count <= 0 || count > 100000) {
+        return false;
+    }
+    switch (unit) {
+        case 'm': seconds = count * 60; break;
+        case 'h': seconds = count * 3600; break;
+        case 'd': seconds = count * 86400; break;
+        case 'w': seconds = count * 7 * 86400; break;
+        default: return false;
+    }
+    return true;
+}
+
+bool parsePriority(const std::string& text, int& priority) {
+    if (text == "high" || text == "1") {
+        priority = 1;
+    } else if (text == "normal" || text == "2") {
+        priority = 2;
+    } else if (text == "low" || text == "3") {
+        priority = 3;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+const char* priorityName(int priority) {
+    return priority <= 1 ? "high" : priority == 2 ? "normal" : "low";
+}
+
+Result registerUser(sqlite3* db, const std::string& username, const std::string& password,
+                    const std::string& role) {
+    EHS_MEASURE("core.registerUser");
+    if (username.empty() || password.empty()) {
+        return failure("Username and password cannot be empty.");
+    }
+    if (role != "worker" && role != "manager") {
+        return failure("Role must be worker or manager.");
+    }
+
+    std::string hashed = hashPassword(password);
+    const char* sql = "INSERT INTO users (username, password, role) VALUES (?, ?, ?);";
+    sqlite3_stmt* stmt = nullptr;
+
+    if (prepare(db, sql, &stmt) != SQLITE_OK) {
+        return failure(db, "Prepare failed");
+    }
+
+    sqlite3_bind_text(stmt, 1, username.c_str(), -1, SQLITE_STATIC);
+    sqlite3_bind_text(stmt, 2, hashed.c_str(), -1, SQLITE_STATIC);
+    sqlite3_bind_text(stmt, 3, role.c_str(), -1, SQLITE_STATIC);
+
+    return runWrite(db, stmt, "Registration failed", true);
+}
+
+LoginResult login(sqlite3* db, const std::string& username, const std::string& password) {
+    EHS_MEASURE("core.login");
+    LoginResult result;
+    if (username.empty() || password.empty()) {
+        result.error = "Username and password cannot be empty.";
+        return result;
+    }
+
+    std::string hashed = hashPassword(password);
+    const char* sql = "SELECT id, role FROM users WHERE username = ? AND password = ?;";
+    sqlite3_stmt* stmt = nullptr;
+
+    if (prepare(db, sql, &stmt) != SQLITE_OK) {
+        result.error = std::string("SQL error in login: ") + sqlite3_errmsg(db);
+        return result;
+    }
+
+    sqlite3_bind_text(stmt, 1, username.c_str(), -1, SQLITE_STATIC);
+    sqlite3_bind_text(stmt, 2, hashed.c_str(), -1, SQLITE_STATIC);
+
+    if (sqlite3_step(stmt) == SQLITE_ROW) {
+        result.ok = true;
+        result.userId = sqlite3_column_int(stmt, 0);
+        result.role = columnText(stmt, 1);
+    }
+
+    finalize(stmt);
+    return result;
+}
+
+Rows<TaskRecord> listTasks(sqlite3* db, int workerId, int afterId, int limit) {
+    EHS_MEASURE("core.listTasks");
+    return workerId >= 0
+               ? queryTasks(db, "WHERE worker_id = ?1 AND id > ?2 ORDER BY id LIMIT ?3", workerId, nullptr,
+                            std::max(afterId, 0), limit)
+               : queryTasks(db, "WHERE id > ?2 ORDER BY id LIMIT ?3", -1, nullptr, std::max(afterId, 0), limit);
+}
+
+Rows<TaskRecord> listOpenTasks(sqlite3* db, int workerId) {
+    EHS_MEASURE("core.listOpenTasks");
+    return queryTasks(db, "WHERE worker_id = ? AND status != 'completed'", workerId, nullptr);
+}
+
+Rows<TaskRecord> listTasksByStatus(sqlite3* db, const std::string& status) {
+    EHS_MEASURE("core.listTasksByStatus");
+    return queryTasks(db, "WHERE status = ?", -1, &status);
+}
+
+Rows<TaskRecord> listViolations(sqlite3* db, const std::string& from, const std::string& to,
+                                const std::string& beforeTimestamp, int beforeId, int limit) {
+    EHS_MEASURE("core.listViolations");
+    Rows<TaskRecord> result;
+    // Without statistics the planner prefers idx_tasks_status and sorts every violation for each page
+    std::string sql = std::string(kTaskColumns) +
+                      "INDEXED BY idx_tasks_violation_time WHERE violation_timestamp IS NOT NULL "
+                      "AND violation_timestamp >= ? AND violation_timestamp <= ? "
+                      "AND (violation_timestamp, id) < (?, ?) ORDER BY violation_timestamp DESC, id DESC LIMIT ?;";
+    sqlite3_stmt* stmt = nullptr;
+
+    if (prepare(db, sql.c_str(), &stmt) != SQLITE_OK) {
+        result.ok = false;
+        result.error = std::string("Failed to prepare violation query: ") + sqlite3_errmsg(db);
+        return result;
+    }
+
+    // A date alone as the upper bound covers that whole day; "~" sorts after every timestamp
+    std::string upper = to.empty() ? "~" : to.size() == 10 ? to + " 23:59:59" : to;
+    sqlite3_bind_text(stmt, 1, from.c_str(), -1, SQLITE_TRANSIENT);
+    sqlite3_bind_text(stmt, 2, upper.c_str(), -1, SQLITE_TRANSIENT);
+    if (beforeTimestamp.empty()) {
+        sqlite3_bind_text(stmt, 3, "~", -1, SQLITE_STATIC);
+        sqlite3_bind_int(stmt, 4, 0);
+    } else {
+        sqlite3_bind_text(stmt, 3, beforeTimestamp.c_str(), -1, SQLITE_TRANSIENT);
+        sqlite3_bind_int(stmt, 4, beforeId);
+    }
+    sqlite3_bind_int(stmt, 5, limit);
+
+    int rc;
+    while ((rc = sqlite3_step(stmt)) == SQLITE_ROW) {
+        result.rows.push_back(readTask(stmt));
+    }
+    if (rc != SQLITE_DONE) {
+        result.ok = false;
+        result.error = std::string("Failed to read violations: ") + sqlite3_errmsg(db);
+    }
+
+    finalize(stmt);
+    return result;
+}
+
+Rows<TaskRecord> listOverdue(sqlite3* db, sqlite3_int64 now, int afterPriority, sqlite3_int64 afterDue, int afterId,
+                             int limit) {
+    EHS_MEASURE("core.listOverdue");
+    Rows<TaskRecord> result;
+    // One index range per priority: a single range over all of them would step over every task not yet due
+    std::string sql = std::string(kTaskColumns) +
+                      "INDEXED BY idx_tasks_deadline WHERE status != 'completed' AND due_at IS NOT NULL "
+                      "AND priority = ? AND due_at <= ? AND (due_at, id) > (?, ?) ORDER BY due_at, id LIMIT ?;";
+    sqlite3_stmt* stmt = nullptr;
+
+    if (prepare(db, sql.c_str(), &stmt) != SQLITE_OK) {
+        result.ok = false;
+        result.error = std::string("Failed to prepare overdue query: ") + sqlite3_errmsg(db);
+        return result;
+    }
+
+    int rc = SQLITE_DONE;
+    for (int priority = std::max(afterPriority, 1); priority <= 3 && rc == SQLITE_DONE; ++priority) {
+        int wanted = limit < 0 ? -1 : limit - static_cast<int>(result.rows.size());
+        if (wanted == 0) {
+            break;
+        }
+        bool resume = priority == afterPriority;
+        sqlite3_bind_int(stmt, 1, priority);
+        sqlite3_bind_int64(stmt, 2, now);
+        sqlite3_bind_int64(stmt, 3, resume ? afterDue : INT64_MIN);
+        sqlite3_bind_int(stmt, 4, resume ? afterId : 0);
+        sqlite3_bind_int(stmt, 5, wanted);
+        while ((rc = sqlite3_step(stmt)) == SQLITE_ROW) {
+            result.rows.push_back(readTask(stmt));
+        }
+        sqlite3_reset(stmt);
+    }
+    if (rc != SQLITE_DONE) {
+        result.ok = false;
+        result.error = std::string("Failed to read overdue tasks: ") + sqlite3_errmsg(db);
+    }
+
+    finalize(stmt);
+    return result;
+}
+
+Rows<DeadlineRecord> listPendingDeadlines(sqlite3* db) {
+    EHS_MEASURE("core.listPendingDeadlines");
+    Rows<DeadlineRecord> result;
+    const char* sql = "SELECT id, due_at FROM tasks INDEXED BY idx_tasks_deadline "
+                      "WHERE status != 'completed' AND due_at IS NOT NULL AND status = 'pending';";
+    sqlite3_stmt* stmt = nullptr;
+
+    if (prepare(db, sql, &stmt) != SQLITE_OK) {
+        result.ok = false;
+        result.error = std::string("Failed to prepare deadline query: ") + sqlite3_errmsg(db);
+        return result;
+    }
+
+    int rc;
+    while ((rc = sqlite3_step(stmt)) == SQLITE_ROW) {
+        DeadlineRecord deadline;
+        deadline.taskId = sqlite3_column_int(stmt, 0);
+        deadline.dueAt = sqlite3_column_int64(stmt, 1);
+        result.rows.push_back(deadline);
+    }
+    if (rc != SQLITE_DONE) {
+        result.ok = false;
+        result.error = std::string("Failed to read deadlines: ") + sqlite3_errmsg(db);
+    }
+
+    finalize(stmt);
+    return result;
+}
+
+Rows<DeadlineRecord> pendingDeadlines(sqlite3* db, const std::vector<int>& taskIds) {
+    EHS_MEASURE("core.pendingDeadlines");
+    Rows<DeadlineRecord> result;
+    const char* sql = "SELECT due_at FROM tasks WHERE id = ? AND status = 'pending' AND due_at IS NOT NULL;";
+    sqlite3_stmt* stmt = nullptr;
+
+    if (prepare(db, sql, &stmt) != SQLITE_OK) {
+        result.ok = false;
+        result.error = std::string("Failed to prepare deadline query: ") + sqlite3_errmsg(db);
+        return result;
+    }
+
+    for (int taskId : taskIds) {
+        sqlite3_bind_int(stmt, 1, taskId);
+        int rc = sqlite3_step(stmt);
+        if (rc == SQLITE_ROW) {
+            DeadlineRecord deadline;
+            deadline.taskId = taskId;
+            deadline.dueAt = sqlite3_column_int64(stmt, 0);
+            result.rows.push_back(deadline);
+        } else if (rc != SQLITE_DONE) {
+            result.ok = false;
+            result.error = std::string("Failed to read deadlines: ") + sqlite3_errmsg(db);
+            break;
+        }
+        sqlite3_reset(stmt);
+    }
+
+    finalize(stmt);
+    return result;
+}
+
+Rows<WorkerRecord> listWorkers(sqlite3* db) {
+    EHS_MEASURE("core.listWorkers");
+    Rows<WorkerRecord> result;
+    const char* sql = "SELECT id, username FROM users WHERE role = 'worker';";
+    sqlite3_stmt* stmt = nullptr;
+
+    if (prepare(db, sql, &stmt) != SQLITE_OK) {
+        result.ok = false;
+        result.error = std::string("Failed to list workers: ") + sqlite3_errmsg(db);
+        return result;
+    }
+
+    while (sqlite3_step(stmt) == SQLITE_ROW) {
+        WorkerRecord worker;
+        worker.id = sqlite3_column_int(stmt, 0);
+        worker.username = columnText(stmt, 1);
+        result.rows.push_back(worker);
+    }
+
+    finalize(stmt);
+    return result;
+}
+
+Rows<WorkerLoad> listWorkerLoads(sqlite3* db) {
+    EHS_MEASURE("core.listWorkerLoads");
+    Rows<WorkerLoad> result;
+    const char* sql = "SELECT l.worker_id, u.username, l.open_tasks, l.weight, l.available "
+                      "FROM worker_load l JOIN users u ON u.id = l.worker_id "
+                      "ORDER BY l.available DESC, l.open_tasks * 1.0 / l.weight, l.worker_id;";
+    sqlite3_stmt* stmt = nullptr;
+
+    if (prepare(db, sql, &stmt) != SQLITE_OK) {
+        result.ok = false;
+        result.error = std::string("Failed to list worker loads: ") + sqlite3_errmsg(db);
+        return result;
+    }
+
+    int rc;
+    while ((rc = sqlite3_step(stmt)) == SQLITE_ROW) {
+        WorkerLoad load;
+        load.workerId = sqlite3_column_int(stmt, 0);
+        load.username = columnText(stmt, 1);
+        load.openTasks = sqlite3_column_int(stmt, 2);
+        load.weight = sqlite3_column_int(stmt, 3);
+        load.available = sqlite3_column_int(stmt, 4) != 0;
+        result.rows.push_back(load);
+    }
+    if (rc != SQLITE_DONE) {
+        result.ok = false;
+        result.error = std::string("Failed to list worker loads: ") + sqlite3_errmsg(db);
+    }
+
+    finalize(stmt);
+    return result;
+}
+
+Result setWorkerAvailability(sqlite3* db, int workerId, bool available, int weight) {
+    EHS_MEASURE("core.setWorkerAvailability");
+    if (weight < 0 || weight > 1000) {
+        return failure("Weight must be 0 to keep the current weight, or between 1 and 1000.");
+    }
+
+    const char* sql = "UPDATE worker_load SET available = ?, weight = IIF(?2 > 0, ?2, weight) WHERE worker_id = ?3;";
+    sqlite3_stmt* stmt = nullptr;
+
+    if (prepare(db, sql, &stmt) != SQLITE_OK) {
+        return failure(db, "Failed to update worker availability");
+    }
+
+    sqlite3_bind_int(stmt, 1, available ? 1 : 0);
+    sqlite3_bind_int(stmt, 2, weight);
+    sqlite3_bind_int(stmt, 3, workerId);
+
+    Result result = runWrite(db, stmt, "Failed to update worker availability");
+    if (result.ok && result.changes == 0) {
+        return failure("Worker not found.");
+    }
+    return result;
+}
+
+Rows<RuleRecord> listRules(sqlite3* db) {
+    EHS_MEASURE("core.listRules");
+    Rows<RuleRecord> result;
+    const char* sql = "SELECT id, rule_text, timestamp FROM rules;";
+    sqlite3_stmt* stmt = nullptr;
+
+    if (prepare(db, sql, &stmt) != SQLITE_OK) {
+        result.ok = false;
+        result.error = std::string("SQL error: ") + sqlite3_errmsg(db);
+        return result;
+    }
+
+    int rc;
+    while ((rc = sqlite3_step(stmt)) == SQLITE_ROW) {
+        RuleRecord rule;
+        rule.id = sqlite3_column_int(stmt, 0);
+        rule.text = columnText(stmt, 1);
+        rule.timestamp = columnText(stmt, 2);
+        result.rows.push_back(rule);
+    }
+    if (rc != SQLITE_DONE) {
+        result.ok = false;
+        result.error = std::string("Execution failed: ") + sqlite3_errmsg(db);
+    }
+
+    finalize(stmt);
+    return result;
+}
+
+Result assignTask(sqlite3* db, int workerId, const std::string& description, sqlite3_int64 dueAt, int priority) {
+    EHS_MEASURE("core.assignTask");
+    if (description.empty()) {
+        return failure("Task description cannot be empty.");
+    }
+    if (priority < 1 || priority > 3) {
+        return failure("Priority must be high, normal or low.");
+    }
+
+    // The username is copied from the worker row in the same statement
+    const char* sql = "INSERT INTO tasks (worker_id, worker_username, task_description, status, due_at, priority) "
+                      "SELECT id, username, ?, 'pending', ?, ? FROM users WHERE id = ? AND role = 'worker';";
+    sqlite3_stmt* stmt = nullptr;
+
+    if (prepare(db, sql, &stmt) != SQLITE_OK) {
+        return failure(db, "Failed to assign task");
+    }
+
+    sqlite3_bind_text(stmt, 1, description.c_str(), -1, SQLITE_STATIC);
+    if (dueAt > 0) {
+        sqlite3_bind_int64(stmt, 2, dueAt);
+    } else {
+        sqlite3_bind_null(stmt, 2);
+    }
+    sqlite3_bind_int(stmt, 3, priority);
+    sqlite3_bind_int(stmt, 4, workerId);
+
+    Result result = runWrite(db, stmt, "Failed to assign task", true);
+    if (result.ok && result.changes == 0) {
+        return failure("Worker not found.");
+    }
+    return result;
+}
+
+Rows<TaskRecord> autoAssignTasks(sqlite3* db, const std::vector<std::string>& descriptions, sqlite3_int64 dueAt,
+                                 int priority, const std::string& site, sqlite3_int64 from, sqlite3_int64 to) {
+    EHS_MEASURE("core.autoAssignTasks");
+    Rows<TaskRecord> result;
+    auto fail = [&result](const std::string& error) {
+        result.ok = false;
+        result.error = error;
+        result.rows.clear();
+        return result;
+    };
+    if (descriptions.empty()) {
+        return fail("No tasks to assign.");
+    }
+    for (const std::string& description : descriptions) {
+        if (description.empty()) {
+            return fail("Task description cannot be empty.");
+        }
+    }
+    if (priority < 1 || priority > 3) {
+        return fail("Priority must be high, normal or low.");
+    }
+
+    if (sqlite3_exec(db, "SAVEPOINT auto_assign;", nullptr, nullptr, nullptr) != SQLITE_OK) {
+        return fail(std::string("Failed to start assigning tasks: ") + sqlite3_errmsg(db));
+    }
+
+    // Without a site, the least-loaded worker is the first entry of the partial index, and the insert trigger
+    // moves them along it; with one, the worker comes off the heap of those on shift and goes back one task heavier
+    const char* leastLoadedSql =
+        "INSERT INTO tasks (worker_id, worker_username, task_description, status, due_at, priority) "
+        "SELECT u.id, u.username, ?, 'pending', ?, ? "
+        "FROM worker_load l INDEXED BY idx_worker_load_least JOIN users u ON u.id = l.worker_id "
+        "WHERE l.available = 1 ORDER BY l.open_tasks * 1.0 / l.weight, l.worker_id LIMIT 1 "
+        "RETURNING id, worker_id, worker_username;";
+    const char* workerSql = "INSERT INTO tasks (worker_id, worker_username, task_description, status, due_at, priority) "
+                            "SELECT id, username, ?, 'pending', ?, ? FROM users WHERE id = ? "
+                            "RETURNING id, worker_id, worker_username;";
+    std::vector<Candidate> candidates;
+    std::string error;
+    if (!site.empty() && !readCandidates(db, site, from, to, candidates, error)) {
+        fail(error);
+    }
+    std::priority_queue<Candidate, std::vector<Candidate>, std::greater<Candidate>> onShift(
+        std::greater<Candidate>(), std::move(candidates));
+
+    sqlite3_stmt* stmt = nullptr;
+    if (result.ok && prepare(db, site.empty() ? leastLoadedSql : workerSql, &stmt) != SQLITE_OK) {
+        fail(std::string("Failed to assign tasks: ") + sqlite3_errmsg(db));
+    }
+    for (size_t i = 0; result.ok && i < descriptions.size(); ++i) {
+        sqlite3_bind_text(stmt, 1, descriptions[i].c_str(), -1, SQLITE_STATIC);
+        if (dueAt > 0) {
+            sqlite3_bind_int64(stmt, 2, dueAt);
+        } else {
+            sqlite3_bind_null(stmt, 2);
+        }
+        sqlite3_bind_int(stmt, 3, priority);
+        Candidate next;
+        if (!site.empty()) {
+            if (onShift.empty()) {
+                fail("No worker is on shift at " + site + " then.");
+                break;
+            }
+            next = onShift.top();
+            onShift.pop();
+            sqlite3_bind_int(stmt, 4, next.workerId);
+        }
+        int rc = sqlite3_step(stmt);
+        if (rc == SQLITE_ROW) {
+            TaskRecord task;
+            task.id = sqlite3_column_int(stmt, 0);
+            task.workerId = sqlite3_column_int(stmt, 1);
+            task.workerUsername = columnText(stmt, 2);
+            task.description = descriptions[i];
+            task.status = "pending";
+            task.dueAt = dueAt;
+            task.priority = priority;
+            result.rows.push_back(task);
+            rc = sqlite3_step(stmt);
+            if (!site.empty()) {
+                ++next.openTasks;
+                onShift.push(next);
+            }
+        } else if (rc == SQLITE_DONE) {
+            fail(site.empty() ? "No worker is available." : "Worker not found.");
+        }
+        if (result.ok && rc != SQLITE_DONE) {
+            fail(std::string("Failed to assign tasks: ") + sqlite3_errmsg(db));
+        }
+        sqlite3_reset(stmt);
+    }
+    finalize(stmt);
+
+    if (!result.ok) {
+        sqlite3_exec(db, "ROLLBACK TO auto_assign; RELEASE auto_assign;", nullptr, nullptr, nullptr);
+        return result;
+    }
+    if (sqlite3_exec(db, "RELEASE auto_assign;", nullptr, nullptr, nullptr) != SQLITE_OK) {
+        return fail(std::string("Failed to commit assigned tasks: ") + sqlite3_errmsg(db));
+    }
+    return result;
+}
+
+Result addShift(sqlite3* db, int workerId, const std::string& site, sqlite3_int64 startsAt, sqlite3_int64 endsAt) {
+    EHS_MEASURE("core.addShift");
+    if (site.empty()) {
+        return failure("Site cannot be empty.");
+    }
+    if (endsAt <= startsAt) {
+        return failure("A shift must end after it starts.");
+    }
+    if (endsAt - startsAt > kMaxShiftSeconds) {
+        return failure("A shift cannot be longer than 24 hours.");
+    }
+
+    const char* sql = "INSERT INTO shifts (worker_id, site, starts_at, ends_at) "
+                      "SELECT id, ?, ?, ? FROM users WHERE id = ? AND role = 'worker';";
+    sqlite3_stmt* stmt = nullptr;
+
+    if (prepare(db, sql, &stmt) != SQLITE_OK) {
+        return failure(db, "Failed to add shift");
+    }
+
+    sqlite3_bind_text(stmt, 1, site.c_str(), -1, SQLITE_STATIC);
+    sqlite3_bind_int64(stmt, 2, startsAt);
+    sqlite3_bind_int64(stmt, 3, endsAt);
+    sqlite3_bind_int(stmt, 4, workerId);
+
+    Result result = runWrite(db, stmt, "Failed to add shift", true);
+    if (result.ok && result.changes == 0) {
+        return failure("Worker not found.");
+    }
+    return result;
+}
+
+Result deleteShift(sqlite3* db, int shiftId) {
+    EHS_MEASURE("core.deleteShift");
+    const char* sql = "DELETE FROM shifts WHERE id = ?;";
+    sqlite3_stmt* stmt = nullptr;
+
+    if (prepare(db, sql, &stmt) != SQLITE_OK) {
+        return failure(db, "Couldn't prepare the delete statement");
+    }
+
+    sqlite3_bind_int(stmt, 1, shiftId);
+
+    Result result = runWrite(db, stmt, "Failed to delete shift");
+    if (result.ok && result.changes == 0) {
+        return failure("Shift not found.");
+    }
+    return result;
+}
+
+Rows<ShiftRecord> listShifts(sqlite3* db, int workerId, sqlite3_int64 from) {
+    EHS_MEASURE("core.listShifts");
+    Rows<ShiftRecord> result;
+    std::string sql = std::string(kShiftColumns) +
+                      "WHERE s.worker_id = ? AND s.starts_at > ? AND s.ends_at > ? ORDER BY s.starts_at, s.id;";
+    sqlite3_stmt* stmt = nullptr;
+
+    if (prepare(db, sql.c_str(), &stmt) != SQLITE_OK) {
+        result.ok = false;
+        result.error = std::string("Failed to list shifts: ") + sqlite3_errmsg(db);
+        return result;
+    }
+
+    sqlite3_bind_int(stmt, 1, workerId);
+    sqlite3_bind_int64(stmt, 2, from - kMaxShiftSeconds);
+    sqlite3_bind_int64(stmt, 3, from);
+
+    int rc;
+    while ((rc = sqlite3_step(stmt)) == SQLITE_ROW) {
+        result.rows.push_back(readShift(stmt));
+    }
+    if (rc != SQLITE_DONE) {
+        result.ok = false;
+        result.error = std::string("Failed to list shifts: ") + sqlite3_errmsg(db);
+    }
+
+    finalize(stmt);
+    return result;
+}
+
+Rows<ShiftRecord> listOnShift(sqlite3* db, const std::string& site, sqlite3_int64 from, sqlite3_int64 to) {
+    EHS_MEASURE("core.listOnShift");
+    Rows<ShiftRecord> result;
+    // An overlapping shift ends after from and lasts at most kMaxShiftSeconds, so it started less than that before
+    std::string sql = std::string(kShiftColumns) +
+                      "WHERE s.site = ? AND s.starts_at > ? AND s.starts_at < ? AND s.ends_at > ? "
+                      "ORDER BY s.starts_at, s.id;";
+    sqlite3_stmt* stmt = nullptr;
+
+    if (prepare(db, sql.c_str(), &stmt) != SQLITE_OK) {
+        result.ok = false;
+        result.error = std::string("Failed to list shifts: ") + sqlite3_errmsg(db);
+        return result;
+    }
+
+    sqlite3_bind_text(stmt, 1, site.c_str(), -1, SQLITE_STATIC);
+    sqlite3_bind_int64(stmt, 2, from - kMaxShiftSeconds);
+    sqlite3_bind_int64(stmt, 3, to);
+    sqlite3_bind_int64(stmt, 4, from);
+
+    int rc;
+    while ((rc = sqlite3_step(stmt)) == SQLITE_ROW) {
+        result.rows.push_back(readShift(stmt));
+    }
+    if (rc != SQLITE_DONE) {
+        result.ok = false;
+        result.error = std::string("Failed to list shifts: ") + sqlite3_errmsg(db);
+    }
+
+    finalize(stmt);
+    return result;
+}
+
+Result markOverdue(sqlite3* db, const std::vector<int>& taskIds, sqlite3_int64 now) {
+    EHS_MEASURE("core.markOverdue");
+    // One savepoint for all the updates; outside a transaction it commits them once rather than per task
+    if (sqlite3_exec(db, "SAVEPOINT mark_overdue;", nullptr, nullptr, nullptr) != SQLITE_OK) {
+        return failure(db, "Failed to start marking overdue tasks");
+    }
+
+    const char* sql = "UPDATE tasks SET status = 'overdue' WHERE id = ? AND status = 'pending' AND due_at <= ?;";
+    sqlite3_stmt* stmt = nullptr;
+    Result result;
+    if (prepare(db, sql, &stmt) != SQLITE_OK) {
+        result = failure(db, "Failed to mark overdue tasks");
+    }
+    for (size_t i = 0; result.ok && i < taskIds.size(); ++i) {
+        sqlite3_bind_int(stmt, 1, taskIds[i]);
+        sqlite3_bind_int64(stmt, 2, now);
+        if (sqlite3_step(stmt) != SQLITE_DONE) {
+            result = failure(db, "Failed to mark overdue tasks");
+        }
+        result.changes += sqlite3_changes(db);
+        sqlite3_reset(stmt);
+    }
+    finalize(stmt);
+
+    if (!result.ok) {
+        sqlite3_exec(db, "ROLLBACK TO mark_overdue; RELEASE mark_overdue;", nullptr, nullptr, nullptr);
+        return result;
+    }
+    if (sqlite3_exec(db, "RELEASE mark_overdue;", nullptr, nullptr, nullptr) != SQLITE_OK) {
+        return failure(db, "Failed to commit overdue tasks");
+    }
+    return result;
+}
+
+Result reportViolation(sqlite3* db, int taskId, const std::string& status, const std::string& comment) {
+    EHS_MEASURE("core.reportViolation");
+    if (status.empty()) {
+        return failure("Task status cannot be empty.");
+    }
+
+    std::string timestamp = currentTimestamp();
+    const char* sql = "UPDATE tasks SET status = ?, violation_comment = ?, violation_timestamp = ? WHERE id = ?;";
+    sqlite3_stmt* stmt = nullptr;
+
+    if (prepare(db, sql, &stmt) != SQLITE_OK) {
+        return failure(db, "Failed to update task");
+    }
+
+    sqlite3_bind_text(stmt, 1, status.c_str(), -1, SQLITE_STATIC);
+    sqlite3_bind_text(stmt, 2, comment.c_str(), -1, SQLITE_STATIC);
+    sqlite3_bind_text(stmt, 3, timestamp.c_str(), -1, SQLITE_STATIC);
+    sqlite3_bind_int(stmt, 4, taskId);
+
+    Result result = runWrite(db, stmt, "Failed to update task");
+    if (result.ok && result.changes == 0) {
+        return failure("Task not found.");
+    }
+    return result;
+}
+
+std::string taskMediaPath(int taskId, int workerId) {
+    return "./uploads/task_" + std::to_string(taskId) + "_user_" + std::to_string(workerId);
+}
+
+Result checkTaskAssignment(sqlite3* db, int taskId, int workerId) {
+    const char* sql = "SELECT 1 FROM tasks WHERE id = ? AND worker_id = ?;";
+    sqlite3_stmt* stmt = nullptr;
+
+    if (prepare(db, sql, &stmt) != SQLITE_OK) {
+        return failure(db, "Failed to prepare statement");
+    }
+
+    sqlite3_bind_int(stmt, 1, taskId);
+    sqlite3_bind_int(stmt, 2, workerId);
+
+    int rc = sqlite3_step(stmt);
+    finalize(stmt);
+    if (rc == SQLITE_ROW) {
+        return Result();
+    }
+    if (rc != SQLITE_DONE) {
+        return failure(db, "Failed to look up task");
+    }
+    return failure("Task is not assigned to this worker.");
+}
+
+Result saveTaskMedia(int taskId, int workerId, const std::string& mediaPath) {
+    EHS_MEASURE("core.saveTaskMedia");
+    trace::Span span("media.copy", "media");
+    std::error_code ec;
+    std::filesystem::create_directories("./uploads", ec);
+    std::filesystem::copy(mediaPath, taskMediaPath(taskId, workerId),
+                          std::filesystem::copy_options::overwrite_existing, ec);
+    if (ec) {
+        return failure("Failed to save media: " + ec.message());
+    }
+    return Result();
+}
+
+Result storeTaskMedia(int taskId, int workerId, const std::string& data) {
+    EHS_MEASURE("core.storeTaskMedia");
+    trace::Span span("media.store", "media");
+    std::error_code ec;
+    std::filesystem::create_directories("./uploads", ec);
+    std::ofstream out(taskMediaPath(taskId, workerId), std::ios::binary | std::ios::trunc);
+    if (!out || !out.write(data.data(), static_cast<std::streamsize>(data.size())).flush()) {
+        return failure("Failed to save media: could not write " + taskMediaPath(taskId, workerId));
+    }
+    return Result();
+}
+
+Result recordTaskReport(sqlite3* db, int taskId, int workerId, const std::string& report,
+                        const std::string& savedMediaPath) {
+    EHS_MEASURE("core.recordTaskReport");
+    std::string timestamp = currentTimestamp();
+    const char* sql = "UPDATE tasks SET worker_report = ?, worker_media = ?, status = 'completed', completed_at = ? "
+                      "WHERE id = ? AND worker_id = ?;";
+    sqlite3_stmt* stmt = nullptr;
+
+    if (prepare(db, sql, &stmt) != SQLITE_OK) {
+        return failure(db, "Failed to prepare statement");
+    }
+
+    sqlite3_bind_text(stmt, 1, report.c_str(), -1, SQLITE_STATIC);
+    sqlite3_bind_text(stmt, 2, savedMediaPath.c_str(), -1, SQLITE_STATIC);
+    sqlite3_bind_text(stmt, 3, timestamp.c_str(), -1, SQLITE_STATIC);
+    sqlite3_bind_int(stmt, 4, taskId);
+    sqlite3_bind_int(stmt, 5, workerId);
+
+    Result result = runWrite(db, stmt, "Failed to submit report");
+    if (result.ok && result.changes == 0) {
+        std::error_code ec;
+        std::filesystem::remove(savedMediaPath, ec);
+        return failure("Task is not assigned to this worker.");
+    }
+    return result;
+}
+
+Result submitTaskReport(sqlite3* db, int taskId, int workerId, const std::string& report,
+                        const std::string& mediaPath) {
+    EHS_MEASURE("core.submitTaskReport");
+    Result assigned = checkTaskAssignment(db, taskId, workerId);
+    if (!assigned.ok) {
+        return assigned;
+    }
+    Result saved = saveTaskMedia(taskId, workerId, mediaPath);
+    if (!saved.ok) {
+        return saved;
+    }
+    return recordTaskReport(db, taskId, workerId, report, taskMediaPath(taskId, workerId));
+}
+
+Result addRule(sqlite3* db, const std::string& text) {
+    EHS_MEASURE("core.addRule");
+    if (text.empty()) {
+        return failure("Rule cannot be empty.");
+    }
+
+    std::string timestamp = currentTimestamp();
+    const char* sql = "INSERT INTO rules (rule_text, timestamp) VALUES (?, ?);";
+    sqlite3_stmt* stmt = nullptr;
+
+    if (prepare(db, sql, &stmt) != SQLITE_OK) {
+        return failure(db, "SQL error");
+    }
+
+    sqlite3_bind_text(stmt, 1, text.c_str(), -1, SQLITE_STATIC);
+    sqlite3_bind_text(stmt, 2, timestamp.c_str(), -1, SQLITE_STATIC);
+
+    return runWrite(db, stmt, "Execution failed", true);
+}
+
+Result deleteRule(sqlite3* db, int ruleId) {
+    EHS_MEASURE("core.deleteRule");
+    const char* sql = "DELETE FROM rules WHERE id = ?;";
+    sqlite3_stmt* stmt = nullptr;
+
+    if (prepare(db, sql, &stmt) != SQLITE_OK) {
+        return failure(db, "Couldn't prepare the delete statement");
+    }
+
+    sqlite3_bind_int(stmt, 1, ruleId);
+
+    Result result = runWrite(db, stmt, "Failed to delete rule");
+    if (result.ok && result.changes == 0) {
+        return failure("Rule not found.");
+    }
+    return result;
+}
+
+Result deleteTask(sqlite3* db, int taskId) {
+    EHS_MEASURE("core.deleteTask");
+    const char* sql = "DELETE FROM tasks WHERE id = ?;";
+    sqlite3_stmt* stmt = nullptr;
+
+    if (prepare(db, sql, &stmt) != SQLITE_OK) {
+        return failure(db, "Couldn't prepare the delete statement");
+    }
+
+    sqlite3_bind_int(stmt, 1, taskId);
+
+    Result result = runWrite(db, stmt, "Failed to delete task");
+    if (result.ok && result.changes == 0) {
+        return failure("Task not found.");
+    }
+    return result;
+}
+
+Result submitRuleFeedback(sqlite3* db, int ruleId, int workerId, int rating, const std::string& text) {
+    EHS_MEASURE("core.submitRuleFeedback");
+    if (text.empty()) {
+        return failure("Feedback cannot be empty.");
+    }
+    if (rating < 0 || rating > 5) {
+        return failure("Rating must be 1-5, or 0 for none.");
+    }
+
+    std::string timestamp = currentTimestamp();
+    const char* sql = "INSERT INTO rule_feedback (rule_id, worker_id, created_at, rating, feedback_text) "
+                      "SELECT id, ?, ?, ?, ? FROM rules WHERE id = ?;";
+    sqlite3_stmt* stmt = nullptr;
+
+    if (prepare(db, sql, &stmt) != SQLITE_OK) {
+        return failure(db, "Failed to prepare statement");
+    }
+
+    sqlite3_bind_int(stmt, 1, workerId);
+    sqlite3_bind_text(stmt, 2, timestamp.c_str(), -1, SQLITE_STATIC);
+    if (rating > 0) {
+        sqlite3_bind_int(stmt, 3, rating);
+    } else {
+        sqlite3_bind_null(stmt, 3);
+    }
+    sqlite3_bind_text(stmt, 4, text.c_str(), -1, SQLITE_STATIC);
+    sqlite3_bind_int(stmt, 5, ruleId);
+
+    Result result = runWrite(db, stmt, "Failed to submit feedback", true);
+    if (result.ok && result.changes == 0) {
+        return failure("Rule not found.");
+    }
+    return result;
+}
+
+Rows<FeedbackSummary> listFeedbackSummaries(sqlite3* db) {
+    EHS_MEASURE("core.listFeedbackSummaries");
+    Rows<FeedbackSummary> result;
+    const char* sql = "SELECT r.id, r.rule_text, IFNULL(s.feedback_count, 0), IFNULL(s.rating_count, 0), "
+                      "IFNULL(s.rating_sum, 0) FROM rules r LEFT JOIN rule_feedback_stats s ON s.rule_id = r.id;";
+    sqlite3_stmt* stmt = nullptr;
+
+    if (prepare(db, sql, &stmt) != SQLITE_OK) {
+        result.ok = false;
+        result.error = std::string("Failed to prepare statement: ") + sqlite3_errmsg(db);
+        return result;
+    }
+
+    while (sqlite3_step(stmt) == SQLITE_ROW) {
+        FeedbackSummary summary;
+        summary.ruleId = sqlite3_column_int(stmt, 0);
+        summary.ruleText = columnText(stmt, 1);
+        summary.feedbackCount = sqlite3_column_int(stmt, 2);
+        summary.ratingCount = sqlite3_column_int(stmt, 3);
+        summary.ratingSum = sqlite3_column_int64(stmt, 4);
+        result.rows.push_back(summary);
+    }
+
+    finalize(stmt);
+    return result;
+}
+
+Rows<FeedbackRecord> listRuleFeedback(sqlite3* db, int ruleId, sqlite3_int64 beforeId, int limit) {
+    EHS_MEASURE("core.listRuleFeedback");
+    Rows<FeedbackRecord> result;
+    const char* sql = "SELECT id, worker_id, created_at, rating, feedback_text FROM rule_feedback "
+                      "WHERE rule_id = ? AND id < ? ORDER BY id DESC LIMIT ?;";
+    sqlite3_stmt* stmt = nullptr;
+
+    if (prepare(db, sql, &stmt) != SQLITE_OK) {
+        result.ok = false;
+        result.error = std::string("Failed to prepare statement: ") + sqlite3_errmsg(db);
+        return result;
+    }
+
+    sqlite3_bind_int(stmt, 1, ruleId);
+    sqlite3_bind_int64(stmt, 2, beforeId > 0 ? beforeId : INT64_MAX);
+    sqlite3_bind_int(stmt, 3, limit);
+
+    while (sqlite3_step(stmt) == SQLITE_ROW) {
+        FeedbackRecord feedback;
+        feedback.id = sqlite3_column_int64(stmt, 0);
+        feedback.ruleId = ruleId;
+        feedback.workerId = sqlite3_column_type(stmt, 1) == SQLITE_NULL ? -1 : sqlite3_column_int(stmt, 1);
+        feedback.createdAt = columnText(stmt, 2);
+        feedback.rating = sqlite3_column_int(stmt, 3);
+        feedback.text = columnText(stmt, 4);
+        result.rows.push_back(feedback);
+    }
+
+    finalize(stmt);
+    return result;
+}
+
+SearchResult search(sqlite3* db, const std::string& query, int workerId, int limit) {
+    EHS_MEASURE("core.search");
+    const char* rulesSql =
+        "SELECT rowid, snippet(rules_fts, 0, '[', ']', '...', 12) FROM rules_fts "
+        "WHERE rules_fts MATCH ? ORDER BY rank LIMIT ?;";
+    const char* tasksSql = workerId < 0
+        ? "SELECT rowid, snippet(tasks_fts, -1, '[', ']', '...', 12) FROM tasks_fts "
+          "WHERE tasks_fts MATCH ? ORDER BY rank LIMIT ?;"
+        : "SELECT f.rowid, snippet(tasks_fts, -1, '[', ']', '...', 12) FROM tasks_fts f "
+          "JOIN tasks t ON t.id = f.rowid WHERE tasks_fts MATCH ?1 AND t.worker_id = ?3 "
+          "ORDER BY f.rank LIMIT ?2;";
+
+    // Hits are collected per attempt and returned only from one that completes, so a retry never repeats them
+    SearchResult result;
+    std::string ftsQuery = query;
+    for (int attempt = 0; attempt < 2; ++attempt) {
+        result.rules.clear();
+        result.tasks.clear();
+
+        int rc = searchMatches(db, rulesSql, ftsQuery, -1, limit, result.rules);
+        if (rc == SQLITE_DONE) {
+            rc = searchMatches(db, tasksSql, ftsQuery, workerId, limit, result.tasks);
+        }
+        if (rc == SQLITE_DONE) {
+            return result;
+        }
+
+        // Treat the input as a literal phrase if it is not valid query syntax
+        std::string phrase = "\"";
+        for (char c : query) {
+            phrase += c;
+            if (c == '"') phrase += '"';
+        }
+        ftsQuery = phrase + "\"";
+    }
+
+    result.ok = false;
+    result.error = std::string("Search failed: ") + sqlite3_errmsg(db);
+    result.rules.clear();
+    result.tasks.clear();
+    return result;
+}
+
+Result addSchedule(sqlite3* db, int workerId, const std::string& description, sqlite3_int64 intervalSeconds,
+                   sqlite3_int64 firstDue) {
+    EHS_MEASURE("core.addSchedule");
+    if (description.empty()) {
+        return failure("Task description cannot be empty.");
+    }
+    if (intervalSeconds < 60) {
+        return failure("Interval must be at least a minute.");
+    }
+
+    const char* sql = "INSERT INTO schedules (worker_id, task_description, interval_seconds, next_due) "
+                      "SELECT id, ?, ?, ? FROM users WHERE id = ? AND role = 'worker';";
+    sqlite3_stmt* stmt = nullptr;
+
+    if (prepare(db, sql, &stmt) != SQLITE_OK) {
+        return failure(db, "Failed to add schedule");
+    }
+
+    sqlite3_bind_text(stmt, 1, description.c_str(), -1, SQLITE_STATIC);
+    sqlite3_bind_int64(stmt, 2, intervalSeconds);
+    sqlite3_bind_int64(stmt, 3, firstDue);
+    sqlite3_bind_int(stmt, 4, workerId);
+
+    Result result = runWrite(db, stmt, "Failed to add schedule", true);
+    if (result.ok && result.changes == 0) {
+        return failure("Worker not found.");
+    }
+    return result;
+}
+
+Rows<ScheduleRecord> listSchedules(sqlite3* db, int afterId, int limit) {
+    EHS_MEASURE("core.listSchedules");
+    Rows<ScheduleRecord> result;
+    const char* sql = "SELECT s.id, s.worker_id, u.username, s.task_description, s.interval_seconds, s.next_due "
+                      "FROM schedules s LEFT JOIN users u ON u.id = s.worker_id "
+                      "WHERE s.id > ? ORDER BY s.id LIMIT ?;";
+    sqlite3_stmt* stmt = nullptr;
+
+    if (prepare(db, sql, &stmt) != SQLITE_OK) {
+        result.ok = false;
+        result.error = std::string("Failed to prepare schedule query: ") + sqlite3_errmsg(db);
+        return result;
+    }
+
+    sqlite3_bind_int(stmt, 1, afterId);
+    sqlite3_bind_int(stmt, 2, limit);
+
+    int rc;
+    while ((rc = sqlite3_step(stmt)) == SQLITE_ROW) {
+        ScheduleRecord schedule;
+        schedule.id = sqlite3_column_int(stmt, 0);
+        schedule.workerId = sqlite3_column_int(stmt, 1);
+        schedule.workerUsername = columnText(stmt, 2);
+        schedule.description = columnText(stmt, 3);
+        schedule.intervalSeconds = sqlite3_column_int64(stmt, 4);
+        schedule.nextDue = sqlite3_column_int64(stmt, 5);
+        result.rows.push_back(schedule);
+    }
+    if (rc != SQLITE_DONE) {
+        result.ok = false;
+        result.error = std::string("Failed to read schedules: ") + sqlite3_errmsg(db);
+    }
+
+    finalize(stmt);
+    return result;
+}
+
+Result deleteSchedule(sqlite3* db, int scheduleId) {
+    EHS_MEASURE("core.deleteSchedule");
+    const char* sql = "DELETE FROM schedules WHERE id = ?;";
+    sqlite3_stmt* stmt = nullptr;
+
+    if (prepare(db, sql, &stmt) != SQLITE_OK) {
+        return failure(db, "Couldn't prepare the delete statement");
+    }
+
+    sqlite3_bind_int(stmt, 1, scheduleId);
+
+    Result result = runWrite(db, stmt, "Failed to delete schedule");
+    if (result.ok && result.changes == 0) {
+        return failure("Schedule not found.");
+    }
+    return result;
+}
+
+Result runSchedule(sqlite3* db, int scheduleId, sqlite3_int64 due, const std::vector<sqlite3_int64>& occurrences,
+                   sqlite3_int64 nextDue) {
+    EHS_MEASURE("core.runSchedule");
+    // A savepoint keeps the advance and its tasks together inside the caller's transaction
+    if (sqlite3_exec(db, "SAVEPOINT run_schedule;", nullptr, nullptr, nullptr) != SQLITE_OK) {
+        return failure(db, "Failed to start the schedule update");
+    }
+    auto rollback = [db](Result result) {
+        sqlite3_exec(db, "ROLLBACK TO run_schedule; RELEASE run_schedule;", nullptr, nullptr, nullptr);
+        return result;
+    };
+
+    sqlite3_stmt* stmt = nullptr;
+    if (prepare(db, "UPDATE schedules SET next_due = ? WHERE id = ? AND next_due = ?;", &stmt) != SQLITE_OK) {
+        return rollback(failure(db, "Failed to advance schedule"));
+    }
+    sqlite3_bind_int64(stmt, 1, nextDue);
+    sqlite3_bind_int(stmt, 2, scheduleId);
+    sqlite3_bind_int64(stmt, 3, due);
+    Result advanced = runWrite(db, stmt, "Failed to advance schedule");
+    if (!advanced.ok) {
+        return rollback(advanced);
+    }
+    if (advanced.changes == 0) {
+        return rollback(failure("Schedule not found."));
+    }
+
+    // Tasks for a worker who has since been deleted are skipped, like assignTask() would refuse them
+    const char* sql = "INSERT INTO tasks (worker_id, worker_username, task_description, status, due_at) "
+                      "SELECT u.id, u.username, s.task_description, 'pending', ? + s.interval_seconds "
+                      "FROM schedules s JOIN users u ON u.id = s.worker_id AND u.role = 'worker' WHERE s.id = ?;";
+    if (prepare(db, sql, &stmt) != SQLITE_OK) {
+        return rollback(failure(db, "Failed to create scheduled task"));
+    }
+    Result result;
+    for (sqlite3_int64 occurrence : occurrences) {
+        sqlite3_bind_int64(stmt, 1, occurrence);
+        sqlite3_bind_int(stmt, 2, scheduleId);
+        if (sqlite3_step(stmt) != SQLITE_DONE) {
+            result = failure(db, "Failed to create scheduled task");
+            break;
+        }
+        if (sqlite3_changes(db) > 0) {
+            result.id = sqlite3_last_insert_rowid(db);
+            result.changes += sqlite3_changes(db);
+        }
+        sqlite3_reset(stmt);
+    }
+    finalize(stmt);
+    if (!result.ok) {
+        return rollback(result);
+    }
+
+    if (sqlite3_exec(db, "RELEASE run_schedule;", nullptr, nullptr, nullptr) != SQLITE_OK) {
+        return rollback(failure(db, "Failed to commit the schedule update"));
+    }
+    return result;
+}
+
+}  // namespace core
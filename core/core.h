@@ -0,0 +1,602 @@
+#ifndef CORE_H_
+#define CORE_H_
+
+#include <sqlite3.h>
+#include <string>
+#include <vector>
+
+/**
+ * @namespace core
+ * @brief Headless operations of the EHS management system.
+ *
+ * Every function takes typed parameters and returns a result struct; none of
+ * them read from std::cin or write to std::cout/std::cerr. The interactive
+ * menus in User, Worker, Manager and code.cpp are a thin shell over these
+ * functions, and the same calls can be driven from a loop, a benchmark or a
+ * service. A function only touches the connection it is given, so concurrent
+ * callers need one connection per thread.
+ */
+namespace core {
+
+/**
+ * @struct Result
+ * @brief Outcome of a write operation.
+ */
+struct Result {
+    bool ok = true;           ///< True if the operation succeeded
+    std::string error;        ///< Error message when ok is false
+    sqlite3_int64 id = 0;     ///< Row ID inserted by the operation; 0 if it inserted nothing
+    int changes = 0;          ///< Number of rows changed by the operation
+};
+
+/**
+ * @struct Rows
+ * @brief Outcome of a read operation returning a list of records.
+ */
+template <typename T>
+struct Rows {
+    bool ok = true;           ///< True if the query succeeded
+    std::string error;        ///< Error message when ok is false
+    std::vector<T> rows;      ///< Records returned by the query
+};
+
+/**
+ * @struct LoginResult
+ * @brief Outcome of a credential check.
+ */
+struct LoginResult {
+    bool ok = false;          ///< True if the credentials matched a user
+    std::string error;        ///< Error message when the lookup itself failed
+    int userId = -1;          ///< ID of the logged-in user
+    std::string role;         ///< Role of the logged-in user ("worker" or "manager")
+};
+
+/// @brief A row of the tasks table.
+struct TaskRecord {
+    int id = 0;
+    int workerId = 0;
+    std::string workerUsername;
+    std::string description;
+    std::string status;
+    std::string violationComment;    ///< Empty if none
+    std::string violationTimestamp;  ///< Empty if none
+    std::string workerReport;        ///< Empty if none
+    std::string workerMedia;         ///< Empty if none
+    sqlite3_int64 dueAt = 0;         ///< Unix time of the deadline, 0 if none
+    int priority = 2;                ///< 1 high, 2 normal, 3 low
+};
+
+/// @brief A row of the rules table.
+struct RuleRecord {
+    int id = 0;
+    std::string text;
+    std::string timestamp;
+};
+
+/// @brief A user with the worker role.
+struct WorkerRecord {
+    int id = 0;
+    std::string username;
+};
+
+/// @brief A worker's open tasks and share of auto-assigned tasks, from worker_load.
+struct WorkerLoad {
+    int workerId = 0;
+    std::string username;
+    int openTasks = 0;        ///< Tasks assigned to the worker and not completed
+    int weight = 100;         ///< Percent of a full share of auto-assigned tasks
+    bool available = true;    ///< False keeps the worker out of auto-assignment
+};
+
+/// @brief Per-rule feedback counters from rule_feedback_stats.
+struct FeedbackSummary {
+    int ruleId = 0;
+    std::string ruleText;
+    int feedbackCount = 0;
+    int ratingCount = 0;
+    sqlite3_int64 ratingSum = 0;
+};
+
+/// @brief A row of the rule_feedback table.
+struct FeedbackRecord {
+    sqlite3_int64 id = 0;
+    int ruleId = 0;
+    int workerId = -1;        ///< -1 for feedback migrated from older databases
+    std::string createdAt;
+    int rating = 0;           ///< 0 if no rating was given
+    std::string text;
+};
+
+/// @brief A row of the schedules table: a task assigned again every interval.
+struct ScheduleRecord {
+    int id = 0;
+    int workerId = 0;
+    std::string workerUsername;      ///< Empty if the worker no longer exists
+    std::string description;
+    sqlite3_int64 intervalSeconds = 0;
+    sqlite3_int64 nextDue = 0;       ///< Unix time of the next occurrence
+};
+
+/// @brief A row of the shifts table: a worker on duty at a site.
+struct ShiftRecord {
+    int id = 0;
+    int workerId = 0;
+    std::string workerUsername;      ///< Empty if the worker no longer exists
+    std::string site;
+    sqlite3_int64 startsAt = 0;      ///< Unix time
+    sqlite3_int64 endsAt = 0;        ///< Unix time, after startsAt
+};
+
+/// @brief The deadline of a pending task.
+struct DeadlineRecord {
+    int taskId = 0;
+    sqlite3_int64 dueAt = 0;         ///< Unix time
+};
+
+/// @brief A ranked full-text match with a highlighted snippet.
+struct SearchHit {
+    int id = 0;
+    std::string snippet;
+};
+
+/**
+ * @struct SearchResult
+ * @brief Matching rules and tasks for a full-text query, best match first.
+ */
+struct SearchResult {
+    bool ok = true;
+    std::string error;
+    std::vector<SearchHit> rules;
+    std::vector<SearchHit> tasks;
+};
+
+/// @brief The longest shift; longer duty is entered as consecutive shifts.
+const sqlite3_int64 kMaxShiftSeconds = 24 * 3600;
+
+/**
+ * @brief Hashes a password using SHA-256.
+ *
+ * @param password Plain text password.
+ * @return Lower-case hex digest.
+ */
+std::string hashPassword(const std::string& password);
+
+/**
+ * @brief SQL condition true when tasks.violation_timestamp is still ctime text.
+ *
+ * Databases written before the core library stored violation times as
+ * ctime text ("Fri Oct 16 20:23:11 2026"). DatabaseManager::setupTables
+ * rewrites them; read-only readers convert them in the query instead.
+ */
+const char* const kLegacyViolationTimeSql =
+    "(violation_timestamp GLOB "
+    "'[A-Z][a-z][a-z] [A-Z][a-z][a-z] [ 0-3][0-9] [0-2][0-9]:[0-5][0-9]:[0-6][0-9] [0-9][0-9][0-9][0-9]' "
+    "AND instr('JanFebMarAprMayJunJulAugSepOctNovDec', substr(violation_timestamp, 5, 3)) % 3 = 1)";
+
+/// @brief SQL expression turning a ctime violation time (see kLegacyViolationTimeSql) into "YYYY-MM-DD HH:MM:SS".
+const char* const kLegacyViolationTimeToCoreSql =
+    "(substr(violation_timestamp, 21, 4) || '-' || "
+    "printf('%02d', (instr('JanFebMarAprMayJunJulAugSepOctNovDec', substr(violation_timestamp, 5, 3)) + 2) / 3) || "
+    "'-' || printf('%02d', CAST(trim(substr(violation_timestamp, 9, 2)) AS INTEGER)) || ' ' || "
+    "substr(violation_timestamp, 12, 8))";
+
+/**
+ * @brief Returns the current local time as "YYYY-MM-DD HH:MM:SS".
+ */
+std::string currentTimestamp();
+
+/**
+ * @brief Formats a Unix time as local "YYYY-MM-DD HH:MM".
+ */
+std::string formatLocalTime(sqlite3_int64 time);
+
+/**
+ * @brief Parses local "YYYY-MM-DD HH:MM[:SS]" (or "YYYY-MM-DD", meaning midnight) into a Unix time.
+ *
+ * @return False if @p text is not in one of these forms, has anything after
+ *         it, or is not a real date (e.g. February 31).
+ */
+bool parseLocalTime(const std::string& text, sqlite3_int64& time);
+
+/**
+ * @brief Parses a recurrence interval.
+ *
+ * Accepts "hourly", "daily", "weekly" or a count with a unit, such as "30m",
+ * "12h", "2d" or "1w".
+ *
+ * @return False if @p text is not an interval or is shorter than a minute.
+ */
+bool parseInterval(const std::string& text, sqlite3_int64& seconds);
+
+/**
+ * @brief Parses a task priority: "high", "normal", "low" or 1 to 3.
+ *
+ * @return False if @p text is none of these.
+ */
+bool parsePriority(const std::string& text, int& priority);
+
+/**
+ * @brief Returns "high", "normal" or "low" for a task priority.
+ */
+const char* priorityName(int priority);
+
+/**
+ * @brief Registers a new user with a hashed password.
+ *
+ * @param db SQLite database connection.
+ * @param username Unique user name.
+ * @param password Plain text password.
+ * @param role "worker" or "manager"; any other role is refused.
+ * @return Result with the new user ID.
+ */
+Result registerUser(sqlite3* db, const std::string& username, const std::string& password,
+                    const std::string& role);
+
+/**
+ * @brief Checks credentials and returns the user's ID and role in one lookup.
+ *
+ * @param db SQLite database connection.
+ * @param username User name.
+ * @param password Plain text password.
+ * @return LoginResult; ok is false if the credentials do not match.
+ */
+LoginResult login(sqlite3* db, const std::string& username, const std::string& password);
+
+/**
+ * @brief Lists tasks in id order, either all of them or those of one worker.
+ *
+ * @param db SQLite database connection.
+ * @param workerId Worker whose tasks to list, or -1 for all tasks.
+ * @param afterId Only return tasks with a larger ID; pass the last ID of the
+ *                previous page, or 0 for the first page.
+ * @param limit Maximum number of tasks, or -1 for all.
+ */
+Rows<TaskRecord> listTasks(sqlite3* db, int workerId = -1, int afterId = 0, int limit = -1);
+
+/**
+ * @brief Lists a worker's tasks that are not completed yet.
+ */
+Rows<TaskRecord> listOpenTasks(sqlite3* db, int workerId);
+
+/**
+ * @brief Lists all tasks with the given status.
+ */
+Rows<TaskRecord> listTasksByStatus(sqlite3* db, const std::string& status);
+
+/**
+ * @brief Lists one page of violations, newest first.
+ *
+ * A violation is any task with a violation time, whatever status
+ * reportViolation() gave it. Served by the partial index on violation time,
+ * so every page costs the same however deep into the list it is.
+ *
+ * @param db SQLite database connection.
+ * @param from Earliest violation time, "YYYY-MM-DD[ HH:MM:SS]"; empty for no bound.
+ * @param to Latest violation time, same format; empty for no bound.
+ * @param beforeTimestamp Violation time of the last row of the previous page; empty for the first page.
+ * @param beforeId ID of the last row of the previous page.
+ * @param limit Maximum number of rows.
+ */
+Rows<TaskRecord> listViolations(sqlite3* db, const std::string& from, const std::string& to,
+                                const std::string& beforeTimestamp, int beforeId, int limit);
+
+/**
+ * @brief Lists all users with the worker role.
+ */
+Rows<WorkerRecord> listWorkers(sqlite3* db);
+
+/**
+ * @brief Lists every worker's load: available workers least loaded first, then the unavailable ones.
+ */
+Rows<WorkerLoad> listWorkerLoads(sqlite3* db);
+
+/**
+ * @brief Sets whether a worker takes auto-assigned tasks, and how large a share.
+ *
+ * @param db SQLite database connection.
+ * @param workerId ID of the worker.
+ * @param available False to leave the worker out of autoAssignTasks().
+ * @param weight Percent of a full share, 1 to 1000: a worker at 200 is
+ *               handed twice the open tasks of one at 100. 0 keeps the current weight.
+ */
+Result setWorkerAvailability(sqlite3* db, int workerId, bool available, int weight);
+
+/**
+ * @brief Lists all safety rules.
+ */
+Rows<RuleRecord> listRules(sqlite3* db);
+
+/**
+ * @brief Lists one page of open tasks past their deadline, most urgent first.
+ *
+ * Tasks are ordered by priority, then deadline. Each priority is one range
+ * of the partial deadline index, so a page costs the same however many open
+ * tasks there are.
+ *
+ * @param db SQLite database connection.
+ * @param now Unix time; tasks due at or before it are overdue.
+ * @param afterPriority Priority of the last row of the previous page; 0 for the first page.
+ * @param afterDue Deadline of the last row of the previous page.
+ * @param afterId ID of the last row of the previous page.
+ * @param limit Maximum number of rows.
+ */
+Rows<TaskRecord> listOverdue(sqlite3* db, sqlite3_int64 now, int afterPriority, sqlite3_int64 afterDue, int afterId,
+                             int limit);
+
+/**
+ * @brief Lists the deadlines of all pending tasks that have one, from the partial deadline index.
+ */
+Rows<DeadlineRecord> listPendingDeadlines(sqlite3* db);
+
+/**
+ * @brief Returns the deadlines of those of @p taskIds that are pending and have one.
+ */
+Rows<DeadlineRecord> pendingDeadlines(sqlite3* db, const std::vector<int>& taskIds);
+
+/**
+ * @brief Assigns a new pending task to a worker.
+ *
+ * @param db SQLite database connection.
+ * @param workerId ID of the worker.
+ * @param description Task description.
+ * @param dueAt Unix time of the deadline, or 0 for none.
+ * @param priority 1 (high) to 3 (low).
+ * @return Result with the new task ID; fails if the worker does not exist.
+ */
+Result assignTask(sqlite3* db, int workerId, const std::string& description, sqlite3_int64 dueAt = 0,
+                  int priority = 2);
+
+/**
+ * @brief Assigns each description as a new pending task to the least-loaded available worker.
+ *
+ * A worker's load is their open tasks over their weight, ties going to the
+ * lowest ID. Without a site, each task takes the first entry of the partial
+ * load index on available workers, and the trigger counting the new task
+ * moves that worker along the index, so every assignment costs O(log n) in
+ * the number of workers however many are handed out at once. With a site,
+ * the workers on shift there (listOnShift()) are read once into a min-heap
+ * by load, and each task costs O(log k) in the number of them. The tasks
+ * are assigned together or not at all.
+ *
+ * @param db SQLite database connection.
+ * @param descriptions One task per description.
+ * @param dueAt Unix time of every task's deadline, or 0 for none.
+ * @param priority 1 (high) to 3 (low).
+ * @param site Only consider workers with a shift at this site overlapping
+ *             [@p from, @p to); empty for every available worker.
+ * @param from Start of the window, Unix time.
+ * @param to End of the window, Unix time.
+ * @return The new tasks, in the order of @p descriptions; fails if no worker is available.
+ */
+Rows<TaskRecord> autoAssignTasks(sqlite3* db, const std::vector<std::string>& descriptions, sqlite3_int64 dueAt = 0,
+                                 int priority = 2, const std::string& site = std::string(), sqlite3_int64 from = 0,
+                                 sqlite3_int64 to = 0);
+
+/**
+ * @brief Adds a shift to a worker's calendar.
+ *
+ * @param db SQLite database connection.
+ * @param workerId ID of the worker; fails if the worker does not exist.
+ * @param site Where the worker is on duty.
+ * @param startsAt Unix time the shift starts.
+ * @param endsAt Unix time it ends, at most kMaxShiftSeconds later.
+ * @return Result with the new shift ID.
+ */
+Result addShift(sqlite3* db, int workerId, const std::string& site, sqlite3_int64 startsAt, sqlite3_int64 endsAt);
+
+/**
+ * @brief Deletes a shift.
+ */
+Result deleteShift(sqlite3* db, int shiftId);
+
+/**
+ * @brief Lists a worker's shifts that end after @p from, earliest first.
+ */
+Rows<ShiftRecord> listShifts(sqlite3* db, int workerId, sqlite3_int64 from);
+
+/**
+ * @brief Lists the shifts at a site overlapping [@p from, @p to): who is on shift there then.
+ *
+ * Since no shift is longer than kMaxShiftSeconds, the overlapping shifts all
+ * start in one range of the site index, from a day before @p from up to
+ * @p to. The query is one seek into it, O(log n) in the number of shifts,
+ * plus the shifts in that range.
+ *
+ * @param db SQLite database connection.
+ * @param site Site name.
+ * @param from Start of the window, Unix time.
+ * @param to End of the window, Unix time; pass @p from + 1 for an instant.
+ */
+Rows<ShiftRecord> listOnShift(sqlite3* db, const std::string& site, sqlite3_int64 from, sqlite3_int64 to);
+
+/**
+ * @brief Marks pending tasks whose deadline has passed as "overdue".
+ *
+ * Each update is guarded by the task's current status and deadline, so an ID
+ * whose task was since completed, rescheduled or deleted changes nothing.
+ * The updates are applied together or not at all.
+ *
+ * @param db SQLite database connection.
+ * @param taskIds Tasks to check.
+ * @param now Unix time to compare the deadlines against.
+ * @return Result whose changes is the number of tasks marked.
+ */
+Result markOverdue(sqlite3* db, const std::vector<int>& taskIds, sqlite3_int64 now);
+
+/**
+ * @brief Records a violation on a task and updates its status.
+ *
+ * @param db SQLite database connection.
+ * @param taskId ID of the task.
+ * @param status New status, e.g. "violation".
+ * @param comment Violation comment.
+ */
+Result reportViolation(sqlite3* db, int taskId, const std::string& status, const std::string& comment);
+
+/**
+ * @brief Returns where the media of a task report is stored.
+ */
+std::string taskMediaPath(int taskId, int workerId);
+
+/**
+ * @brief Checks that a task is assigned to a worker, before their report media is saved.
+ *
+ * @return Result; fails with "Task is not assigned to this worker." otherwise.
+ */
+Result checkTaskAssignment(sqlite3* db, int taskId, int workerId);
+
+/**
+ * @brief Copies report media to taskMediaPath(taskId, workerId). Touches no database.
+ *
+ * Call checkTaskAssignment() first, so no file is written for another worker's task.
+ *
+ * @param taskId ID of the reported task.
+ * @param workerId ID of the reporting worker.
+ * @param mediaPath Path of the media file to attach.
+ */
+Result saveTaskMedia(int taskId, int workerId, const std::string& mediaPath);
+
+/**
+ * @brief Writes uploaded report media to taskMediaPath(taskId, workerId). Touches no database.
+ *
+ * Call checkTaskAssignment() first, so no file is written for another worker's task.
+ *
+ * @param taskId ID of the reported task.
+ * @param workerId ID of the reporting worker.
+ * @param data File contents.
+ */
+Result storeTaskMedia(int taskId, int workerId, const std::string& data);
+
+/**
+ * @brief Stores a report whose media has already been saved and marks the task completed now.
+ *
+ * If the task is not assigned to the worker (it may have been reassigned
+ * since checkTaskAssignment()), the saved media is removed again.
+ *
+ * @param db SQLite database connection.
+ * @param taskId ID of the task; it must be assigned to workerId.
+ * @param workerId ID of the reporting worker.
+ * @param report Report description.
+ * @param savedMediaPath Stored media path, from taskMediaPath().
+ */
+Result recordTaskReport(sqlite3* db, int taskId, int workerId, const std::string& report,
+                        const std::string& savedMediaPath);
+
+/**
+ * @brief Copies the report media into ./uploads and marks the task completed.
+ *
+ * Equivalent to checkTaskAssignment(), saveTaskMedia() and recordTaskReport().
+ *
+ * @param db SQLite database connection.
+ * @param taskId ID of the task; it must be assigned to workerId.
+ * @param workerId ID of the reporting worker.
+ * @param report Report description.
+ * @param mediaPath Path of the media file to attach.
+ */
+Result submitTaskReport(sqlite3* db, int taskId, int workerId, const std::string& report,
+                        const std::string& mediaPath);
+
+/**
+ * @brief Adds a safety rule stamped with the current time.
+ */
+Result addRule(sqlite3* db, const std::string& text);
+
+/**
+ * @brief Deletes a safety rule and its feedback.
+ */
+Result deleteRule(sqlite3* db, int ruleId);
+
+/**
+ * @brief Deletes a task.
+ */
+Result deleteTask(sqlite3* db, int taskId);
+
+/**
+ * @brief Appends feedback on a rule.
+ *
+ * @param db SQLite database connection.
+ * @param ruleId ID of the rule; fails if it does not exist.
+ * @param workerId ID of the worker giving feedback.
+ * @param rating 1-5, or 0 for no rating.
+ * @param text Feedback text.
+ */
+Result submitRuleFeedback(sqlite3* db, int ruleId, int workerId, int rating, const std::string& text);
+
+/**
+ * @brief Lists every rule with its feedback counters.
+ */
+Rows<FeedbackSummary> listFeedbackSummaries(sqlite3* db);
+
+/**
+ * @brief Returns one page of a rule's feedback, newest first.
+ *
+ * @param db SQLite database connection.
+ * @param ruleId ID of the rule.
+ * @param beforeId Only return feedback with a smaller ID; pass the last ID of
+ *                 the previous page, or 0 for the first page.
+ * @param limit Maximum number of entries.
+ */
+Rows<FeedbackRecord> listRuleFeedback(sqlite3* db, int ruleId, sqlite3_int64 beforeId, int limit);
+
+/**
+ * @brief Full-text search over rules, task descriptions and worker reports.
+ *
+ * A query that is not valid FTS5 syntax is retried as a literal phrase.
+ *
+ * @param db SQLite database connection.
+ * @param query Search terms, e.g. "confined space".
+ * @param workerId Restrict task matches to this worker, or -1 for all tasks.
+ * @param limit Maximum matches per category.
+ */
+SearchResult search(sqlite3* db, const std::string& query, int workerId = -1, int limit = 20);
+
+/**
+ * @brief Creates a recurring task.
+ *
+ * @param db SQLite database connection.
+ * @param workerId ID of the worker each occurrence is assigned to; fails if
+ *                 the worker does not exist.
+ * @param description Task description of every occurrence.
+ * @param intervalSeconds Time between occurrences, at least a minute.
+ * @param firstDue Unix time of the first occurrence.
+ * @return Result with the new schedule ID.
+ */
+Result addSchedule(sqlite3* db, int workerId, const std::string& description, sqlite3_int64 intervalSeconds,
+                   sqlite3_int64 firstDue);
+
+/**
+ * @brief Lists schedules in ID order.
+ *
+ * @param db SQLite database connection.
+ * @param afterId Only return schedules with a larger ID; 0 for all of them.
+ * @param limit Maximum number of schedules, or -1 for no limit.
+ */
+Rows<ScheduleRecord> listSchedules(sqlite3* db, int afterId = 0, int limit = -1);
+
+/**
+ * @brief Deletes a schedule. Tasks it already created are kept.
+ */
+Result deleteSchedule(sqlite3* db, int scheduleId);
+
+/**
+ * @brief Creates the tasks of a schedule's due occurrences and moves it on.
+ *
+ * The schedule only advances if its next_due is still @p due, so an
+ * occurrence is never created twice, even by two schedulers; otherwise
+ * nothing is written and the call fails with "Schedule not found.". Each
+ * task carries the schedule's description, and its deadline (due_at) is one
+ * interval after its occurrence, when the next occurrence is due.
+ *
+ * @param db SQLite database connection.
+ * @param scheduleId ID of the schedule.
+ * @param due The schedule's next_due as last read.
+ * @param occurrences Due times to create tasks for, oldest first.
+ * @param nextDue New next_due of the schedule.
+ * @return Result with the number of tasks created in changes.
+ */
+Result runSchedule(sqlite3* db, int scheduleId, sqlite3_int64 due, const std::vector<sqlite3_int64>& occurrences,
+                   sqlite3_int64 nextDue);
+
+}  // namespace core
+
+#endif  // CORE_H_
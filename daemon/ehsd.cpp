@@ -0,0 +1,222 @@
+/**
+ * @file ehsd.cpp
+ * @brief ehsd: serves the worker and manager operations to many terminals from one process.
+ *
+ * ehsd owns ehs.db: it is the only process with a write connection, so kiosks
+ * no longer contend for SQLite file locks. Writes from all sessions share the
+ * ConnectionPool writer thread, which commits queued writes together.
+ *
+ * Compile from the repository root:
+ * @code
+ * g++ -std=c++20 -O2 daemon/ehsd.cpp daemon/server.cpp protocol/protocol.cpp service/service.cpp service/async_service.cpp archive/archive.cpp compaction/compaction.cpp backup/backup.cpp scheduler/scheduler.cpp scheduler/deadlines.cpp core/core.cpp metrics/metrics.cpp trace/trace.cpp logging/logging.cpp executor/executor.cpp db/Database.cpp db/ConnectionPool.cpp db/SlowQueryLog.cpp -lsqlite3 -lssl -lcrypto -lz -pthread -o ehsd
+ * @endcode
+ *
+ * Usage:
+ * @code
+ * ./ehsd [--db ehs.db] [--socket ehsd.sock] [--tcp 127.0.0.1:7878] [--no-tcp] [--incremental-vacuum]
+ *       [--no-scheduler] [--no-deadlines]
+ * @endcode
+ *
+ * SIGHUP (kill -HUP <pid>) compacts the database online (see
+ * compaction/compaction.h) while sessions go on; --incremental-vacuum makes
+ * the compacted file use auto_vacuum = INCREMENTAL. With EHS_WAL_ARCHIVE set,
+ * every commit is archived there for point-in-time restore (see
+ * backup/backup.h); take base backups with ehs --backup.
+ *
+ * Recurring tasks are created by a scheduler thread (see
+ * scheduler/scheduler.h), which first catches up on occurrences missed while
+ * ehsd was down; --no-scheduler leaves that to another process. Pending
+ * tasks whose deadline passes are marked overdue by a deadline watcher
+ * (scheduler/deadlines.h), which also logs an alert for each; --no-deadlines
+ * turns it off.
+ *
+ * The same environment variables as the interactive program apply
+ * (EHS_LOG_FILE, EHS_THREADS, EHS_DB_READERS, EHS_SLOW_QUERY_MS, ...).
+ * Requests run as AsyncService tasks: EHS_THREADS pool threads (default one
+ * per core) run the continuations, and EHS_IO_THREADS blocking threads
+ * (default 32) do the SQLite and media work. EHS_DB_READERS defaults to the
+ * number of blocking threads, so no read waits for a connection.
+ */
+
+#include "server.h"
+#include "../archive/archive.h"
+#include "../backup/backup.h"
+#include "../compaction/compaction.h"
+#include "../db/ConnectionPool.h"
+#include "../db/Database.h"
+#include "../executor/executor.h"
+#include "../logging/logging.h"
+#include "../metrics/metrics.h"
+#include "../scheduler/deadlines.h"
+#include "../scheduler/scheduler.h"
+#include "../trace/trace.h"
+#include <csignal>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <pthread.h>
+#include <atomic>
+#include <string>
+#include <thread>
+
+int main(int argc, char** argv) {
+    std::string dbPath = "ehs.db";
+    const char* socketEnv = std::getenv("EHSD_SOCKET");
+    std::string socketPath = socketEnv ? socketEnv : "ehsd.sock";
+    const char* tcpEnv = std::getenv("EHSD_TCP");
+    std::string tcp = tcpEnv ? tcpEnv : "127.0.0.1:7878";
+    compaction::Options compactOptions;
+    bool runScheduler = true;
+    bool watchDeadlines = true;
+
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--db" && i + 1 < argc) {
+            dbPath = argv[++i];
+        } else if (arg == "--socket" && i + 1 < argc) {
+            socketPath = argv[++i];
+        } else if (arg == "--tcp" && i + 1 < argc) {
+            tcp = argv[++i];
+        } else if (arg == "--no-tcp") {
+            tcp.clear();
+        } else if (arg == "--incremental-vacuum") {
+            compactOptions.incrementalVacuum = true;
+        } else if (arg == "--no-scheduler") {
+            runScheduler = false;
+        } else if (arg == "--no-deadlines") {
+            watchDeadlines = false;
+        } else {
+            std::cerr << "Usage: " << argv[0]
+                      << " [--db ehs.db] [--socket ehsd.sock] [--tcp HOST:PORT] [--no-tcp] [--incremental-vacuum]"
+                         " [--no-scheduler] [--no-deadlines]\n";
+            return 2;
+        }
+    }
+
+    // SIGINT/SIGTERM are read from a signalfd by the event loop, so block them before any thread starts
+    sigset_t stopSignals;
+    sigemptyset(&stopSignals);
+    sigaddset(&stopSignals, SIGINT);
+    sigaddset(&stopSignals, SIGTERM);
+    pthread_sigmask(SIG_BLOCK, &stopSignals, nullptr);
+
+    // SIGHUP is taken by the compaction thread with sigwait, so it stays blocked everywhere else
+    sigset_t compactSignal;
+    sigemptyset(&compactSignal);
+    sigaddset(&compactSignal, SIGHUP);
+    pthread_sigmask(SIG_BLOCK, &compactSignal, nullptr);
+
+    const char* metricsFile = std::getenv("EHS_METRICS_FILE");
+    metrics::setDumpPath(metricsFile ? metricsFile : "ehsd_metrics.prom");
+    metrics::installDumpSignalHandler();
+
+    const char* traceFile = std::getenv("EHS_TRACE_FILE");
+    trace::setExportPath(traceFile ? traceFile : "ehsd_trace.json");
+    trace::installExportSignalHandler();
+    trace::setThreadName("ehsd-loop");
+
+    const char* logFile = std::getenv("EHS_LOG_FILE");
+    const char* logLevel = std::getenv("EHS_LOG_LEVEL");
+    logging::start(logFile ? logFile : "ehsd.log", logging::parseLevel(logLevel ? logLevel : "", logging::Level::Info));
+
+    const char* threads = std::getenv("EHS_THREADS");
+    const char* ioThreads = std::getenv("EHS_IO_THREADS");
+    executor::start(threads ? std::atoi(threads) : 0, ioThreads ? std::atoi(ioThreads) : 32);
+
+    {
+        DatabaseManager dbManager(dbPath);
+        dbManager.setupTables();
+
+        const char* slowQueryMs = std::getenv("EHS_SLOW_QUERY_MS");
+        if (slowQueryMs) {
+            const char* slowQueryLog = std::getenv("EHS_SLOW_QUERY_LOG");
+            dbManager.enableSlowQueryLog(slowQueryLog ? slowQueryLog : "ehs_slow_queries.log", std::atof(slowQueryMs));
+        }
+
+        // Task history reads the archive database written by ehs --archive-days, found next to --db as ehs finds it
+        const char* archiveEnv = std::getenv("EHS_ARCHIVE_DB");
+        std::string archiveFile = archiveEnv ? archiveEnv : archive::defaultPath(dbPath);
+        std::string archiveError;
+        bool archived = archive::attach(dbManager.getDB(), archiveFile, true, archiveError);
+        if (!archived) {
+            logging::error("{}", archiveError);
+        }
+
+        const char* walArchiveEnv = std::getenv("EHS_WAL_ARCHIVE");
+
+        // Read connections, and the slow-query log's plan connection, see the archive too
+        auto attachArchive = [archived, archiveFile](sqlite3* connection) {
+            std::string error;
+            if (archived && !archive::attach(connection, archiveFile, false, error)) {
+                logging::error("{}", error);
+            }
+        };
+        dbManager.preparePlanConnection(attachArchive);
+
+        // A read borrows a connection for its call; enough for every blocking thread (and the scheduler) at once
+        const char* readers = std::getenv("EHS_DB_READERS");
+        ConnectionPool db(dbManager.getDB(), dbPath,
+                          readers ? std::atoi(readers) : executor::blockingThreadCount() + (runScheduler ? 1 : 0),
+                          [&dbManager, attachArchive](sqlite3* reader) {
+                              dbManager.traceConnection(reader);
+                              attachArchive(reader);
+                          });
+        backup::WalArchiver walArchiver(walArchiveEnv ? walArchiveEnv : "");
+        std::string walArchiveError;
+        if (walArchiveEnv && !walArchiver.start(db, walArchiveError)) {
+            logging::error("{}", walArchiveError);
+        }
+
+        LocalService local(db);
+        AsyncService service(local);
+
+        scheduler::Scheduler schedules(local);
+        if (runScheduler) {
+            schedules.start();
+        }
+        scheduler::DeadlineWatcher deadlines(db);
+        if (watchDeadlines) {
+            deadlines.start();
+        }
+
+        std::atomic<bool> stopping{false};
+        std::thread compactor([&]() {
+            trace::setThreadName("ehsd-compact");
+            int signal = 0;
+            while (sigwait(&compactSignal, &signal) == 0 && !stopping) {
+                logging::info("SIGHUP: compacting {}", dbPath);
+                compaction::run(db, compactOptions);
+            }
+        });
+        auto stopCompactor = [&]() {
+            stopping = true;
+            pthread_kill(compactor.native_handle(), SIGHUP);
+            compactor.join();
+        };
+
+        Server server(service);
+        bool listening = !socketPath.empty() && server.listenUnix(socketPath);
+        size_t colon = tcp.rfind(':');
+        if (!tcp.empty() && colon != std::string::npos) {
+            listening = server.listenTcp(tcp.substr(0, colon), std::atoi(tcp.c_str() + colon + 1)) || listening;
+        }
+        if (!listening) {
+            logging::error("ehsd has nothing to listen on.");
+            schedules.stop();
+            deadlines.stop();
+            stopCompactor();
+            executor::shutdown();
+            logging::stop();
+            return 1;
+        }
+
+        server.run();
+        schedules.stop();
+        deadlines.stop();
+        stopCompactor();  // Waits for a compaction in progress
+        executor::shutdown();  // Let running requests finish before the service goes away
+    }
+
+    logging::stop();
+    return 0;
+}
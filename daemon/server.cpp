@@ -0,0 +1,587 @@
+/**
+ * @file server.cpp
+ * @brief Implementation of the ehsd event loop and request dispatch.
+ *
+ */
+
+#include "server.h"
+#include "../executor/executor.h"
+#include "../logging/logging.h"
+#include "../metrics/metrics.h"
+#include "../protocol/protocol.h"
+#include "../trace/trace.h"
+#include <algorithm>
+#include <arpa/inet.h>
+#include <cerrno>
+#include <csignal>
+#include <cstring>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/signalfd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+namespace {
+
+const size_t kReadChunk = 64 * 1024;
+using protocol::kMaxPage;
+
+const char* opName(protocol::Op op) {
+    static const char* const names[] = {"", "login", "register", "logout", "list_tasks", "list_open_tasks",
+                                        "list_tasks_by_status", "list_workers", "list_rules", "assign_task",
+                                        "report_violation", "submit_task_report", "add_rule", "delete_rule",
+                                        "delete_task", "submit_rule_feedback", "list_feedback_summaries",
+                                        "list_rule_feedback", "search", "list_task_history", "add_schedule",
+                                        "list_schedules", "delete_schedule", "list_overdue",
+                                        "auto_assign_tasks", "list_worker_loads", "set_worker_availability",
+                                        "add_shift", "delete_shift", "list_shifts", "list_on_shift"};
+    return names[static_cast<int>(op)];
+}
+
+/// @brief Latency histogram per operation, e.g. "ehsd.login".
+metrics::OperationId opMetric(protocol::Op op) {
+    static const std::vector<metrics::OperationId> ids = [] {
+        std::vector<metrics::OperationId> result(static_cast<size_t>(protocol::kLastOp) + 1, -1);
+        for (int code = static_cast<int>(protocol::Op::Login); code <= static_cast<int>(protocol::kLastOp); ++code) {
+            result[code] = metrics::operation(std::string("ehsd.") + opName(static_cast<protocol::Op>(code)));
+        }
+        return result;
+    }();
+    return ids[static_cast<size_t>(op)];
+}
+
+template <typename T>
+std::string encode(const T& value) {
+    protocol::Writer out;
+    protocol::put(out, value);
+    return out.data();
+}
+
+}  // namespace
+
+Server::Server(AsyncService& service) : service(service) {
+    epoll = epoll_create1(EPOLL_CLOEXEC);
+    wakeup = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (epoll < 0 || wakeup < 0) {
+        logging::error("Failed to create the event loop: {}", std::strerror(errno));
+        return;
+    }
+    epoll_event event{};
+    event.events = EPOLLIN;
+    event.data.fd = wakeup;
+    epoll_ctl(epoll, EPOLL_CTL_ADD, wakeup, &event);
+}
+
+Server::~Server() {
+    while (!connections.empty()) {
+        close(connections.begin()->first);
+    }
+    for (int listener : listeners) {
+        ::close(listener);
+    }
+    if (!unixPath.empty()) {
+        unlink(unixPath.c_str());
+    }
+    if (signals >= 0) ::close(signals);
+    if (wakeup >= 0) ::close(wakeup);
+    if (epoll >= 0) ::close(epoll);
+}
+
+bool Server::listenUnix(const std::string& path) {
+    sockaddr_un address{};
+    if (path.size() >= sizeof(address.sun_path)) {
+        logging::error("Socket path too long: {}", path);
+        return false;
+    }
+    address.sun_family = AF_UNIX;
+    std::strcpy(address.sun_path, path.c_str());
+
+    int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    unlink(path.c_str());
+    if (fd < 0 || bind(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0 || listen(fd, SOMAXCONN) != 0) {
+        logging::error("Failed to listen on {}: {}", path, std::strerror(errno));
+        if (fd >= 0) ::close(fd);
+        return false;
+    }
+    unixPath = path;
+
+    epoll_event event{};
+    event.events = EPOLLIN;
+    event.data.fd = fd;
+    epoll_ctl(epoll, EPOLL_CTL_ADD, fd, &event);
+    listeners.push_back(fd);
+    logging::info("Listening on {}", path);
+    return true;
+}
+
+bool Server::listenTcp(const std::string& host, int port) {
+    sockaddr_in address{};
+    address.sin_family = AF_INET;
+    address.sin_port = htons(static_cast<uint16_t>(port));
+    if (inet_pton(AF_INET, host.c_str(), &address.sin_addr) != 1) {
+        logging::error("Invalid listen address: {}", host);
+        return false;
+    }
+
+    int fd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    int on = 1;
+    if (fd >= 0) setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+    if (fd < 0 || bind(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0 || listen(fd, SOMAXCONN) != 0) {
+        logging::error("Failed to listen on {}:{}: {}", host, port, std::strerror(errno));
+        if (fd >= 0) ::close(fd);
+        return false;
+    }
+
+    epoll_event event{};
+    event.events = EPOLLIN;
+    event.data.fd = fd;
+    epoll_ctl(epoll, EPOLL_CTL_ADD, fd, &event);
+    listeners.push_back(fd);
+    logging::info("Listening on {}:{}", host, port);
+    return true;
+}
+
+void Server::run() {
+    sigset_t mask;
+    sigemptyset(&mask);
+    sigaddset(&mask, SIGINT);
+    sigaddset(&mask, SIGTERM);
+    signals = signalfd(-1, &mask, SFD_NONBLOCK | SFD_CLOEXEC);
+    if (signals >= 0) {
+        epoll_event event{};
+        event.events = EPOLLIN;
+        event.data.fd = signals;
+        epoll_ctl(epoll, EPOLL_CTL_ADD, signals, &event);
+    }
+
+    epoll_event events[256];
+    while (true) {
+        int ready = epoll_wait(epoll, events, 256, -1);
+        if (ready < 0) {
+            if (errno == EINTR) continue;
+            logging::error("epoll_wait failed: {}", std::strerror(errno));
+            return;
+        }
+        for (int i = 0; i < ready; ++i) {
+            int fd = events[i].data.fd;
+            if (fd == signals) {
+                signalfd_siginfo info;
+                while (read(signals, &info, sizeof(info)) == sizeof(info)) {}
+                logging::info("Shutting down ({} sessions)", connections.size());
+                return;
+            }
+            if (fd == wakeup) {
+                drainCompletions();
+                continue;
+            }
+            if (std::find(listeners.begin(), listeners.end(), fd) != listeners.end()) {
+                accept(fd);
+                continue;
+            }
+
+            auto found = connections.find(fd);
+            if (found == connections.end()) continue;
+            Connection& connection = *found->second;
+            if (events[i].events & (EPOLLERR | EPOLLHUP)) {
+                close(fd);
+                continue;
+            }
+            if (events[i].events & EPOLLOUT) {
+                flush(connection);
+                if (connections.find(fd) == connections.end()) continue;
+            }
+            if (events[i].events & EPOLLIN) {
+                onReadable(connection);
+            }
+        }
+    }
+}
+
+void Server::accept(int listener) {
+    while (true) {
+        int fd = accept4(listener, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (fd < 0) {
+            if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR) {
+                logging::warn("accept failed: {}", std::strerror(errno));
+            }
+            return;
+        }
+        int on = 1;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &on, sizeof(on));  // Fails harmlessly on Unix sockets
+
+        std::unique_ptr<Connection> connection(new Connection());
+        connection->fd = fd;
+        connection->id = nextId++;
+        epoll_event event{};
+        event.events = EPOLLIN | EPOLLRDHUP;
+        event.data.fd = fd;
+        if (epoll_ctl(epoll, EPOLL_CTL_ADD, fd, &event) != 0) {
+            ::close(fd);
+            continue;
+        }
+        connections[fd] = std::move(connection);
+    }
+}
+
+void Server::onReadable(Connection& connection) {
+    int fd = connection.fd;
+    char chunk[kReadChunk];
+    while (true) {
+        ssize_t n = read(connection.fd, chunk, sizeof(chunk));
+        if (n > 0) {
+            connection.in.append(chunk, static_cast<size_t>(n));
+            if (connection.in.size() > protocol::kMaxFrame + 4) {
+                break;  // More than a frame; watch() stops reading until it is taken
+            }
+            continue;
+        }
+        if (n < 0 && errno == EINTR) continue;
+        if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) break;
+        close(connection.fd);  // Peer closed or the socket failed
+        return;
+    }
+    dispatch(connection);
+    if (connections.find(fd) != connections.end()) {
+        watch(connection);
+    }
+}
+
+void Server::dispatch(Connection& connection) {
+    if (connection.busy) {
+        return;
+    }
+    std::string request;
+    protocol::FrameStatus status = protocol::takeFrame(connection.in, request);
+    if (status == protocol::FrameStatus::TooLarge) {
+        logging::warn("Closing session {}: request larger than {} bytes", connection.id, protocol::kMaxFrame);
+        close(connection.fd);
+        return;
+    }
+    if (status == protocol::FrameStatus::Partial) {
+        return;
+    }
+
+    connection.busy = true;
+    int fd = connection.fd;
+    uint64_t id = connection.id;
+    handle(connection.session, request, [this, fd, id](Session session, std::string response) {
+        {
+            std::lock_guard<std::mutex> lock(completedMutex);
+            completed.push_back({fd, id, std::move(session), std::move(response)});
+        }
+        uint64_t one = 1;
+        ssize_t ignored = write(wakeup, &one, sizeof(one));
+        (void)ignored;
+    });
+}
+
+void Server::drainCompletions() {
+    uint64_t count;
+    ssize_t ignored = read(wakeup, &count, sizeof(count));
+    (void)ignored;
+
+    std::deque<Completion> batch;
+    {
+        std::lock_guard<std::mutex> lock(completedMutex);
+        batch.swap(completed);
+    }
+    for (Completion& done : batch) {
+        auto found = connections.find(done.fd);
+        if (found == connections.end() || found->second->id != done.id) {
+            continue;  // The client went away while its request ran
+        }
+        Connection& connection = *found->second;
+        connection.busy = false;
+        connection.session = std::move(done.session);
+        if (done.response.size() > protocol::kMaxFrame) {
+            // Clients drop frames this large, so the connection would be lost; paged listings never get here
+            logging::error("Reply of {} bytes exceeds the frame limit", done.response.size());
+            done.response = protocol::failure("Result too large for one reply; narrow the request.");
+        }
+        protocol::appendFrame(connection.out, done.response);
+        flush(connection);
+        if (connections.find(done.fd) != connections.end()) {
+            dispatch(connection);  // Next pipelined request, if any
+        }
+        if (connections.find(done.fd) != connections.end()) {
+            watch(connection);
+        }
+    }
+}
+
+void Server::flush(Connection& connection) {
+    size_t sent = 0;
+    while (sent < connection.out.size()) {
+        ssize_t n = send(connection.fd, connection.out.data() + sent, connection.out.size() - sent, MSG_NOSIGNAL);
+        if (n > 0) {
+            sent += static_cast<size_t>(n);
+            continue;
+        }
+        if (n < 0 && errno == EINTR) continue;
+        if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) break;
+        close(connection.fd);
+        return;
+    }
+    connection.out.erase(0, sent);
+    watch(connection);
+}
+
+void Server::watch(Connection& connection) {
+    // Reading resumes once the request completes and the buffer is down to a frame
+    bool reading = !connection.busy && connection.in.size() <= protocol::kMaxFrame + 4;
+    bool wantWrite = !connection.out.empty();
+    if (reading == connection.reading && wantWrite == connection.wantWrite) {
+        return;
+    }
+    epoll_event event{};
+    event.events = (reading ? static_cast<uint32_t>(EPOLLIN | EPOLLRDHUP) : static_cast<uint32_t>(0)) |
+                   (wantWrite ? static_cast<uint32_t>(EPOLLOUT) : static_cast<uint32_t>(0));
+    event.data.fd = connection.fd;
+    epoll_ctl(epoll, EPOLL_CTL_MOD, connection.fd, &event);
+    connection.reading = reading;
+    connection.wantWrite = wantWrite;
+}
+
+void Server::close(int fd) {
+    epoll_ctl(epoll, EPOLL_CTL_DEL, fd, nullptr);
+    ::close(fd);
+    connections.erase(fd);
+}
+
+template <typename T>
+executor::Detached Server::respond(executor::Task<T> pending, Session session, Reply reply) {
+    T result = co_await pending.resumeAt(executor::Priority::High);
+    reply(std::move(session), encode(result));
+}
+
+executor::Detached Server::login(std::string username, std::string password, Reply reply) {
+    core::LoginResult result = co_await service.login(username, password).resumeAt(executor::Priority::High);
+    Session next;
+    if (result.ok) {
+        next.userId = result.userId;
+        next.role = result.role;
+        logging::info("Session login as {}", username);
+    }
+    reply(std::move(next), encode(result));
+}
+
+void Server::handle(const Session& session, const std::string& request, Reply reply) {
+    protocol::Reader in(request);
+    protocol::Op op;
+    if (!in.getOp(op)) {
+        reply(session, protocol::failure("Malformed request."));
+        return;
+    }
+
+    // Latency covers the whole request, from decoding to the encoded response
+    uint64_t start = trace::nowMicros();
+    Reply timed = [op, start, reply](Session next, std::string response) {
+        uint64_t elapsed = trace::nowMicros() - start;
+        metrics::record(opMetric(op), elapsed * 1000);
+        trace::recordSpan(opName(op), "ehsd", start, elapsed);
+        reply(std::move(next), std::move(response));
+    };
+    auto fail = [&](const char* error) { timed(session, protocol::failure(error)); };
+    auto respond = [&](auto task) { Server::respond(std::move(task), session, timed); };
+
+    bool manager = session.role == "manager";
+    bool worker = session.role == "worker";
+    bool loggedIn = manager || worker;
+    std::string a, b, c;
+    int x = 0, y = 0, z = 0;
+    sqlite3_int64 wide = 0;
+
+    switch (op) {
+        case protocol::Op::Login:
+            if (in.getString(a) && in.getString(b) && in.done()) {
+                login(a, b, timed);
+                return;
+            }
+            break;
+        case protocol::Op::Register:
+            if (in.getString(a) && in.getString(b) && in.getString(c) && in.done()) {
+                // Anyone reaching ehsd may sign up as a worker; only a manager can add another manager
+                return c == "worker" || manager ? respond(service.registerUser(a, b, c))
+                                                : fail("Only a manager can register a manager.");
+            }
+            break;
+        case protocol::Op::Logout:
+            if (in.done()) {
+                timed(Session(), encode(core::Result()));
+                return;
+            }
+            break;
+        case protocol::Op::Search:
+            if (in.getString(a) && in.getInt(x) && in.done()) {
+                return loggedIn ? respond(service.search(a, manager ? x : session.userId)) : fail("Not logged in.");
+            }
+            break;
+        case protocol::Op::ListTasks:
+            if (in.getInt(x) && in.getInt(y) && in.getInt(z) && in.done()) {
+                if (!loggedIn) return fail("Not logged in.");
+                return z >= 1 && z <= kMaxPage ? respond(service.listTasks(manager ? x : session.userId, y, z))
+                                               : fail("Limit must be 1-1000.");
+            }
+            break;
+        case protocol::Op::ListTaskHistory:
+            if (in.getInt(x) && in.getInt(y) && in.getInt(z) && in.done()) {
+                if (!loggedIn) return fail("Not logged in.");
+                return z >= 1 && z <= kMaxPage ? respond(service.listTaskHistory(manager ? x : session.userId, y, z))
+                                               : fail("Limit must be 1-1000.");
+            }
+            break;
+        case protocol::Op::ListRules:
+            if (in.done()) {
+                return loggedIn ? respond(service.listRules()) : fail("Not logged in.");
+            }
+            break;
+        case protocol::Op::ListFeedbackSummaries:
+            if (in.done()) {
+                return loggedIn ? respond(service.listFeedbackSummaries()) : fail("Not logged in.");
+            }
+            break;
+        case protocol::Op::ListRuleFeedback:
+            if (in.getInt(x) && in.getInt(wide) && in.getInt(y) && in.done()) {
+                if (!loggedIn) return fail("Not logged in.");
+                return y >= 1 && y <= kMaxPage ? respond(service.listRuleFeedback(x, wide, y))
+                                               : fail("Limit must be 1-1000.");
+            }
+            break;
+        case protocol::Op::ListOpenTasks:
+            if (in.getInt(x) && in.done()) {
+                return worker ? respond(service.listOpenTasks(session.userId)) : fail("Only workers can do this.");
+            }
+            break;
+        case protocol::Op::SubmitTaskReport:
+            if (in.getInt(x) && in.getInt(y) && in.getString(a) && in.getString(b) && in.done()) {
+                return worker ? respond(service.submitTaskReportData(x, session.userId, a, b))
+                              : fail("Only workers can do this.");
+            }
+            break;
+        case protocol::Op::SubmitRuleFeedback:
+            if (in.getInt(x) && in.getInt(y) && in.getInt(z) && in.getString(a) && in.done()) {
+                return worker ? respond(service.submitRuleFeedback(x, session.userId, z, a))
+                              : fail("Only workers can do this.");
+            }
+            break;
+        case protocol::Op::ListTasksByStatus:
+            if (in.getString(a) && in.done()) {
+                return manager ? respond(service.listTasksByStatus(a)) : fail("Only managers can do this.");
+            }
+            break;
+        case protocol::Op::ListWorkers:
+            if (in.done()) {
+                return manager ? respond(service.listWorkers()) : fail("Only managers can do this.");
+            }
+            break;
+        case protocol::Op::AssignTask: {
+            // Clients from before deadlines send neither a deadline nor a priority
+            int priority = 2;
+            if (in.getInt(x) && in.getString(a) &&
+                (in.done() || (in.getInt(wide) && in.getInt(priority) && in.done()))) {
+                return manager ? respond(service.assignTask(x, a, wide, priority)) : fail("Only managers can do this.");
+            }
+            break;
+        }
+        case protocol::Op::ReportViolation:
+            if (in.getInt(x) && in.getString(a) && in.getString(b) && in.done()) {
+                return manager ? respond(service.reportViolation(x, a, b)) : fail("Only managers can do this.");
+            }
+            break;
+        case protocol::Op::AddRule:
+            if (in.getString(a) && in.done()) {
+                return manager ? respond(service.addRule(a)) : fail("Only managers can do this.");
+            }
+            break;
+        case protocol::Op::DeleteRule:
+            if (in.getInt(x) && in.done()) {
+                return manager ? respond(service.deleteRule(x)) : fail("Only managers can do this.");
+            }
+            break;
+        case protocol::Op::DeleteTask:
+            if (in.getInt(x) && in.done()) {
+                return manager ? respond(service.deleteTask(x)) : fail("Only managers can do this.");
+            }
+            break;
+        case protocol::Op::AddSchedule: {
+            sqlite3_int64 firstDue = 0;
+            if (in.getInt(x) && in.getString(a) && in.getInt(wide) && in.getInt(firstDue) && in.done()) {
+                return manager ? respond(service.addSchedule(x, a, wide, firstDue)) : fail("Only managers can do this.");
+            }
+            break;
+        }
+        case protocol::Op::ListSchedules:
+            if (in.done()) {
+                return manager ? respond(service.listSchedules()) : fail("Only managers can do this.");
+            }
+            break;
+        case protocol::Op::DeleteSchedule:
+            if (in.getInt(x) && in.done()) {
+                return manager ? respond(service.deleteSchedule(x)) : fail("Only managers can do this.");
+            }
+            break;
+        case protocol::Op::ListOverdue:
+            if (in.getInt(x) && in.getInt(wide) && in.getInt(y) && in.getInt(z) && in.done()) {
+                if (!manager) return fail("Only managers can do this.");
+                return z >= 1 && z <= kMaxPage ? respond(service.listOverdue(x, wide, y, z))
+                                               : fail("Limit must be 1-1000.");
+            }
+            break;
+        case protocol::Op::AutoAssignTasks: {
+            std::vector<std::string> descriptions;
+            sqlite3_int64 count = 0;
+            bool read = in.getInt(count) && count >= 0 && count <= protocol::kMaxFrame;
+            for (sqlite3_int64 i = 0; read && i < count; ++i) {
+                descriptions.emplace_back();
+                read = in.getString(descriptions.back());
+            }
+            // Clients from before shifts send no site
+            if (read && in.getInt(wide) && in.getInt(x) && (in.done() || (in.getString(a) && in.done()))) {
+                return manager ? respond(service.autoAssignTasks(std::move(descriptions), wide, x, a))
+                               : fail("Only managers can do this.");
+            }
+            break;
+        }
+        case protocol::Op::ListWorkerLoads:
+            if (in.done()) {
+                return manager ? respond(service.listWorkerLoads()) : fail("Only managers can do this.");
+            }
+            break;
+        case protocol::Op::SetWorkerAvailability: {
+            bool available = true;
+            if (in.getInt(x) && in.getBool(available) && in.getInt(y) && in.done()) {
+                return manager ? respond(service.setWorkerAvailability(x, available, y))
+                               : fail("Only managers can do this.");
+            }
+            break;
+        }
+        case protocol::Op::AddShift: {
+            sqlite3_int64 endsAt = 0;
+            if (in.getInt(x) && in.getString(a) && in.getInt(wide) && in.getInt(endsAt) && in.done()) {
+                return manager ? respond(service.addShift(x, a, wide, endsAt)) : fail("Only managers can do this.");
+            }
+            break;
+        }
+        case protocol::Op::DeleteShift:
+            if (in.getInt(x) && in.done()) {
+                return manager ? respond(service.deleteShift(x)) : fail("Only managers can do this.");
+            }
+            break;
+        case protocol::Op::ListShifts:
+            if (in.getInt(x) && in.done()) {
+                return loggedIn ? respond(service.listShifts(manager ? x : session.userId)) : fail("Not logged in.");
+            }
+            break;
+        case protocol::Op::ListOnShift: {
+            sqlite3_int64 to = 0;
+            if (in.getString(a) && in.getInt(wide) && in.getInt(to) && in.done()) {
+                return manager ? respond(service.listOnShift(a, wide, to)) : fail("Only managers can do this.");
+            }
+            break;
+        }
+    }
+    fail("Malformed request.");
+}
@@ -0,0 +1,123 @@
+#ifndef SERVER_H_
+#define SERVER_H_
+
+#include "../service/async_service.h"
+#include <functional>
+#include <cstdint>
+#include <deque>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+/**
+ * @class Server
+ * @brief The ehsd event loop: many client sessions over one AsyncService.
+ *
+ * One thread runs a level-triggered epoll loop over the Unix and TCP
+ * listeners and every client socket, all non-blocking. A complete request
+ * frame (protocol/protocol.h) is decoded on the loop and started on the
+ * AsyncService, so a slow write or media upload never stalls the loop and no
+ * thread waits for a session; the response comes back from the request's
+ * continuation through an eventfd and is written as the socket accepts it. Each connection has at
+ * most one request in flight, so responses keep request order while further
+ * requests wait in the connection's input buffer. The loop stops reading a
+ * connection while its request runs or its buffer holds more than a frame,
+ * so a client that keeps sending cannot grow the buffer or spin the loop.
+ *
+ * A connection is a session: Login stores the user ID and role, and every
+ * later request is checked against them. Workers only ever act as themselves;
+ * manager-only operations fail for workers and the other way round. Anyone
+ * may register as a worker, but only a manager session can register a
+ * manager.
+ */
+class Server {
+public:
+    explicit Server(AsyncService& service);
+    ~Server();
+
+    Server(const Server&) = delete;
+    Server& operator=(const Server&) = delete;
+
+    /**
+     * @brief Listens on a Unix domain socket, replacing a stale socket file.
+     */
+    bool listenUnix(const std::string& path);
+
+    /**
+     * @brief Listens on a TCP address, e.g. ("127.0.0.1", 7878).
+     */
+    bool listenTcp(const std::string& host, int port);
+
+    /**
+     * @brief Serves clients until SIGINT or SIGTERM arrives.
+     *
+     * Both signals must already be blocked in every thread (block them in
+     * main() before any thread starts). Requests still running when the loop
+     * stops complete, but their responses are dropped; call
+     * executor::shutdown() before destroying the server or the service.
+     */
+    void run();
+
+    /// @brief Number of connected clients.
+    size_t sessionCount() const { return connections.size(); }
+
+private:
+    struct Session {
+        int userId = -1;
+        std::string role;             ///< Empty until Login succeeds
+    };
+
+    struct Connection {
+        int fd = -1;
+        uint64_t id = 0;              ///< Distinguishes connections that reuse an fd
+        std::string in;
+        std::string out;
+        bool busy = false;            ///< A request is running on the executor
+        bool wantWrite = false;       ///< EPOLLOUT is armed
+        bool reading = true;          ///< EPOLLIN is armed
+        Session session;
+    };
+
+    struct Completion {
+        int fd;
+        uint64_t id;
+        Session session;
+        std::string response;
+    };
+
+    using Reply = std::function<void(Session, std::string)>;
+
+    /// @brief Starts a request; @p reply gets the updated session and the response.
+    void handle(const Session& session, const std::string& request, Reply reply);
+
+    /// @brief Replies with the encoded result of @p pending once it completes; the session is unchanged.
+    template <typename T>
+    static executor::Detached respond(executor::Task<T> pending, Session session, Reply reply);
+
+    /// @brief Logs in and replies with the session that opens (an empty one if login fails).
+    executor::Detached login(std::string username, std::string password, Reply reply);
+
+    void accept(int listener);
+    void onReadable(Connection& connection);
+    void dispatch(Connection& connection);
+    void flush(Connection& connection);
+    void watch(Connection& connection);
+    void close(int fd);
+    void drainCompletions();
+
+    AsyncService& service;
+    int epoll = -1;
+    int wakeup = -1;                  ///< eventfd signalled when a request completes
+    int signals = -1;                 ///< signalfd for SIGINT/SIGTERM
+    std::string unixPath;
+    std::vector<int> listeners;
+    std::map<int, std::unique_ptr<Connection>> connections;
+    uint64_t nextId = 1;
+
+    std::mutex completedMutex;
+    std::deque<Completion> completed;
+};
+
+#endif  // SERVER_H_
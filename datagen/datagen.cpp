@@ -0,0 +1,496 @@
+/**
+ * @file datagen.cpp
+ * @brief Seeded, deterministic generator of production-scale EHS databases.
+ *
+ * Producer jobs on the shared pool (executor/executor.h) turn fixed-size chunks of row numbers into rows, each chunk
+ * with its own random stream derived from the seed and the chunk index, so the
+ * output does not depend on thread scheduling. A single writer thread (SQLite
+ * allows one writer) consumes the chunks in order through a bounded queue and
+ * inserts them with prepared statements inside large transactions.
+ *
+ */
+
+#include "datagen.h"
+#include "../core/core.h"
+#include "../db/Database.h"
+#include "../executor/executor.h"
+#include <sqlite3.h>
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <condition_variable>
+#include <ctime>
+#include <iostream>
+#include <map>
+#include <mutex>
+#include <numeric>
+#include <random>
+#include <future>
+#include <vector>
+
+namespace {
+
+const long long kChunkRows = 10000;
+const std::time_t kNewestTimestamp = 1767225600;        // 2026-01-01 00:00:00 UTC
+const std::time_t kHistorySeconds = 5LL * 365 * 24 * 3600;
+
+const char* kEquipment[] = {
+    "fire extinguisher", "forklift", "emergency shower", "eye wash station", "scaffolding",
+    "gas detector", "ladder", "harness", "lockout tagout station", "ventilation fan",
+    "first aid kit", "chemical storage cabinet", "crane hook", "guard rail", "exit signage"};
+const char* kAreas[] = {
+    "warehouse A", "loading dock", "boiler room", "paint shop", "assembly line 3",
+    "confined space tank 2", "roof access", "chemical store", "workshop", "packaging hall"};
+const char* kActions[] = {"Inspect", "Test", "Audit", "Clean and check", "Replace tag on", "Verify"};
+const char* kReportWords[] = {
+    "checked", "pressure", "gauge", "seal", "intact", "no", "leaks", "found", "area", "cleared",
+    "signage", "visible", "confined", "space", "permit", "verified", "gas", "levels", "normal",
+    "harness", "inspected", "worn", "strap", "replaced", "supervisor", "informed", "photo",
+    "attached", "lockout", "applied", "guard", "rail", "loose", "tightened", "spill", "contained",
+    "absorbent", "used", "ventilation", "running", "exit", "blocked", "pallets", "moved",
+    "hydraulic", "fluid", "topped", "up", "and", "the", "was", "all", "ok", "after", "shift"};
+const char* kViolations[] = {
+    "No hard hat in active zone", "Harness not clipped at height", "Blocked fire exit",
+    "Confined space entered without permit", "Forklift speeding in pedestrian lane",
+    "Chemical container unlabeled", "Guard removed from machine", "Eye protection not worn"};
+const char* kFeedback[] = {
+    "Rule is clear and easy to follow.", "Hard to follow during night shift.",
+    "Need more equipment to comply.", "Signage for this rule is missing in our area.",
+    "Training on this rule would help.", "Rule conflicts with the production schedule.",
+    "Works well, no issues.", "Please clarify which zones this applies to."};
+
+template <typename T, size_t N>
+const T& pick(const T (&items)[N], std::mt19937_64& rng) {
+    return items[rng() % N];
+}
+
+/// @brief Samples ranks 0..n-1 with probability proportional to 1 / (rank + 1)^s.
+class ZipfSampler {
+public:
+    ZipfSampler(int n, double exponent) : cdf(n) {
+        double sum = 0;
+        for (int i = 0; i < n; ++i) {
+            sum += 1.0 / std::pow(i + 1.0, exponent);
+            cdf[i] = sum;
+        }
+        for (double& value : cdf) value /= sum;
+    }
+
+    int sample(std::mt19937_64& rng) const {
+        double u = std::uniform_real_distribution<double>(0.0, 1.0)(rng);
+        return static_cast<int>(std::lower_bound(cdf.begin(), cdf.end(), u) - cdf.begin());
+    }
+
+private:
+    std::vector<double> cdf;
+};
+
+struct TaskRow {
+    long long id;
+    int workerId;
+    std::string description;
+    const char* status;
+    std::string violationComment;
+    std::string violationTimestamp;
+    std::string report;
+    std::string media;
+    std::string completedAt;
+    std::time_t dueAt = 0;            ///< 0 for completed tasks
+    int priority = 2;
+};
+
+struct FeedbackRow {
+    int ruleId;
+    int workerId;
+    std::string createdAt;
+    int rating;
+    std::string text;
+};
+
+struct Chunk {
+    std::vector<TaskRow> tasks;
+    std::vector<FeedbackRow> feedback;
+};
+
+/// @brief Hands chunks from producers to the writer in index order, with bounded look-ahead.
+class OrderedQueue {
+public:
+    explicit OrderedQueue(long long maxAhead) : maxAhead(maxAhead) {}
+
+    bool push(long long index, Chunk&& chunk) {
+        std::unique_lock<std::mutex> lock(mutex);
+        spaceAvailable.wait(lock, [&] { return index < nextIndex + maxAhead || stopped; });
+        if (stopped) return false;
+        ready.emplace(index, std::move(chunk));
+        chunkReady.notify_all();
+        return true;
+    }
+
+    bool pop(Chunk& chunk) {
+        std::unique_lock<std::mutex> lock(mutex);
+        chunkReady.wait(lock, [&] { return ready.count(nextIndex) > 0 || stopped; });
+        if (stopped) return false;
+        chunk = std::move(ready[nextIndex]);
+        ready.erase(nextIndex++);
+        spaceAvailable.notify_all();
+        return true;
+    }
+
+    void stop() {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopped = true;
+        spaceAvailable.notify_all();
+        chunkReady.notify_all();
+    }
+
+private:
+    std::mutex mutex;
+    std::condition_variable spaceAvailable;
+    std::condition_variable chunkReady;
+    std::map<long long, Chunk> ready;
+    long long nextIndex = 0;
+    long long maxAhead;
+    bool stopped = false;
+};
+
+std::string formatTimestamp(std::time_t t) {
+    std::tm utc;
+    gmtime_r(&t, &utc);
+    char buffer[32];
+    std::strftime(buffer, sizeof(buffer), "%Y-%m-%d %H:%M:%S", &utc);
+    return buffer;
+}
+
+std::time_t randomPastTime(std::mt19937_64& rng) {
+    return kNewestTimestamp - static_cast<std::time_t>(rng() % kHistorySeconds);
+}
+
+/// @brief Shared, read-only state used by all producers.
+struct Plan {
+    GeneratorConfig config;
+    int workers;
+    long long feedbackRows;
+    long long taskChunks;
+    long long totalChunks;
+    ZipfSampler workerZipf;
+    ZipfSampler ruleZipf;
+    std::vector<int> workerByRank;   ///< Zipf rank -> worker ID, shuffled by seed
+    std::vector<int> ruleByRank;     ///< Zipf rank -> rule ID, shuffled by seed
+};
+
+Chunk produceChunk(const Plan& plan, long long index) {
+    const GeneratorConfig& config = plan.config;
+    std::mt19937_64 rng(config.seed * 0x9E3779B97F4A7C15ULL + static_cast<unsigned long long>(index));
+    Chunk chunk;
+
+    if (index < plan.taskChunks) {
+        long long first = index * kChunkRows + 1;
+        long long last = std::min(config.tasks, first + kChunkRows - 1);
+        chunk.tasks.reserve(last - first + 1);
+
+        for (long long id = first; id <= last; ++id) {
+            TaskRow row;
+            row.id = id;
+            row.workerId = plan.workerByRank[plan.workerZipf.sample(rng)];
+            row.description = std::string(pick(kActions, rng)) + " " + pick(kEquipment, rng) + " in " + pick(kAreas, rng);
+
+            double u = std::uniform_real_distribution<double>(0.0, 1.0)(rng);
+            row.status = u < 0.70 ? "completed" : u < 0.85 ? "pending" : u < 0.93 ? "violation" : "incomplete";
+
+            if (row.status[0] == 'c') {
+                int words = config.reportWordsMin +
+                            static_cast<int>(rng() % (config.reportWordsMax - config.reportWordsMin + 1));
+                row.report.reserve(words * 8);
+                for (int w = 0; w < words; ++w) {
+                    if (w) row.report += ' ';
+                    row.report += pick(kReportWords, rng);
+                }
+                row.media = "./uploads/task_" + std::to_string(id) + "_user_" + std::to_string(row.workerId);
+                row.completedAt = formatTimestamp(randomPastTime(rng));
+            } else if (row.status[0] == 'v' || row.status[0] == 'i') {
+                row.violationComment = pick(kViolations, rng);
+                row.violationTimestamp = formatTimestamp(randomPastTime(rng));
+            }
+            // Open tasks carry a deadline, which by today's clock has passed: the worst case for the overdue list
+            if (row.status[0] != 'c') {
+                row.dueAt = randomPastTime(rng);
+                row.priority = 1 + static_cast<int>(rng() % 3);
+            }
+            chunk.tasks.push_back(std::move(row));
+        }
+    } else {
+        long long first = (index - plan.taskChunks) * kChunkRows;
+        long long last = std::min(plan.feedbackRows, first + kChunkRows);
+        chunk.feedback.reserve(last - first);
+
+        for (long long n = first; n < last; ++n) {
+            FeedbackRow row;
+            row.ruleId = plan.ruleByRank[plan.ruleZipf.sample(rng)];
+            row.workerId = plan.workerByRank[plan.workerZipf.sample(rng)];
+            row.createdAt = formatTimestamp(randomPastTime(rng));
+            row.rating = rng() % 10 < 6 ? 1 + static_cast<int>(rng() % 5) : 0;
+            row.text = pick(kFeedback, rng);
+            chunk.feedback.push_back(std::move(row));
+        }
+    }
+    return chunk;
+}
+
+bool exec(sqlite3* db, const char* sql) {
+    if (sqlite3_exec(db, sql, 0, 0, nullptr) != SQLITE_OK) {
+        std::cerr << "Generator SQL failed (" << sql << "): " << sqlite3_errmsg(db) << "\n";
+        return false;
+    }
+    return true;
+}
+
+bool insertUsersAndRules(sqlite3* db, const Plan& plan) {
+    const GeneratorConfig& config = plan.config;
+    std::string hashed = core::hashPassword(config.password);
+    std::mt19937_64 rng(config.seed);
+
+    sqlite3_stmt* stmt = nullptr;
+    if (sqlite3_prepare_v2(db, "INSERT INTO users (id, username, password, role) VALUES (?, ?, ?, ?);",
+                           -1, &stmt, nullptr) != SQLITE_OK) {
+        return false;
+    }
+    for (int id = 1; id <= plan.workers + config.managers; ++id) {
+        bool isWorker = id <= plan.workers;
+        std::string name = isWorker ? generatedWorkerName(id) : generatedManagerName(id - plan.workers);
+        sqlite3_bind_int(stmt, 1, id);
+        sqlite3_bind_text(stmt, 2, name.c_str(), -1, SQLITE_TRANSIENT);
+        sqlite3_bind_text(stmt, 3, hashed.c_str(), -1, SQLITE_STATIC);
+        sqlite3_bind_text(stmt, 4, isWorker ? "worker" : "manager", -1, SQLITE_STATIC);
+        if (sqlite3_step(stmt) != SQLITE_DONE) {
+            std::cerr << "Inserting users failed: " << sqlite3_errmsg(db) << "\n";
+            sqlite3_finalize(stmt);
+            return false;
+        }
+        sqlite3_reset(stmt);
+    }
+    sqlite3_finalize(stmt);
+
+    if (sqlite3_prepare_v2(db, "INSERT INTO rules (id, rule_text, timestamp) VALUES (?, ?, ?);",
+                           -1, &stmt, nullptr) != SQLITE_OK) {
+        return false;
+    }
+    for (int id = 1; id <= config.rules; ++id) {
+        std::string text = std::string("Always use the ") + pick(kEquipment, rng) + " correctly in " +
+                           pick(kAreas, rng) + " (rule " + std::to_string(id) + ")";
+        std::string timestamp = formatTimestamp(randomPastTime(rng));
+        sqlite3_bind_int(stmt, 1, id);
+        sqlite3_bind_text(stmt, 2, text.c_str(), -1, SQLITE_TRANSIENT);
+        sqlite3_bind_text(stmt, 3, timestamp.c_str(), -1, SQLITE_TRANSIENT);
+        if (sqlite3_step(stmt) != SQLITE_DONE) {
+            std::cerr << "Inserting rules failed: " << sqlite3_errmsg(db) << "\n";
+            sqlite3_finalize(stmt);
+            return false;
+        }
+        sqlite3_reset(stmt);
+    }
+    sqlite3_finalize(stmt);
+    return true;
+}
+
+void bindOptionalText(sqlite3_stmt* stmt, int index, const std::string& value) {
+    if (value.empty()) {
+        sqlite3_bind_null(stmt, index);
+    } else {
+        sqlite3_bind_text(stmt, index, value.c_str(), static_cast<int>(value.size()), SQLITE_STATIC);
+    }
+}
+
+/// @brief Consumes chunks in order and writes them in transactions of config.batchRows rows.
+bool writeChunks(sqlite3* db, const Plan& plan, OrderedQueue& queue) {
+    sqlite3_stmt* taskStmt = nullptr;
+    sqlite3_stmt* feedbackStmt = nullptr;
+    sqlite3_prepare_v2(db, "INSERT INTO tasks (id, worker_id, worker_username, task_description, status, "
+                           "violation_comment, violation_timestamp, worker_report, worker_media, completed_at, "
+                           "due_at, priority) VALUES (?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?);", -1, &taskStmt, nullptr);
+    sqlite3_prepare_v2(db, "INSERT INTO rule_feedback (rule_id, worker_id, created_at, rating, feedback_text) "
+                       "VALUES (?, ?, ?, ?, ?);", -1, &feedbackStmt, nullptr);
+    if (!taskStmt || !feedbackStmt) {
+        std::cerr << "Preparing inserts failed: " << sqlite3_errmsg(db) << "\n";
+        sqlite3_finalize(taskStmt);
+        sqlite3_finalize(feedbackStmt);
+        return false;
+    }
+
+    bool ok = exec(db, "BEGIN;");
+    long long rowsInTransaction = 0;
+    long long rowsWritten = 0;
+    Chunk chunk;
+
+    for (long long index = 0; ok && index < plan.totalChunks; ++index) {
+        if (!queue.pop(chunk)) {
+            ok = false;
+            break;
+        }
+
+        for (const TaskRow& row : chunk.tasks) {
+            std::string username = generatedWorkerName(row.workerId);
+            sqlite3_bind_int64(taskStmt, 1, row.id);
+            sqlite3_bind_int(taskStmt, 2, row.workerId);
+            sqlite3_bind_text(taskStmt, 3, username.c_str(), -1, SQLITE_STATIC);
+            sqlite3_bind_text(taskStmt, 4, row.description.c_str(), -1, SQLITE_STATIC);
+            sqlite3_bind_text(taskStmt, 5, row.status, -1, SQLITE_STATIC);
+            bindOptionalText(taskStmt, 6, row.violationComment);
+            bindOptionalText(taskStmt, 7, row.violationTimestamp);
+            bindOptionalText(taskStmt, 8, row.report);
+            bindOptionalText(taskStmt, 9, row.media);
+            bindOptionalText(taskStmt, 10, row.completedAt);
+            if (row.dueAt) {
+                sqlite3_bind_int64(taskStmt, 11, row.dueAt);
+            } else {
+                sqlite3_bind_null(taskStmt, 11);
+            }
+            sqlite3_bind_int(taskStmt, 12, row.priority);
+            if (sqlite3_step(taskStmt) != SQLITE_DONE) {
+                std::cerr << "Inserting task " << row.id << " failed: " << sqlite3_errmsg(db) << "\n";
+                ok = false;
+                break;
+            }
+            sqlite3_reset(taskStmt);
+        }
+
+        for (const FeedbackRow& row : chunk.feedback) {
+            if (!ok) break;
+            sqlite3_bind_int(feedbackStmt, 1, row.ruleId);
+            sqlite3_bind_int(feedbackStmt, 2, row.workerId);
+            sqlite3_bind_text(feedbackStmt, 3, row.createdAt.c_str(), -1, SQLITE_STATIC);
+            if (row.rating > 0) {
+                sqlite3_bind_int(feedbackStmt, 4, row.rating);
+            } else {
+                sqlite3_bind_null(feedbackStmt, 4);
+            }
+            sqlite3_bind_text(feedbackStmt, 5, row.text.c_str(), -1, SQLITE_STATIC);
+            if (sqlite3_step(feedbackStmt) != SQLITE_DONE) {
+                std::cerr << "Inserting feedback failed: " << sqlite3_errmsg(db) << "\n";
+                ok = false;
+                break;
+            }
+            sqlite3_reset(feedbackStmt);
+        }
+
+        long long rows = static_cast<long long>(chunk.tasks.size() + chunk.feedback.size());
+        rowsInTransaction += rows;
+        rowsWritten += rows;
+        if (ok && rowsInTransaction >= plan.config.batchRows) {
+            ok = exec(db, "COMMIT;") && exec(db, "BEGIN;");
+            rowsInTransaction = 0;
+            if (!plan.config.quiet) {
+                std::cerr << "  " << rowsWritten << " rows written\n";
+            }
+        }
+    }
+
+    ok = ok && exec(db, "COMMIT;");
+    if (!ok) {
+        sqlite3_exec(db, "ROLLBACK;", 0, 0, nullptr);
+    }
+    sqlite3_finalize(taskStmt);
+    sqlite3_finalize(feedbackStmt);
+    return ok;
+}
+
+}  // namespace
+
+int generatedWorkerCount(const GeneratorConfig& config) {
+    if (config.workers > 0) return config.workers;
+    return static_cast<int>(std::max(10LL, config.tasks / 100));
+}
+
+std::string generatedWorkerName(int n) {
+    return "worker" + std::to_string(n);
+}
+
+std::string generatedManagerName(int n) {
+    return "manager" + std::to_string(n);
+}
+
+bool generateDataset(const std::string& path, const GeneratorConfig& config) {
+    if (config.tasks < 0 || config.rules < 1 || config.threads < 1 || config.batchRows < 1 ||
+        config.reportWordsMin < 1 || config.reportWordsMax < config.reportWordsMin) {
+        std::cerr << "Invalid generator configuration.\n";
+        return false;
+    }
+
+    int workers = generatedWorkerCount(config);
+    long long feedbackRows = config.feedback >= 0 ? config.feedback : config.tasks / 10;
+    long long taskChunks = (config.tasks + kChunkRows - 1) / kChunkRows;
+    long long feedbackChunks = (feedbackRows + kChunkRows - 1) / kChunkRows;
+
+    Plan plan{config, workers, feedbackRows, taskChunks, taskChunks + feedbackChunks,
+              ZipfSampler(workers, config.zipfExponent), ZipfSampler(config.rules, config.zipfExponent), {}, {}};
+    std::mt19937_64 shuffleRng(config.seed);
+    plan.workerByRank.resize(workers);
+    std::iota(plan.workerByRank.begin(), plan.workerByRank.end(), 1);
+    std::shuffle(plan.workerByRank.begin(), plan.workerByRank.end(), shuffleRng);
+    plan.ruleByRank.resize(config.rules);
+    std::iota(plan.ruleByRank.begin(), plan.ruleByRank.end(), 1);
+    std::shuffle(plan.ruleByRank.begin(), plan.ruleByRank.end(), shuffleRng);
+
+    DatabaseManager dbManager(path);
+    sqlite3* db = dbManager.getDB();
+    if (!db) {
+        return false;
+    }
+    dbManager.setupTables();
+
+    sqlite3_stmt* stmt = nullptr;
+    bool empty = sqlite3_prepare_v2(db, "SELECT count(*) FROM users;", -1, &stmt, nullptr) == SQLITE_OK &&
+                 sqlite3_step(stmt) == SQLITE_ROW && sqlite3_column_int64(stmt, 0) == 0;
+    sqlite3_finalize(stmt);
+    if (!empty) {
+        std::cerr << "Refusing to generate into " << path << ": it already contains users.\n";
+        return false;
+    }
+
+    // Bulk-load settings; the search index and the tasks indexes are rebuilt in one pass afterwards
+    exec(db, "PRAGMA synchronous = OFF;");
+    exec(db, "PRAGMA journal_mode = MEMORY;");
+    exec(db, "PRAGMA cache_size = -262144;");
+    exec(db, "DROP TRIGGER IF EXISTS rules_fts_ai; DROP TRIGGER IF EXISTS rules_fts_ad; "
+             "DROP TRIGGER IF EXISTS rules_fts_au; DROP TRIGGER IF EXISTS tasks_fts_ai; "
+             "DROP TRIGGER IF EXISTS tasks_fts_ad; DROP TRIGGER IF EXISTS tasks_fts_au;");
+    exec(db, "DROP INDEX IF EXISTS idx_tasks_worker; DROP INDEX IF EXISTS idx_tasks_status; "
+             "DROP INDEX IF EXISTS idx_tasks_completed;");
+
+    bool ok = exec(db, "BEGIN;") && insertUsersAndRules(db, plan) && exec(db, "COMMIT;");
+
+    if (ok) {
+        OrderedQueue queue(config.threads * 2 + 1);
+        std::atomic<long long> nextChunk{0};
+        std::vector<std::future<void>> producers;
+        for (int t = 0; t < config.threads; ++t) {
+            producers.push_back(executor::async([&] {
+                long long index;
+                while ((index = nextChunk++) < plan.totalChunks) {
+                    if (!queue.push(index, produceChunk(plan, index))) break;
+                }
+            }, executor::Priority::Low));
+        }
+
+        ok = writeChunks(db, plan, queue);
+        queue.stop();
+        for (std::future<void>& producer : producers) {
+            producer.wait();
+        }
+    }
+
+    if (ok) {
+        if (!config.quiet) {
+            std::cerr << (config.searchIndex ? "  rebuilding search index\n" : "  clearing search index\n");
+        }
+        ok = config.searchIndex
+            ? exec(db, "INSERT INTO rules_fts(rules_fts) VALUES ('rebuild'); "
+                       "INSERT INTO tasks_fts(tasks_fts) VALUES ('rebuild');")
+            : exec(db, "INSERT INTO rules_fts(rules_fts) VALUES ('delete-all'); "
+                       "INSERT INTO tasks_fts(tasks_fts) VALUES ('delete-all');");
+    }
+
+    // Restore the search triggers and tasks indexes dropped for the load
+    dbManager.setupTables();
+    exec(db, "PRAGMA synchronous = FULL;");
+    return ok;
+}
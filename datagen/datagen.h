@@ -0,0 +1,65 @@
+#ifndef DATAGEN_H_
+#define DATAGEN_H_
+
+#include <string>
+
+/**
+ * @struct GeneratorConfig
+ * @brief Shape of a synthetic production-scale EHS database.
+ *
+ * The same config and seed always produce the same database, whatever the
+ * number of producer threads.
+ */
+struct GeneratorConfig {
+    long long tasks = 10000;          ///< Number of task rows
+    int workers = 0;                  ///< Number of workers; 0 means tasks / 100 (at least 10)
+    int managers = 5;                 ///< Number of managers
+    int rules = 200;                  ///< Number of safety rules
+    long long feedback = 0;           ///< Number of rule feedback rows; -1 means tasks / 10
+    double zipfExponent = 1.1;        ///< Skew of tasks per worker and feedback per rule
+    unsigned long long seed = 42;     ///< Random seed
+    int threads = 4;                  ///< Number of producer jobs queued on the shared pool
+    long long batchRows = 100000;     ///< Rows per write transaction
+    int reportWordsMin = 20;          ///< Shortest worker report, in words
+    int reportWordsMax = 200;         ///< Longest worker report, in words
+    std::string password = "password"; ///< Password given to every generated user
+    bool searchIndex = true;          ///< Rebuild the full-text index after loading
+    bool quiet = false;               ///< Suppress progress output on std::cerr
+};
+
+/**
+ * @brief Returns the number of workers a config generates.
+ */
+int generatedWorkerCount(const GeneratorConfig& config);
+
+/**
+ * @brief Returns the username of the n-th generated worker (1-based, equal to its user ID).
+ */
+std::string generatedWorkerName(int n);
+
+/**
+ * @brief Returns the username of the n-th generated manager (1-based).
+ */
+std::string generatedManagerName(int n);
+
+/**
+ * @brief Writes a synthetic dataset into a database file.
+ *
+ * The schema is created with DatabaseManager::setupTables. Workers get user
+ * IDs 1..W and managers W+1..W+M. Tasks are spread over workers with a Zipf
+ * distribution and carry a realistic status mix, long worker reports for
+ * completed work, violation details and media references. Rule feedback is
+ * Zipf-distributed over rules.
+ *
+ * Rows are produced by config.threads producer jobs on the shared pool
+ * (executor/executor.h; at most one per pool thread runs at a time) and written by a
+ * single writer in transactions of config.batchRows rows. The full-text
+ * triggers are suspended during the load and the index rebuilt once at the end.
+ *
+ * @param path Database file; it must not contain users yet.
+ * @param config Dataset shape.
+ * @return True if the dataset was written completely.
+ */
+bool generateDataset(const std::string& path, const GeneratorConfig& config);
+
+#endif  // DATAGEN_H_
@@ -0,0 +1,89 @@
+/**
+ * @file ehs_datagen.cpp
+ * @brief Command-line front end of the synthetic data generator.
+ *
+ * Compile from the repository root:
+ * @code
+ * g++ -std=c++20 -O2 datagen/ehs_datagen.cpp datagen/datagen.cpp core/core.cpp metrics/metrics.cpp trace/trace.cpp logging/logging.cpp executor/executor.cpp db/Database.cpp db/SlowQueryLog.cpp -lsqlite3 -lssl -lcrypto -pthread -o ehs_datagen
+ * @endcode
+ *
+ * Usage:
+ * @code
+ * ./ehs_datagen --out ehs.db [--tasks N] [--workers N] [--managers N] [--rules N]
+ *               [--feedback N] [--zipf S] [--seed N] [--threads N] [--batch N]
+ *               [--report-words MIN,MAX] [--password PW] [--no-search-index]
+ * @endcode
+ */
+
+#include "datagen.h"
+#include "../executor/executor.h"
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+
+int main(int argc, char** argv) {
+    GeneratorConfig config;
+    config.feedback = -1;
+    std::string out;
+
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (arg == "--out" && hasValue) {
+            out = argv[++i];
+        } else if (arg == "--tasks" && hasValue) {
+            config.tasks = std::atoll(argv[++i]);
+        } else if (arg == "--workers" && hasValue) {
+            config.workers = std::atoi(argv[++i]);
+        } else if (arg == "--managers" && hasValue) {
+            config.managers = std::atoi(argv[++i]);
+        } else if (arg == "--rules" && hasValue) {
+            config.rules = std::atoi(argv[++i]);
+        } else if (arg == "--feedback" && hasValue) {
+            config.feedback = std::atoll(argv[++i]);
+        } else if (arg == "--zipf" && hasValue) {
+            config.zipfExponent = std::atof(argv[++i]);
+        } else if (arg == "--seed" && hasValue) {
+            config.seed = std::strtoull(argv[++i], nullptr, 10);
+        } else if (arg == "--threads" && hasValue) {
+            config.threads = std::atoi(argv[++i]);
+        } else if (arg == "--batch" && hasValue) {
+            config.batchRows = std::atoll(argv[++i]);
+        } else if (arg == "--report-words" && hasValue) {
+            std::string range = argv[++i];
+            size_t comma = range.find(',');
+            config.reportWordsMin = std::atoi(range.substr(0, comma).c_str());
+            config.reportWordsMax = comma == std::string::npos ? config.reportWordsMin
+                                                               : std::atoi(range.substr(comma + 1).c_str());
+        } else if (arg == "--password" && hasValue) {
+            config.password = argv[++i];
+        } else if (arg == "--no-search-index") {
+            config.searchIndex = false;
+        } else {
+            out.clear();
+            break;
+        }
+    }
+
+    if (out.empty()) {
+        std::cerr << "Usage: ehs_datagen --out FILE [--tasks N] [--workers N] [--managers N] [--rules N]\n"
+                     "                   [--feedback N] [--zipf S] [--seed N] [--threads N] [--batch N]\n"
+                     "                   [--report-words MIN,MAX] [--password PW] [--no-search-index]\n";
+        return 1;
+    }
+
+    // One pool thread per producer job
+    executor::start(config.threads);
+
+    auto start = std::chrono::steady_clock::now();
+    if (!generateDataset(out, config)) {
+        std::cerr << "Generation failed.\n";
+        return 1;
+    }
+
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    std::cerr << "Generated " << config.tasks << " tasks for " << generatedWorkerCount(config)
+              << " workers in " << seconds << "s\n";
+    return 0;
+}
@@ -0,0 +1,211 @@
+/**
+ * @file ConnectionPool.cpp
+ * @brief Implementation of the ConnectionPool class (WAL writer thread and read connections).
+ *
+ * A Reader holds a weak reference to the pool's reader state, so a handle
+ * that outlives the pool does not touch it again. The pool closes only idle
+ * connections; one still lent when the pool goes is closed by its Reader.
+ *
+ */
+
+#include "ConnectionPool.h"
+#include "../logging/logging.h"
+#include "../trace/trace.h"
+#include <algorithm>
+#include <vector>
+
+struct ConnectionPool::ReaderState {
+    std::string dbName;
+    int maxReaders;
+    std::function<void(sqlite3*)> onOpen;
+
+    std::mutex mutex;                   ///< Guards everything below
+    std::condition_variable returned;
+    std::vector<sqlite3*> idle;
+    int opened = 0;                     ///< Connections opened or being opened
+    bool closed = false;
+
+    /// @brief Takes a connection back; false once the pool is closed, when the caller must close it.
+    bool release(sqlite3* connection) {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (closed) return false;
+        idle.push_back(connection);
+        returned.notify_one();
+        return true;
+    }
+};
+
+namespace {
+
+const size_t kMaxBatch = 256;  ///< Writes committed together at most
+
+}  // namespace
+
+void ConnectionPool::Reader::release() {
+    if (!connection) return;
+    std::shared_ptr<ReaderState> state = owner.lock();
+    if (!state || !state->release(connection)) {
+        sqlite3_close(connection);  // The pool is gone
+    }
+    connection = nullptr;
+}
+
+ConnectionPool::ConnectionPool(sqlite3* writer, const std::string& dbName, int maxReaders,
+                               std::function<void(sqlite3*)> onOpen)
+    : writer(writer), readers(std::make_shared<ReaderState>()) {
+    readers->dbName = dbName;
+    readers->maxReaders = std::max(1, maxReaders);
+    readers->onOpen = std::move(onOpen);
+
+    char* errMsg = nullptr;
+    if (sqlite3_exec(writer, "PRAGMA journal_mode = WAL; PRAGMA busy_timeout = 5000;", nullptr, nullptr,
+                     &errMsg) != SQLITE_OK) {
+        logging::error("Failed to enable WAL mode: {}", errMsg ? errMsg : "unknown error");
+        sqlite3_free(errMsg);
+    }
+
+    writerThread = std::thread(&ConnectionPool::writerLoop, this);
+}
+
+ConnectionPool::~ConnectionPool() {
+    {
+        std::lock_guard<std::mutex> lock(writeMutex);
+        stopping = true;
+    }
+    writeReady.notify_one();
+    writerThread.join();
+
+    std::lock_guard<std::mutex> lock(readers->mutex);
+    readers->closed = true;
+    for (sqlite3* connection : readers->idle) {
+        sqlite3_close(connection);
+    }
+    readers->idle.clear();
+    readers->returned.notify_all();  // Waiting reader() calls give up
+}
+
+ConnectionPool::Reader ConnectionPool::reader() {
+    ReaderState& state = *readers;
+    sqlite3* connection = nullptr;
+    {
+        std::unique_lock<std::mutex> lock(state.mutex);
+        if (state.idle.empty() && state.opened >= state.maxReaders) {
+            trace::Span span("db.reader.wait", "lock");
+            state.returned.wait(lock, [&] {
+                return state.closed || !state.idle.empty() || state.opened < state.maxReaders;
+            });
+        }
+        if (state.closed) {
+            return Reader();
+        }
+        if (!state.idle.empty()) {
+            connection = state.idle.back();
+            state.idle.pop_back();
+        } else {
+            ++state.opened;
+        }
+    }
+
+    if (!connection) {
+        if (sqlite3_open_v2(state.dbName.c_str(), &connection, SQLITE_OPEN_READONLY | SQLITE_OPEN_NOMUTEX,
+                            nullptr) != SQLITE_OK) {
+            logging::error("Failed to open read connection: {}", sqlite3_errmsg(connection));
+            sqlite3_close(connection);
+            std::lock_guard<std::mutex> lock(state.mutex);
+            --state.opened;
+            state.returned.notify_one();  // A waiter may open one in its place
+            return Reader();
+        }
+        sqlite3_busy_timeout(connection, 5000);
+        if (state.onOpen) {
+            state.onOpen(connection);
+        }
+    }
+
+    return Reader(readers, connection);
+}
+
+void ConnectionPool::enqueue(std::function<void(sqlite3*)> run, std::function<void()> publish, bool alone) {
+    {
+        std::lock_guard<std::mutex> lock(writeMutex);
+        writeQueue.push_back({std::move(run), std::move(publish), alone});
+    }
+    writeReady.notify_one();
+}
+
+void ConnectionPool::writerLoop() {
+    trace::setThreadName("db-writer");
+    std::vector<WriteJob> batch;
+    while (true) {
+        {
+            std::unique_lock<std::mutex> lock(writeMutex);
+            writeReady.wait(lock, [&] { return stopping || !writeQueue.empty(); });
+            if (writeQueue.empty()) {
+                return;
+            }
+            // An exclusive job ends the batch before it and runs in a batch of its own
+            while (!writeQueue.empty() && batch.size() < kMaxBatch &&
+                   !(writeQueue.front().alone && !batch.empty())) {
+                batch.push_back(std::move(writeQueue.front()));
+                writeQueue.pop_front();
+                if (batch.back().alone) break;
+            }
+        }
+        runBatch(batch);
+        batch.clear();
+    }
+}
+
+void ConnectionPool::runBatch(std::vector<WriteJob>& batch) {
+    trace::Span span("db.write", "db");
+    bool grouped = batch.size() > 1 && sqlite3_get_autocommit(writer) &&
+                   sqlite3_exec(writer, "BEGIN IMMEDIATE;", nullptr, nullptr, nullptr) == SQLITE_OK;
+    if (grouped) {
+        for (WriteJob& job : batch) {
+            job.run(writer);
+        }
+        if (sqlite3_exec(writer, "COMMIT;", nullptr, nullptr, nullptr) == SQLITE_OK) {
+            for (WriteJob& job : batch) {
+                job.publish();
+            }
+            return;
+        }
+        logging::warn("Group commit of {} writes failed, retrying one by one: {}", batch.size(),
+                      sqlite3_errmsg(writer));
+        sqlite3_exec(writer, "ROLLBACK;", nullptr, nullptr, nullptr);
+    }
+
+    for (WriteJob& job : batch) {
+        job.run(writer);
+        job.publish();
+    }
+}
+
+int ConnectionPool::addUpdateHook(UpdateHook hook) {
+    // Exclusive, so a failed group commit never runs it twice
+    return exclusive([this, &hook](sqlite3* db) {
+        if (updateHooks.empty()) {
+            sqlite3_update_hook(db, &ConnectionPool::onUpdate, this);
+        }
+        updateHooks.emplace_back(++lastHookId, std::move(hook));
+        return lastHookId;
+    });
+}
+
+void ConnectionPool::removeUpdateHook(int id) {
+    exclusive([this, id](sqlite3* db) {
+        updateHooks.erase(std::remove_if(updateHooks.begin(), updateHooks.end(),
+                                         [id](const std::pair<int, UpdateHook>& hook) { return hook.first == id; }),
+                          updateHooks.end());
+        if (updateHooks.empty()) {
+            sqlite3_update_hook(db, nullptr, nullptr);
+        }
+        return 0;
+    });
+}
+
+void ConnectionPool::onUpdate(void* pool, int op, const char* database, const char* table, sqlite3_int64 rowid) {
+    for (const std::pair<int, UpdateHook>& hook : static_cast<ConnectionPool*>(pool)->updateHooks) {
+        hook.second(op, database, table, rowid);
+    }
+}
@@ -0,0 +1,194 @@
+#ifndef CONNECTIONPOOL_H
+#define CONNECTIONPOOL_H
+
+#include <sqlite3.h>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+/**
+ * @class ConnectionPool
+ * @brief One writer connection on a dedicated thread plus a pool of read-only connections.
+ *
+ * The database is switched to WAL mode, so readers see the last committed
+ * state without waiting for the writer and the writer never waits for
+ * readers. Every write runs on the writer thread, one at a time, which is the
+ * only serialization SQLite needs; writes that queue up behind each other are
+ * committed as one transaction. Reads run on the calling thread, on a
+ * read-only connection lent by reader(). No lock is held around reads.
+ *
+ * A connection is lent for as long as the Reader handle lives, which for
+ * `core::listTasks(pool.reader(), ...)` is the one call, and then goes back
+ * to the pool. At most maxReaders read connections are opened; further
+ * callers wait until a running read returns one.
+ */
+class ConnectionPool {
+public:
+    /**
+     * @brief Switches the database to WAL mode and starts the writer thread.
+     *
+     * @param writer Open read-write connection; it stays owned by the caller
+     *        (DatabaseManager) and must outlive the pool.
+     * @param dbName Database file, used to open the read-only connections.
+     * @param maxReaders Maximum number of read-only connections.
+     * @param onOpen Called with every read connection after it is opened,
+     *        e.g. to attach the slow-query log.
+     */
+    ConnectionPool(sqlite3* writer, const std::string& dbName, int maxReaders = 8,
+                   std::function<void(sqlite3*)> onOpen = nullptr);
+
+    /**
+     * @brief Runs the queued writes, stops the writer thread and closes the idle read connections.
+     *
+     * A connection still lent out is closed when its Reader is destroyed.
+     */
+    ~ConnectionPool();
+
+    struct ReaderState;  ///< Open and idle read connections (ConnectionPool.cpp)
+
+    /**
+     * @class Reader
+     * @brief A read connection lent by reader(), returned to the pool when the handle is destroyed.
+     *
+     * Converts to sqlite3*, so it can be passed straight to the core functions.
+     */
+    class Reader {
+    public:
+        Reader() = default;
+        Reader(std::weak_ptr<ReaderState> owner, sqlite3* connection)
+            : owner(std::move(owner)), connection(connection) {}
+        Reader(Reader&& other) noexcept : owner(std::move(other.owner)), connection(other.connection) {
+            other.connection = nullptr;
+        }
+        Reader& operator=(Reader&& other) noexcept {
+            if (this != &other) {
+                release();
+                owner = std::move(other.owner);
+                connection = other.connection;
+                other.connection = nullptr;
+            }
+            return *this;
+        }
+        Reader(const Reader&) = delete;
+        Reader& operator=(const Reader&) = delete;
+        ~Reader() { release(); }
+
+        sqlite3* get() const { return connection; }
+        operator sqlite3*() const { return connection; }
+
+    private:
+        void release();
+
+        std::weak_ptr<ReaderState> owner;
+        sqlite3* connection = nullptr;
+    };
+
+    ConnectionPool(const ConnectionPool&) = delete;
+    ConnectionPool& operator=(const ConnectionPool&) = delete;
+
+    /**
+     * @brief Lends a read-only connection, waiting for one if maxReaders are in use.
+     *
+     * Keep the handle only for the reads that need it: a handle held for
+     * good takes its connection out of the pool.
+     *
+     * @return The connection; it converts to nullptr if it could not be opened or the pool is closing.
+     */
+    Reader reader();
+
+    /**
+     * @brief Runs @p job with the writer connection on the writer thread and returns its result.
+     *
+     * Blocks until the job's changes are committed, so a read issued
+     * afterwards sees them. Jobs queued while the writer is busy are committed
+     * together in one transaction (group commit); if that commit fails, each
+     * job is rolled back and run again on its own, so a job must only touch
+     * the database. Called from the writer thread itself, the job runs inline.
+     */
+    template <typename F>
+    std::invoke_result_t<F, sqlite3*> write(F&& job) {
+        return submit(std::forward<F>(job), false);
+    }
+
+    /**
+     * @brief Runs @p job with the writer connection on the writer thread, by itself and outside any transaction.
+     *
+     * Writes queued before the job are committed first and writes queued
+     * after it wait until it returns, so the job sees the database quiesced.
+     * Used for maintenance that SQLite refuses inside a transaction (ATTACH,
+     * VACUUM, backups into the database). Called from the writer thread
+     * itself, the job runs inline.
+     */
+    template <typename F>
+    std::invoke_result_t<F, sqlite3*> exclusive(F&& job) {
+        return submit(std::forward<F>(job), true);
+    }
+
+    /// @brief Called for each row the writer inserts, updates or deletes, as with sqlite3_update_hook().
+    using UpdateHook = std::function<void(int op, const char* database, const char* table, sqlite3_int64 rowid)>;
+
+    /**
+     * @brief Adds a callback for every row changed on the writer connection.
+     *
+     * SQLite keeps one update hook per connection, so the pool owns it and
+     * passes each change to every callback added here. Callbacks run on the
+     * writer thread in the middle of a statement and must not use the
+     * connection; changes that are later rolled back are reported too.
+     *
+     * @return ID to pass to removeUpdateHook().
+     */
+    int addUpdateHook(UpdateHook hook);
+
+    void removeUpdateHook(int id);
+
+private:
+    /// @brief A queued write and the callback that releases its caller once committed.
+    struct WriteJob {
+        std::function<void(sqlite3*)> run;
+        std::function<void()> publish;
+        bool alone = false;             ///< Never grouped with other jobs
+    };
+
+    template <typename F>
+    std::invoke_result_t<F, sqlite3*> submit(F&& job, bool alone) {
+        using Result = std::invoke_result_t<F, sqlite3*>;
+        if (std::this_thread::get_id() == writerThread.get_id()) {
+            return job(writer);
+        }
+        std::optional<Result> result;
+        std::promise<void> committed;
+        // Both closures only run before committed is set, while this frame is alive
+        enqueue([&](sqlite3* db) { result = job(db); }, [&]() { committed.set_value(); }, alone);
+        committed.get_future().wait();
+        return std::move(*result);
+    }
+
+    void enqueue(std::function<void(sqlite3*)> run, std::function<void()> publish, bool alone);
+    void writerLoop();
+    void runBatch(std::vector<WriteJob>& batch);
+    static void onUpdate(void* pool, int op, const char* database, const char* table, sqlite3_int64 rowid);
+
+    sqlite3* writer;
+    std::shared_ptr<ReaderState> readers;
+
+    std::mutex writeMutex;                          ///< Guards writeQueue and stopping
+    std::condition_variable writeReady;
+    std::deque<WriteJob> writeQueue;
+    bool stopping = false;
+    std::thread writerThread;
+
+    // Only touched on the writer thread
+    std::vector<std::pair<int, UpdateHook>> updateHooks;
+    int lastHookId = 0;
+};
+
+#endif // CONNECTIONPOOL_H
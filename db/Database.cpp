@@ -17,12 +17,14 @@
 
 #include "Database.h"
 #include <sqlite3.h>
-#include <iostream>
+#include "../core/core.h"
+#include "../logging/logging.h"
 
-DatabaseManager::DatabaseManager(const std::string& dbName) {
+DatabaseManager::DatabaseManager(const std::string& dbName, int openFlags) : dbName(dbName) {
     // Open the SQLite database
-    if (sqlite3_open(dbName.c_str(), &db)) {
-        std::cerr << "Failed to open DB: " << sqlite3_errmsg(db) << "\n";
+    if (sqlite3_open_v2(dbName.c_str(), &db, openFlags, nullptr)) {
+        logging::error("Failed to open DB {}: {}", dbName, sqlite3_errmsg(db));
+        sqlite3_close(db);
         db = nullptr;
     }
 }
@@ -35,15 +37,56 @@ DatabaseManager::DatabaseManager(const std::string& dbName) {
  */
 DatabaseManager::~DatabaseManager() {
     if (db) {
+        if (slowQueryLog) {
+            slowQueryLog->detach(db);
+        }
         sqlite3_close(db);
     }
 }
 
+/**
+ * @brief Enables the slow-query log on this connection.
+ *
+ * Replaces any previously enabled log. Statements taking at least thresholdMs
+ * are written with their expanded SQL, duration, rows stepped and query plan.
+ */
+void DatabaseManager::enableSlowQueryLog(const std::string& logPath, double thresholdMs,
+                                         std::uintmax_t maxBytes, int maxFiles) {
+    if (!db) {
+        return;
+    }
+    if (slowQueryLog) {
+        slowQueryLog->detach(db);
+    }
+    slowQueryLog.reset(new SlowQueryLog(dbName, logPath, thresholdMs, maxBytes, maxFiles));
+    slowQueryLog->attach(db);
+}
+
+/**
+ * @brief Traces another connection with the slow-query log, if it is enabled.
+ */
+void DatabaseManager::traceConnection(sqlite3* connection) {
+    if (slowQueryLog && connection) {
+        slowQueryLog->attach(connection);
+    }
+}
+
+/**
+ * @brief Runs @p setup on the slow-query log's plan connection, if the log is enabled.
+ */
+void DatabaseManager::preparePlanConnection(const std::function<void(sqlite3*)>& setup) {
+    if (slowQueryLog) {
+        slowQueryLog->preparePlanConnection(setup);
+    }
+}
+
 /**
  * @brief Sets up the required tables in the database.
  *
- * This function creates the 'users', 'tasks', and 'rules' tables if they do not
- * already exist. It will be called during initialization to ensure the database schema is set up.
+ * This function creates the 'users', 'tasks', 'rules', 'rule_feedback', 'worker_load' and
+ * 'shifts' tables if they do not already exist, along with the tasks indexes by worker and by status and the
+ * full-text search index over them. It will be called
+ * during initialization to ensure the database schema is set up.
  */
 void DatabaseManager::setupTables() {
     const char* userTable = "CREATE TABLE IF NOT EXISTS users ("
@@ -62,7 +105,12 @@ void DatabaseManager::setupTables() {
                             "violation_timestamp TEXT, "
                             "worker_report TEXT, "
                             "worker_media TEXT, "
-                            "FOREIGN KEY(worker_id) REFERENCES users(username));";
+                            "completed_at TEXT, "
+                            "due_at INTEGER, "
+                            "priority INTEGER NOT NULL DEFAULT 2, "
+                            "FOREIGN KEY(worker_id) REFERENCES users(username));"
+                            "CREATE INDEX IF NOT EXISTS idx_tasks_worker ON tasks(worker_id, id);"
+                            "CREATE INDEX IF NOT EXISTS idx_tasks_status ON tasks(status, id);";
 
     const char* rulesTable = "CREATE TABLE IF NOT EXISTS rules ("
                              "id INTEGER PRIMARY KEY AUTOINCREMENT, "
@@ -70,15 +118,273 @@ void DatabaseManager::setupTables() {
                              "feedback TEXT, "
                              "timestamp TEXT);";
 
+    const char* feedbackTable = "CREATE TABLE IF NOT EXISTS rule_feedback ("
+                                "id INTEGER PRIMARY KEY AUTOINCREMENT, "
+                                "rule_id INTEGER NOT NULL, "
+                                "worker_id INTEGER, "
+                                "created_at TEXT, "
+                                "rating INTEGER CHECK (rating BETWEEN 1 AND 5), "
+                                "feedback_text TEXT NOT NULL);"
+                                "CREATE INDEX IF NOT EXISTS idx_rule_feedback_rule ON rule_feedback(rule_id, id);"
+                                "CREATE TABLE IF NOT EXISTS rule_feedback_stats ("
+                                "rule_id INTEGER PRIMARY KEY, "
+                                "feedback_count INTEGER NOT NULL DEFAULT 0, "
+                                "rating_count INTEGER NOT NULL DEFAULT 0, "
+                                "rating_sum INTEGER NOT NULL DEFAULT 0);";
+
+    // Counters are maintained incrementally so listing rules never aggregates the feedback log
+    const char* feedbackTriggers =
+        "CREATE TRIGGER IF NOT EXISTS rule_feedback_ai AFTER INSERT ON rule_feedback BEGIN "
+        "INSERT INTO rule_feedback_stats(rule_id, feedback_count, rating_count, rating_sum) "
+        "VALUES (new.rule_id, 1, new.rating IS NOT NULL, IFNULL(new.rating, 0)) "
+        "ON CONFLICT(rule_id) DO UPDATE SET feedback_count = feedback_count + 1, "
+        "rating_count = rating_count + excluded.rating_count, "
+        "rating_sum = rating_sum + excluded.rating_sum; END;"
+        "CREATE TRIGGER IF NOT EXISTS rules_feedback_ad AFTER DELETE ON rules BEGIN "
+        "DELETE FROM rule_feedback WHERE rule_id = old.id; "
+        "DELETE FROM rule_feedback_stats WHERE rule_id = old.id; END;";
+
+    // next_due is Unix time so the scheduler compares integers, never parses timestamps
+    const char* schedulesTable = "CREATE TABLE IF NOT EXISTS schedules ("
+                                 "id INTEGER PRIMARY KEY AUTOINCREMENT, "
+                                 "worker_id INTEGER NOT NULL, "
+                                 "task_description TEXT NOT NULL, "
+                                 "interval_seconds INTEGER NOT NULL CHECK (interval_seconds >= 60), "
+                                 "next_due INTEGER NOT NULL);";
+
+    // weight is a percentage of a full share of tasks: a worker at 50 is handed half as many
+    const char* workerLoadTable = "CREATE TABLE IF NOT EXISTS worker_load ("
+                                  "worker_id INTEGER PRIMARY KEY, "
+                                  "open_tasks INTEGER NOT NULL DEFAULT 0, "
+                                  "weight INTEGER NOT NULL DEFAULT 100 CHECK (weight BETWEEN 1 AND 1000), "
+                                  "available INTEGER NOT NULL DEFAULT 1);"
+                                  "CREATE INDEX IF NOT EXISTS idx_worker_load_least "
+                                  "ON worker_load(open_tasks * 1.0 / weight, worker_id) WHERE available = 1;";
+
+    // Open-task counts follow every insert, status change and delete, so auto-assignment never counts tasks
+    const char* workerLoadTriggers =
+        "CREATE TRIGGER IF NOT EXISTS users_load_ai AFTER INSERT ON users WHEN new.role = 'worker' BEGIN "
+        "INSERT OR IGNORE INTO worker_load(worker_id) VALUES (new.id); END;"
+        "CREATE TRIGGER IF NOT EXISTS users_load_ad AFTER DELETE ON users BEGIN "
+        "DELETE FROM worker_load WHERE worker_id = old.id; END;"
+        "CREATE TRIGGER IF NOT EXISTS tasks_load_ai AFTER INSERT ON tasks WHEN new.status != 'completed' BEGIN "
+        "UPDATE worker_load SET open_tasks = open_tasks + 1 WHERE worker_id = CAST(new.worker_id AS INTEGER); END;"
+        "CREATE TRIGGER IF NOT EXISTS tasks_load_ad AFTER DELETE ON tasks WHEN old.status != 'completed' BEGIN "
+        "UPDATE worker_load SET open_tasks = open_tasks - 1 WHERE worker_id = CAST(old.worker_id AS INTEGER); END;"
+        "CREATE TRIGGER IF NOT EXISTS tasks_load_au AFTER UPDATE OF status, worker_id ON tasks "
+        "WHEN (old.status != 'completed') != (new.status != 'completed') OR old.worker_id != new.worker_id BEGIN "
+        "UPDATE worker_load SET open_tasks = open_tasks - 1 "
+        "WHERE old.status != 'completed' AND worker_id = CAST(old.worker_id AS INTEGER); "
+        "UPDATE worker_load SET open_tasks = open_tasks + 1 "
+        "WHERE new.status != 'completed' AND worker_id = CAST(new.worker_id AS INTEGER); END;";
+
+    // Shifts last at most a day (core::kMaxShiftSeconds), so every shift overlapping a time window
+    // starts in one range of the site index: the day before the window up to its end
+    const char* shiftsTable = "CREATE TABLE IF NOT EXISTS shifts ("
+                              "id INTEGER PRIMARY KEY AUTOINCREMENT, "
+                              "worker_id INTEGER NOT NULL, "
+                              "site TEXT NOT NULL, "
+                              "starts_at INTEGER NOT NULL, "
+                              "ends_at INTEGER NOT NULL, "
+                              "CHECK (ends_at > starts_at AND ends_at - starts_at <= 86400));"
+                              "CREATE INDEX IF NOT EXISTS idx_shifts_site ON shifts(site, starts_at, ends_at, worker_id);"
+                              "CREATE INDEX IF NOT EXISTS idx_shifts_worker ON shifts(worker_id, starts_at);"
+                              "CREATE TRIGGER IF NOT EXISTS users_shifts_ad AFTER DELETE ON users BEGIN "
+                              "DELETE FROM shifts WHERE worker_id = old.id; END;";
+
+    bool feedbackMigrated = tableExists("rule_feedback");
+    bool loadMigrated = tableExists("worker_load");
+
     // Execute the queries to create tables
     if (sqlite3_exec(db, userTable, 0, 0, nullptr) != SQLITE_OK) {
-        std::cerr << "Error creating users table: " << sqlite3_errmsg(db) << "\n";
+        logging::error("Error creating users table: {}", sqlite3_errmsg(db));
     }
     if (sqlite3_exec(db, taskTable, 0, 0, nullptr) != SQLITE_OK) {
-        std::cerr << "Error creating tasks table: " << sqlite3_errmsg(db) << "\n";
+        logging::error("Error creating tasks table: {}", sqlite3_errmsg(db));
+    }
+
+    // Completion times drive archiving; tasks completed before the column existed count as completed now
+    if (!columnExists("tasks", "completed_at")) {
+        const char* migrateSql = "ALTER TABLE tasks ADD COLUMN completed_at TEXT;"
+                                 "UPDATE tasks SET completed_at = strftime('%Y-%m-%d %H:%M:%S', 'now', 'localtime') "
+                                 "WHERE status = 'completed';";
+        if (sqlite3_exec(db, migrateSql, 0, 0, nullptr) != SQLITE_OK) {
+            logging::error("Error adding tasks.completed_at: {}", sqlite3_errmsg(db));
+        }
+    }
+    if (sqlite3_exec(db, "CREATE INDEX IF NOT EXISTS idx_tasks_completed ON tasks(completed_at) "
+                         "WHERE status = 'completed';", 0, 0, nullptr) != SQLITE_OK) {
+        logging::error("Error creating tasks completion index: {}", sqlite3_errmsg(db));
+    }
+    // Deadlines are Unix time, like schedules.next_due; existing tasks have none and normal priority
+    if (!columnExists("tasks", "due_at")) {
+        const char* migrateSql = "ALTER TABLE tasks ADD COLUMN due_at INTEGER;"
+                                 "ALTER TABLE tasks ADD COLUMN priority INTEGER NOT NULL DEFAULT 2;";
+        if (sqlite3_exec(db, migrateSql, 0, 0, nullptr) != SQLITE_OK) {
+            logging::error("Error adding tasks.due_at: {}", sqlite3_errmsg(db));
+        }
+    }
+    if (sqlite3_exec(db, "CREATE INDEX IF NOT EXISTS idx_tasks_deadline ON tasks(priority, due_at, id) "
+                         "WHERE status != 'completed' AND due_at IS NOT NULL;", 0, 0, nullptr) != SQLITE_OK) {
+        logging::error("Error creating tasks deadline index: {}", sqlite3_errmsg(db));
+    }
+    // A violation report sets a free-form status, so reported violations are the rows with a violation time.
+    // The first version of this index covered status = 'violation' only; it is replaced under a new name.
+    if (sqlite3_exec(db, "DROP INDEX IF EXISTS idx_tasks_violation; "
+                         "CREATE INDEX IF NOT EXISTS idx_tasks_violation_time ON tasks(violation_timestamp, id) "
+                         "WHERE violation_timestamp IS NOT NULL;", 0, 0, nullptr) != SQLITE_OK) {
+        logging::error("Error creating tasks violation index: {}", sqlite3_errmsg(db));
+    }
+    // Violation times used to be ctime text ("Fri Oct 16 20:23:11 2026"); they are now
+    // "YYYY-MM-DD HH:MM:SS", which sorts and compares as text. Legacy values start with a letter,
+    // so the index range above 'A' finds just them and the rewrite costs nothing once done.
+    std::string violationTimeSql = std::string("UPDATE tasks SET violation_timestamp = ") +
+                                   core::kLegacyViolationTimeToCoreSql + " WHERE violation_timestamp >= 'A' AND " +
+                                   core::kLegacyViolationTimeSql + ";";
+    if (sqlite3_exec(db, violationTimeSql.c_str(), 0, 0, nullptr) != SQLITE_OK) {
+        logging::error("Error converting violation times: {}", sqlite3_errmsg(db));
     }
     if (sqlite3_exec(db, rulesTable, 0, 0, nullptr) != SQLITE_OK) {
-        std::cerr << "Error creating rules table: " << sqlite3_errmsg(db) << "\n";
+        logging::error("Error creating rules table: {}", sqlite3_errmsg(db));
+    }
+    if (sqlite3_exec(db, feedbackTable, 0, 0, nullptr) != SQLITE_OK) {
+        logging::error("Error creating rule_feedback table: {}", sqlite3_errmsg(db));
+    }
+    if (sqlite3_exec(db, feedbackTriggers, 0, 0, nullptr) != SQLITE_OK) {
+        logging::error("Error creating rule_feedback triggers: {}", sqlite3_errmsg(db));
+    }
+    if (sqlite3_exec(db, schedulesTable, 0, 0, nullptr) != SQLITE_OK) {
+        logging::error("Error creating schedules table: {}", sqlite3_errmsg(db));
+    }
+
+    if (sqlite3_exec(db, workerLoadTable, 0, 0, nullptr) != SQLITE_OK) {
+        logging::error("Error creating worker_load table: {}", sqlite3_errmsg(db));
+    }
+    if (sqlite3_exec(db, workerLoadTriggers, 0, 0, nullptr) != SQLITE_OK) {
+        logging::error("Error creating worker_load triggers: {}", sqlite3_errmsg(db));
+    }
+
+    if (sqlite3_exec(db, shiftsTable, 0, 0, nullptr) != SQLITE_OK) {
+        logging::error("Error creating shifts table: {}", sqlite3_errmsg(db));
+    }
+
+    // Count the open tasks of workers registered before the table existed, once, from the per-worker index
+    if (!loadMigrated) {
+        const char* migrateSql = "INSERT OR IGNORE INTO worker_load (worker_id, open_tasks) "
+                                 "SELECT u.id, (SELECT COUNT(*) FROM tasks t WHERE t.worker_id = CAST(u.id AS TEXT) "
+                                 "AND t.status != 'completed') FROM users u WHERE u.role = 'worker';";
+        if (sqlite3_exec(db, migrateSql, 0, 0, nullptr) != SQLITE_OK) {
+            logging::error("Error counting open tasks per worker: {}", sqlite3_errmsg(db));
+        }
+    }
+
+    // Carry over the single feedback value older databases kept on the rule row
+    if (!feedbackMigrated) {
+        const char* migrateSql = "INSERT INTO rule_feedback (rule_id, created_at, feedback_text) "
+                                 "SELECT id, timestamp, feedback FROM rules "
+                                 "WHERE feedback IS NOT NULL AND feedback != '';";
+        if (sqlite3_exec(db, migrateSql, 0, 0, nullptr) != SQLITE_OK) {
+            logging::error("Error migrating rule feedback: {}", sqlite3_errmsg(db));
+        }
+    }
+
+    setupSearchIndex();
+}
+
+/**
+ * @brief Checks whether a table (or virtual table) exists in the schema.
+ *
+ * @param name Name of the table to look up in sqlite_master.
+ * @return True if the table exists.
+ */
+bool DatabaseManager::tableExists(const std::string& name) {
+    const char* sql = "SELECT 1 FROM sqlite_master WHERE name = ?;";
+    sqlite3_stmt* stmt = nullptr;
+    bool exists = false;
+
+    if (sqlite3_prepare_v2(db, sql, -1, &stmt, nullptr) == SQLITE_OK) {
+        sqlite3_bind_text(stmt, 1, name.c_str(), -1, SQLITE_TRANSIENT);
+        exists = sqlite3_step(stmt) == SQLITE_ROW;
+    }
+    sqlite3_finalize(stmt);
+    return exists;
+}
+
+/**
+ * @brief Checks whether a table has a column.
+ *
+ * @param table Table to inspect with PRAGMA table_info.
+ * @param column Column name.
+ * @return True if the column exists.
+ */
+bool DatabaseManager::columnExists(const std::string& table, const std::string& column) {
+    const char* sql = "SELECT 1 FROM pragma_table_info(?) WHERE name = ?;";
+    sqlite3_stmt* stmt = nullptr;
+    bool exists = false;
+
+    if (sqlite3_prepare_v2(db, sql, -1, &stmt, nullptr) == SQLITE_OK) {
+        sqlite3_bind_text(stmt, 1, table.c_str(), -1, SQLITE_TRANSIENT);
+        sqlite3_bind_text(stmt, 2, column.c_str(), -1, SQLITE_TRANSIENT);
+        exists = sqlite3_step(stmt) == SQLITE_ROW;
+    }
+    sqlite3_finalize(stmt);
+    return exists;
+}
+
+/**
+ * @brief Sets up the FTS5 full-text search index over rules and tasks.
+ *
+ * Creates external-content FTS5 tables mirroring rules.rule_text and
+ * tasks.task_description / tasks.worker_report, plus the triggers that keep
+ * them in sync on insert, update and delete. The index only stores tokens,
+ * the text itself stays in the base tables. When the index is created for an
+ * existing database it is rebuilt once from the current rows.
+ */
+void DatabaseManager::setupSearchIndex() {
+    bool rulesIndexed = tableExists("rules_fts");
+    bool tasksIndexed = tableExists("tasks_fts");
+
+    const char* ftsTables = "CREATE VIRTUAL TABLE IF NOT EXISTS rules_fts USING fts5("
+                            "rule_text, content='rules', content_rowid='id');"
+                            "CREATE VIRTUAL TABLE IF NOT EXISTS tasks_fts USING fts5("
+                            "task_description, worker_report, content='tasks', content_rowid='id');";
+
+    const char* ftsTriggers =
+        "CREATE TRIGGER IF NOT EXISTS rules_fts_ai AFTER INSERT ON rules BEGIN "
+        "INSERT INTO rules_fts(rowid, rule_text) VALUES (new.id, new.rule_text); END;"
+        "CREATE TRIGGER IF NOT EXISTS rules_fts_ad AFTER DELETE ON rules BEGIN "
+        "INSERT INTO rules_fts(rules_fts, rowid, rule_text) VALUES ('delete', old.id, old.rule_text); END;"
+        "CREATE TRIGGER IF NOT EXISTS rules_fts_au AFTER UPDATE OF rule_text ON rules BEGIN "
+        "INSERT INTO rules_fts(rules_fts, rowid, rule_text) VALUES ('delete', old.id, old.rule_text); "
+        "INSERT INTO rules_fts(rowid, rule_text) VALUES (new.id, new.rule_text); END;"
+        "CREATE TRIGGER IF NOT EXISTS tasks_fts_ai AFTER INSERT ON tasks BEGIN "
+        "INSERT INTO tasks_fts(rowid, task_description, worker_report) "
+        "VALUES (new.id, new.task_description, new.worker_report); END;"
+        "CREATE TRIGGER IF NOT EXISTS tasks_fts_ad AFTER DELETE ON tasks BEGIN "
+        "INSERT INTO tasks_fts(tasks_fts, rowid, task_description, worker_report) "
+        "VALUES ('delete', old.id, old.task_description, old.worker_report); END;"
+        "CREATE TRIGGER IF NOT EXISTS tasks_fts_au AFTER UPDATE OF task_description, worker_report ON tasks BEGIN "
+        "INSERT INTO tasks_fts(tasks_fts, rowid, task_description, worker_report) "
+        "VALUES ('delete', old.id, old.task_description, old.worker_report); "
+        "INSERT INTO tasks_fts(rowid, task_description, worker_report) "
+        "VALUES (new.id, new.task_description, new.worker_report); END;";
+
+    if (sqlite3_exec(db, ftsTables, 0, 0, nullptr) != SQLITE_OK) {
+        logging::error("Error creating search index: {}", sqlite3_errmsg(db));
+        return;
+    }
+    if (sqlite3_exec(db, ftsTriggers, 0, 0, nullptr) != SQLITE_OK) {
+        logging::error("Error creating search triggers: {}", sqlite3_errmsg(db));
+    }
+
+    // Index rows that were written before the search index existed
+    if (!rulesIndexed &&
+        sqlite3_exec(db, "INSERT INTO rules_fts(rules_fts) VALUES ('rebuild');", 0, 0, nullptr) != SQLITE_OK) {
+        logging::error("Error rebuilding rules search index: {}", sqlite3_errmsg(db));
+    }
+    if (!tasksIndexed &&
+        sqlite3_exec(db, "INSERT INTO tasks_fts(tasks_fts) VALUES ('rebuild');", 0, 0, nullptr) != SQLITE_OK) {
+        logging::error("Error rebuilding tasks search index: {}", sqlite3_errmsg(db));
     }
 }
 
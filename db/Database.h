@@ -2,7 +2,11 @@
 #define DATABASE_H
 
 #include <sqlite3.h>
+#include <cstdint>
+#include <functional>
+#include <memory>
 #include <string>
+#include "SlowQueryLog.h"
 
 /**
  * @class DatabaseManager
@@ -14,14 +18,39 @@
 class DatabaseManager {
 private:
     sqlite3* db; ///< Pointer to the SQLite database connection
+    std::string dbName; ///< File name the connection was opened with
+    std::unique_ptr<SlowQueryLog> slowQueryLog; ///< Statement tracer, if enabled
+
+    /**
+     * @brief Checks whether a table exists in the database schema.
+     *
+     * @param name The table name.
+     * @return True if the table exists.
+     */
+    bool tableExists(const std::string& name);
+
+    /**
+     * @brief Checks whether a table has a column.
+     *
+     * @param table The table name.
+     * @param column The column name.
+     * @return True if the column exists.
+     */
+    bool columnExists(const std::string& table, const std::string& column);
+
+    /**
+     * @brief Creates the FTS5 search tables and the triggers keeping them in sync.
+     */
+    void setupSearchIndex();
 
 public:
     /**
      * @brief Constructor that opens the SQLite database.
      * 
      * @param dbName The name of the SQLite database file.
+     * @param openFlags sqlite3_open_v2 flags; leave out SQLITE_OPEN_CREATE to require an existing file.
      */
-    DatabaseManager(const std::string& dbName);
+    DatabaseManager(const std::string& dbName, int openFlags = SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE);
 
     /**
      * @brief Destructor that closes the SQLite database.
@@ -38,10 +67,45 @@ public:
     /**
      * @brief Sets up the required tables in the database.
      * 
-     * This function creates the 'users', 'tasks', and 'rules' tables if they do not already exist.
-     * It ensures the necessary schema is in place for the application to function properly.
+     * This function creates the 'users', 'tasks', 'rules' and 'rule_feedback' tables if they do not already exist,
+     * together with the 'rules_fts' and 'tasks_fts' full-text search tables. It ensures the necessary schema is in place for the application to function properly.
      */
     void setupTables();
+
+    /**
+     * @brief Logs every statement slower than a threshold to a rotating file.
+     *
+     * Registers sqlite3_trace_v2 with SQLITE_TRACE_PROFILE on the connection. Each
+     * entry holds the expanded SQL, duration, rows stepped and EXPLAIN QUERY PLAN.
+     *
+     * @param logPath Log file; rotated copies are logPath.1 ... logPath.<maxFiles>.
+     * @param thresholdMs Minimum duration, in milliseconds, of a logged statement.
+     * @param maxBytes Size at which the log is rotated.
+     * @param maxFiles Number of rotated files kept.
+     */
+    void enableSlowQueryLog(const std::string& logPath, double thresholdMs,
+                            std::uintmax_t maxBytes = 10 * 1024 * 1024, int maxFiles = 5);
+
+    /**
+     * @brief Attaches the slow-query log, if enabled, to another connection to the same database.
+     *
+     * Used for the read-only connections of a ConnectionPool. The connection
+     * must be closed before this DatabaseManager is destroyed.
+     *
+     * @param connection Connection to trace.
+     */
+    void traceConnection(sqlite3* connection);
+
+    /**
+     * @brief Sets up the slow-query log's plan connection, if the log is enabled, like the read connections.
+     *
+     * Plans of statements on attached databases, or calling functions the
+     * application registers, are only available once the plan connection
+     * has them too.
+     *
+     * @param setup Called with the plan connection; it must not trace it.
+     */
+    void preparePlanConnection(const std::function<void(sqlite3*)>& setup);
 };
 
 #endif // DATABASE_H
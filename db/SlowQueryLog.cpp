@@ -0,0 +1,202 @@
+/**
+ * @file SlowQueryLog.cpp
+ * @brief Implementation of the SlowQueryLog class for SQL statement tracing.
+ *
+ * Row counts are collected per statement from SQLITE_TRACE_ROW events and
+ * reported when SQLITE_TRACE_PROFILE signals that the statement finished.
+ * Only statements over the threshold are copied out and queued, so the cost
+ * for fast statements is one hash-map update per row on the connection's
+ * own map.
+ *
+ */
+
+#include "SlowQueryLog.h"
+#include "../logging/logging.h"
+#include <cstdio>
+#include <filesystem>
+#include <sstream>
+
+namespace {
+
+const size_t kMaxQueued = 1000;  ///< Slow statements waiting for the log's thread
+
+}  // namespace
+
+SlowQueryLog::SlowQueryLog(const std::string& dbName, const std::string& logPath, double thresholdMs,
+                           std::uintmax_t maxBytes, int maxFiles)
+    : logPath(logPath),
+      thresholdNs(static_cast<sqlite3_int64>(thresholdMs * 1e6)),
+      maxBytes(maxBytes),
+      maxFiles(maxFiles) {
+    log.open(logPath, std::ios::app);
+    if (!log) {
+        logging::error("Failed to open slow query log: {}", logPath);
+    }
+
+    if (sqlite3_open_v2(dbName.c_str(), &planDb, SQLITE_OPEN_READONLY, nullptr) != SQLITE_OK) {
+        logging::error("Failed to open DB for query plans: {}", sqlite3_errmsg(planDb));
+        sqlite3_close(planDb);
+        planDb = nullptr;
+    }
+    writer = std::thread([this]() { writeLoop(); });
+}
+
+SlowQueryLog::~SlowQueryLog() {
+    {
+        std::lock_guard<std::mutex> lock(queueMutex);
+        stopping = true;
+    }
+    queueChanged.notify_all();
+    writer.join();
+    if (planDb) {
+        sqlite3_close(planDb);
+    }
+}
+
+void SlowQueryLog::attach(sqlite3* db) {
+    std::lock_guard<std::mutex> lock(tracedMutex);
+    std::unique_ptr<Traced>& state = traced[db];
+    sqlite3_trace_v2(db, 0, nullptr, nullptr);  // Before the old state goes, if the connection was traced
+    state.reset(new Traced{this, {}});
+    sqlite3_trace_v2(db, SQLITE_TRACE_PROFILE | SQLITE_TRACE_ROW, &SlowQueryLog::traceCallback, state.get());
+}
+
+void SlowQueryLog::detach(sqlite3* db) {
+    std::lock_guard<std::mutex> lock(tracedMutex);
+    sqlite3_trace_v2(db, 0, nullptr, nullptr);
+    traced.erase(db);
+}
+
+void SlowQueryLog::preparePlanConnection(const std::function<void(sqlite3*)>& setup) {
+    std::lock_guard<std::mutex> lock(planMutex);
+    if (planDb) {
+        setup(planDb);
+    }
+}
+
+int SlowQueryLog::traceCallback(unsigned mask, void* context, void* p, void* x) {
+    Traced* state = static_cast<Traced*>(context);
+    sqlite3_stmt* stmt = static_cast<sqlite3_stmt*>(p);
+
+    if (mask == SQLITE_TRACE_ROW) {
+        state->rowCounts[stmt]++;
+    } else if (mask == SQLITE_TRACE_PROFILE) {
+        state->log->statementFinished(*state, stmt, *static_cast<sqlite3_int64*>(x));
+    }
+    return 0;
+}
+
+void SlowQueryLog::statementFinished(Traced& state, sqlite3_stmt* stmt, sqlite3_int64 nanoseconds) {
+    long long rows = 0;
+    auto it = state.rowCounts.find(stmt);
+    if (it != state.rowCounts.end()) {
+        rows = it->second;
+        state.rowCounts.erase(it);
+    }
+
+    if (nanoseconds < thresholdNs) {
+        return;
+    }
+
+    char* expanded = sqlite3_expanded_sql(stmt);
+    const char* sql = sqlite3_sql(stmt);
+    Entry entry{std::time(nullptr), nanoseconds, rows,
+                sqlite3_stmt_status(stmt, SQLITE_STMTSTATUS_FULLSCAN_STEP, 0),
+                expanded ? expanded : (sql ? sql : ""), sql ? sql : ""};
+    sqlite3_free(expanded);
+    {
+        std::lock_guard<std::mutex> lock(queueMutex);
+        if (queue.size() >= kMaxQueued) {
+            ++dropped;
+            return;
+        }
+        queue.push_back(std::move(entry));
+    }
+    queueChanged.notify_one();
+}
+
+void SlowQueryLog::writeLoop() {
+    std::unique_lock<std::mutex> lock(queueMutex);
+    while (true) {
+        queueChanged.wait(lock, [this] { return stopping || !queue.empty(); });
+        if (queue.empty()) {
+            return;  // Stopping, and everything queued is written
+        }
+        Entry entry = std::move(queue.front());
+        queue.pop_front();
+        long long lost = dropped;
+        dropped = 0;
+        lock.unlock();
+        if (lost > 0) {
+            log << "(" << lost << " slow statements not logged: the queue was full)\n";
+        }
+        write(entry);
+        lock.lock();
+    }
+}
+
+void SlowQueryLog::write(const Entry& entry) {
+    if (!log) {
+        return;
+    }
+    char timestamp[100];
+    std::tm local = {};
+    localtime_r(&entry.time, &local);
+    std::strftime(timestamp, sizeof(timestamp), "%Y-%m-%d %H:%M:%S", &local);
+
+    log << "[" << timestamp << "] " << entry.nanoseconds / 1e6 << " ms, " << entry.rows << " rows, "
+        << entry.fullScanSteps << " full-scan steps\n"
+        << "SQL: " << entry.expandedSql << "\n"
+        << "PLAN:\n" << queryPlan(entry.sql) << "\n";
+    log.flush();
+
+    rotateIfNeeded();
+}
+
+std::string SlowQueryLog::queryPlan(const std::string& sql) {
+    std::lock_guard<std::mutex> lock(planMutex);
+    if (!planDb || sql.empty()) {
+        return "  (unavailable)\n";
+    }
+
+    std::string explain = std::string("EXPLAIN QUERY PLAN ") + sql;
+    sqlite3_stmt* stmt = nullptr;
+    if (sqlite3_prepare_v2(planDb, explain.c_str(), -1, &stmt, nullptr) != SQLITE_OK) {
+        return std::string("  (unavailable: ") + sqlite3_errmsg(planDb) + ")\n";
+    }
+
+    // Columns are id, parent, notused, detail; indent each step under its parent
+    std::ostringstream plan;
+    std::unordered_map<int, int> depth;
+    while (sqlite3_step(stmt) == SQLITE_ROW) {
+        int id = sqlite3_column_int(stmt, 0);
+        int parent = sqlite3_column_int(stmt, 1);
+        const unsigned char* detail = sqlite3_column_text(stmt, 3);
+        depth[id] = depth.count(parent) ? depth[parent] + 1 : 1;
+        plan << std::string(depth[id] * 2, ' ') << (detail ? reinterpret_cast<const char*>(detail) : "") << "\n";
+    }
+    sqlite3_finalize(stmt);
+
+    std::string result = plan.str();
+    return result.empty() ? "  (no plan)\n" : result;
+}
+
+void SlowQueryLog::rotateIfNeeded() {
+    std::error_code ec;
+    if (std::filesystem::file_size(logPath, ec) < maxBytes || ec) {
+        return;
+    }
+
+    log.close();
+    for (int i = maxFiles - 1; i >= 1; --i) {
+        std::string from = logPath + "." + std::to_string(i);
+        std::string to = logPath + "." + std::to_string(i + 1);
+        std::filesystem::rename(from, to, ec);
+    }
+    if (maxFiles > 0) {
+        std::filesystem::rename(logPath, logPath + ".1", ec);
+    } else {
+        std::filesystem::remove(logPath, ec);
+    }
+    log.open(logPath, std::ios::app);
+}
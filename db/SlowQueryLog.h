@@ -0,0 +1,113 @@
+#ifndef SLOWQUERYLOG_H
+#define SLOWQUERYLOG_H
+
+#include <sqlite3.h>
+#include <condition_variable>
+#include <cstdint>
+#include <ctime>
+#include <deque>
+#include <fstream>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+
+/**
+ * @class SlowQueryLog
+ * @brief Writes SQL statements slower than a threshold to a rotating log file.
+ *
+ * Attached to a connection with sqlite3_trace_v2 (SQLITE_TRACE_PROFILE and
+ * SQLITE_TRACE_ROW). For every statement over the threshold it logs the
+ * expanded SQL (bound parameters filled in), the duration, the number of rows
+ * stepped, the full-scan step count and the EXPLAIN QUERY PLAN output.
+ *
+ * Rows are counted in state kept per traced connection, which SQLite only
+ * ever calls back on one thread at a time, so tracing takes no shared lock.
+ * A slow statement is queued; the plan and the file write happen on the
+ * log's own thread, on a separate read-only connection so no traced
+ * connection is re-entered from inside its own callback. When the queue is
+ * full, entries are dropped and counted rather than blocking the caller.
+ */
+class SlowQueryLog {
+public:
+    /**
+     * @brief Opens the log and the read-only connection used for query plans, and starts the log's thread.
+     *
+     * @param dbName Database file being traced.
+     * @param logPath Log file; rotated files are named logPath.1, logPath.2, ...
+     * @param thresholdMs Statements taking at least this long are logged.
+     * @param maxBytes Size at which the log is rotated.
+     * @param maxFiles Number of rotated files kept.
+     */
+    SlowQueryLog(const std::string& dbName, const std::string& logPath, double thresholdMs,
+                 std::uintmax_t maxBytes = 10 * 1024 * 1024, int maxFiles = 5);
+
+    /**
+     * @brief Writes the queued entries, then closes the log and the plan connection.
+     */
+    ~SlowQueryLog();
+
+    /**
+     * @brief Starts tracing a connection.
+     */
+    void attach(sqlite3* db);
+
+    /**
+     * @brief Stops tracing a connection.
+     */
+    void detach(sqlite3* db);
+
+    /**
+     * @brief Runs @p setup on the plan connection, e.g. to attach the databases and
+     *        register the functions the traced connections use.
+     */
+    void preparePlanConnection(const std::function<void(sqlite3*)>& setup);
+
+private:
+    /// @brief Per-connection trace state; only touched from that connection's callbacks.
+    struct Traced {
+        SlowQueryLog* log;
+        std::unordered_map<sqlite3_stmt*, long long> rowCounts;
+    };
+
+    /// @brief A slow statement waiting to be written.
+    struct Entry {
+        std::time_t time;
+        sqlite3_int64 nanoseconds;
+        long long rows;
+        int fullScanSteps;
+        std::string expandedSql;
+        std::string sql;
+    };
+
+    static int traceCallback(unsigned mask, void* context, void* p, void* x);
+
+    void statementFinished(Traced& traced, sqlite3_stmt* stmt, sqlite3_int64 nanoseconds);
+    void writeLoop();
+    void write(const Entry& entry);
+    std::string queryPlan(const std::string& sql);
+    void rotateIfNeeded();
+
+    std::string logPath;
+    sqlite3_int64 thresholdNs;
+    std::uintmax_t maxBytes;
+    int maxFiles;
+
+    std::mutex tracedMutex;                               ///< Guards traced (attach and detach only)
+    std::unordered_map<sqlite3*, std::unique_ptr<Traced>> traced;
+
+    std::mutex queueMutex;                                ///< Guards the four members below
+    std::condition_variable queueChanged;
+    std::deque<Entry> queue;
+    long long dropped = 0;
+    bool stopping = false;
+
+    std::mutex planMutex;                                 ///< Guards planDb
+    sqlite3* planDb = nullptr;
+    std::ofstream log;                                    ///< Written only by writer
+    std::thread writer;
+};
+
+#endif // SLOWQUERYLOG_H
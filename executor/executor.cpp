@@ -0,0 +1,295 @@
+/**
+ * @file executor.cpp
+ * @brief Work-stealing pool with per-thread, per-priority deques.
+ *
+ * Each deque has its own small lock, so threads only contend when one steals
+ * from another. A shared pending count with a condition variable lets idle
+ * threads sleep; it is updated under the sleep lock by submitters so a wakeup
+ * can never be missed.
+ *
+ * Offloaded tasks go to one FIFO queue served by the blocking threads. The
+ * pool threads only exit once no offloaded task is queued or running, since
+ * an offloaded task usually ends by submitting its continuation.
+ *
+ */
+
+#include "executor.h"
+#include "../logging/logging.h"
+#include "../trace/trace.h"
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace executor {
+
+namespace {
+
+const int kPriorities = 3;
+
+struct WorkerQueue {
+    std::mutex mutex;
+    std::deque<std::function<void()>> tasks[kPriorities];
+};
+
+struct Pool {
+    std::mutex lifecycle;                          ///< Serializes start() and shutdown()
+    std::vector<std::unique_ptr<WorkerQueue>> queues;
+    std::vector<std::thread> threads;
+    std::atomic<int> size{0};
+    std::atomic<bool> accepting{false};
+    std::atomic<unsigned> nextQueue{0};
+
+    std::mutex sleepMutex;                         ///< Guards pending, offloaded and stopping
+    std::condition_variable wake;
+    long long pending = 0;
+    long long offloaded = 0;                       ///< Offloaded tasks queued or running
+    bool stopping = false;
+
+    std::mutex blockingMutex;                      ///< Guards blockingTasks and blockingStopping
+    std::condition_variable blockingWake;
+    std::deque<std::function<void()>> blockingTasks;
+    std::vector<std::thread> blockingThreads;
+    bool blockingStopping = false;
+};
+
+Pool& pool() {
+    static Pool* instance = new Pool();  // never destroyed; tasks may submit after main
+    return *instance;
+}
+
+thread_local int currentWorker = -1;  ///< Index of the pool thread running this code, or -1
+thread_local bool onBlockingThread = false;
+
+/// @brief Takes the calling thread's newest task at @p priority.
+bool popLocal(Pool& p, int self, int priority, std::function<void()>& task) {
+    WorkerQueue& q = *p.queues[self];
+    std::lock_guard<std::mutex> lock(q.mutex);
+    if (q.tasks[priority].empty()) return false;
+    task = std::move(q.tasks[priority].back());
+    q.tasks[priority].pop_back();
+    return true;
+}
+
+/// @brief Takes the oldest task at @p priority from another thread.
+bool steal(Pool& p, int self, int priority, std::function<void()>& task) {
+    int n = static_cast<int>(p.queues.size());
+    for (int k = 1; k < n; ++k) {
+        WorkerQueue& q = *p.queues[(self + k) % n];
+        std::lock_guard<std::mutex> lock(q.mutex);
+        if (q.tasks[priority].empty()) continue;
+        task = std::move(q.tasks[priority].front());
+        q.tasks[priority].pop_front();
+        return true;
+    }
+    return false;
+}
+
+void run(std::function<void()>& task) {
+    try {
+        task();
+    } catch (const std::exception& e) {
+        logging::error("Background task failed: {}", e.what());
+    } catch (...) {
+        logging::error("Background task failed with an unknown exception");
+    }
+}
+
+bool take(Pool& p, int self, std::function<void()>& task) {
+    for (int priority = 0; priority < kPriorities; ++priority) {
+        if (popLocal(p, self, priority, task) || steal(p, self, priority, task)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void workerLoop(int self) {
+    Pool& p = pool();
+    currentWorker = self;
+    trace::setThreadName("executor-" + std::to_string(self));
+
+    while (true) {
+        std::function<void()> task;
+        if (take(p, self, task)) {
+            {
+                std::lock_guard<std::mutex> lock(p.sleepMutex);
+                --p.pending;
+            }
+            trace::Span span("executor.task", "executor");
+            run(task);
+            continue;
+        }
+
+        std::unique_lock<std::mutex> lock(p.sleepMutex);
+        p.wake.wait(lock, [&] { return p.pending > 0 || (p.stopping && p.offloaded == 0); });
+        if (p.stopping && p.pending == 0 && p.offloaded == 0) {
+            break;
+        }
+    }
+}
+
+void blockingLoop(int self) {
+    Pool& p = pool();
+    onBlockingThread = true;
+    trace::setThreadName("executor-io-" + std::to_string(self));
+
+    while (true) {
+        std::function<void()> task;
+        {
+            std::unique_lock<std::mutex> lock(p.blockingMutex);
+            p.blockingWake.wait(lock, [&] { return !p.blockingTasks.empty() || p.blockingStopping; });
+            if (p.blockingTasks.empty()) {
+                return;
+            }
+            task = std::move(p.blockingTasks.front());
+            p.blockingTasks.pop_front();
+        }
+        {
+            trace::Span span("executor.offload", "executor");
+            run(task);
+        }
+        {
+            std::lock_guard<std::mutex> lock(p.sleepMutex);
+            --p.offloaded;
+        }
+        p.wake.notify_all();
+    }
+}
+
+}  // namespace
+
+void start(int threads, int blockingThreads) {
+    Pool& p = pool();
+    std::lock_guard<std::mutex> lock(p.lifecycle);
+    if (p.accepting.load() || !p.threads.empty()) {
+        return;
+    }
+
+    if (threads <= 0) {
+        threads = static_cast<int>(std::max(1u, std::thread::hardware_concurrency()));
+    }
+    if (blockingThreads <= 0) {
+        blockingThreads = 4;
+    }
+    p.queues.clear();
+    for (int i = 0; i < threads; ++i) {
+        p.queues.push_back(std::make_unique<WorkerQueue>());
+    }
+    {
+        std::lock_guard<std::mutex> sleepLock(p.sleepMutex);
+        p.pending = 0;
+        p.offloaded = 0;
+        p.stopping = false;
+    }
+    {
+        std::lock_guard<std::mutex> blockingLock(p.blockingMutex);
+        p.blockingStopping = false;
+    }
+    p.size.store(threads);
+    for (int i = 0; i < threads; ++i) {
+        p.threads.emplace_back(workerLoop, i);
+    }
+    for (int i = 0; i < blockingThreads; ++i) {
+        p.blockingThreads.emplace_back(blockingLoop, i);
+    }
+    p.accepting.store(true, std::memory_order_release);
+}
+
+bool submit(std::function<void()> task, Priority priority) {
+    Pool& p = pool();
+    if (currentWorker < 0 && !onBlockingThread && !p.accepting.load(std::memory_order_acquire)) {
+        if (p.size.load() == 0) {
+            start();  // first use; a pool that was shut down stays down
+        }
+        if (!p.accepting.load(std::memory_order_acquire)) {
+            return false;
+        }
+    }
+
+    int n = p.size.load(std::memory_order_relaxed);
+    int target = currentWorker >= 0 ? currentWorker : static_cast<int>(p.nextQueue++ % n);
+    {
+        WorkerQueue& q = *p.queues[target];
+        std::lock_guard<std::mutex> lock(q.mutex);
+        q.tasks[static_cast<int>(priority)].push_back(std::move(task));
+    }
+    {
+        std::lock_guard<std::mutex> lock(p.sleepMutex);
+        ++p.pending;
+    }
+    p.wake.notify_one();
+    return true;
+}
+
+bool offload(std::function<void()> task) {
+    Pool& p = pool();
+    if (currentWorker < 0 && !onBlockingThread && !p.accepting.load(std::memory_order_acquire)) {
+        if (p.size.load() == 0) {
+            start();
+        }
+        if (!p.accepting.load(std::memory_order_acquire)) {
+            return false;
+        }
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(p.sleepMutex);
+        ++p.offloaded;
+    }
+    {
+        std::lock_guard<std::mutex> lock(p.blockingMutex);
+        p.blockingTasks.push_back(std::move(task));
+    }
+    p.blockingWake.notify_one();
+    return true;
+}
+
+void shutdown() {
+    Pool& p = pool();
+    std::lock_guard<std::mutex> lock(p.lifecycle);
+    if (p.threads.empty()) {
+        return;
+    }
+
+    p.accepting.store(false, std::memory_order_release);
+    {
+        std::lock_guard<std::mutex> sleepLock(p.sleepMutex);
+        p.stopping = true;
+    }
+    p.wake.notify_all();
+    for (std::thread& thread : p.threads) {
+        thread.join();
+    }
+
+    // Nothing is queued or running on the blocking threads any more
+    {
+        std::lock_guard<std::mutex> blockingLock(p.blockingMutex);
+        p.blockingStopping = true;
+    }
+    p.blockingWake.notify_all();
+    for (std::thread& thread : p.blockingThreads) {
+        thread.join();
+    }
+    p.blockingThreads.clear();
+    p.threads.clear();
+}
+
+int threadCount() {
+    Pool& p = pool();
+    std::lock_guard<std::mutex> lock(p.lifecycle);
+    return static_cast<int>(p.threads.size());
+}
+
+int blockingThreadCount() {
+    Pool& p = pool();
+    std::lock_guard<std::mutex> lock(p.lifecycle);
+    return static_cast<int>(p.blockingThreads.size());
+}
+
+}  // namespace executor
@@ -0,0 +1,95 @@
+#ifndef EXECUTOR_H_
+#define EXECUTOR_H_
+
+#include <functional>
+#include <future>
+#include <memory>
+#include <type_traits>
+
+/**
+ * @namespace executor
+ * @brief Process-wide work-stealing thread pool for background work.
+ *
+ * Every pool thread owns a deque per priority. A thread takes its own newest
+ * task first (LIFO, cache-warm) and, when it has none at that priority,
+ * steals the oldest task from another thread before looking at a lower
+ * priority. Tasks submitted from outside the pool are spread over the deques
+ * round-robin; tasks submitted from a pool thread go to that thread's deque.
+ *
+ * Dataset generation and other CPU-bound background jobs run here, so the
+ * number of pool threads is the one place that bounds the CPU used by
+ * background work.
+ *
+ * Work that blocks (SQLite calls, file copies, task report uploads) is
+ * instead handed to offload(), which runs it on a separate set of blocking
+ * threads so the pool threads stay free for continuations (see
+ * executor/task.h).
+ */
+namespace executor {
+
+enum class Priority { High, Normal, Low };
+
+/**
+ * @brief Starts the pool; does nothing if it is already running.
+ *
+ * submit() starts the pool on first use with one thread per core, so calling
+ * this is only needed to choose the size.
+ *
+ * @param threads Number of pool threads; 0 means one per hardware thread.
+ * @param blockingThreads Number of threads for offload(); 0 means 4.
+ */
+void start(int threads = 0, int blockingThreads = 0);
+
+/**
+ * @brief Queues a task.
+ *
+ * @return False if the pool is shutting down and the task was not queued.
+ */
+bool submit(std::function<void()> task, Priority priority = Priority::Normal);
+
+/**
+ * @brief Queues a task that blocks on I/O on the blocking threads (FIFO).
+ *
+ * Tasks may submit() follow-up work; shutdown() waits for offloaded tasks
+ * and everything they submit.
+ *
+ * @return False if the pool is shutting down and the task was not queued.
+ */
+bool offload(std::function<void()> task);
+
+/**
+ * @brief Queues a callable and returns a future for its result.
+ *
+ * If the pool is shutting down the future reports std::future_error
+ * (broken_promise) instead of a result.
+ */
+template <typename F>
+std::future<std::invoke_result_t<F>> async(F&& f, Priority priority = Priority::Normal) {
+    using Result = std::invoke_result_t<F>;
+    auto task = std::make_shared<std::packaged_task<Result()>>(std::forward<F>(f));
+    std::future<Result> future = task->get_future();
+    submit([task]() { (*task)(); }, priority);
+    return future;
+}
+
+/**
+ * @brief Stops accepting outside work, runs every queued task and joins the threads.
+ *
+ * Tasks running on the pool or the blocking threads may still submit
+ * follow-up work while it drains.
+ */
+void shutdown();
+
+/**
+ * @brief Number of pool threads (0 before the pool is started).
+ */
+int threadCount();
+
+/**
+ * @brief Number of blocking threads used by offload() (0 before the pool is started).
+ */
+int blockingThreadCount();
+
+}  // namespace executor
+
+#endif  // EXECUTOR_H_
@@ -0,0 +1,305 @@
+#ifndef EXECUTOR_TASK_H_
+#define EXECUTOR_TASK_H_
+
+#include "executor.h"
+#include "../logging/logging.h"
+#include <coroutine>
+#include <exception>
+#include <functional>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <type_traits>
+#include <utility>
+
+namespace executor {
+
+template <typename T>
+class Task;
+
+/**
+ * @class Task
+ * @brief The eventual result of an asynchronous operation, with continuations.
+ *
+ * then() attaches the next step; it runs on the pool once the value is ready,
+ * so a multi-step flow (save the media, then record the report, then reply)
+ * reads top to bottom without any thread waiting between the steps. A step
+ * may return a plain value or another Task, which is chained rather than
+ * nested:
+ * @code
+ * service.ingestMedia(taskId, workerId, data)
+ *     .then([=](core::Result saved) {
+ *         return saved.ok ? service.recordReport(taskId, workerId, report) : executor::ready(saved);
+ *     })
+ *     .then([=](core::Result recorded) { reply(recorded); });
+ * @endcode
+ *
+ * A coroutine that returns a Task can co_await other Tasks instead; it runs
+ * on the caller's thread until its first co_await and resumes on the pool:
+ * @code
+ * executor::Task<core::Result> submit(AsyncService& service, int taskId, int workerId,
+ *                                     std::string report, std::string media) {
+ *     core::Result saved = co_await service.ingestMedia(taskId, workerId, media);
+ *     if (!saved.ok) co_return saved;
+ *     co_return co_await service.recordReport(taskId, workerId, report);
+ * }
+ * @endcode
+ * Take coroutine parameters by value: references may dangle after the first
+ * co_await.
+ *
+ * An exception thrown by a step skips the remaining steps; it is rethrown by
+ * get() or co_await, or logged by the pool when it reaches a step that
+ * returns void. A Task has one continuation: call then(), get() or co_await
+ * once.
+ */
+template <typename T>
+class Task {
+    struct State;
+
+public:
+    using Value = T;
+
+    /// @brief Lets a function returning Task<T> be a coroutine; co_return completes the task.
+    struct promise_type {
+        Task<T> task;
+
+        Task<T> get_return_object() { return task; }
+        std::suspend_never initial_suspend() noexcept { return {}; }
+        std::suspend_never final_suspend() noexcept { return {}; }
+        void return_value(T value) { task.complete(std::move(value)); }
+        void unhandled_exception() { task.fail(std::current_exception()); }
+    };
+
+    /// @brief Suspends a coroutine until the task is ready, then resumes it on the pool.
+    class Awaiter {
+    public:
+        Awaiter(std::shared_ptr<State> state, Priority priority) : state(std::move(state)), priority(priority) {}
+
+        bool await_ready() const {
+            std::lock_guard<std::mutex> lock(state->mutex);
+            return state->done;
+        }
+
+        void await_suspend(std::coroutine_handle<> caller) const {
+            Task(state).attach([caller]() { caller.resume(); }, priority);
+        }
+
+        T await_resume() const {
+            if (state->error) {
+                std::rethrow_exception(state->error);
+            }
+            return std::move(*state->value);
+        }
+
+    private:
+        std::shared_ptr<State> state;
+        Priority priority;
+    };
+
+    /// @brief A task that completes when complete() or fail() is called.
+    Task() : state(std::make_shared<State>()) {}
+
+    /// @brief True once a value or an exception is set.
+    bool ready() const {
+        std::lock_guard<std::mutex> lock(state->mutex);
+        return state->done;
+    }
+
+    /// @brief Sets the value and schedules the continuation, if any.
+    void complete(T value) const {
+        std::function<void()> next;
+        Priority priority;
+        {
+            std::lock_guard<std::mutex> lock(state->mutex);
+            state->value.emplace(std::move(value));
+            state->done = true;
+            next = std::move(state->next);
+            priority = state->priority;
+        }
+        state->finished.notify_all();
+        schedule(std::move(next), priority);
+    }
+
+    /// @brief Sets an exception and schedules the continuation, if any.
+    void fail(std::exception_ptr error) const {
+        std::function<void()> next;
+        Priority priority;
+        {
+            std::lock_guard<std::mutex> lock(state->mutex);
+            state->error = error;
+            state->done = true;
+            next = std::move(state->next);
+            priority = state->priority;
+        }
+        state->finished.notify_all();
+        schedule(std::move(next), priority);
+    }
+
+    /**
+     * @brief Runs @p f with the value on the pool once it is ready.
+     *
+     * @return Task of f's result (flattened if f returns a Task), or void if f returns void.
+     */
+    template <typename F>
+    auto then(F f, Priority priority = Priority::Normal) const {
+        using R = std::invoke_result_t<F, T>;
+        std::shared_ptr<State> source = state;
+        if constexpr (std::is_void_v<R>) {
+            attach([source, f]() mutable {
+                if (source->error) {
+                    std::rethrow_exception(source->error);  // Logged by the pool
+                }
+                f(std::move(*source->value));
+            }, priority);
+        } else {
+            using U = typename Unwrap<R>::type;
+            Task<U> next;
+            attach([source, f, next]() mutable {
+                if (source->error) {
+                    next.fail(source->error);
+                    return;
+                }
+                try {
+                    if constexpr (Unwrap<R>::isTask) {
+                        f(std::move(*source->value)).forward(next);
+                    } else {
+                        next.complete(f(std::move(*source->value)));
+                    }
+                } catch (...) {
+                    next.fail(std::current_exception());
+                }
+            }, priority);
+            return next;
+        }
+    }
+
+    /// @brief co_await resumes at @p priority instead of Normal.
+    Awaiter resumeAt(Priority priority) const { return Awaiter(state, priority); }
+
+    Awaiter operator co_await() const { return Awaiter(state, Priority::Normal); }
+
+    /// @brief Blocks until the value is ready and returns it. Not for use on pool threads.
+    T get() const {
+        std::unique_lock<std::mutex> lock(state->mutex);
+        state->finished.wait(lock, [&] { return state->done; });
+        if (state->error) {
+            std::rethrow_exception(state->error);
+        }
+        return std::move(*state->value);
+    }
+
+private:
+    template <typename>
+    friend class Task;
+
+    explicit Task(std::shared_ptr<State> state) : state(std::move(state)) {}
+
+    struct State {
+        std::mutex mutex;
+        std::condition_variable finished;
+        bool done = false;
+        std::optional<T> value;
+        std::exception_ptr error;
+        std::function<void()> next;
+        Priority priority = Priority::Normal;
+    };
+
+    template <typename R>
+    struct Unwrap {
+        using type = R;
+        static constexpr bool isTask = false;
+    };
+    template <typename U>
+    struct Unwrap<Task<U>> {
+        using type = U;
+        static constexpr bool isTask = true;
+    };
+
+    void attach(std::function<void()> next, Priority priority) const {
+        {
+            std::lock_guard<std::mutex> lock(state->mutex);
+            state->priority = priority;
+            if (!state->done) {
+                state->next = std::move(next);
+                return;
+            }
+        }
+        schedule(std::move(next), priority);
+    }
+
+    static void schedule(std::function<void()> next, Priority priority) {
+        if (next && !submit(next, priority)) {
+            next();  // The pool is gone; finish the chain on this thread
+        }
+    }
+
+    /// @brief Completes @p target with this task's outcome.
+    void forward(Task<T> target) const {
+        std::shared_ptr<State> source = state;
+        attach([source, target]() {
+            if (source->error) {
+                target.fail(source->error);
+            } else {
+                target.complete(std::move(*source->value));
+            }
+        }, Priority::Normal);
+    }
+
+    std::shared_ptr<State> state;
+};
+
+/**
+ * @brief Return type of a coroutine that nobody waits for, such as one that ends by replying to a client.
+ *
+ * Like a then() step that returns void, an exception it does not catch is logged.
+ */
+struct Detached {
+    struct promise_type {
+        Detached get_return_object() { return {}; }
+        std::suspend_never initial_suspend() noexcept { return {}; }
+        std::suspend_never final_suspend() noexcept { return {}; }
+        void return_void() {}
+        void unhandled_exception() {
+            try {
+                throw;
+            } catch (const std::exception& e) {
+                logging::error("Background task failed: {}", e.what());
+            } catch (...) {
+                logging::error("Background task failed with an unknown exception");
+            }
+        }
+    };
+};
+
+/// @brief A task that is already complete.
+template <typename T>
+Task<T> ready(T value) {
+    Task<T> task;
+    task.complete(std::move(value));
+    return task;
+}
+
+/**
+ * @brief Runs blocking work on the blocking threads (offload()) and returns its result as a Task.
+ */
+template <typename F>
+Task<std::invoke_result_t<F>> blocking(F f) {
+    using R = std::invoke_result_t<F>;
+    Task<R> task;
+    auto run = [task, f]() mutable {
+        try {
+            task.complete(f());
+        } catch (...) {
+            task.fail(std::current_exception());
+        }
+    };
+    if (!offload(run)) {
+        run();  // The pool is shutting down; do the work on this thread
+    }
+    return task;
+}
+
+}  // namespace executor
+
+#endif  // EXECUTOR_TASK_H_
@@ -0,0 +1,71 @@
+#ifndef EXPORTER_H_
+#define EXPORTER_H_
+
+#include <sqlite3.h>
+#include <string>
+
+/**
+ * @namespace exporter
+ * @brief Streams tasks, rules and rule feedback out of the database as NDJSON or CSV.
+ *
+ * Rows go straight from the SQLite cursor into a fixed-size output buffer:
+ * nothing is collected per row, so memory stays flat whatever the table size.
+ * Filters map onto indexes (tasks by worker or status, feedback by rule, and
+ * every table by id), and rows always come out in id order, so a nightly pull
+ * can resume from the last id it saw with afterId.
+ */
+namespace exporter {
+
+/// @brief What to export.
+enum class Table { Tasks, Rules, Feedback };
+
+/// @brief Output encoding: one JSON object per line, or CSV with a header row.
+enum class Format { Ndjson, Csv };
+
+/**
+ * @struct Options
+ * @brief Table, format and filters of one export.
+ */
+struct Options {
+    Table table = Table::Tasks;
+    Format format = Format::Ndjson;
+    bool gzip = false;            ///< Compress the output with gzip
+    int gzipLevel = 1;            ///< 1 (fastest) to 9 (smallest)
+    int workerId = -1;            ///< Tasks of this worker only; -1 for all
+    std::string status;           ///< Tasks with this status only; empty for all
+    int ruleId = -1;              ///< Feedback on this rule only; -1 for all
+    sqlite3_int64 afterId = 0;    ///< Only rows with a greater id
+};
+
+/**
+ * @struct Summary
+ * @brief Outcome of an export.
+ */
+struct Summary {
+    bool ok = true;               ///< True if every row was written
+    std::string error;            ///< Error message when ok is false
+    long long rows = 0;           ///< Rows written
+    sqlite3_int64 lastId = 0;     ///< Id of the last row written; the next afterId
+};
+
+/// @brief Parses "tasks", "rules" or "feedback".
+bool parseTable(const std::string& name, Table& table);
+
+/// @brief Parses "ndjson" or "csv".
+bool parseFormat(const std::string& name, Format& format);
+
+/**
+ * @brief Exports the rows selected by @p options.
+ *
+ * The export reads from a single snapshot of @p db, so concurrent writers
+ * neither block it nor show up half-way through.
+ *
+ * @param db Connection to read from (a pool reader).
+ * @param options Table, format and filters.
+ * @param path Output file, or "-" for standard output.
+ */
+Summary run(sqlite3* db, const Options& options, const std::string& path);
+
+}  // namespace exporter
+
+#endif  // EXPORTER_H_
@@ -0,0 +1,121 @@
+/**
+ * @file ehs_federate.cpp
+ * @brief Command-line front end of the federated reports.
+ *
+ * Compile from the repository root:
+ * @code
+ * g++ -std=c++20 -O2 federation/ehs_federate.cpp federation/federation.cpp executor/executor.cpp logging/logging.cpp json/json.cpp metrics/metrics.cpp trace/trace.cpp -lsqlite3 -pthread -o ehs_federate
+ * @endcode
+ *
+ * Usage:
+ * @code
+ * ./ehs_federate --report violations|feedback [--jobs N] [--max-mbps X] [--live]
+ *                [--list FILE] PATTERN...
+ * @endcode
+ *
+ * Each PATTERN is a file name or a glob (such as "/nas/archive/plant-*.db",
+ * quoted so the shell leaves it alone); --list FILE adds one pattern per
+ * line. The merged table is printed as NDJSON, one group per line in quarter
+ * order, and a summary goes to stderr.
+ */
+
+#include "federation.h"
+#include "../executor/executor.h"
+#include "../json/json.h"
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+namespace {
+
+int usage() {
+    std::cerr << "Usage: ehs_federate --report violations|feedback [--jobs N] [--max-mbps X] [--live]\n"
+                 "                    [--list FILE] PATTERN...\n";
+    return 2;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    federation::Options options;
+    bool haveReport = false;
+    std::vector<std::string> patterns;
+
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (arg == "--report" && hasValue) {
+            if (!federation::parseReport(argv[++i], options.report)) {
+                return usage();
+            }
+            haveReport = true;
+        } else if (arg == "--jobs" && hasValue) {
+            options.jobs = std::max(1, std::atoi(argv[++i]));
+        } else if (arg == "--max-mbps" && hasValue) {
+            options.maxMBps = std::atof(argv[++i]);
+        } else if (arg == "--live") {
+            options.live = true;
+        } else if (arg == "--list" && hasValue) {
+            std::ifstream list(argv[++i]);
+            if (!list) {
+                std::cerr << "Cannot read " << argv[i] << "\n";
+                return 1;
+            }
+            std::string line;
+            while (std::getline(list, line)) {
+                if (!line.empty() && line[0] != '#') {
+                    patterns.push_back(line);
+                }
+            }
+        } else if (!arg.empty() && arg[0] != '-') {
+            patterns.push_back(arg);
+        } else {
+            return usage();
+        }
+    }
+    if (!haveReport || patterns.empty()) {
+        return usage();
+    }
+
+    std::vector<std::string> files;
+    std::string error;
+    if (!federation::expandInputs(patterns, files, error)) {
+        std::cerr << error << "\n";
+        return 1;
+    }
+
+    // Only the blocking threads scan; one pool thread is enough for the rest
+    executor::start(1, options.jobs);
+    federation::Summary summary = federation::run(files, options);
+    executor::shutdown();
+
+    for (const auto& entry : summary.groups) {
+        const federation::Group& group = entry.second;
+        std::cout << "{\"quarter\":" << json::quote(entry.first.first);
+        if (options.report == federation::Report::Violations) {
+            std::cout << ",\"violation\":" << json::quote(entry.first.second) << ",\"violations\":" << group.count;
+        } else {
+            std::cout << ",\"rule\":" << json::quote(entry.first.second) << ",\"feedback\":" << group.count
+                      << ",\"ratings\":" << group.ratingCount << ",\"average_rating\":";
+            if (group.ratingCount > 0) {
+                std::cout << static_cast<double>(group.ratingSum) / group.ratingCount;
+            } else {
+                std::cout << "null";
+            }
+        }
+        std::cout << "}\n";
+    }
+
+    for (const std::string& failure : summary.errors) {
+        std::cerr << failure << "\n";
+    }
+    std::cerr << "Aggregated " << summary.files << " of " << files.size() << " files, "
+              << summary.bytesRead / (1024.0 * 1024.0) << " MiB read in " << summary.seconds << " s";
+    if (summary.throttledSeconds > 0) {
+        std::cerr << " (" << summary.throttledSeconds << " s spent waiting for the I/O budget over all jobs)";
+    }
+    std::cerr << "\n";
+    return summary.ok ? 0 : 1;
+}
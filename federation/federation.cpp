@@ -0,0 +1,406 @@
+/**
+ * @file federation.cpp
+ * @brief The I/O-budget VFS shim, the per-file aggregate scans and the merge.
+ *
+ * The shim is a VFS registered for the duration of a run, stacked on the
+ * default one. Its files forward every method to the real file; xRead and
+ * xFetch (memory-mapped pages) first charge the blocks they touch for the
+ * first time against a shared budget. The budget is a virtual clock that
+ * advances by bytes / rate for every charge and is allowed to lag the real
+ * clock by at most one second, so a scan sleeps once it runs ahead of the
+ * rate and short bursts after idle time go through at once.
+ *
+ * Files are scanned in lanes: min(jobs, files) offloaded tasks, each taking
+ * the next file until none is left and merging its partial aggregate under
+ * one mutex.
+ */
+
+#include "federation.h"
+#include "../core/core.h"
+#include "../executor/executor.h"
+#include "../metrics/metrics.h"
+#include "../trace/trace.h"
+#include <glob.h>
+#include <sqlite3.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstring>
+#include <mutex>
+#include <set>
+#include <thread>
+
+namespace federation {
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+const std::int64_t kBlockBytes = 4096;
+
+// Files are opened read-only and never migrated, so violation times still in ctime text are converted here
+const std::string kViolationTime = std::string("(CASE WHEN ") + core::kLegacyViolationTimeSql + " THEN " +
+                                   core::kLegacyViolationTimeToCoreSql + " ELSE violation_timestamp END)";
+
+const std::string kViolationsSql =
+    "SELECT IFNULL(strftime('%Y', " + kViolationTime + ") || '-Q' || "
+    "((CAST(strftime('%m', " + kViolationTime + ") AS INTEGER) + 2) / 3), 'unknown'), "
+    "IFNULL(violation_comment, ''), count(*), 0, 0 "
+    "FROM tasks WHERE violation_timestamp IS NOT NULL GROUP BY 1, 2;";
+
+const char* kFeedbackSql =
+    "SELECT IFNULL(strftime('%Y', f.created_at) || '-Q' || "
+    "((CAST(strftime('%m', f.created_at) AS INTEGER) + 2) / 3), 'unknown'), "
+    "r.rule_text, count(*), count(f.rating), IFNULL(sum(f.rating), 0) "
+    "FROM rule_feedback f JOIN rules r ON r.id = f.rule_id GROUP BY 1, 2;";
+
+/**
+ * @class Budget
+ * @brief Bytes read so far and the rate limit they are held to.
+ */
+class Budget {
+public:
+    explicit Budget(double bytesPerSecond) : bytesPerSecond(bytesPerSecond), clock(Clock::now()) {}
+
+    /// @brief Counts @p bytes and sleeps until the budget allows them.
+    void charge(std::uint64_t bytes) {
+        total += bytes;
+        if (bytesPerSecond <= 0) {
+            return;
+        }
+        Clock::time_point now = Clock::now();
+        Clock::time_point start;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            start = std::max(clock, now - std::chrono::seconds(1));
+            clock = start + std::chrono::duration_cast<Clock::duration>(
+                                std::chrono::duration<double>(bytes / bytesPerSecond));
+        }
+        if (start > now) {
+            std::this_thread::sleep_until(start);
+            sleptMicros += std::chrono::duration_cast<std::chrono::microseconds>(start - now).count();
+        }
+    }
+
+    std::uint64_t bytes() const { return total.load(); }
+    double sleptSeconds() const { return sleptMicros.load() / 1e6; }
+
+private:
+    const double bytesPerSecond;
+    std::mutex mutex;                         ///< Guards clock
+    Clock::time_point clock;                  ///< When the budget is next free
+    std::atomic<std::uint64_t> total{0};
+    std::atomic<long long> sleptMicros{0};
+};
+
+/// @brief The shim VFS: the default VFS with a budget-charging xOpen.
+struct ShimVfs {
+    sqlite3_vfs base;
+    sqlite3_vfs* root;
+    Budget* budget;
+    std::string name;
+};
+
+/// @brief A file opened through the shim; the real file follows it in the same allocation.
+struct ShimFile {
+    sqlite3_file base;
+    sqlite3_file* real;
+    Budget* budget;
+    std::vector<bool>* touched;               ///< Blocks already charged; main database only
+};
+
+sqlite3_file* real(sqlite3_file* file) { return reinterpret_cast<ShimFile*>(file)->real; }
+
+/// @brief Charges the blocks of [offset, offset + amount) that were not read before.
+void chargeBlocks(ShimFile* file, sqlite3_int64 offset, int amount) {
+    if (!file->touched || amount <= 0) {
+        return;
+    }
+    size_t first = static_cast<size_t>(offset / kBlockBytes);
+    size_t last = static_cast<size_t>((offset + amount - 1) / kBlockBytes);
+    if (file->touched->size() <= last) {
+        file->touched->resize(last + 1);
+    }
+    std::uint64_t fresh = 0;
+    for (size_t block = first; block <= last; ++block) {
+        if (!(*file->touched)[block]) {
+            (*file->touched)[block] = true;
+            ++fresh;
+        }
+    }
+    if (fresh) {
+        file->budget->charge(fresh * kBlockBytes);
+    }
+}
+
+int shimClose(sqlite3_file* file) {
+    ShimFile* shim = reinterpret_cast<ShimFile*>(file);
+    int rc = shim->real->pMethods->xClose(shim->real);
+    delete shim->touched;
+    shim->touched = nullptr;
+    return rc;
+}
+
+int shimRead(sqlite3_file* file, void* buffer, int amount, sqlite3_int64 offset) {
+    chargeBlocks(reinterpret_cast<ShimFile*>(file), offset, amount);
+    return real(file)->pMethods->xRead(real(file), buffer, amount, offset);
+}
+
+int shimWrite(sqlite3_file* file, const void* buffer, int amount, sqlite3_int64 offset) {
+    return real(file)->pMethods->xWrite(real(file), buffer, amount, offset);
+}
+
+int shimTruncate(sqlite3_file* file, sqlite3_int64 size) {
+    return real(file)->pMethods->xTruncate(real(file), size);
+}
+
+int shimSync(sqlite3_file* file, int flags) { return real(file)->pMethods->xSync(real(file), flags); }
+
+int shimFileSize(sqlite3_file* file, sqlite3_int64* size) {
+    return real(file)->pMethods->xFileSize(real(file), size);
+}
+
+int shimLock(sqlite3_file* file, int level) { return real(file)->pMethods->xLock(real(file), level); }
+
+int shimUnlock(sqlite3_file* file, int level) { return real(file)->pMethods->xUnlock(real(file), level); }
+
+int shimCheckReservedLock(sqlite3_file* file, int* out) {
+    return real(file)->pMethods->xCheckReservedLock(real(file), out);
+}
+
+int shimFileControl(sqlite3_file* file, int op, void* arg) {
+    return real(file)->pMethods->xFileControl(real(file), op, arg);
+}
+
+int shimSectorSize(sqlite3_file* file) { return real(file)->pMethods->xSectorSize(real(file)); }
+
+int shimDeviceCharacteristics(sqlite3_file* file) {
+    return real(file)->pMethods->xDeviceCharacteristics(real(file));
+}
+
+int shimShmMap(sqlite3_file* file, int region, int size, int extend, void volatile** out) {
+    return real(file)->pMethods->xShmMap(real(file), region, size, extend, out);
+}
+
+int shimShmLock(sqlite3_file* file, int offset, int n, int flags) {
+    return real(file)->pMethods->xShmLock(real(file), offset, n, flags);
+}
+
+void shimShmBarrier(sqlite3_file* file) { real(file)->pMethods->xShmBarrier(real(file)); }
+
+int shimShmUnmap(sqlite3_file* file, int deleteFlag) {
+    return real(file)->pMethods->xShmUnmap(real(file), deleteFlag);
+}
+
+int shimFetch(sqlite3_file* file, sqlite3_int64 offset, int amount, void** out) {
+    int rc = real(file)->pMethods->xFetch(real(file), offset, amount, out);
+    if (rc == SQLITE_OK && *out) {
+        chargeBlocks(reinterpret_cast<ShimFile*>(file), offset, amount);
+    }
+    return rc;
+}
+
+int shimUnfetch(sqlite3_file* file, sqlite3_int64 offset, void* page) {
+    return real(file)->pMethods->xUnfetch(real(file), offset, page);
+}
+
+const sqlite3_io_methods kShimMethods = {
+    3,
+    shimClose,
+    shimRead,
+    shimWrite,
+    shimTruncate,
+    shimSync,
+    shimFileSize,
+    shimLock,
+    shimUnlock,
+    shimCheckReservedLock,
+    shimFileControl,
+    shimSectorSize,
+    shimDeviceCharacteristics,
+    shimShmMap,
+    shimShmLock,
+    shimShmBarrier,
+    shimShmUnmap,
+    shimFetch,
+    shimUnfetch,
+};
+
+int shimOpen(sqlite3_vfs* vfs, const char* name, sqlite3_file* file, int flags, int* outFlags) {
+    ShimVfs* shimVfs = reinterpret_cast<ShimVfs*>(vfs);
+    ShimFile* shim = reinterpret_cast<ShimFile*>(file);
+    shim->real = reinterpret_cast<sqlite3_file*>(shim + 1);
+    shim->budget = shimVfs->budget;
+    shim->touched = nullptr;
+    int rc = shimVfs->root->xOpen(shimVfs->root, name, shim->real, flags, outFlags);
+    if (rc != SQLITE_OK || !shim->real->pMethods) {
+        shim->base.pMethods = nullptr;
+        return rc;
+    }
+    if (flags & SQLITE_OPEN_MAIN_DB) {
+        shim->touched = new std::vector<bool>();
+    }
+    shim->base.pMethods = &kShimMethods;
+    return SQLITE_OK;
+}
+
+/// @brief Percent-encodes the characters that end or escape the path of a file: URI.
+std::string uriPath(const std::string& path) {
+    static const char* hexDigits = "0123456789ABCDEF";
+    std::string out;
+    for (unsigned char c : path) {
+        if (c == '%' || c == '?' || c == '#') {
+            out += '%';
+            out += hexDigits[c >> 4];
+            out += hexDigits[c & 0x0f];
+        } else {
+            out += static_cast<char>(c);
+        }
+    }
+    return out;
+}
+
+/// @brief Aggregates one file; returns false with @p error set if it fails.
+bool scan(const std::string& path, const Options& options, const std::string& vfsName,
+          std::map<Key, Group>& groups, std::string& error) {
+    EHS_MEASURE("federation.scan");
+    trace::Span span("federation.scan", "federation");
+    std::string uri = "file:" + uriPath(path) + (options.live ? "?mode=ro" : "?mode=ro&immutable=1");
+    sqlite3* db = nullptr;
+    if (sqlite3_open_v2(uri.c_str(), &db, SQLITE_OPEN_READONLY | SQLITE_OPEN_URI, vfsName.c_str()) != SQLITE_OK) {
+        error = db ? sqlite3_errmsg(db) : "out of memory";
+        sqlite3_close(db);
+        return false;
+    }
+    sqlite3_busy_timeout(db, 5000);
+    std::string mmap = "PRAGMA mmap_size = " + std::to_string(options.mmapBytes) + ";";
+    sqlite3_exec(db, mmap.c_str(), nullptr, nullptr, nullptr);
+
+    const char* sql = options.report == Report::Violations ? kViolationsSql.c_str() : kFeedbackSql;
+    sqlite3_stmt* stmt = nullptr;
+    if (sqlite3_prepare_v2(db, sql, -1, &stmt, nullptr) != SQLITE_OK) {
+        error = sqlite3_errmsg(db);
+        sqlite3_close(db);
+        return false;
+    }
+    int rc;
+    while ((rc = sqlite3_step(stmt)) == SQLITE_ROW) {
+        const unsigned char* quarter = sqlite3_column_text(stmt, 0);
+        const unsigned char* label = sqlite3_column_text(stmt, 1);
+        Group& group = groups[Key(quarter ? reinterpret_cast<const char*>(quarter) : "",
+                                  label ? reinterpret_cast<const char*>(label) : "")];
+        group.count += sqlite3_column_int64(stmt, 2);
+        group.ratingCount += sqlite3_column_int64(stmt, 3);
+        group.ratingSum += sqlite3_column_int64(stmt, 4);
+    }
+    if (rc != SQLITE_DONE) {
+        error = sqlite3_errmsg(db);
+    }
+    sqlite3_finalize(stmt);
+    sqlite3_close(db);
+    return rc == SQLITE_DONE;
+}
+
+}  // namespace
+
+bool parseReport(const std::string& name, Report& report) {
+    if (name == "violations") {
+        report = Report::Violations;
+    } else if (name == "feedback") {
+        report = Report::Feedback;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+bool expandInputs(const std::vector<std::string>& patterns, std::vector<std::string>& files, std::string& error) {
+    std::set<std::string> unique;
+    for (const std::string& pattern : patterns) {
+        glob_t matches;
+        int rc = glob(pattern.c_str(), 0, nullptr, &matches);
+        if (rc != 0) {
+            globfree(&matches);
+            error = "No database file matches " + pattern;
+            return false;
+        }
+        for (size_t i = 0; i < matches.gl_pathc; ++i) {
+            unique.insert(matches.gl_pathv[i]);
+        }
+        globfree(&matches);
+    }
+    files.assign(unique.begin(), unique.end());
+    return true;
+}
+
+Summary run(const std::vector<std::string>& files, const Options& options) {
+    trace::Span span("federation.run", "federation");
+    Summary summary;
+    Clock::time_point start = Clock::now();
+    Budget budget(options.maxMBps * 1e6);
+
+    // One VFS per run, so concurrent runs keep separate budgets
+    static std::atomic<int> runs{0};
+    ShimVfs shimVfs;
+    shimVfs.root = sqlite3_vfs_find(nullptr);
+    shimVfs.budget = &budget;
+    shimVfs.name = "ehs_federation_" + std::to_string(++runs);
+    shimVfs.base = *shimVfs.root;
+    shimVfs.base.pNext = nullptr;
+    shimVfs.base.zName = shimVfs.name.c_str();
+    shimVfs.base.szOsFile = static_cast<int>(sizeof(ShimFile)) + shimVfs.root->szOsFile;
+    shimVfs.base.xOpen = shimOpen;
+    sqlite3_vfs_register(&shimVfs.base, 0);
+
+    std::mutex mutex;                         // Guards summary and lanes
+    std::condition_variable finished;
+    std::atomic<size_t> next{0};
+    int lanes = static_cast<int>(std::min<size_t>(std::max(1, options.jobs), files.size()));
+    auto lane = [&]() {
+        for (size_t i = next++; i < files.size(); i = next++) {
+            std::map<Key, Group> groups;
+            std::string error;
+            bool ok = scan(files[i], options, shimVfs.name, groups, error);
+            std::lock_guard<std::mutex> lock(mutex);
+            if (!ok) {
+                summary.ok = false;
+                summary.errors.push_back(files[i] + ": " + error);
+                continue;
+            }
+            ++summary.files;
+            for (const auto& entry : groups) {
+                Group& group = summary.groups[entry.first];
+                group.count += entry.second.count;
+                group.ratingCount += entry.second.ratingCount;
+                group.ratingSum += entry.second.ratingSum;
+            }
+        }
+        std::lock_guard<std::mutex> lock(mutex);
+        --lanes;
+        finished.notify_all();
+    };
+    int started = lanes;
+    for (int i = 0; i < started; ++i) {
+        if (!executor::offload(lane)) {
+            std::lock_guard<std::mutex> lock(mutex);
+            --lanes;
+        }
+    }
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        finished.wait(lock, [&]() { return lanes == 0; });
+    }
+    if (next.load() < files.size()) {
+        summary.ok = false;
+        summary.errors.push_back("The executor is shutting down; not every file was aggregated");
+    }
+
+    sqlite3_vfs_unregister(&shimVfs.base);
+    summary.bytesRead = budget.bytes();
+    summary.throttledSeconds = budget.sleptSeconds();
+    summary.seconds = std::chrono::duration<double>(Clock::now() - start).count();
+    return summary;
+}
+
+}  // namespace federation
@@ -0,0 +1,90 @@
+#ifndef FEDERATION_H_
+#define FEDERATION_H_
+
+#include <cstdint>
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+
+/**
+ * @namespace federation
+ * @brief Read-only aggregate reports over many ehs.db files at once.
+ *
+ * run() opens every file read-only through a VFS shim that rate-limits the
+ * bytes SQLite pulls from storage, runs the report's GROUP BY on a bounded
+ * number of files at a time on the executor's blocking threads, and merges
+ * the per-file partial aggregates into one table.
+ *
+ * Files are opened with immutable=1 by default: no locks, no -shm file and
+ * no WAL, which is what archived copies on a NAS want. A file still being
+ * written to, or copied together with its -wal file, needs Options::live.
+ * Bytes are counted the first time each 4 KiB block of a file is read or
+ * memory-mapped, so re-reading a page that is already cached costs nothing.
+ */
+namespace federation {
+
+/// @brief What to aggregate.
+enum class Report {
+    Violations,   ///< Violations per quarter and violation comment
+    Feedback      ///< Rule feedback per quarter and rule text, with ratings
+};
+
+/**
+ * @struct Options
+ * @brief Report, parallelism and I/O budget of a federated run.
+ */
+struct Options {
+    Report report = Report::Violations;
+    int jobs = 4;                            ///< Files scanned at the same time
+    double maxMBps = 0;                      ///< Read budget over all files in MB/s; 0 for unlimited
+    bool live = false;                       ///< Open with locking and WAL instead of immutable=1
+    std::int64_t mmapBytes = 256LL << 20;    ///< PRAGMA mmap_size of each connection
+};
+
+/// @brief Partial or merged aggregate of one group.
+struct Group {
+    long long count = 0;                     ///< Violations or feedback entries
+    long long ratingCount = 0;               ///< Feedback entries with a rating
+    long long ratingSum = 0;                 ///< Sum of those ratings
+};
+
+/// @brief Group key: the quarter ("2025-Q3") and the violation comment or rule text.
+using Key = std::pair<std::string, std::string>;
+
+/**
+ * @struct Summary
+ * @brief Merged result of a federated run.
+ */
+struct Summary {
+    bool ok = true;                          ///< False if any file could not be aggregated
+    std::vector<std::string> errors;         ///< One "file: message" per failed file
+    int files = 0;                           ///< Files aggregated
+    std::map<Key, Group> groups;             ///< Merged aggregates, in key order
+    std::uint64_t bytesRead = 0;             ///< Bytes pulled from storage
+    double seconds = 0;                      ///< Wall time of the run
+    double throttledSeconds = 0;             ///< Time the scans slept to stay within maxMBps
+};
+
+/// @brief Parses "violations" or "feedback".
+bool parseReport(const std::string& name, Report& report);
+
+/**
+ * @brief Expands glob patterns into a sorted list of distinct files.
+ *
+ * @return False, with @p error set, if a pattern matches nothing.
+ */
+bool expandInputs(const std::vector<std::string>& patterns, std::vector<std::string>& files, std::string& error);
+
+/**
+ * @brief Runs a report over @p files and merges the results.
+ *
+ * Starts the executor if it is not running; at most Options::jobs of its
+ * blocking threads are used. A file that fails is listed in Summary::errors
+ * and left out of the totals.
+ */
+Summary run(const std::vector<std::string>& files, const Options& options);
+
+}  // namespace federation
+
+#endif  // FEDERATION_H_
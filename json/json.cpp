@@ -0,0 +1,242 @@
+/**
+ * @file json.cpp
+ * @brief Flat JSON object parser and string escaping.
+ *
+ */
+
+#include "json.h"
+#include <cstdio>
+#include <cstdlib>
+
+namespace json {
+
+namespace {
+
+class Parser {
+public:
+    explicit Parser(const std::string& text) : text(text) {}
+
+    bool object(Object& out, std::string& error) {
+        skipSpace();
+        if (!consume('{')) return fail(error, "expected '{'");
+        skipSpace();
+        if (consume('}')) return end(error);
+        while (true) {
+            std::string name;
+            Value value;
+            skipSpace();
+            if (!string(name)) return fail(error, "expected member name");
+            skipSpace();
+            if (!consume(':')) return fail(error, "expected ':'");
+            skipSpace();
+            if (!scalar(value)) return fail(error, "unsupported value for \"" + name + "\"");
+            out[name] = value;
+            skipSpace();
+            if (consume(',')) continue;
+            if (consume('}')) return end(error);
+            return fail(error, "expected ',' or '}'");
+        }
+    }
+
+private:
+    bool end(std::string& error) {
+        skipSpace();
+        return pos == text.size() || fail(error, "trailing characters");
+    }
+
+    bool fail(std::string& error, const std::string& what) {
+        error = what + " at offset " + std::to_string(pos);
+        return false;
+    }
+
+    void skipSpace() {
+        while (pos < text.size() && (text[pos] == ' ' || text[pos] == '\t' || text[pos] == '\r' || text[pos] == '\n')) {
+            ++pos;
+        }
+    }
+
+    bool consume(char c) {
+        if (pos < text.size() && text[pos] == c) {
+            ++pos;
+            return true;
+        }
+        return false;
+    }
+
+    bool literal(const char* word) {
+        size_t n = std::char_traits<char>::length(word);
+        if (text.compare(pos, n, word) != 0) return false;
+        pos += n;
+        return true;
+    }
+
+    static void appendUtf8(std::string& out, unsigned code) {
+        if (code < 0x80) {
+            out += static_cast<char>(code);
+        } else if (code < 0x800) {
+            out += static_cast<char>(0xc0 | (code >> 6));
+            out += static_cast<char>(0x80 | (code & 0x3f));
+        } else if (code < 0x10000) {
+            out += static_cast<char>(0xe0 | (code >> 12));
+            out += static_cast<char>(0x80 | ((code >> 6) & 0x3f));
+            out += static_cast<char>(0x80 | (code & 0x3f));
+        } else {
+            out += static_cast<char>(0xf0 | (code >> 18));
+            out += static_cast<char>(0x80 | ((code >> 12) & 0x3f));
+            out += static_cast<char>(0x80 | ((code >> 6) & 0x3f));
+            out += static_cast<char>(0x80 | (code & 0x3f));
+        }
+    }
+
+    bool hex4(unsigned& code) {
+        if (pos + 4 > text.size()) return false;
+        code = 0;
+        for (int i = 0; i < 4; ++i) {
+            char c = text[pos++];
+            code <<= 4;
+            if (c >= '0' && c <= '9') code |= c - '0';
+            else if (c >= 'a' && c <= 'f') code |= c - 'a' + 10;
+            else if (c >= 'A' && c <= 'F') code |= c - 'A' + 10;
+            else return false;
+        }
+        return true;
+    }
+
+    bool string(std::string& out) {
+        if (!consume('"')) return false;
+        while (pos < text.size()) {
+            char c = text[pos++];
+            if (c == '"') return true;
+            if (c != '\\') {
+                out += c;
+                continue;
+            }
+            if (pos >= text.size()) return false;
+            char e = text[pos++];
+            switch (e) {
+                case '"': out += '"'; break;
+                case '\\': out += '\\'; break;
+                case '/': out += '/'; break;
+                case 'b': out += '\b'; break;
+                case 'f': out += '\f'; break;
+                case 'n': out += '\n'; break;
+                case 'r': out += '\r'; break;
+                case 't': out += '\t'; break;
+                case 'u': {
+                    unsigned code;
+                    if (!hex4(code)) return false;
+                    if (code >= 0xd800 && code < 0xdc00) {
+                        unsigned low;
+                        if (!literal("\\u") || !hex4(low) || low < 0xdc00 || low > 0xdfff) return false;
+                        code = 0x10000 + ((code - 0xd800) << 10) + (low - 0xdc00);
+                    }
+                    appendUtf8(out, code);
+                    break;
+                }
+                default:
+                    return false;
+            }
+        }
+        return false;
+    }
+
+    bool scalar(Value& value) {
+        if (pos >= text.size()) return false;
+        char c = text[pos];
+        if (c == '"') {
+            value.type = Value::Type::String;
+            return string(value.text);
+        }
+        if (literal("true")) {
+            value.type = Value::Type::Bool;
+            value.boolean = true;
+            return true;
+        }
+        if (literal("false")) {
+            value.type = Value::Type::Bool;
+            return true;
+        }
+        if (literal("null")) {
+            return true;
+        }
+        if (c == '-' || digit(c)) {
+            size_t start = pos;
+            if (number(value)) return true;
+            pos = start;  // Report the error at the start of the value
+            return false;
+        }
+        return false;
+    }
+
+    static bool digit(char c) { return c >= '0' && c <= '9'; }
+
+    /// @brief Skips one or more digits.
+    bool digits() {
+        size_t start = pos;
+        while (pos < text.size() && digit(text[pos])) ++pos;
+        return pos > start;
+    }
+
+    /// @brief The JSON number grammar only; strtod alone would also take hex, inf and nan.
+    bool number(Value& value) {
+        size_t begin = pos;
+        if (text[pos] == '-') ++pos;
+        if (pos < text.size() && text[pos] == '0') {
+            ++pos;
+        } else if (!digits()) {
+            return false;
+        }
+        if (pos < text.size() && text[pos] == '.') {
+            ++pos;
+            if (!digits()) return false;
+        }
+        if (pos < text.size() && (text[pos] == 'e' || text[pos] == 'E')) {
+            ++pos;
+            if (pos < text.size() && (text[pos] == '+' || text[pos] == '-')) ++pos;
+            if (!digits()) return false;
+        }
+        value.type = Value::Type::Number;
+        value.text.assign(text, begin, pos - begin);
+        value.number = std::strtod(value.text.c_str(), nullptr);
+        return true;
+    }
+
+    const std::string& text;
+    size_t pos = 0;
+};
+
+}  // namespace
+
+bool parseObject(const std::string& text, Object& object, std::string& error) {
+    object.clear();
+    return Parser(text).object(object, error);
+}
+
+std::string escape(const std::string& value) {
+    std::string escaped;
+    escaped.reserve(value.size());
+    for (unsigned char c : value) {
+        switch (c) {
+            case '"': escaped += "\\\""; break;
+            case '\\': escaped += "\\\\"; break;
+            case '\n': escaped += "\\n"; break;
+            case '\r': escaped += "\\r"; break;
+            case '\t': escaped += "\\t"; break;
+            default:
+                if (c < 0x20) {
+                    char buffer[8];
+                    std::snprintf(buffer, sizeof(buffer), "\\u%04x", c);
+                    escaped += buffer;
+                } else {
+                    escaped += static_cast<char>(c);
+                }
+        }
+    }
+    return escaped;
+}
+
+std::string quote(const std::string& value) {
+    return "\"" + escape(value) + "\"";
+}
+
+}  // namespace json
@@ -0,0 +1,54 @@
+#ifndef JSON_H_
+#define JSON_H_
+
+#include <map>
+#include <string>
+
+/**
+ * @namespace json
+ * @brief Minimal JSON support for line-oriented (NDJSON) input and output.
+ *
+ * Only flat objects are parsed: string, number, boolean and null members.
+ * Nested objects and arrays are rejected, which is all the batch command
+ * format needs; output is written directly with escape().
+ */
+namespace json {
+
+/**
+ * @struct Value
+ * @brief A scalar member of a parsed object.
+ */
+struct Value {
+    enum class Type { Null, Bool, Number, String };
+    Type type = Type::Null;
+    bool boolean = false;
+    double number = 0;
+    std::string text;         ///< String value, or the number as written
+};
+
+/// @brief Members of a flat object by name.
+using Object = std::map<std::string, Value>;
+
+/**
+ * @brief Parses one flat JSON object, e.g. {"op":"assign","worker_id":2}.
+ *
+ * @param text Input line.
+ * @param object Receives the members.
+ * @param error Set to a description when parsing fails.
+ * @return False on malformed input.
+ */
+bool parseObject(const std::string& text, Object& object, std::string& error);
+
+/**
+ * @brief Escapes a string for use inside a JSON string literal (without quotes).
+ */
+std::string escape(const std::string& value);
+
+/**
+ * @brief Returns value as a quoted JSON string.
+ */
+std::string quote(const std::string& value);
+
+}  // namespace json
+
+#endif  // JSON_H_
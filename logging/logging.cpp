@@ -0,0 +1,302 @@
+/**
+ * @file logging.cpp
+ * @brief Lock-free record ring and the background writer thread.
+ *
+ * The ring is a bounded multi-producer queue: every slot carries a sequence
+ * number, a producer claims position p by advancing the shared tail with a
+ * compare-and-swap once slot p's sequence equals p, fills the record in place
+ * and publishes it by setting the sequence to p + 1. The single consumer
+ * waits for that value, formats the record, and hands the slot back to the
+ * next lap by setting the sequence to p + capacity.
+ *
+ */
+
+#include "logging.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <ctime>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <thread>
+
+namespace logging {
+
+namespace {
+
+const uint64_t kCapacity = 4096;  ///< Records buffered before calls start dropping
+
+struct Slot {
+    Record record;  // first member: commit() recovers the slot from the record pointer
+    std::atomic<uint64_t> sequence{0};
+    uint64_t position = 0;
+};
+
+struct Logger {
+    std::unique_ptr<Slot[]> slots{new Slot[kCapacity]};
+    alignas(64) std::atomic<uint64_t> tail{0};
+    alignas(64) uint64_t head = 0;  ///< Only touched by the writer thread
+    std::atomic<uint64_t> dropped{0};
+    uint64_t droppedReported = 0;
+    // Producers between begin() and commit() are claimed - committed; stop() waits for them to finish
+    alignas(64) std::atomic<uint64_t> claimed{0};
+    alignas(64) std::atomic<uint64_t> committed{0};
+
+    std::atomic<bool> running{false};
+    std::atomic<int> fileLevel{static_cast<int>(Level::Info)};
+    Level consoleLevel = Level::Error;
+    std::thread writer;
+
+    std::string path;
+    std::uintmax_t maxBytes = 0;
+    int maxFiles = 0;
+    std::ofstream file;
+
+    Logger() {
+        for (uint64_t i = 0; i < kCapacity; ++i) {
+            slots[i].sequence.store(i, std::memory_order_relaxed);
+        }
+    }
+};
+
+Logger& logger() {
+    static Logger* instance = new Logger();  // never destroyed; threads may log after main
+    return *instance;
+}
+
+thread_local char sessionContext[kContextBytes] = "";
+thread_local Record scratch;  ///< Used while the writer thread is not running
+
+const char* levelName(Level level) {
+    switch (level) {
+        case Level::Debug: return "DEBUG";
+        case Level::Info: return "INFO ";
+        case Level::Warn: return "WARN ";
+        case Level::Error: return "ERROR";
+    }
+    return "?    ";
+}
+
+/// @brief Expands a record into one log line (without the trailing newline).
+std::string format(const Record& record) {
+    std::time_t seconds = static_cast<std::time_t>(record.timeMicros / 1000000);
+    std::tm local;
+    localtime_r(&seconds, &local);
+    char timestamp[64];
+    std::strftime(timestamp, sizeof(timestamp), "%Y-%m-%d %H:%M:%S", &local);
+    char micros[16];
+    std::snprintf(micros, sizeof(micros), ".%06d", static_cast<int>(record.timeMicros % 1000000));
+
+    std::string line = std::string(timestamp) + micros + " " + levelName(record.level) + " ";
+    if (record.context[0]) {
+        line += "[";
+        line += record.context;
+        line += "] ";
+    }
+
+    int next = 0;
+    for (const char* p = record.format; *p; ++p) {
+        if (p[0] == '{' && p[1] == '}' && next < record.argCount) {
+            const auto& arg = record.args[next];
+            switch (record.types[next]) {
+                case Record::ArgType::Int: line += std::to_string(arg.i); break;
+                case Record::ArgType::Unsigned: line += std::to_string(arg.u); break;
+                case Record::ArgType::Double: {
+                    char number[32];
+                    std::snprintf(number, sizeof(number), "%g", arg.d);
+                    line += number;
+                    break;
+                }
+                case Record::ArgType::Text: line += record.text + arg.textOffset; break;
+            }
+            ++next;
+            ++p;
+        } else {
+            line += *p;
+        }
+    }
+    return line;
+}
+
+void fillHeader(Record& record, Level level, const char* format) {
+    record.format = format;
+    record.level = level;
+    record.timeMicros = std::chrono::duration_cast<std::chrono::microseconds>(
+                            std::chrono::system_clock::now().time_since_epoch()).count();
+    record.argCount = 0;
+    record.textUsed = 0;
+    std::memcpy(record.context, sessionContext, kContextBytes);
+}
+
+void rotateIfNeeded(Logger& l) {
+    std::error_code ec;
+    if (std::filesystem::file_size(l.path, ec) < l.maxBytes || ec) {
+        return;
+    }
+
+    l.file.close();
+    for (int i = l.maxFiles - 1; i >= 1; --i) {
+        std::filesystem::rename(l.path + "." + std::to_string(i), l.path + "." + std::to_string(i + 1), ec);
+    }
+    if (l.maxFiles > 0) {
+        std::filesystem::rename(l.path, l.path + ".1", ec);
+    } else {
+        std::filesystem::remove(l.path, ec);
+    }
+    l.file.open(l.path, std::ios::app);
+}
+
+void writeLine(Logger& l, Level level, const std::string& line) {
+    l.file << line << '\n';
+    if (level >= l.consoleLevel) {
+        std::cerr << line << '\n';
+    }
+}
+
+/// @brief Writes every published record; returns false if there was none.
+bool drain(Logger& l) {
+    bool wrote = false;
+    while (true) {
+        Slot& slot = l.slots[l.head % kCapacity];
+        if (slot.sequence.load(std::memory_order_acquire) != l.head + 1) {
+            break;
+        }
+        writeLine(l, slot.record.level, format(slot.record));
+        slot.sequence.store(l.head + kCapacity, std::memory_order_release);
+        ++l.head;
+        wrote = true;
+    }
+
+    uint64_t dropped = l.dropped.load(std::memory_order_relaxed);
+    if (dropped != l.droppedReported) {
+        Record note;
+        fillHeader(note, Level::Warn, "{} log records dropped (ring full)");
+        note.context[0] = '\0';
+        note.add(dropped - l.droppedReported);
+        writeLine(l, Level::Warn, format(note));
+        l.droppedReported = dropped;
+        wrote = true;
+    }
+
+    if (wrote) {
+        l.file.flush();
+        rotateIfNeeded(l);
+    }
+    return wrote;
+}
+
+void writerLoop() {
+    Logger& l = logger();
+    while (true) {
+        if (drain(l)) continue;
+        if (!l.running.load(std::memory_order_acquire)) {
+            // Records claimed before stop() must still be written, so wait for their commits
+            while (l.committed.load() != l.claimed.load()) {
+                drain(l);
+                std::this_thread::yield();
+            }
+            drain(l);
+            break;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(2));
+    }
+}
+
+}  // namespace
+
+Record* begin(Level level, const char* format) {
+    Logger& l = logger();
+    if (static_cast<int>(level) < l.fileLevel.load(std::memory_order_relaxed)) {
+        return nullptr;
+    }
+    // Counted before running is read: stop() either sees this claim or this call sees it stopping
+    l.claimed.fetch_add(1);
+    if (!l.running.load()) {
+        l.committed.fetch_add(1);
+        fillHeader(scratch, level, format);
+        return &scratch;
+    }
+
+    uint64_t position = l.tail.load(std::memory_order_relaxed);
+    while (true) {
+        Slot& slot = l.slots[position % kCapacity];
+        int64_t diff = static_cast<int64_t>(slot.sequence.load(std::memory_order_acquire)) -
+                       static_cast<int64_t>(position);
+        if (diff == 0) {
+            if (l.tail.compare_exchange_weak(position, position + 1, std::memory_order_relaxed)) {
+                slot.position = position;
+                fillHeader(slot.record, level, format);
+                return &slot.record;
+            }
+        } else if (diff < 0) {
+            l.dropped.fetch_add(1, std::memory_order_relaxed);
+            l.committed.fetch_add(1);
+            return nullptr;
+        } else {
+            position = l.tail.load(std::memory_order_relaxed);
+        }
+    }
+}
+
+void commit(Record* record) {
+    if (record == &scratch) {
+        std::cerr << format(scratch) << '\n';
+        return;
+    }
+    Slot* slot = reinterpret_cast<Slot*>(record);
+    slot->sequence.store(slot->position + 1, std::memory_order_release);
+    logger().committed.fetch_add(1);
+}
+
+void setSessionContext(const std::string& context) {
+    size_t length = std::min(context.size(), kContextBytes - 1);
+    std::memcpy(sessionContext, context.data(), length);
+    sessionContext[length] = '\0';
+}
+
+Level parseLevel(const std::string& name, Level fallback) {
+    if (name == "debug") return Level::Debug;
+    if (name == "info") return Level::Info;
+    if (name == "warn") return Level::Warn;
+    if (name == "error") return Level::Error;
+    return fallback;
+}
+
+bool start(const std::string& path, Level fileLevel, Level consoleLevel, std::uintmax_t maxBytes, int maxFiles) {
+    Logger& l = logger();
+    if (l.running.load()) {
+        return true;
+    }
+
+    l.file.open(path, std::ios::app);
+    if (!l.file) {
+        std::cerr << "Failed to open log file: " << path << "\n";
+        return false;
+    }
+    l.path = path;
+    l.maxBytes = maxBytes;
+    l.maxFiles = maxFiles;
+    l.consoleLevel = consoleLevel;
+    l.fileLevel.store(static_cast<int>(fileLevel));
+    l.running.store(true, std::memory_order_release);
+    l.writer = std::thread(writerLoop);
+    return true;
+}
+
+void stop() {
+    Logger& l = logger();
+    if (!l.running.exchange(false)) {
+        return;
+    }
+    l.writer.join();
+    l.file.close();
+}
+
+uint64_t droppedCount() {
+    return logger().dropped.load(std::memory_order_relaxed);
+}
+
+}  // namespace logging
@@ -0,0 +1,168 @@
+#ifndef LOGGING_H_
+#define LOGGING_H_
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <type_traits>
+
+/**
+ * @namespace logging
+ * @brief Asynchronous structured logger with lazy formatting.
+ *
+ * A log call copies its level, timestamp, the thread's session context and
+ * its arguments into a slot of a fixed-size multi-producer ring buffer and
+ * returns; it never takes a lock, allocates or touches a stream. A background
+ * thread started by start() drains the ring, substitutes each "{}" in the
+ * format string with the next argument, and writes the line to a rotating log
+ * file (and, at or above the console level, to stderr). When the ring is full
+ * the record is dropped and counted rather than blocking the caller.
+ *
+ * Before start() (or after stop()) log calls are formatted and written to
+ * stderr directly, so tools that never start the logger still see errors.
+ *
+ * Format strings must be string literals, because only the pointer is stored.
+ */
+namespace logging {
+
+enum class Level { Debug, Info, Warn, Error };
+
+const int kMaxArgs = 6;           ///< Arguments kept per record
+const size_t kTextBytes = 320;    ///< Bytes shared by all text arguments of a record
+const size_t kContextBytes = 48;  ///< Bytes kept of the session context
+
+/// @brief One log call, as stored in the ring before formatting.
+struct Record {
+    enum class ArgType : uint8_t { Int, Unsigned, Double, Text };
+
+    const char* format = nullptr;
+    Level level = Level::Info;
+    int64_t timeMicros = 0;        ///< Wall-clock time of the call
+    uint8_t argCount = 0;
+    ArgType types[kMaxArgs];
+    union {
+        long long i;
+        unsigned long long u;
+        double d;
+        uint16_t textOffset;
+    } args[kMaxArgs];
+    uint16_t textUsed = 0;
+    char text[kTextBytes];
+    char context[kContextBytes];
+
+    /// @brief Appends a text argument, truncating it to the space left.
+    void addText(const char* value, size_t length) {
+        if (argCount >= kMaxArgs) return;
+        types[argCount] = ArgType::Text;
+        if (textUsed >= kTextBytes - 1) {
+            // No room left, not even for a terminator: point at the one ending the text, so the argument is empty
+            args[argCount++].textOffset = static_cast<uint16_t>(kTextBytes - 1);
+            text[kTextBytes - 1] = '\0';
+            return;
+        }
+        size_t room = kTextBytes - textUsed - 1;
+        if (length > room) length = room;
+        args[argCount].textOffset = textUsed;
+        std::memcpy(text + textUsed, value, length);
+        text[textUsed + length] = '\0';
+        textUsed = static_cast<uint16_t>(textUsed + length + 1);
+        ++argCount;
+    }
+
+    template <typename T>
+    void add(const T& value) {
+        if (argCount >= kMaxArgs) return;
+        if constexpr (std::is_same_v<T, bool>) {
+            addText(value ? "true" : "false", value ? 4 : 5);
+        } else if constexpr (std::is_integral_v<T> && std::is_signed_v<T>) {
+            types[argCount] = ArgType::Int;
+            args[argCount++].i = value;
+        } else if constexpr (std::is_integral_v<T>) {
+            types[argCount] = ArgType::Unsigned;
+            args[argCount++].u = value;
+        } else if constexpr (std::is_floating_point_v<T>) {
+            types[argCount] = ArgType::Double;
+            args[argCount++].d = value;
+        } else if constexpr (std::is_same_v<T, std::string>) {
+            addText(value.data(), value.size());
+        } else {
+            const char* s = value;
+            addText(s ? s : "(null)", s ? std::strlen(s) : 6);
+        }
+    }
+};
+
+/**
+ * @brief Claims a ring slot for a record at @p level, or returns nullptr if the
+ *        level is filtered out. Used by the log functions below.
+ */
+Record* begin(Level level, const char* format);
+
+/**
+ * @brief Publishes a record claimed with begin().
+ */
+void commit(Record* record);
+
+/**
+ * @brief Logs a message; "{}" placeholders are replaced by @p args in order.
+ */
+template <typename... Args>
+void log(Level level, const char* format, const Args&... args) {
+    Record* record = begin(level, format);
+    if (!record) return;
+    (record->add(args), ...);
+    commit(record);
+}
+
+template <typename... Args>
+void debug(const char* format, const Args&... args) { log(Level::Debug, format, args...); }
+
+template <typename... Args>
+void info(const char* format, const Args&... args) { log(Level::Info, format, args...); }
+
+template <typename... Args>
+void warn(const char* format, const Args&... args) { log(Level::Warn, format, args...); }
+
+template <typename... Args>
+void error(const char* format, const Args&... args) { log(Level::Error, format, args...); }
+
+/**
+ * @brief Sets the context attached to every record of the calling thread,
+ *        e.g. "user=7 role=worker". An empty string clears it.
+ */
+void setSessionContext(const std::string& context);
+
+/**
+ * @brief Parses "debug", "info", "warn" or "error"; returns @p fallback otherwise.
+ */
+Level parseLevel(const std::string& name, Level fallback);
+
+/**
+ * @brief Starts the background thread that writes records to @p path.
+ *
+ * @param path Log file; rotated files are named path.1, path.2, ...
+ * @param fileLevel Records below this level are discarded at the call site.
+ * @param consoleLevel Records at or above this level are also written to stderr.
+ * @param maxBytes Size at which the log is rotated.
+ * @param maxFiles Number of rotated files kept.
+ * @return False if the file could not be opened.
+ */
+bool start(const std::string& path, Level fileLevel = Level::Info, Level consoleLevel = Level::Error,
+           std::uintmax_t maxBytes = 10 * 1024 * 1024, int maxFiles = 5);
+
+/**
+ * @brief Writes every queued record and stops the background thread.
+ *
+ * Records that other threads have begun but not yet committed are waited
+ * for and written too; calls that begin after stop() write to stderr.
+ */
+void stop();
+
+/**
+ * @brief Number of records dropped because the ring was full.
+ */
+uint64_t droppedCount();
+
+}  // namespace logging
+
+#endif  // LOGGING_H_
@@ -1,6 +1,10 @@
 #include "manager.h"
-#include <iostream>
+#include "../core/core.h"
+#include "../logging/logging.h"
+#include <algorithm>
 #include <ctime>
+#include <iostream>
+#include <vector>
 
 Manager::Manager() : User("manager") {}
 Manager::~Manager() {}
@@ -13,8 +17,13 @@ Manager::~Manager() {}
  * - Reporting violations related to tasks.
  * - Adding and deleting safety rules.
  * - Deleting existing tasks.
+ * - Creating and deleting recurring tasks.
+ * - Listing overdue tasks.
+ * - Auto-assigning tasks to the least-loaded available workers.
+ * - Managing worker shifts and listing who is on shift at a site.
  *
- * The class uses SQLite for all database operations and follows object-oriented
+ * The class handles the manager's prompts and output and delegates the database
+ * operations to the headless functions in core/core.h, following object-oriented
  * principles. It is intended to be used in conjunction with the overall EHS 
  * system that manages Environment, Health, and Safety processes.
  *
@@ -23,32 +32,80 @@ Manager::~Manager() {}
 /**
  * @brief Assigns a task to a worker.
  *
- * Displays a list of available workers, prompts the manager
- * for task details, and inserts the task into the database.
+ * Prompts the manager for task details, its priority, an optional
+ * deadline and an optional site. It then displays the workers, least
+ * loaded first or only those on shift at the site until the deadline,
+ * and asks for one of them (or 0 to pick the least-loaded one) before
+ * inserting the task into the database.
  *
- * @param db Pointer to the SQLite database connection.
+ * @param service EHS operations, local or over ehsd.
  */
-void Manager::assignTask(sqlite3* db) {
-    sqlite3_stmt* stmt = nullptr;
+void Manager::assignTask(Service& service) {
     int workerId;
-    std::string task, username;
+    std::string task;
 
-    // Show list of workers
-    std::cout << "\n--- Available Workers ---\n";
-    const char* queryWorkers = "SELECT id, username FROM users WHERE role = 'worker';";
-    if (sqlite3_prepare_v2(db, queryWorkers, -1, &stmt, nullptr) == SQLITE_OK) {
-        while (sqlite3_step(stmt) == SQLITE_ROW) {
-            int id = sqlite3_column_int(stmt, 0);
-            const char* uname = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 1));
-            std::cout << "ID: " << id << " | Username: " << uname << "\n";
+    // Task description input
+    std::cout << "\nEnter task description: ";
+    std::getline(std::cin, task);
+
+    std::string text;
+    int priority = 2;
+    while (true) {
+        std::cout << "Priority (high, normal, low; empty for normal): ";
+        std::getline(std::cin, text);
+        if (text.empty() || core::parsePriority(text, priority)) {
+            break;
+        }
+        std::cout << "Invalid priority. Please try again.\n";
+    }
+
+    sqlite3_int64 dueAt = 0;
+    while (true) {
+        std::cout << "Due (YYYY-MM-DD HH:MM, empty for no deadline): ";
+        std::getline(std::cin, text);
+        if (text.empty() || core::parseLocalTime(text, dueAt)) {
+            break;
+        }
+        std::cout << "Invalid time. Please try again.\n";
+    }
+
+    std::string site;
+    std::cout << "Site (empty for any): ";
+    std::getline(std::cin, site);
+
+    // Show the candidates: those on shift at the site between now and the deadline, or everyone, least loaded first
+    std::vector<int> onShift;
+    if (!site.empty()) {
+        sqlite3_int64 now = std::time(nullptr);
+        core::Rows<core::ShiftRecord> shifts = service.listOnShift(site, now, dueAt > now ? dueAt : now + 1);
+        if (!shifts.ok) {
+            std::cout << shifts.error << "\n";
+            return;
+        }
+        std::cout << "\n--- On Shift at " << site << " ---\n";
+        for (const core::ShiftRecord& shift : shifts.rows) {
+            std::cout << "ID: " << shift.workerId << " | Username: " << shift.workerUsername << " | Shift: "
+                      << core::formatLocalTime(shift.startsAt) << " - " << core::formatLocalTime(shift.endsAt) << "\n";
+            onShift.push_back(shift.workerId);
+        }
+        if (onShift.empty()) {
+            std::cout << "No worker is on shift at " << site << " then.\n";
+            return;
+        }
+    } else {
+        std::cout << "\n--- Available Workers ---\n";
+        core::Rows<core::WorkerLoad> workers = service.listWorkerLoads();
+        for (const core::WorkerLoad& worker : workers.rows) {
+            std::cout << "ID: " << worker.workerId << " | Username: " << worker.username << " | Open tasks: "
+                      << worker.openTasks << " | Weight: " << worker.weight << "%"
+                      << (worker.available ? "" : " | Unavailable") << "\n";
         }
     }
-    sqlite3_finalize(stmt);
     std::cout << "\n";
 
     // Input validation for worker ID
     while (true) {
-        std::cout << "Enter worker ID (non-negative number): ";
+        std::cout << "Enter worker ID (0 for the least-loaded available worker): ";
         std::cin >> workerId;
         std::cout << "\n";
     
@@ -63,38 +120,140 @@ void Manager::assignTask(sqlite3* db) {
         }
     }
 
-    // Task description input
-    std::cout << "Enter task description: ";
-    std::getline(std::cin, task);
+    // Insert task into the database
+    if (workerId == 0) {
+        core::Rows<core::TaskRecord> assigned = service.autoAssignTasks({task}, dueAt, priority, site);
+        if (assigned.ok) {
+            std::cout << "Task assigned to " << assigned.rows[0].workerUsername << ".\n";
+        } else {
+            std::cout << assigned.error << "\n";
+        }
+        return;
+    }
+    if (!site.empty() && std::find(onShift.begin(), onShift.end(), workerId) == onShift.end()) {
+        std::cout << "Worker " << workerId << " is not on shift at " << site << " then.\n";
+        return;
+    }
+    core::Result result = service.assignTask(workerId, task, dueAt, priority);
+    if (result.ok) {
+        std::cout << "Task assigned successfully.\n";
+    } else {
+        std::cout << result.error << "\n";
+    }
+}
 
-    // Fetch username for the worker
-    const char* getUserSql = "SELECT username FROM users WHERE id = ?;";
-    if (sqlite3_prepare_v2(db, getUserSql, -1, &stmt, nullptr) == SQLITE_OK) {
-        sqlite3_bind_int(stmt, 1, workerId);
-        if (sqlite3_step(stmt) == SQLITE_ROW) {
-            username = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 0));
+/**
+ * @brief Hands a list of tasks to the least-loaded available workers.
+ *
+ * Reads one description per line until an empty line, then one priority,
+ * deadline and site for all of them.
+ *
+ * @param service EHS operations, local or over ehsd.
+ */
+void Manager::autoAssignTasks(Service& service) {
+    std::vector<std::string> tasks;
+    std::string text;
+    std::cout << "\nEnter task descriptions, one per line; an empty line ends the list:\n";
+    while (std::getline(std::cin, text) && !text.empty()) {
+        tasks.push_back(text);
+    }
+    if (tasks.empty()) {
+        std::cout << "No tasks entered.\n";
+        return;
+    }
+
+    int priority = 2;
+    while (true) {
+        std::cout << "Priority (high, normal, low; empty for normal): ";
+        std::getline(std::cin, text);
+        if (text.empty() || core::parsePriority(text, priority)) {
+            break;
+        }
+        std::cout << "Invalid priority. Please try again.\n";
+    }
+
+    sqlite3_int64 dueAt = 0;
+    while (true) {
+        std::cout << "Due (YYYY-MM-DD HH:MM, empty for no deadline): ";
+        std::getline(std::cin, text);
+        if (text.empty() || core::parseLocalTime(text, dueAt)) {
+            break;
+        }
+        std::cout << "Invalid time. Please try again.\n";
+    }
+
+    std::string site;
+    std::cout << "Site, to assign only workers on shift there until the deadline (empty for any): ";
+    std::getline(std::cin, site);
+
+    core::Rows<core::TaskRecord> assigned = service.autoAssignTasks(tasks, dueAt, priority, site);
+    if (!assigned.ok) {
+        std::cout << assigned.error << "\n";
+        return;
+    }
+    const size_t shown = 20;
+    for (size_t i = 0; i < assigned.rows.size() && i < shown; ++i) {
+        std::cout << "Task " << assigned.rows[i].id << " -> " << assigned.rows[i].workerUsername << " | "
+                  << assigned.rows[i].description << "\n";
+    }
+    if (assigned.rows.size() > shown) {
+        std::cout << "... and " << assigned.rows.size() - shown << " more.\n";
+    }
+    std::cout << assigned.rows.size() << " tasks assigned.\n";
+}
+
+/**
+ * @brief Takes a worker in or out of auto-assignment and sets their share of tasks.
+ *
+ * @param service EHS operations, local or over ehsd.
+ */
+void Manager::setWorkerAvailability(Service& service) {
+    int workerId;
+    while (true) {
+        std::cout << "\nEnter worker ID (non-negative number): ";
+        std::cin >> workerId;
+        if (std::cin.fail() || workerId < 0) {
+            std::cin.clear();
+            std::cin.ignore(10000, '\n');
+            std::cout << "Invalid input. Please try again.\n";
         } else {
-            std::cout << "Worker not found.\n";
-            sqlite3_finalize(stmt);
-            return;
+            std::cin.ignore();
+            break;
         }
     }
-    sqlite3_finalize(stmt);
 
-    // Insert task into the database
-    const char* insertSql = "INSERT INTO tasks (worker_id, worker_username, task_description, status) VALUES (?, ?, ?, 'pending');";
-    if (sqlite3_prepare_v2(db, insertSql, -1, &stmt, nullptr) == SQLITE_OK) {
-        sqlite3_bind_int(stmt, 1, workerId);
-        sqlite3_bind_text(stmt, 2, username.c_str(), -1, SQLITE_STATIC);
-        sqlite3_bind_text(stmt, 3, task.c_str(), -1, SQLITE_STATIC);
-
-        if (sqlite3_step(stmt) == SQLITE_DONE) {
-            std::cout << "Task assigned successfully.\n";
+    std::string text;
+    bool available = true;
+    while (true) {
+        std::cout << "Available for auto-assigned tasks? (y/n): ";
+        std::getline(std::cin, text);
+        if (text == "y" || text == "n") {
+            available = text == "y";
+            break;
+        }
+        std::cout << "Please answer y or n.\n";
+    }
+
+    int weight;
+    while (true) {
+        std::cout << "Weight, percent of a full share (1-1000, 0 to keep the current one): ";
+        std::cin >> weight;
+        if (std::cin.fail() || weight < 0 || weight > 1000) {
+            std::cin.clear();
+            std::cin.ignore(10000, '\n');
+            std::cout << "Invalid input. Please try again.\n";
         } else {
-            std::cout << "Failed to assign task.\n";
+            std::cin.ignore();
+            break;
         }
     }
-    sqlite3_finalize(stmt);
+
+    core::Result result = service.setWorkerAvailability(workerId, available, weight);
+    if (result.ok) {
+        std::cout << "Worker availability updated.\n";
+    } else {
+        std::cout << result.error << "\n";
+    }
 }
 
 /**
@@ -103,25 +262,19 @@ void Manager::assignTask(sqlite3* db) {
  * Lists all pending tasks, allows the manager to select a task,
  * and records the violation details along with the updated task status.
  *
- * @param db Pointer to the SQLite database connection.
+ * @param service EHS operations, local or over ehsd.
  */
-void Manager::reportViolation(sqlite3* db) {
-    sqlite3_stmt* stmt = nullptr;
+void Manager::reportViolation(Service& service) {
     int taskId;
     std::string comment, status;
 
     // Display all pending tasks
     std::cout << "\n--- Assigned Tasks ---\n";
-    const char* getTasks = "SELECT id, worker_username, task_description FROM tasks WHERE status = 'pending';";
-    if (sqlite3_prepare_v2(db, getTasks, -1, &stmt, nullptr) == SQLITE_OK) {
-        while (sqlite3_step(stmt) == SQLITE_ROW) {
-            int id = sqlite3_column_int(stmt, 0);
-            const char* user = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 1));
-            const char* desc = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 2));
-            std::cout << "Task ID: " << id << " | Assigned To: " << user << "\nDescription: " << desc << "\n------------------------\n";
-        }
+    core::Rows<core::TaskRecord> tasks = service.listTasksByStatus("pending");
+    for (const core::TaskRecord& task : tasks.rows) {
+        std::cout << "Task ID: " << task.id << " | Assigned To: " << task.workerUsername
+                  << "\nDescription: " << task.description << "\n------------------------\n";
     }
-    sqlite3_finalize(stmt);
 
     // Input validation for task ID
     while (true) {
@@ -159,28 +312,16 @@ void Manager::reportViolation(sqlite3* db) {
         }
     }
 
-    // Get current timestamp
-    time_t now = time(0);
-    std::string timestamp = ctime(&now);
-    if (!timestamp.empty() && timestamp.back() == '\n') {
-        timestamp.pop_back();
-    }
+    std::cout << "Enter violation comment: ";
+    std::getline(std::cin, comment);
 
     // Update task with violation details
-    const char* updateSql = "UPDATE tasks SET status = ?, violation_comment = ?, violation_timestamp = ? WHERE id = ?;";
-    if (sqlite3_prepare_v2(db, updateSql, -1, &stmt, nullptr) == SQLITE_OK) {
-        sqlite3_bind_text(stmt, 1, status.c_str(), -1, SQLITE_STATIC);
-        sqlite3_bind_text(stmt, 2, comment.c_str(), -1, SQLITE_STATIC);
-        sqlite3_bind_text(stmt, 3, timestamp.c_str(), -1, SQLITE_STATIC);
-        sqlite3_bind_int(stmt, 4, taskId);
-
-        if (sqlite3_step(stmt) == SQLITE_DONE) {
-            std::cout << "Task updated with violation info.\n";
-        } else {
-            std::cout << "Failed to update task.\n";
-        }
+    core::Result result = service.reportViolation(taskId, status, comment);
+    if (result.ok) {
+        std::cout << "Task updated with violation info.\n";
+    } else {
+        std::cout << result.error << "\n";
     }
-    sqlite3_finalize(stmt);
 }
 
 /**
@@ -189,9 +330,9 @@ void Manager::reportViolation(sqlite3* db) {
  * Prompts the manager for a safety rule text and inserts it into
  * the rules table in the database with the current timestamp.
  *
- * @param db Pointer to the SQLite database connection.
+ * @param service EHS operations, local or over ehsd.
  */
-void Manager::addRule(sqlite3* db) {
+void Manager::addRule(Service& service) {
     std::string rule;
     while (true) {
         std::cout << "Enter the new safety rule: ";
@@ -204,32 +345,13 @@ void Manager::addRule(sqlite3* db) {
         }
     }
 
-    // Get current timestamp
-    std::time_t now = std::time(nullptr);
-    char timestamp[100];
-    std::strftime(timestamp, sizeof(timestamp), "%Y-%m-%d %H:%M:%S", std::localtime(&now));
-
     // Insert rule into the database
-    std::string query = "INSERT INTO rules (rule_text, timestamp) VALUES (?, ?);";
-    sqlite3_stmt* stmt;
-    int rc = sqlite3_prepare_v2(db, query.c_str(), -1, &stmt, 0);
-
-    if (rc != SQLITE_OK) {
-        std::cerr << "SQL error: " << sqlite3_errmsg(db) << std::endl;
-        return;
-    }
-
-    sqlite3_bind_text(stmt, 1, rule.c_str(), -1, SQLITE_STATIC);
-    sqlite3_bind_text(stmt, 2, timestamp, -1, SQLITE_STATIC);
-
-    rc = sqlite3_step(stmt);
-    if (rc != SQLITE_DONE) {
-        std::cerr << "Execution failed: " << sqlite3_errmsg(db) << std::endl;
+    core::Result result = service.addRule(rule);
+    if (!result.ok) {
+        logging::error("{}", result.error);
     } else {
         std::cout << "New rule added successfully.\n";
     }
-
-    sqlite3_finalize(stmt);
 }
 
 /**
@@ -238,25 +360,20 @@ void Manager::addRule(sqlite3* db) {
  * Displays all rules and allows the manager to select a rule ID
  * to delete from the database.
  *
- * @param db Pointer to the SQLite database connection.
+ * @param service EHS operations, local or over ehsd.
  */
-void Manager::deleteRule(sqlite3* db) {
+void Manager::deleteRule(Service& service) {
     // Display all rules
-    const char* listSql = "SELECT id, rule_text FROM rules;";
-    sqlite3_stmt* listStmt;
-
-    if (sqlite3_prepare_v2(db, listSql, -1, &listStmt, nullptr) != SQLITE_OK) {
-        std::cerr << "Failed to retrieve rules: " << sqlite3_errmsg(db) << "\n";
+    core::Rows<core::RuleRecord> rules = service.listRules();
+    if (!rules.ok) {
+        logging::error("Failed to retrieve rules: {}", rules.error);
         return;
     }
 
     std::cout << "\n--- Existing Rules ---\n";
-    while (sqlite3_step(listStmt) == SQLITE_ROW) {
-        int id = sqlite3_column_int(listStmt, 0);
-        const unsigned char* ruleText = sqlite3_column_text(listStmt, 1);
-        std::cout << "ID: " << id << " | Rule: " << ruleText << '\n';
+    for (const core::RuleRecord& rule : rules.rows) {
+        std::cout << "ID: " << rule.id << " | Rule: " << rule.text << '\n';
     }
-    sqlite3_finalize(listStmt);
 
     // Input validation for rule ID
     int ruleId;
@@ -274,23 +391,12 @@ void Manager::deleteRule(sqlite3* db) {
     std::cin.ignore();
 
     // Delete rule from database
-    const char* deleteSql = "DELETE FROM rules WHERE id = ?;";
-    sqlite3_stmt* delStmt;
-
-    if (sqlite3_prepare_v2(db, deleteSql, -1, &delStmt, nullptr) != SQLITE_OK) {
-        std::cout << "Couldn't prepare the delete statement.\n";
-        return;
-    }
-
-    sqlite3_bind_int(delStmt, 1, ruleId);
-
-    if (sqlite3_step(delStmt) == SQLITE_DONE) {
+    core::Result result = service.deleteRule(ruleId);
+    if (result.ok) {
         std::cout << "Rule deleted successfully.\n";
     } else {
-        std::cout << "Failed to delete rule.\n";
+        std::cout << result.error << "\n";
     }
-
-    sqlite3_finalize(delStmt);
 }
 
 /**
@@ -299,26 +405,20 @@ void Manager::deleteRule(sqlite3* db) {
  * Displays all tasks and allows the manager to select a task ID
  * to delete from the database.
  *
- * @param db Pointer to the SQLite database connection.
+ * @param service EHS operations, local or over ehsd.
  */
-void Manager::deleteTask(sqlite3* db) {
+void Manager::deleteTask(Service& service) {
     // Display all tasks
-    const char* listSql = "SELECT id, task_description, worker_username FROM tasks;";
-    sqlite3_stmt* listStmt;
-
-    if (sqlite3_prepare_v2(db, listSql, -1, &listStmt, nullptr) != SQLITE_OK) {
-        std::cerr << "Failed to retrieve tasks: " << sqlite3_errmsg(db) << "\n";
+    core::Rows<core::TaskRecord> tasks = service.listTasks(-1);
+    if (!tasks.ok) {
+        logging::error("Failed to retrieve tasks: {}", tasks.error);
         return;
     }
 
     std::cout << "\n--- Existing Tasks ---\n";
-    while (sqlite3_step(listStmt) == SQLITE_ROW) {
-        int id = sqlite3_column_int(listStmt, 0);
-        const unsigned char* taskDescription = sqlite3_column_text(listStmt, 1);
-        const unsigned char* workerUsername = sqlite3_column_text(listStmt, 2);
-        std::cout << "ID: " << id << " | Worker: " << workerUsername << " | Task: " << taskDescription << '\n';
+    for (const core::TaskRecord& task : tasks.rows) {
+        std::cout << "ID: " << task.id << " | Worker: " << task.workerUsername << " | Task: " << task.description << '\n';
     }
-    sqlite3_finalize(listStmt);
 
     // Input validation for task ID
     int taskId;
@@ -336,21 +436,338 @@ void Manager::deleteTask(sqlite3* db) {
     std::cin.ignore();
 
     // Delete task from database
-    const char* deleteSql = "DELETE FROM tasks WHERE id = ?;";
-    sqlite3_stmt* delStmt;
+    core::Result result = service.deleteTask(taskId);
+    if (result.ok) {
+        std::cout << "Task deleted successfully.\n";
+    } else {
+        std::cout << result.error << "\n";
+    }
+}
+
+/**
+ * @brief Creates a recurring task.
+ *
+ * Shows the workers, then prompts for the worker ID, the task description,
+ * the interval and the first due time (empty for now).
+ *
+ * @param service EHS operations, local or over ehsd.
+ */
+void Manager::addSchedule(Service& service) {
+    std::cout << "\n--- Available Workers ---\n";
+    core::Rows<core::WorkerRecord> workers = service.listWorkers();
+    for (const core::WorkerRecord& worker : workers.rows) {
+        std::cout << "ID: " << worker.id << " | Username: " << worker.username << "\n";
+    }
+
+    int workerId;
+    while (true) {
+        std::cout << "\nEnter worker ID (non-negative number): ";
+        std::cin >> workerId;
+        if (std::cin.fail() || workerId < 0) {
+            std::cin.clear();
+            std::cin.ignore(10000, '\n');
+            std::cout << "Invalid input. Please try again.\n";
+        } else {
+            std::cin.ignore();
+            break;
+        }
+    }
+
+    std::string task;
+    std::cout << "Enter task description: ";
+    std::getline(std::cin, task);
+
+    std::string text;
+    sqlite3_int64 interval = 0;
+    while (true) {
+        std::cout << "Repeat every (hourly, daily, weekly, or e.g. 30m, 12h, 2d, 1w): ";
+        std::getline(std::cin, text);
+        if (core::parseInterval(text, interval)) {
+            break;
+        }
+        std::cout << "Invalid interval. Please try again.\n";
+    }
 
-    if (sqlite3_prepare_v2(db, deleteSql, -1, &delStmt, nullptr) != SQLITE_OK) {
-        std::cout << "Couldn't prepare the delete statement.\n";
+    sqlite3_int64 firstDue = std::time(nullptr);
+    while (true) {
+        std::cout << "First due (YYYY-MM-DD HH:MM, empty for now): ";
+        std::getline(std::cin, text);
+        if (text.empty() || core::parseLocalTime(text, firstDue)) {
+            break;
+        }
+        std::cout << "Invalid time. Please try again.\n";
+    }
+
+    core::Result result = service.addSchedule(workerId, task, interval, firstDue);
+    if (result.ok) {
+        std::cout << "Recurring task " << result.id << " created; first due " << core::formatLocalTime(firstDue)
+                  << ".\n";
+    } else {
+        std::cout << result.error << "\n";
+    }
+}
+
+/**
+ * @brief Lists recurring tasks with their interval and next due time.
+ *
+ * @param service EHS operations, local or over ehsd.
+ */
+void Manager::viewSchedules(Service& service) {
+    core::Rows<core::ScheduleRecord> schedules = service.listSchedules();
+    if (!schedules.ok) {
+        logging::error("Failed to retrieve recurring tasks: {}", schedules.error);
         return;
     }
 
-    sqlite3_bind_int(delStmt, 1, taskId);
+    std::cout << "\n--- Recurring Tasks ---\n";
+    for (const core::ScheduleRecord& schedule : schedules.rows) {
+        std::cout << "ID: " << schedule.id << " | Worker: " << schedule.workerUsername << " | Every "
+                  << schedule.intervalSeconds / 60 << " min | Next due: " << core::formatLocalTime(schedule.nextDue)
+                  << "\nTask: " << schedule.description << "\n------------------------\n";
+    }
+}
 
-    if (sqlite3_step(delStmt) == SQLITE_DONE) {
-        std::cout << "Task deleted successfully.\n";
+/**
+ * @brief Deletes a recurring task.
+ *
+ * Displays the recurring tasks and allows the manager to select one by ID.
+ *
+ * @param service EHS operations, local or over ehsd.
+ */
+void Manager::deleteSchedule(Service& service) {
+    viewSchedules(service);
+
+    int scheduleId;
+    while (true) {
+        std::cout << "\nEnter recurring task ID to delete: ";
+        std::cin >> scheduleId;
+        if (std::cin.fail() || scheduleId < 0) {
+            std::cin.clear();
+            std::cin.ignore(10000, '\n');
+            std::cout << "Invalid input. ID must be a non-negative number.\n";
+        } else {
+            break;
+        }
+    }
+    std::cin.ignore();
+
+    core::Result result = service.deleteSchedule(scheduleId);
+    if (result.ok) {
+        std::cout << "Recurring task deleted successfully.\n";
     } else {
-        std::cout << "Failed to delete task.\n";
+        std::cout << result.error << "\n";
     }
+}
 
-    sqlite3_finalize(delStmt);
+/**
+ * @brief Lists open tasks past their deadline, most urgent first, a page at a time.
+ *
+ * @param service EHS operations, local or over ehsd.
+ */
+void Manager::viewOverdue(Service& service) {
+    const int pageSize = 20;
+    int lastPriority = 0;
+    sqlite3_int64 lastDue = 0;
+    int lastId = 0;
+    std::time_t now = std::time(nullptr);
+
+    std::cout << "\n--- Overdue Tasks ---\n";
+    while (true) {
+        core::Rows<core::TaskRecord> page = service.listOverdue(lastPriority, lastDue, lastId, pageSize);
+        if (!page.ok) {
+            logging::error("Failed to retrieve overdue tasks: {}", page.error);
+            return;
+        }
+
+        for (const core::TaskRecord& task : page.rows) {
+            lastPriority = task.priority;
+            lastDue = task.dueAt;
+            lastId = task.id;
+            sqlite3_int64 hours = (now - task.dueAt) / 3600;
+            std::string late = hours < 48 ? std::to_string(hours) + " h" : std::to_string(hours / 24) + " days";
+            std::cout << "ID: " << task.id << " | Worker: " << task.workerUsername << " | Priority: "
+                      << core::priorityName(task.priority) << " | Due: " << core::formatLocalTime(task.dueAt) << " ("
+                      << late << " late) | Status: " << task.status
+                      << "\nTask: " << task.description << "\n------------------------\n";
+        }
+
+        if (page.rows.empty()) {
+            std::cout << "No more overdue tasks.\n";
+            break;
+        }
+        if (static_cast<int>(page.rows.size()) < pageSize) {
+            break;
+        }
+
+        std::string more;
+        std::cout << "Press Enter for more, or q to stop: ";
+        std::getline(std::cin, more);
+        if (!more.empty()) {
+            break;
+        }
+    }
+}
+
+/**
+ * @brief Adds a shift to a worker's calendar.
+ *
+ * @param service EHS operations, local or over ehsd.
+ */
+void Manager::addShift(Service& service) {
+    int workerId;
+    while (true) {
+        std::cout << "\nEnter worker ID (non-negative number): ";
+        std::cin >> workerId;
+        if (std::cin.fail() || workerId < 0) {
+            std::cin.clear();
+            std::cin.ignore(10000, '\n');
+            std::cout << "Invalid input. Please try again.\n";
+        } else {
+            std::cin.ignore();
+            break;
+        }
+    }
+
+    std::string site;
+    std::cout << "Enter site: ";
+    std::getline(std::cin, site);
+
+    std::string text;
+    sqlite3_int64 startsAt = 0;
+    while (true) {
+        std::cout << "Starts (YYYY-MM-DD HH:MM): ";
+        std::getline(std::cin, text);
+        if (core::parseLocalTime(text, startsAt)) {
+            break;
+        }
+        std::cout << "Invalid time. Please try again.\n";
+    }
+
+    sqlite3_int64 endsAt = 0;
+    while (true) {
+        std::cout << "Ends (YYYY-MM-DD HH:MM, at most 24 hours later): ";
+        std::getline(std::cin, text);
+        if (core::parseLocalTime(text, endsAt)) {
+            break;
+        }
+        std::cout << "Invalid time. Please try again.\n";
+    }
+
+    core::Result result = service.addShift(workerId, site, startsAt, endsAt);
+    if (result.ok) {
+        std::cout << "Shift " << result.id << " added.\n";
+    } else {
+        std::cout << result.error << "\n";
+    }
+}
+
+/**
+ * @brief Lists a worker's shifts that have not ended yet.
+ *
+ * @param service EHS operations, local or over ehsd.
+ */
+void Manager::viewShifts(Service& service) {
+    int workerId;
+    while (true) {
+        std::cout << "\nEnter worker ID (non-negative number): ";
+        std::cin >> workerId;
+        if (std::cin.fail() || workerId < 0) {
+            std::cin.clear();
+            std::cin.ignore(10000, '\n');
+            std::cout << "Invalid input. Please try again.\n";
+        } else {
+            std::cin.ignore();
+            break;
+        }
+    }
+
+    core::Rows<core::ShiftRecord> shifts = service.listShifts(workerId);
+    if (!shifts.ok) {
+        logging::error("Failed to retrieve shifts: {}", shifts.error);
+        return;
+    }
+
+    std::cout << "\n--- Shifts ---\n";
+    for (const core::ShiftRecord& shift : shifts.rows) {
+        std::cout << "ID: " << shift.id << " | Site: " << shift.site << " | " << core::formatLocalTime(shift.startsAt)
+                  << " - " << core::formatLocalTime(shift.endsAt) << "\n";
+    }
+    if (shifts.rows.empty()) {
+        std::cout << "No upcoming shifts.\n";
+    }
+}
+
+/**
+ * @brief Deletes a shift.
+ *
+ * @param service EHS operations, local or over ehsd.
+ */
+void Manager::deleteShift(Service& service) {
+    int shiftId;
+    while (true) {
+        std::cout << "\nEnter shift ID to delete: ";
+        std::cin >> shiftId;
+        if (std::cin.fail() || shiftId < 0) {
+            std::cin.clear();
+            std::cin.ignore(10000, '\n');
+            std::cout << "Invalid input. Please try again.\n";
+        } else {
+            std::cin.ignore();
+            break;
+        }
+    }
+
+    core::Result result = service.deleteShift(shiftId);
+    if (result.ok) {
+        std::cout << "Shift deleted successfully.\n";
+    } else {
+        std::cout << result.error << "\n";
+    }
+}
+
+/**
+ * @brief Lists who is on shift at a site during a time window.
+ *
+ * @param service EHS operations, local or over ehsd.
+ */
+void Manager::viewOnShift(Service& service) {
+    std::string site;
+    std::cout << "\nEnter site: ";
+    std::getline(std::cin, site);
+
+    std::string text;
+    sqlite3_int64 from = std::time(nullptr);
+    while (true) {
+        std::cout << "From (YYYY-MM-DD HH:MM, empty for now): ";
+        std::getline(std::cin, text);
+        if (text.empty() || core::parseLocalTime(text, from)) {
+            break;
+        }
+        std::cout << "Invalid time. Please try again.\n";
+    }
+
+    sqlite3_int64 to = from + 1;
+    while (true) {
+        std::cout << "To (YYYY-MM-DD HH:MM, empty for the same instant): ";
+        std::getline(std::cin, text);
+        if (text.empty() || core::parseLocalTime(text, to)) {
+            break;
+        }
+        std::cout << "Invalid time. Please try again.\n";
+    }
+
+    core::Rows<core::ShiftRecord> shifts = service.listOnShift(site, from, to);
+    if (!shifts.ok) {
+        logging::error("Failed to retrieve shifts: {}", shifts.error);
+        return;
+    }
+
+    std::cout << "\n--- On Shift at " << site << " ---\n";
+    for (const core::ShiftRecord& shift : shifts.rows) {
+        std::cout << "Worker ID: " << shift.workerId << " | Username: " << shift.workerUsername << " | "
+                  << core::formatLocalTime(shift.startsAt) << " - " << core::formatLocalTime(shift.endsAt) << "\n";
+    }
+    if (shifts.rows.empty()) {
+        std::cout << "No one is on shift then.\n";
+    }
 }
@@ -14,6 +14,9 @@
  * - Report safety violations
  * - Add or delete safety rules
  * - Delete tasks
+ * - Create and delete recurring tasks
+ * - Auto-assign tasks to the least-loaded workers
+ * - Manage worker shifts
  */
 class Manager : public User {
  public:
@@ -30,12 +33,14 @@ class Manager : public User {
   /**
    * @brief Assigns a task to a worker.
    *
-   * Displays a list of available workers, prompts the manager
-   * for task details, and inserts the task into the database.
+   * Prompts the manager for task details, priority, deadline and
+   * an optional site, displays the workers least loaded first (or
+   * those on shift at the site until the deadline), and inserts the
+   * task for the one chosen, or for the least-loaded one on 0.
    *
-   * @param db Pointer to the SQLite database connection.
+   * @param service EHS operations, local or over ehsd.
    */
-  void assignTask(sqlite3* db);
+  void assignTask(Service& service);
 
   /**
    * @brief Reports a safety violation associated with a task.
@@ -43,36 +48,110 @@ class Manager : public User {
    * Lists assigned tasks, allows selection, and records a violation
    * in the task entry with updated status.
    *
-   * @param db Pointer to the SQLite database connection.
+   * @param service EHS operations, local or over ehsd.
    */
-  void reportViolation(sqlite3* db);
+  void reportViolation(Service& service);
 
   /**
    * @brief Adds a new safety rule to the system.
    *
    * Prompts the manager for rule text and inserts it into the database.
    *
-   * @param db Pointer to the SQLite database connection.
+   * @param service EHS operations, local or over ehsd.
    */
-  void addRule(sqlite3* db);
+  void addRule(Service& service);
 
   /**
    * @brief Deletes an existing safety rule.
    *
    * Displays all rules and allows the manager to delete by rule ID.
    *
-   * @param db Pointer to the SQLite database connection.
+   * @param service EHS operations, local or over ehsd.
    */
-  void deleteRule(sqlite3* db);
+  void deleteRule(Service& service);
 
   /**
    * @brief Deletes an existing task.
    *
    * Displays all tasks and allows the manager to delete by task ID.
    *
-   * @param db Pointer to the SQLite database connection.
+   * @param service EHS operations, local or over ehsd.
    */
-  void deleteTask(sqlite3* db);
+  void deleteTask(Service& service);
+
+  /**
+   * @brief Creates a recurring task.
+   *
+   * Prompts for the worker, the description, the interval ("daily", "12h",
+   * ...) and the first due time; the scheduler creates a task each time it
+   * falls due.
+   *
+   * @param service EHS operations, local or over ehsd.
+   */
+  void addSchedule(Service& service);
+
+  /**
+   * @brief Lists recurring tasks with their next due time.
+   *
+   * @param service EHS operations, local or over ehsd.
+   */
+  void viewSchedules(Service& service);
+
+  /**
+   * @brief Deletes a recurring task. Tasks it already created are kept.
+   *
+   * @param service EHS operations, local or over ehsd.
+   */
+  void deleteSchedule(Service& service);
+
+  /**
+   * @brief Lists open tasks past their deadline, high priority and most overdue first.
+   *
+   * @param service EHS operations, local or over ehsd.
+   */
+  void viewOverdue(Service& service);
+
+  /**
+   * @brief Assigns a list of tasks, each to the least-loaded available worker.
+   *
+   * @param service EHS operations, local or over ehsd.
+   */
+  void autoAssignTasks(Service& service);
+
+  /**
+   * @brief Sets whether a worker takes auto-assigned tasks, and their weight.
+   *
+   * @param service EHS operations, local or over ehsd.
+   */
+  void setWorkerAvailability(Service& service);
+
+  /**
+   * @brief Adds a shift at a site to a worker's calendar.
+   *
+   * @param service EHS operations, local or over ehsd.
+   */
+  void addShift(Service& service);
+
+  /**
+   * @brief Lists a worker's shifts that have not ended yet.
+   *
+   * @param service EHS operations, local or over ehsd.
+   */
+  void viewShifts(Service& service);
+
+  /**
+   * @brief Deletes a shift.
+   *
+   * @param service EHS operations, local or over ehsd.
+   */
+  void deleteShift(Service& service);
+
+  /**
+   * @brief Lists who is on shift at a site during a time window.
+   *
+   * @param service EHS operations, local or over ehsd.
+   */
+  void viewOnShift(Service& service);
 };
 
 #endif  // MANAGER_H_
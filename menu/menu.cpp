@@ -0,0 +1,346 @@
+/**
+ * @file menu.cpp
+ * @brief The interactive register/login, worker and manager menus.
+ *
+ * The menus only call the Service interface, so the same code drives the
+ * local database (code.cpp) and the ehsd daemon (client/ehs_client.cpp).
+ *
+ */
+
+#include "menu.h"
+#include "../manager/manager.h"
+#include "../worker/worker.h"
+#include "../user/user.h"
+#include "../logging/logging.h"
+#include "../metrics/metrics.h"
+#include "../trace/trace.h"
+#include <iostream>
+#include <string>
+
+namespace {
+
+void handleSearch(Service& service, User& u, int userId, bool isManager) {
+    std::string query;
+    std::cout << "Enter search terms: ";
+    std::getline(std::cin, query);
+    if (query.empty()) {
+        std::cout << "Search terms cannot be empty.\n";
+        return;
+    }
+    u.searchRecords(service, query, userId, isManager);
+}
+
+void handleWorkerMenu(Service& service, int userId) {
+    static const metrics::OperationId menuOps[] = {
+        metrics::operation("menu.worker.logout"), metrics::operation("menu.worker.view_tasks"),
+        metrics::operation("menu.worker.report_task"), metrics::operation("menu.worker.view_rules"),
+        metrics::operation("menu.worker.give_feedback"), metrics::operation("menu.worker.view_feedback"),
+        metrics::operation("menu.worker.search"), metrics::operation("menu.worker.task_history")};
+    static const char* const menuSpans[] = {"menu.worker.logout", "menu.worker.view_tasks",
+                                            "menu.worker.report_task", "menu.worker.view_rules",
+                                            "menu.worker.give_feedback", "menu.worker.view_feedback",
+                                            "menu.worker.search", "menu.worker.task_history"};
+    Worker w;
+    int choice;
+
+    do {
+        std::cout << "\n--- Worker Menu ---\n";
+        std::cout << "1. View Assigned Tasks\n";
+        std::cout << "2. Report Task Work\n";
+        std::cout << "3. View Safety Rules\n";
+        std::cout << "4. Give Feedback for Rules\n";
+        std::cout << "5. View Feedback of Rules\n";
+        std::cout << "6. Search Rules and Tasks\n";
+        std::cout << "7. View Task History (including archived)\n";
+        std::cout << "0. Logout\n";
+        std::cout << "Enter choice: ";
+        std::cin >> choice;
+        std::cin.ignore();
+
+        metrics::ScopedLatency timer(choice >= 0 && choice <= 7 ? menuOps[choice] : -1);
+        trace::Span span(choice >= 0 && choice <= 7 ? menuSpans[choice] : nullptr, "menu");
+        switch (choice) {
+            case 1:
+                w.viewTaskDetails(service, userId);
+                break;
+            case 2:
+                w.reportTaskWork(service, userId);
+                break;
+            case 3:
+                w.viewRules(service);
+                break;
+            case 4:
+                w.GiveRuleFeedback(service, userId);
+                break;
+            case 5:
+                w.ViewRuleFeedback(service);
+                break;
+            case 6:
+                handleSearch(service, w, userId, false);
+                break;
+            case 7:
+                w.viewTaskDetails(service, userId, false, true);
+                break;
+            case 0:
+                std::cout << "Logging out...\n";
+                break;
+            default:
+                std::cout << "Invalid choice!\n";
+        }
+    } while (choice != 0);
+}
+
+void handleManagerMenu(Service& service) {
+    static const metrics::OperationId menuOps[] = {
+        metrics::operation("menu.manager.logout"), metrics::operation("menu.manager.assign_task"),
+        metrics::operation("menu.manager.report_violation"), metrics::operation("menu.manager.view_rules"),
+        metrics::operation("menu.manager.add_rule"), metrics::operation("menu.manager.view_feedback"),
+        metrics::operation("menu.manager.view_tasks"), metrics::operation("menu.manager.delete_task"),
+        metrics::operation("menu.manager.delete_rule"), metrics::operation("menu.manager.search"),
+        metrics::operation("menu.manager.dump_metrics"), metrics::operation("menu.manager.export_trace"),
+        metrics::operation("menu.manager.task_history"), metrics::operation("menu.manager.add_schedule"),
+        metrics::operation("menu.manager.view_schedules"), metrics::operation("menu.manager.delete_schedule"),
+        metrics::operation("menu.manager.view_overdue"), metrics::operation("menu.manager.auto_assign"),
+        metrics::operation("menu.manager.set_availability"), metrics::operation("menu.manager.add_shift"),
+        metrics::operation("menu.manager.view_shifts"), metrics::operation("menu.manager.delete_shift"),
+        metrics::operation("menu.manager.view_on_shift")};
+    static const char* const menuSpans[] = {"menu.manager.logout", "menu.manager.assign_task",
+                                            "menu.manager.report_violation", "menu.manager.view_rules",
+                                            "menu.manager.add_rule", "menu.manager.view_feedback",
+                                            "menu.manager.view_tasks", "menu.manager.delete_task",
+                                            "menu.manager.delete_rule", "menu.manager.search",
+                                            "menu.manager.dump_metrics", "menu.manager.export_trace",
+                                            "menu.manager.task_history", "menu.manager.add_schedule",
+                                            "menu.manager.view_schedules", "menu.manager.delete_schedule",
+                                            "menu.manager.view_overdue", "menu.manager.auto_assign",
+                                            "menu.manager.set_availability", "menu.manager.add_shift",
+                                            "menu.manager.view_shifts", "menu.manager.delete_shift",
+                                            "menu.manager.view_on_shift"};
+    Manager m;
+    int choice;
+
+    do {
+        std::cout << "\n--- Manager Menu ---\n";
+        std::cout << "1. Assign Task\n";
+        std::cout << "2. Report Violation\n";
+        std::cout << "3. View Rules\n";
+        std::cout << "4. Add Rule\n";
+        std::cout << "5. View Feedback of rules\n";
+        std::cout << "6. View Assigned Tasks\n";
+        std::cout << "7. Delete the task\n";
+        std::cout << "8. Delete rules\n";
+        std::cout << "9. Search Rules and Tasks\n";
+        std::cout << "10. Dump metrics\n";
+        std::cout << "11. Export trace\n";
+        std::cout << "12. View Task History (including archived)\n";
+        std::cout << "13. Add Recurring Task\n";
+        std::cout << "14. View Recurring Tasks\n";
+        std::cout << "15. Delete Recurring Task\n";
+        std::cout << "16. View Overdue Tasks\n";
+        std::cout << "17. Auto-Assign Tasks\n";
+        std::cout << "18. Set Worker Availability\n";
+        std::cout << "19. Add Shift\n";
+        std::cout << "20. View Worker Shifts\n";
+        std::cout << "21. Delete Shift\n";
+        std::cout << "22. Who Is On Shift\n";
+        std::cout << "0. Logout\n";
+        std::cout << "Enter choice: ";
+        std::cin >> choice;
+        std::cin.ignore();
+
+        metrics::ScopedLatency timer(choice >= 0 && choice <= 22 ? menuOps[choice] : -1);
+        trace::Span span(choice >= 0 && choice <= 22 ? menuSpans[choice] : nullptr, "menu");
+        switch (choice) {
+            case 1:
+                m.assignTask(service);
+                break;
+            case 2:
+                m.reportViolation(service);
+                break;
+            case 3:
+                m.viewRules(service);
+                break;
+            case 4:
+                m.addRule(service);
+                break;
+            case 5:
+                m.ViewRuleFeedback(service);
+                break;
+            case 6:
+                m.viewTaskDetails(service, 0, true);
+                break;
+            case 7:
+                m.deleteTask(service);
+                break;
+            case 8:
+                m.deleteRule(service);
+                break;
+            case 9:
+                handleSearch(service, m, 0, true);
+                break;
+            case 10:
+                if (metrics::dump())
+                    std::cout << "Metrics written to " << metrics::dumpPath() << "\n";
+                else
+                    std::cout << "Failed to write metrics to " << metrics::dumpPath() << "\n";
+                break;
+            case 11:
+                if (trace::exportChromeTrace(trace::exportPath()))
+                    std::cout << "Trace written to " << trace::exportPath() << "\n";
+                else
+                    std::cout << "Failed to write trace to " << trace::exportPath() << "\n";
+                break;
+            case 12:
+                m.viewTaskDetails(service, 0, true, true);
+                break;
+            case 13:
+                m.addSchedule(service);
+                break;
+            case 14:
+                m.viewSchedules(service);
+                break;
+            case 15:
+                m.deleteSchedule(service);
+                break;
+            case 16:
+                m.viewOverdue(service);
+                break;
+            case 17:
+                m.autoAssignTasks(service);
+                break;
+            case 18:
+                m.setWorkerAvailability(service);
+                break;
+            case 19:
+                m.addShift(service);
+                break;
+            case 20:
+                m.viewShifts(service);
+                break;
+            case 21:
+                m.deleteShift(service);
+                break;
+            case 22:
+                m.viewOnShift(service);
+                break;
+            case 0:
+                std::cout << "Logging out...\n";
+                break;
+            default:
+                std::cout << "Invalid choice!\n";
+        }
+    } while (choice != 0);
+}
+
+void handleRegistration(Service& service, const std::string& username, const std::string& password) {
+    std::string role;
+    while (true) {
+        std::cout << "Enter role (worker/manager): ";
+        std::getline(std::cin, role);
+        if (role.empty()) {
+            std::cout << "Role cannot be empty. Please enter a valid role.\n";
+        } else if (role != "worker" && role != "manager") {
+            std::cout << "Invalid role. Please enter 'worker' or 'manager'.\n";
+        } else {
+            break;
+        }
+    }
+
+    if (role == "worker") {
+        Worker w;
+        if (w.userExists(service, username, password))
+            std::cout << "User already exists with these credentials!\n";
+        else if (w.registerUser(service, username, password))
+            std::cout << "Registration Successfull!\n";
+        else
+            std::cout << "Registration failed!\n";
+
+    } else if (role == "manager") {
+        Manager m;
+        if (m.userExists(service, username, password))
+            std::cout << "User already exists with these credentials!\n";
+        else if (m.registerUser(service, username, password))
+            std::cout << "Registration Successfull!\n";
+        else
+            std::cout << "Registration failed!\n";
+
+    } else {
+        std::cout << "Invalid role entered!\n";
+    }
+}
+
+void handleLogin(Service& service, const std::string& username, const std::string& password) {
+    // One lookup returns both the role and the user ID
+    core::LoginResult login = service.login(username, password);
+    if (!login.error.empty()) {
+        logging::error("{}", login.error);
+    }
+
+    if (login.ok && (login.role == "worker" || login.role == "manager")) {
+        logging::setSessionContext("user=" + std::to_string(login.userId) + " role=" + login.role);
+        logging::info("Logged in as {}", username);
+        std::cout << "Logged in successfully!\n";
+        if (login.role == "worker")
+            handleWorkerMenu(service, login.userId);
+        else
+            handleManagerMenu(service);
+        service.logout();
+        logging::info("Logged out");
+        logging::setSessionContext("");
+    } else {
+        logging::warn("Failed login for {}", username);
+        std::cout << "Invalid credentials!\n";
+    }
+}
+
+}  // namespace
+
+void runMainMenu(Service& service) {
+    int choice;
+
+    while (true) {
+        std::cout << "\n=== EHS System ===\n";
+        std::cout << "1. Register\n2. Login\n0. Exit\nChoice: ";
+        std::cin >> choice;
+        std::cin.ignore();
+
+        if (choice == 0) {
+            std::cout << "Exiting...\n";
+            break;
+        }
+
+        std::string username, password;
+
+        while (true) {
+            std::cout << "Username: ";
+            std::getline(std::cin, username);
+            if (username.empty()) {
+                std::cout << "Username cannot be empty. Please enter a valid username.\n";
+            } else {
+                break; // Exit the loop if the username is valid
+            }
+        }
+        
+        while (true) {
+            std::cout << "Password: ";
+            std::getline(std::cin, password);
+            if (password.empty()) {
+                std::cout << "Password cannot be empty. Please enter a valid password.\n";
+            } else {
+                break; // Exit the loop if the password is valid
+            }
+        }
+        switch (choice) {
+            case 1:
+                handleRegistration(service, username, password);
+                break;
+            case 2:
+                handleLogin(service, username, password);
+                break;
+            default:
+                std::cout << "Invalid choice!\n";
+                break;
+        }
+    }
+
+}
@@ -0,0 +1,16 @@
+#ifndef MENU_H_
+#define MENU_H_
+
+#include "../service/service.h"
+
+/**
+ * @brief Runs the interactive register/login loop until the user chooses Exit.
+ *
+ * Logged-in users get the worker or manager menu for their role. Every
+ * operation goes through the given service.
+ *
+ * @param service Local database or ehsd connection.
+ */
+void runMainMenu(Service& service);
+
+#endif  // MENU_H_
@@ -0,0 +1,300 @@
+/**
+ * @file metrics.cpp
+ * @brief Thread-local latency histograms and their Prometheus dump.
+ *
+ * Buckets are log-linear: values below 32 ns get one bucket each, larger
+ * values keep their top 5 significant bits, i.e. 16 buckets per power of
+ * two. A percentile is reported as its bucket's upper bound, so it is at
+ * most 1/16 (6.25%) above the true value. Every thread owns one histogram per
+ * operation and is the only writer of it, so recording uses plain relaxed
+ * loads and stores. A dump takes the registry lock, merges the live threads
+ * with the totals of threads that already exited, and formats the result.
+ *
+ */
+
+#include "metrics.h"
+#include <signal.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <array>
+#include <atomic>
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <sstream>
+#include <thread>
+#include <vector>
+
+namespace metrics {
+
+namespace {
+
+const int kMaxOperations = 256;
+const int kSubBucketBits = 5;
+const int kBuckets = (1 << kSubBucketBits) + (64 - kSubBucketBits) * (1 << (kSubBucketBits - 1));
+
+int bucketIndex(uint64_t value) {
+    if (value < (1u << kSubBucketBits)) {
+        return static_cast<int>(value);
+    }
+    int msb = 63 - __builtin_clzll(value);
+    int shift = msb - (kSubBucketBits - 1);
+    int mantissa = static_cast<int>(value >> shift) - (1 << (kSubBucketBits - 1));
+    return (1 << kSubBucketBits) + (shift - 1) * (1 << (kSubBucketBits - 1)) + mantissa;
+}
+
+/// @brief Highest value that falls into a bucket.
+uint64_t bucketUpperBound(int index) {
+    if (index < (1 << kSubBucketBits)) {
+        return static_cast<uint64_t>(index);
+    }
+    int k = index - (1 << kSubBucketBits);
+    int shift = k / (1 << (kSubBucketBits - 1)) + 1;
+    uint64_t mantissa = static_cast<uint64_t>(k % (1 << (kSubBucketBits - 1)) + (1 << (kSubBucketBits - 1)));
+    return ((mantissa + 1) << shift) - 1;
+}
+
+/// @brief Histogram written by exactly one thread and read by the dumper.
+struct ThreadHistogram {
+    std::array<std::atomic<uint64_t>, kBuckets> buckets{};
+    std::atomic<uint64_t> count{0};
+    std::atomic<uint64_t> sum{0};
+    std::atomic<uint64_t> max{0};
+};
+
+/// @brief Plain histogram used for merging.
+struct Totals {
+    std::vector<uint64_t> buckets = std::vector<uint64_t>(kBuckets, 0);
+    uint64_t count = 0;
+    uint64_t sum = 0;
+    uint64_t max = 0;
+
+    void add(const ThreadHistogram& h) {
+        for (int i = 0; i < kBuckets; ++i) {
+            buckets[i] += h.buckets[i].load(std::memory_order_relaxed);
+        }
+        count += h.count.load(std::memory_order_relaxed);
+        sum += h.sum.load(std::memory_order_relaxed);
+        max = std::max(max, h.max.load(std::memory_order_relaxed));
+    }
+
+    void add(const Totals& other) {
+        for (int i = 0; i < kBuckets; ++i) {
+            buckets[i] += other.buckets[i];
+        }
+        count += other.count;
+        sum += other.sum;
+        max = std::max(max, other.max);
+    }
+
+    uint64_t percentile(double q) const {
+        uint64_t rank = static_cast<uint64_t>(std::ceil(q * count));
+        uint64_t seen = 0;
+        for (int i = 0; i < kBuckets; ++i) {
+            seen += buckets[i];
+            if (seen >= rank && seen > 0) {
+                return std::min(bucketUpperBound(i), max);
+            }
+        }
+        return max;
+    }
+};
+
+/// @brief All histograms of one thread, indexed by operation ID.
+struct ThreadBlock {
+    std::array<std::atomic<ThreadHistogram*>, kMaxOperations> histograms{};
+
+    ~ThreadBlock() {
+        for (auto& h : histograms) {
+            delete h.load(std::memory_order_relaxed);
+        }
+    }
+};
+
+struct Registry {
+    std::mutex mutex;
+    std::vector<std::string> names;
+    std::set<ThreadBlock*> live;
+    std::vector<Totals> retired;      ///< Totals of threads that have exited
+    std::string path = "ehs_metrics.prom";
+};
+
+Registry& registry() {
+    static Registry* instance = new Registry();  // never destroyed; threads may exit after main
+    return *instance;
+}
+
+/// @brief Owns the calling thread's block and folds it into the totals on thread exit.
+struct ThreadHandle {
+    ThreadBlock* block = nullptr;
+
+    ThreadBlock* get() {
+        if (!block) {
+            block = new ThreadBlock();
+            Registry& r = registry();
+            std::lock_guard<std::mutex> lock(r.mutex);
+            r.live.insert(block);
+        }
+        return block;
+    }
+
+    ~ThreadHandle() {
+        if (!block) return;
+        Registry& r = registry();
+        std::lock_guard<std::mutex> lock(r.mutex);
+        for (size_t id = 0; id < r.names.size(); ++id) {
+            ThreadHistogram* h = block->histograms[id].load(std::memory_order_acquire);
+            if (h) r.retired[id].add(*h);
+        }
+        r.live.erase(block);
+        delete block;
+    }
+};
+
+thread_local ThreadHandle threadHandle;
+
+std::string escapeLabel(const std::string& value) {
+    std::string escaped;
+    for (char c : value) {
+        if (c == '\\' || c == '"') escaped += '\\';
+        if (c == '\n') {
+            escaped += "\\n";
+            continue;
+        }
+        escaped += c;
+    }
+    return escaped;
+}
+
+}  // namespace
+
+OperationId operation(const std::string& name) {
+    Registry& r = registry();
+    std::lock_guard<std::mutex> lock(r.mutex);
+    for (size_t id = 0; id < r.names.size(); ++id) {
+        if (r.names[id] == name) return static_cast<OperationId>(id);
+    }
+    if (r.names.size() >= static_cast<size_t>(kMaxOperations)) {
+        return -1;
+    }
+    r.names.push_back(name);
+    r.retired.emplace_back();
+    return static_cast<OperationId>(r.names.size() - 1);
+}
+
+void record(OperationId id, uint64_t nanoseconds) {
+    if (id < 0 || id >= kMaxOperations) return;
+
+    ThreadBlock* block = threadHandle.get();
+    ThreadHistogram* h = block->histograms[id].load(std::memory_order_relaxed);
+    if (!h) {
+        h = new ThreadHistogram();
+        block->histograms[id].store(h, std::memory_order_release);
+    }
+
+    // Single writer per histogram: load + store is enough, no read-modify-write needed
+    auto& bucket = h->buckets[bucketIndex(nanoseconds)];
+    bucket.store(bucket.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    h->count.store(h->count.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    h->sum.store(h->sum.load(std::memory_order_relaxed) + nanoseconds, std::memory_order_relaxed);
+    if (nanoseconds > h->max.load(std::memory_order_relaxed)) {
+        h->max.store(nanoseconds, std::memory_order_relaxed);
+    }
+}
+
+std::string renderPrometheus() {
+    Registry& r = registry();
+    std::lock_guard<std::mutex> lock(r.mutex);
+
+    std::vector<Totals> merged(r.names.size());
+    for (size_t id = 0; id < r.names.size(); ++id) {
+        merged[id].add(r.retired[id]);
+        for (ThreadBlock* block : r.live) {
+            ThreadHistogram* h = block->histograms[id].load(std::memory_order_acquire);
+            if (h) merged[id].add(*h);
+        }
+    }
+
+    std::ostringstream out;
+    out.precision(9);
+    out << "# HELP ehs_operation_latency_seconds Latency of EHS operations and menu actions.\n"
+        << "# TYPE ehs_operation_latency_seconds summary\n";
+    for (size_t id = 0; id < r.names.size(); ++id) {
+        const Totals& t = merged[id];
+        if (t.count == 0) continue;
+        std::string label = "operation=\"" + escapeLabel(r.names[id]) + "\"";
+        for (double q : {0.5, 0.9, 0.99}) {
+            out << "ehs_operation_latency_seconds{" << label << ",quantile=\"" << q << "\"} "
+                << t.percentile(q) / 1e9 << "\n";
+        }
+        out << "ehs_operation_latency_seconds_sum{" << label << "} " << t.sum / 1e9 << "\n"
+            << "ehs_operation_latency_seconds_count{" << label << "} " << t.count << "\n";
+    }
+
+    out << "# HELP ehs_operation_latency_max_seconds Slowest observed call of each operation.\n"
+        << "# TYPE ehs_operation_latency_max_seconds gauge\n";
+    for (size_t id = 0; id < r.names.size(); ++id) {
+        const Totals& t = merged[id];
+        if (t.count == 0) continue;
+        out << "ehs_operation_latency_max_seconds{operation=\"" << escapeLabel(r.names[id]) << "\"} "
+            << t.max / 1e9 << "\n";
+    }
+    return out.str();
+}
+
+void setDumpPath(const std::string& path) {
+    Registry& r = registry();
+    std::lock_guard<std::mutex> lock(r.mutex);
+    r.path = path;
+}
+
+std::string dumpPath() {
+    Registry& r = registry();
+    std::lock_guard<std::mutex> lock(r.mutex);
+    return r.path;
+}
+
+bool dump() {
+    std::string path = dumpPath();
+    std::string text = renderPrometheus();
+    // The menu and the SIGUSR1 thread may dump at once, so each dump writes its own temporary file
+    static std::atomic<unsigned> dumps{0};
+    std::string tmp = path + "." + std::to_string(getpid()) + "." + std::to_string(++dumps) + ".tmp";
+
+    bool written;
+    {
+        std::ofstream out(tmp, std::ios::trunc);
+        if (!out) return false;
+        out << text;
+        written = static_cast<bool>(out.flush());
+    }
+    if (!written || std::rename(tmp.c_str(), path.c_str()) != 0) {
+        std::remove(tmp.c_str());
+        return false;
+    }
+    return true;
+}
+
+void installDumpSignalHandler() {
+    sigset_t set;
+    sigemptyset(&set);
+    sigaddset(&set, SIGUSR1);
+    pthread_sigmask(SIG_BLOCK, &set, nullptr);
+
+    std::thread([set]() {
+        // Other process-directed signals must not land on this thread
+        sigset_t all;
+        sigfillset(&all);
+        pthread_sigmask(SIG_BLOCK, &all, nullptr);
+
+        int signal;
+        while (sigwait(&set, &signal) == 0) {
+            dump();
+        }
+    }).detach();
+}
+
+}  // namespace metrics
@@ -0,0 +1,112 @@
+#ifndef METRICS_H_
+#define METRICS_H_
+
+#include <chrono>
+#include <cstdint>
+#include <string>
+
+/**
+ * @namespace metrics
+ * @brief Per-operation latency histograms.
+ *
+ * Each thread records into its own HDR-style log-linear histograms (within
+ * 6.25% from 1 ns up to hours), so recording is a handful of
+ * relaxed atomic stores with no locks and no shared cache lines. A dump
+ * merges all threads and writes p50/p90/p99/max, sums and counts in the
+ * Prometheus text format, for the node exporter textfile collector.
+ *
+ * Typical use at the top of a function:
+ * @code
+ * EHS_MEASURE("core.assignTask");
+ * @endcode
+ */
+namespace metrics {
+
+/// @brief Identifier of a named operation, obtained once through operation().
+using OperationId = int;
+
+/**
+ * @brief Registers (or looks up) an operation by name.
+ *
+ * Takes a lock; call it once per call site and keep the ID (EHS_MEASURE does
+ * this with a function-local static).
+ *
+ * @param name Operation name, e.g. "core.assignTask" or "menu.manager.assign_task".
+ * @return The operation ID, or -1 if the operation table is full.
+ */
+OperationId operation(const std::string& name);
+
+/**
+ * @brief Records one latency sample for an operation on the calling thread.
+ *
+ * @param id Operation ID from operation().
+ * @param nanoseconds Measured latency.
+ */
+void record(OperationId id, uint64_t nanoseconds);
+
+/**
+ * @class ScopedLatency
+ * @brief Records the time between construction and destruction.
+ */
+class ScopedLatency {
+public:
+    explicit ScopedLatency(OperationId id) : id(id), start(std::chrono::steady_clock::now()) {}
+    ~ScopedLatency() {
+        record(id, static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                                             std::chrono::steady_clock::now() - start).count()));
+    }
+    ScopedLatency(const ScopedLatency&) = delete;
+    ScopedLatency& operator=(const ScopedLatency&) = delete;
+
+private:
+    OperationId id;
+    std::chrono::steady_clock::time_point start;
+};
+
+/**
+ * @brief Renders all histograms in the Prometheus text exposition format.
+ */
+std::string renderPrometheus();
+
+/**
+ * @brief Sets the file written by dump() and by the SIGUSR1 handler.
+ */
+void setDumpPath(const std::string& path);
+
+/**
+ * @brief Returns the file written by dump().
+ */
+std::string dumpPath();
+
+/**
+ * @brief Writes renderPrometheus() to the dump file.
+ *
+ * The file is written next to its destination and renamed into place, so a
+ * scraper never reads a partial file.
+ *
+ * @return True if the file was written.
+ */
+bool dump();
+
+/**
+ * @brief Starts a background thread that calls dump() on every SIGUSR1.
+ *
+ * SIGUSR1 is blocked on the calling thread and handled with sigwait, so call
+ * this from main() before any other thread is started; threads created later
+ * inherit the blocked mask.
+ */
+void installDumpSignalHandler();
+
+}  // namespace metrics
+
+#define EHS_METRICS_CONCAT_INNER(a, b) a##b
+#define EHS_METRICS_CONCAT(a, b) EHS_METRICS_CONCAT_INNER(a, b)
+
+/// @brief Records the latency of the enclosing scope under the given operation name.
+#define EHS_MEASURE(name)                                                                         \
+    static const ::metrics::OperationId EHS_METRICS_CONCAT(ehsMetricsOp_, __LINE__) =               \
+        ::metrics::operation(name);                                                                 \
+    ::metrics::ScopedLatency EHS_METRICS_CONCAT(ehsMetricsTimer_, __LINE__)(                        \
+        EHS_METRICS_CONCAT(ehsMetricsOp_, __LINE__))
+
+#endif  // METRICS_H_
@@ -0,0 +1,330 @@
+/**
+ * @file protocol.cpp
+ * @brief Encoding of ehsd requests and responses.
+ *
+ */
+
+#include "protocol.h"
+#include <cassert>
+#include <cerrno>
+#include <sys/socket.h>
+#include <unistd.h>
+
+namespace protocol {
+
+void Writer::putInt(sqlite3_int64 value) {
+    uint64_t zigzag = (static_cast<uint64_t>(value) << 1) ^ static_cast<uint64_t>(value >> 63);
+    while (zigzag >= 0x80) {
+        out.push_back(static_cast<char>((zigzag & 0x7f) | 0x80));
+        zigzag >>= 7;
+    }
+    out.push_back(static_cast<char>(zigzag));
+}
+
+void Writer::putString(const std::string& value) {
+    putInt(static_cast<sqlite3_int64>(value.size()));
+    out.append(value);
+}
+
+bool Reader::getInt(sqlite3_int64& value) {
+    uint64_t zigzag = 0;
+    for (int shift = 0; ok && shift < 64; shift += 7) {
+        if (pos >= data.size()) break;
+        uint8_t byte = static_cast<uint8_t>(data[pos++]);
+        zigzag |= static_cast<uint64_t>(byte & 0x7f) << shift;
+        if (!(byte & 0x80)) {
+            value = static_cast<sqlite3_int64>(zigzag >> 1) ^ -static_cast<sqlite3_int64>(zigzag & 1);
+            return true;
+        }
+    }
+    ok = false;
+    return false;
+}
+
+bool Reader::getInt(int& value) {
+    sqlite3_int64 wide = 0;
+    if (!getInt(wide) || wide < INT32_MIN || wide > INT32_MAX) {
+        ok = false;
+        return false;
+    }
+    value = static_cast<int>(wide);
+    return true;
+}
+
+bool Reader::getBool(bool& value) {
+    sqlite3_int64 wide = 0;
+    if (!getInt(wide)) return false;
+    value = wide != 0;
+    return true;
+}
+
+bool Reader::getString(std::string& value) {
+    sqlite3_int64 size = 0;
+    if (!getInt(size) || size < 0 || static_cast<uint64_t>(size) > data.size() - pos) {
+        ok = false;
+        return false;
+    }
+    value.assign(data, pos, static_cast<size_t>(size));
+    pos += static_cast<size_t>(size);
+    return true;
+}
+
+bool Reader::getOp(Op& op) {
+    sqlite3_int64 code = 0;
+    if (!getInt(code) || code < static_cast<int>(Op::Login) || code > static_cast<int>(kLastOp)) {
+        ok = false;
+        return false;
+    }
+    op = static_cast<Op>(code);
+    return true;
+}
+
+void put(Writer& out, const core::Result& result) {
+    out.putBool(result.ok);
+    out.putString(result.error);
+    if (!result.ok) return;
+    out.putInt(result.id);
+    out.putInt(result.changes);
+}
+
+void put(Writer& out, const core::LoginResult& result) {
+    out.putBool(result.ok);
+    out.putString(result.error);
+    if (!result.ok) return;
+    out.putInt(result.userId);
+    out.putString(result.role);
+}
+
+void put(Writer& out, const core::TaskRecord& task) {
+    out.putInt(task.id);
+    out.putInt(task.workerId);
+    out.putString(task.workerUsername);
+    out.putString(task.description);
+    out.putString(task.status);
+    out.putString(task.violationComment);
+    out.putString(task.violationTimestamp);
+    out.putString(task.workerReport);
+    out.putString(task.workerMedia);
+    out.putInt(task.dueAt);
+    out.putInt(task.priority);
+}
+
+void put(Writer& out, const core::RuleRecord& rule) {
+    out.putInt(rule.id);
+    out.putString(rule.text);
+    out.putString(rule.timestamp);
+}
+
+void put(Writer& out, const core::WorkerRecord& worker) {
+    out.putInt(worker.id);
+    out.putString(worker.username);
+}
+
+void put(Writer& out, const core::WorkerLoad& load) {
+    out.putInt(load.workerId);
+    out.putString(load.username);
+    out.putInt(load.openTasks);
+    out.putInt(load.weight);
+    out.putBool(load.available);
+}
+
+void put(Writer& out, const core::FeedbackSummary& summary) {
+    out.putInt(summary.ruleId);
+    out.putString(summary.ruleText);
+    out.putInt(summary.feedbackCount);
+    out.putInt(summary.ratingCount);
+    out.putInt(summary.ratingSum);
+}
+
+void put(Writer& out, const core::FeedbackRecord& feedback) {
+    out.putInt(feedback.id);
+    out.putInt(feedback.ruleId);
+    out.putInt(feedback.workerId);
+    out.putString(feedback.createdAt);
+    out.putInt(feedback.rating);
+    out.putString(feedback.text);
+}
+
+void put(Writer& out, const core::ScheduleRecord& schedule) {
+    out.putInt(schedule.id);
+    out.putInt(schedule.workerId);
+    out.putString(schedule.workerUsername);
+    out.putString(schedule.description);
+    out.putInt(schedule.intervalSeconds);
+    out.putInt(schedule.nextDue);
+}
+
+void put(Writer& out, const core::ShiftRecord& shift) {
+    out.putInt(shift.id);
+    out.putInt(shift.workerId);
+    out.putString(shift.workerUsername);
+    out.putString(shift.site);
+    out.putInt(shift.startsAt);
+    out.putInt(shift.endsAt);
+}
+
+void put(Writer& out, const core::SearchHit& hit) {
+    out.putInt(hit.id);
+    out.putString(hit.snippet);
+}
+
+void put(Writer& out, const core::SearchResult& result) {
+    out.putBool(result.ok);
+    out.putString(result.error);
+    if (!result.ok) return;
+    for (const std::vector<core::SearchHit>* hits : {&result.rules, &result.tasks}) {
+        out.putInt(static_cast<sqlite3_int64>(hits->size()));
+        for (const core::SearchHit& hit : *hits) {
+            put(out, hit);
+        }
+    }
+}
+
+bool get(Reader& in, core::Result& result) {
+    if (!in.getBool(result.ok) || !in.getString(result.error)) return false;
+    return !result.ok || (in.getInt(result.id) && in.getInt(result.changes));
+}
+
+bool get(Reader& in, core::LoginResult& result) {
+    if (!in.getBool(result.ok) || !in.getString(result.error)) return false;
+    return !result.ok || (in.getInt(result.userId) && in.getString(result.role));
+}
+
+bool get(Reader& in, core::TaskRecord& task) {
+    return in.getInt(task.id) && in.getInt(task.workerId) && in.getString(task.workerUsername) &&
+           in.getString(task.description) && in.getString(task.status) && in.getString(task.violationComment) &&
+           in.getString(task.violationTimestamp) && in.getString(task.workerReport) &&
+           in.getString(task.workerMedia) && in.getInt(task.dueAt) && in.getInt(task.priority);
+}
+
+bool get(Reader& in, core::RuleRecord& rule) {
+    return in.getInt(rule.id) && in.getString(rule.text) && in.getString(rule.timestamp);
+}
+
+bool get(Reader& in, core::WorkerRecord& worker) {
+    return in.getInt(worker.id) && in.getString(worker.username);
+}
+
+bool get(Reader& in, core::WorkerLoad& load) {
+    return in.getInt(load.workerId) && in.getString(load.username) && in.getInt(load.openTasks) &&
+           in.getInt(load.weight) && in.getBool(load.available);
+}
+
+bool get(Reader& in, core::FeedbackSummary& summary) {
+    return in.getInt(summary.ruleId) && in.getString(summary.ruleText) && in.getInt(summary.feedbackCount) &&
+           in.getInt(summary.ratingCount) && in.getInt(summary.ratingSum);
+}
+
+bool get(Reader& in, core::FeedbackRecord& feedback) {
+    return in.getInt(feedback.id) && in.getInt(feedback.ruleId) && in.getInt(feedback.workerId) &&
+           in.getString(feedback.createdAt) && in.getInt(feedback.rating) && in.getString(feedback.text);
+}
+
+bool get(Reader& in, core::ScheduleRecord& schedule) {
+    return in.getInt(schedule.id) && in.getInt(schedule.workerId) && in.getString(schedule.workerUsername) &&
+           in.getString(schedule.description) && in.getInt(schedule.intervalSeconds) && in.getInt(schedule.nextDue);
+}
+
+bool get(Reader& in, core::ShiftRecord& shift) {
+    return in.getInt(shift.id) && in.getInt(shift.workerId) && in.getString(shift.workerUsername) &&
+           in.getString(shift.site) && in.getInt(shift.startsAt) && in.getInt(shift.endsAt);
+}
+
+bool get(Reader& in, core::SearchHit& hit) {
+    return in.getInt(hit.id) && in.getString(hit.snippet);
+}
+
+bool get(Reader& in, core::SearchResult& result) {
+    if (!in.getBool(result.ok) || !in.getString(result.error)) return false;
+    if (!result.ok) return true;
+    for (std::vector<core::SearchHit>* hits : {&result.rules, &result.tasks}) {
+        sqlite3_int64 count = 0;
+        if (!in.getInt(count) || count < 0 || count > kMaxFrame) return false;
+        hits->resize(static_cast<size_t>(count));
+        for (core::SearchHit& hit : *hits) {
+            if (!get(in, hit)) return false;
+        }
+    }
+    return true;
+}
+
+std::string failure(const std::string& error) {
+    Writer out;
+    out.putBool(false);
+    out.putString(error);
+    return out.data();
+}
+
+FrameStatus takeFrame(std::string& buffer, std::string& payload) {
+    if (buffer.size() < 4) {
+        return FrameStatus::Partial;
+    }
+    uint32_t size = 0;
+    for (int i = 0; i < 4; ++i) {
+        size = (size << 8) | static_cast<uint8_t>(buffer[i]);
+    }
+    if (size > kMaxFrame) {
+        return FrameStatus::TooLarge;
+    }
+    if (buffer.size() - 4 < size) {
+        return FrameStatus::Partial;
+    }
+    payload.assign(buffer, 4, size);
+    buffer.erase(0, 4 + size);
+    return FrameStatus::Ready;
+}
+
+void appendFrame(std::string& out, const std::string& payload) {
+    assert(payload.size() <= kMaxFrame);  // The length prefix would wrap and the peer rejects it anyway
+    uint32_t size = static_cast<uint32_t>(payload.size());
+    for (int shift = 24; shift >= 0; shift -= 8) {
+        out.push_back(static_cast<char>((size >> shift) & 0xff));
+    }
+    out.append(payload);
+}
+
+bool sendFrame(int fd, const std::string& payload) {
+    if (payload.size() > kMaxFrame) {
+        return false;
+    }
+    std::string frame;
+    appendFrame(frame, payload);
+    size_t sent = 0;
+    while (sent < frame.size()) {
+        ssize_t n = ::send(fd, frame.data() + sent, frame.size() - sent, MSG_NOSIGNAL);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return false;
+        sent += static_cast<size_t>(n);
+    }
+    return true;
+}
+
+namespace {
+
+bool readFully(int fd, char* data, size_t size) {
+    size_t got = 0;
+    while (got < size) {
+        ssize_t n = ::read(fd, data + got, size - got);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return false;
+        got += static_cast<size_t>(n);
+    }
+    return true;
+}
+
+}  // namespace
+
+bool recvFrame(int fd, std::string& payload) {
+    unsigned char header[4];
+    if (!readFully(fd, reinterpret_cast<char*>(header), sizeof(header))) {
+        return false;
+    }
+    uint32_t size = (uint32_t(header[0]) << 24) | (uint32_t(header[1]) << 16) | (uint32_t(header[2]) << 8) | header[3];
+    if (size > kMaxFrame) {
+        return false;
+    }
+    payload.resize(size);
+    return readFully(fd, &payload[0], size);
+}
+
+}  // namespace protocol
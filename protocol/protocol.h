@@ -0,0 +1,195 @@
+#ifndef PROTOCOL_H_
+#define PROTOCOL_H_
+
+#include "../core/core.h"
+#include <cstdint>
+#include <string>
+
+/**
+ * @namespace protocol
+ * @brief Wire format between ehsd and its clients.
+ *
+ * Every message is a frame: a 4-byte big-endian payload length followed by
+ * the payload. A request payload is the operation code followed by its
+ * arguments; the response payload is the operation's result struct. Integers
+ * are zigzag varints and strings are a varint length followed by the bytes,
+ * so a typical request is a few dozen bytes.
+ *
+ * Every result struct starts with ok and error, and its remaining fields are
+ * only sent when ok is true, so a failure (e.g. "Not logged in.") has the same
+ * encoding whatever the operation.
+ */
+namespace protocol {
+
+/// @brief Largest payload accepted in either direction (report media included).
+const uint32_t kMaxFrame = 64u << 20;
+
+/// @brief Largest page a client may ask for in a paged listing, as in batch mode.
+const int kMaxPage = 1000;
+
+/// @brief Request operation codes. Values are part of the wire format.
+enum class Op : uint8_t {
+    Login = 1,
+    Register = 2,
+    Logout = 3,
+    ListTasks = 4,          ///< Worker, after_id and limit: one page in id order
+    ListOpenTasks = 5,
+    ListTasksByStatus = 6,
+    ListWorkers = 7,
+    ListRules = 8,
+    AssignTask = 9,
+    ReportViolation = 10,
+    SubmitTaskReport = 11,  ///< Carries the media file contents
+    AddRule = 12,
+    DeleteRule = 13,
+    DeleteTask = 14,
+    SubmitRuleFeedback = 15,
+    ListFeedbackSummaries = 16,
+    ListRuleFeedback = 17,
+    Search = 18,
+    ListTaskHistory = 19,   ///< Paged like ListTasks
+    AddSchedule = 20,
+    ListSchedules = 21,
+    DeleteSchedule = 22,
+    ListOverdue = 23,
+    AutoAssignTasks = 24,   ///< A count, that many descriptions, the deadline, the priority and the site
+    ListWorkerLoads = 25,
+    SetWorkerAvailability = 26,
+    AddShift = 27,
+    DeleteShift = 28,
+    ListShifts = 29,
+    ListOnShift = 30,
+};
+
+/// @brief The highest operation code; decoding rejects anything above it.
+const Op kLastOp = Op::ListOnShift;
+
+/**
+ * @class Writer
+ * @brief Appends varints and strings to a payload.
+ */
+class Writer {
+public:
+    void putInt(sqlite3_int64 value);
+    void putBool(bool value) { putInt(value ? 1 : 0); }
+    void putString(const std::string& value);
+    void putOp(Op op) { putInt(static_cast<sqlite3_int64>(op)); }
+
+    const std::string& data() const { return out; }
+
+private:
+    std::string out;
+};
+
+/**
+ * @class Reader
+ * @brief Reads varints and strings from a payload.
+ *
+ * Each getter returns false once the payload is truncated or malformed, and
+ * every later call fails too, so a decoder can check once at the end.
+ */
+class Reader {
+public:
+    explicit Reader(const std::string& data) : data(data) {}
+
+    bool getInt(sqlite3_int64& value);
+    bool getInt(int& value);
+    bool getBool(bool& value);
+    bool getString(std::string& value);
+    bool getOp(Op& op);
+
+    /// @brief True if every byte was consumed and nothing failed.
+    bool done() const { return ok && pos == data.size(); }
+
+private:
+    const std::string& data;
+    size_t pos = 0;
+    bool ok = true;
+};
+
+void put(Writer& out, const core::Result& result);
+void put(Writer& out, const core::LoginResult& result);
+void put(Writer& out, const core::TaskRecord& task);
+void put(Writer& out, const core::RuleRecord& rule);
+void put(Writer& out, const core::WorkerRecord& worker);
+void put(Writer& out, const core::WorkerLoad& load);
+void put(Writer& out, const core::FeedbackSummary& summary);
+void put(Writer& out, const core::FeedbackRecord& feedback);
+void put(Writer& out, const core::SearchHit& hit);
+void put(Writer& out, const core::SearchResult& result);
+void put(Writer& out, const core::ScheduleRecord& schedule);
+void put(Writer& out, const core::ShiftRecord& shift);
+
+bool get(Reader& in, core::Result& result);
+bool get(Reader& in, core::LoginResult& result);
+bool get(Reader& in, core::TaskRecord& task);
+bool get(Reader& in, core::RuleRecord& rule);
+bool get(Reader& in, core::WorkerRecord& worker);
+bool get(Reader& in, core::WorkerLoad& load);
+bool get(Reader& in, core::FeedbackSummary& summary);
+bool get(Reader& in, core::FeedbackRecord& feedback);
+bool get(Reader& in, core::SearchHit& hit);
+bool get(Reader& in, core::SearchResult& result);
+bool get(Reader& in, core::ScheduleRecord& schedule);
+bool get(Reader& in, core::ShiftRecord& shift);
+
+template <typename T>
+void put(Writer& out, const core::Rows<T>& rows) {
+    out.putBool(rows.ok);
+    out.putString(rows.error);
+    if (!rows.ok) return;
+    out.putInt(static_cast<sqlite3_int64>(rows.rows.size()));
+    for (const T& row : rows.rows) {
+        put(out, row);
+    }
+}
+
+template <typename T>
+bool get(Reader& in, core::Rows<T>& rows) {
+    sqlite3_int64 count = 0;
+    if (!in.getBool(rows.ok) || !in.getString(rows.error)) return false;
+    if (!rows.ok) return true;
+    if (!in.getInt(count) || count < 0 || count > kMaxFrame) return false;
+    rows.rows.resize(static_cast<size_t>(count));
+    for (T& row : rows.rows) {
+        if (!get(in, row)) return false;
+    }
+    return true;
+}
+
+/**
+ * @brief Encodes a failure; decodes as a failed result of any operation.
+ */
+std::string failure(const std::string& error);
+
+/// @brief Result of takeFrame().
+enum class FrameStatus { Ready, Partial, TooLarge };
+
+/**
+ * @brief Removes the first complete frame from buffer.
+ *
+ * @param buffer Bytes received so far.
+ * @param payload Set to the frame's payload when Ready.
+ * @return Ready, Partial if more bytes are needed, or TooLarge if the frame
+ *         exceeds kMaxFrame.
+ */
+FrameStatus takeFrame(std::string& buffer, std::string& payload);
+
+/**
+ * @brief Appends payload to out as a frame; payload must not exceed kMaxFrame.
+ */
+void appendFrame(std::string& out, const std::string& payload);
+
+/**
+ * @brief Writes one frame to a blocking socket.
+ */
+bool sendFrame(int fd, const std::string& payload);
+
+/**
+ * @brief Reads one frame from a blocking socket.
+ */
+bool recvFrame(int fd, std::string& payload);
+
+}  // namespace protocol
+
+#endif  // PROTOCOL_H_
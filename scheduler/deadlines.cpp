@@ -0,0 +1,223 @@
+/**
+ * @file deadlines.cpp
+ * @brief The deadline heap and the thread that marks tasks overdue.
+ */
+
+#include "deadlines.h"
+#include "../db/ConnectionPool.h"
+#include "../logging/logging.h"
+#include "../metrics/metrics.h"
+#include "../trace/trace.h"
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <ctime>
+
+namespace scheduler {
+
+namespace {
+
+/// @brief Stale heap entries tolerated beyond the live ones before the heap is rebuilt.
+const size_t kStaleSlack = 4096;
+
+}  // namespace
+
+DeadlineWatcher::DeadlineWatcher(ConnectionPool& pool, const DeadlineOptions& options)
+    : pool(pool), options(options) {}
+
+DeadlineWatcher::~DeadlineWatcher() {
+    stop();
+    if (hookId) {
+        pool.removeUpdateHook(hookId);
+    }
+}
+
+bool DeadlineWatcher::load(std::string& error) {
+    trace::Span span("deadlines.load", "scheduler");
+    core::Rows<core::DeadlineRecord> pending = pool.exclusive([this](sqlite3* db) {
+        if (!hookId) {
+            hookId = pool.addUpdateHook([this](int, const char* database, const char* table, sqlite3_int64 rowid) {
+                if (std::strcmp(table, "tasks") != 0 || std::strcmp(database, "main") != 0) {
+                    return;
+                }
+                if (marking) {
+                    return;
+                }
+                std::lock_guard<std::mutex> lock(mutex);
+                changed.push_back(static_cast<int>(rowid));
+                wake.notify_one();
+            });
+        }
+        return core::listPendingDeadlines(db);
+    });
+    if (!pending.ok) {
+        error = pending.error;
+        return false;
+    }
+
+    heap = decltype(heap)();
+    deadlines.clear();
+    for (const core::DeadlineRecord& deadline : pending.rows) {
+        watch(deadline);
+    }
+
+    std::lock_guard<std::mutex> lock(mutex);
+    counters.watched = deadlines.size();
+    return true;
+}
+
+void DeadlineWatcher::watch(const core::DeadlineRecord& deadline) {
+    Entry entry;
+    entry.due = deadline.dueAt;
+    entry.taskId = deadline.taskId;
+    heap.push(entry);
+    deadlines[deadline.taskId] = deadline.dueAt;
+}
+
+long long DeadlineWatcher::markDue(sqlite3_int64 now) {
+    EHS_MEASURE("deadlines.markDue");
+    trace::Span span("deadlines.markDue", "scheduler");
+    std::vector<int> tasks;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        tasks.swap(changed);
+    }
+
+    // Changed tasks are read on the writer, after the writes that changed them
+    if (!tasks.empty()) {
+        std::sort(tasks.begin(), tasks.end());
+        tasks.erase(std::unique(tasks.begin(), tasks.end()), tasks.end());
+        core::Rows<core::DeadlineRecord> fresh =
+            pool.write([&tasks](sqlite3* db) { return core::pendingDeadlines(db, tasks); });
+        if (!fresh.ok) {
+            logging::error("Cannot read changed deadlines: {}", fresh.error);
+            std::lock_guard<std::mutex> lock(mutex);
+            changed.insert(changed.end(), tasks.begin(), tasks.end());
+            ++counters.failures;
+            return 0;
+        }
+        // Rows come back in the order asked for; tasks missing from them are no longer pending
+        size_t next = 0;
+        for (int taskId : tasks) {
+            if (next < fresh.rows.size() && fresh.rows[next].taskId == taskId) {
+                auto it = deadlines.find(taskId);
+                if (it == deadlines.end() || it->second != fresh.rows[next].dueAt) {
+                    watch(fresh.rows[next]);
+                }
+                ++next;
+            } else {
+                deadlines.erase(taskId);
+            }
+        }
+    }
+
+    std::vector<Entry> due;
+    while (!heap.empty() && heap.top().due <= now) {
+        Entry entry = heap.top();
+        heap.pop();
+        auto it = deadlines.find(entry.taskId);
+        if (it != deadlines.end() && it->second == entry.due) {
+            due.push_back(entry);
+            deadlines.erase(it);
+        }
+    }
+    if (heap.size() > deadlines.size() + kStaleSlack) {
+        heap = decltype(heap)();
+        for (const auto& deadline : deadlines) {
+            heap.push(Entry{deadline.second, deadline.first});
+        }
+    }
+
+    long long marked = 0;
+    long long failures = 0;
+    for (size_t first = 0; first < due.size(); first += options.batchSize) {
+        size_t last = std::min(due.size(), first + options.batchSize);
+        std::vector<int> ids;
+        for (size_t i = first; i < last; ++i) {
+            ids.push_back(due[i].taskId);
+        }
+        core::Result result = pool.write([this, &ids, now](sqlite3* db) {
+            marking = true;
+            core::Result marks = core::markOverdue(db, ids, now);
+            marking = false;
+            return marks;
+        });
+        if (result.ok) {
+            marked += result.changes;
+        } else {
+            // Retried on the next pass
+            ++failures;
+            for (size_t i = first; i < last; ++i) {
+                watch(core::DeadlineRecord{due[i].taskId, due[i].due});
+            }
+            logging::error("Cannot mark {} tasks overdue: {}", ids.size(), result.error);
+        }
+    }
+    if (marked > 0) {
+        alert(due, marked);
+    }
+
+    std::lock_guard<std::mutex> lock(mutex);
+    counters.watched = deadlines.size();
+    counters.marked += marked;
+    counters.failures += failures;
+    return marked;
+}
+
+void DeadlineWatcher::alert(const std::vector<Entry>& overdue, long long marked) {
+    size_t shown = std::min(overdue.size(), static_cast<size_t>(std::max(0, options.maxAlerts)));
+    for (size_t i = 0; i < shown; ++i) {
+        logging::warn("Task {} is overdue; it was due {}", overdue[i].taskId, core::formatLocalTime(overdue[i].due));
+    }
+    if (overdue.size() > shown) {
+        logging::warn("{} more tasks are overdue", overdue.size() - shown);
+    }
+    logging::info("Marked {} tasks overdue", marked);
+}
+
+void DeadlineWatcher::start() {
+    thread = std::thread([this]() {
+        trace::setThreadName("deadlines");
+        std::string error;
+        if (!load(error)) {
+            logging::error("Cannot read task deadlines: {}", error);
+        }
+        logging::info("Deadline watcher started with {} pending deadlines", deadlines.size());
+        std::unique_lock<std::mutex> lock(mutex);
+        while (!stopping) {
+            lock.unlock();
+            sqlite3_int64 now = std::time(nullptr);
+            markDue(now);
+            // Entries left due by now failed to mark; they are retried a second later
+            bool idle = heap.empty();
+            auto next = std::chrono::system_clock::from_time_t(
+                static_cast<std::time_t>(idle ? now : std::max(heap.top().due, now + 1)));
+            lock.lock();
+            // Sleep until the earliest deadline, unless a task changes first
+            auto ready = [this]() { return stopping || !changed.empty(); };
+            if (idle) {
+                wake.wait(lock, ready);
+            } else {
+                wake.wait_until(lock, next, ready);
+            }
+        }
+    });
+}
+
+void DeadlineWatcher::stop() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    wake.notify_all();
+    if (thread.joinable()) {
+        thread.join();
+    }
+}
+
+DeadlineStats DeadlineWatcher::stats() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return counters;
+}
+
+}  // namespace scheduler
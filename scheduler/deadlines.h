@@ -0,0 +1,118 @@
+#ifndef DEADLINES_H_
+#define DEADLINES_H_
+
+#include "../core/core.h"
+#include <sqlite3.h>
+#include <condition_variable>
+#include <cstddef>
+#include <functional>
+#include <mutex>
+#include <queue>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+class ConnectionPool;
+
+namespace scheduler {
+
+/**
+ * @struct DeadlineOptions
+ * @brief Alerting and batching of a DeadlineWatcher.
+ */
+struct DeadlineOptions {
+    int maxAlerts = 20;       ///< Overdue tasks logged one by one per pass; the rest are counted
+    int batchSize = 500;      ///< Tasks marked overdue per transaction
+};
+
+/**
+ * @struct DeadlineStats
+ * @brief Counters since the DeadlineWatcher was created.
+ */
+struct DeadlineStats {
+    size_t watched = 0;           ///< Pending tasks with a deadline still ahead
+    long long marked = 0;         ///< Tasks marked overdue
+    long long failures = 0;       ///< Batches that failed and will be retried
+};
+
+/**
+ * @class DeadlineWatcher
+ * @brief Marks pending tasks "overdue" when their deadline passes, without polling the tasks table.
+ *
+ * The deadlines of pending tasks sit in a min-heap, so the watcher sleeps
+ * until the earliest one and only touches the tasks that fall due. It learns
+ * of new and changed tasks from an update hook on the pool's writer
+ * (ConnectionPool::addUpdateHook()) and re-reads just those rows. A heap
+ * entry whose task has since changed is dropped when it surfaces (lazy
+ * deletion), and core::markOverdue() re-checks each task's status and
+ * deadline, so a stale entry never marks anything.
+ *
+ * All its reads and writes go through the writer, so it leases no read
+ * connection. Changes from other processes are not seen until load().
+ */
+class DeadlineWatcher {
+public:
+    explicit DeadlineWatcher(ConnectionPool& pool, const DeadlineOptions& options = DeadlineOptions());
+    ~DeadlineWatcher();
+    DeadlineWatcher(const DeadlineWatcher&) = delete;
+    DeadlineWatcher& operator=(const DeadlineWatcher&) = delete;
+
+    /**
+     * @brief Starts following the writer's changes and reads every pending deadline into the heap.
+     *
+     * Both happen in one exclusive writer job, so no change falls in between.
+     */
+    bool load(std::string& error);
+
+    /**
+     * @brief Re-reads the tasks changed since the last pass and marks those due by @p now.
+     *
+     * @return The number of tasks marked overdue.
+     */
+    long long markDue(sqlite3_int64 now);
+
+    /**
+     * @brief Loads the deadlines and calls markDue() on a thread of its own until stop().
+     *
+     * The thread wakes at the earliest deadline, or when a task changes.
+     */
+    void start();
+
+    void stop();
+
+    DeadlineStats stats() const;
+
+private:
+    /// @brief A heap entry; greater() on it makes std::priority_queue a min-heap.
+    struct Entry {
+        sqlite3_int64 due = 0;
+        int taskId = 0;
+        bool operator>(const Entry& other) const {
+            return due != other.due ? due > other.due : taskId > other.taskId;
+        }
+    };
+
+    void watch(const core::DeadlineRecord& deadline);
+    void alert(const std::vector<Entry>& overdue, long long marked);
+
+    ConnectionPool& pool;
+    DeadlineOptions options;
+    int hookId = 0;
+    bool marking = false;         ///< Only touched on the writer thread: set while markDue() writes, to skip its own changes
+
+    // Only touched by the thread calling load() and markDue()
+    std::priority_queue<Entry, std::vector<Entry>, std::greater<Entry>> heap;
+    std::unordered_map<int, sqlite3_int64> deadlines;  ///< Task ID to current deadline; heap entries not matching are stale
+
+    mutable std::mutex mutex;     ///< Guards everything below
+    std::condition_variable wake;
+    std::vector<int> changed;     ///< Tasks written since the last pass
+    bool stopping = false;
+    DeadlineStats counters;
+    std::thread thread;
+};
+
+}  // namespace scheduler
+
+#endif  // DEADLINES_H_
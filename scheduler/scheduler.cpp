@@ -0,0 +1,236 @@
+/**
+ * @file scheduler.cpp
+ * @brief Timer wheel and the scheduler thread that creates recurring tasks.
+ *
+ * The wheel follows the classic hashed hierarchical layout: an entry is
+ * filed by how far ahead it is due, in the level-0 slot of its second or the
+ * higher-level slot of its 256 s, 4.5 h or 12 day window. When the seconds
+ * wrap to 0, the matching slot one level up is emptied and its entries are
+ * filed again, now one level closer.
+ */
+
+#include "scheduler.h"
+#include "../db/ConnectionPool.h"
+#include "../logging/logging.h"
+#include "../metrics/metrics.h"
+#include "../trace/trace.h"
+#include <algorithm>
+#include <chrono>
+#include <ctime>
+
+namespace scheduler {
+
+namespace {
+
+/// @brief Schedules read per query when loading the wheel.
+const int kLoadPage = 10000;
+
+}  // namespace
+
+TimerWheel::TimerWheel(sqlite3_int64 now) : current(now) {}
+
+void TimerWheel::add(const Entry& entry) {
+    ++count;
+    place(entry);
+}
+
+void TimerWheel::place(const Entry& entry) {
+    if (entry.due <= current) {
+        overdue.push_back(entry);
+        return;
+    }
+    sqlite3_int64 ahead = entry.due - current;
+    if (ahead < (1 << kNearBits)) {
+        near[entry.due & ((1 << kNearBits) - 1)].push_back(entry);
+        return;
+    }
+    for (int level = 0; level < kFarLevels; ++level) {
+        int shift = kNearBits + level * kFarBits;
+        if (ahead < (sqlite3_int64(1) << (shift + kFarBits))) {
+            far[level][(entry.due >> shift) & ((1 << kFarBits) - 1)].push_back(entry);
+            return;
+        }
+    }
+    overflow.push_back(entry);
+}
+
+void TimerWheel::cascade(std::vector<Entry>& slot) {
+    std::vector<Entry> entries;
+    entries.swap(slot);
+    for (const Entry& entry : entries) {
+        place(entry);
+    }
+}
+
+void TimerWheel::advance(sqlite3_int64 now, std::vector<Entry>& expired) {
+    if (count == overdue.size()) {
+        current = std::max(current, now);  // Nothing is waiting in the slots, so skip the empty seconds
+    }
+    while (current < now) {
+        ++current;
+        if ((current & ((1 << kNearBits) - 1)) == 0) {
+            bool wrapped = true;
+            for (int level = 0; level < kFarLevels && wrapped; ++level) {
+                int index = static_cast<int>((current >> (kNearBits + level * kFarBits)) & ((1 << kFarBits) - 1));
+                cascade(far[level][index]);
+                wrapped = index == 0;
+            }
+            if (wrapped) {
+                cascade(overflow);
+            }
+        }
+        std::vector<Entry>& slot = near[current & ((1 << kNearBits) - 1)];
+        count -= slot.size();
+        expired.insert(expired.end(), slot.begin(), slot.end());
+        slot.clear();
+    }
+    count -= overdue.size();
+    expired.insert(expired.end(), overdue.begin(), overdue.end());
+    overdue.clear();
+}
+
+Scheduler::Scheduler(LocalService& service, const Options& options)
+    : service(service), options(options), wheel(std::time(nullptr)) {}
+
+Scheduler::~Scheduler() {
+    stop();
+}
+
+bool Scheduler::load(std::string& error) {
+    trace::Span span("scheduler.load", "scheduler");
+    ConnectionPool::Reader db = service.connections().reader();
+    for (;;) {
+        core::Rows<core::ScheduleRecord> page = core::listSchedules(db, lastId, kLoadPage);
+        if (!page.ok) {
+            error = page.error;
+            return false;
+        }
+        for (const core::ScheduleRecord& schedule : page.rows) {
+            TimerWheel::Entry entry;
+            entry.due = schedule.nextDue;
+            entry.interval = schedule.intervalSeconds;
+            entry.id = schedule.id;
+            wheel.add(entry);
+            lastId = schedule.id;
+        }
+        if (page.rows.size() < static_cast<size_t>(kLoadPage)) {
+            break;
+        }
+    }
+
+    std::lock_guard<std::mutex> lock(mutex);
+    counters.schedules = wheel.size();
+    return true;
+}
+
+void Scheduler::addNew() {
+    std::string error;
+    if (!load(error)) {
+        logging::error("Cannot read new schedules: {}", error);
+    }
+}
+
+void Scheduler::runDue(sqlite3_int64 now) {
+    addNew();
+    std::vector<TimerWheel::Entry> due;
+    wheel.advance(now, due);
+    for (size_t first = 0; first < due.size(); first += options.batchSize) {
+        size_t last = std::min(due.size(), first + options.batchSize);
+        fire(std::vector<TimerWheel::Entry>(due.begin() + first, due.begin() + last), now);
+    }
+
+    std::lock_guard<std::mutex> lock(mutex);
+    counters.schedules = wheel.size();
+}
+
+void Scheduler::fire(const std::vector<TimerWheel::Entry>& due, sqlite3_int64 now) {
+    EHS_MEASURE("scheduler.fire");
+    trace::Span span("scheduler.fire", "scheduler");
+    std::vector<LocalService::WriteOp> writes;
+    std::vector<TimerWheel::Entry> next;
+    long long skipped = 0;
+    writes.reserve(due.size());
+    next.reserve(due.size());
+
+    for (const TimerWheel::Entry& entry : due) {
+        // Every occurrence due by now is missed or current; the next one is the first still ahead
+        sqlite3_int64 missed = (now - entry.due) / entry.interval + 1;
+        sqlite3_int64 created = std::min<sqlite3_int64>(missed, std::max(1, options.maxCatchUp));
+        std::vector<sqlite3_int64> occurrences;
+        for (sqlite3_int64 k = missed - created; k < missed; ++k) {
+            occurrences.push_back(entry.due + k * entry.interval);
+        }
+        skipped += missed - created;
+
+        TimerWheel::Entry advanced = entry;
+        advanced.due = entry.due + missed * entry.interval;
+        next.push_back(advanced);
+        writes.push_back([entry, occurrences, advanced](sqlite3* db) {
+            return core::runSchedule(db, entry.id, entry.due, occurrences, advanced.due);
+        });
+    }
+
+    std::vector<core::Result> results = service.writeAll(writes);
+    long long tasks = 0;
+    long long failures = 0;
+    for (size_t i = 0; i < results.size(); ++i) {
+        if (results[i].ok) {
+            tasks += results[i].changes;
+            wheel.add(next[i]);
+        } else if (results[i].error == "Schedule not found.") {
+            // Deleted, or advanced by another scheduler: it is no longer ours to run
+            logging::debug("Dropping schedule {}: {}", due[i].id, results[i].error);
+        } else {
+            // Retried on the next tick from the same due time
+            ++failures;
+            wheel.add(due[i]);
+            logging::error("Cannot run schedule {}: {}", due[i].id, results[i].error);
+        }
+    }
+    if (skipped > 0) {
+        logging::warn("Skipped {} missed occurrences beyond the catch-up limit of {} per schedule", skipped,
+                      options.maxCatchUp);
+    }
+    logging::debug("Created {} tasks for {} due schedules", tasks, due.size());
+
+    std::lock_guard<std::mutex> lock(mutex);
+    counters.tasksCreated += tasks;
+    counters.skipped += skipped;
+    counters.failures += failures;
+}
+
+void Scheduler::start() {
+    thread = std::thread([this]() {
+        trace::setThreadName("scheduler");
+        addNew();
+        logging::info("Scheduler started with {} schedules", wheel.size());
+        std::unique_lock<std::mutex> lock(mutex);
+        while (!stopping) {
+            lock.unlock();
+            runDue(std::time(nullptr));
+            lock.lock();
+            // Wake just after the next second starts
+            auto now = std::chrono::system_clock::now();
+            auto next = std::chrono::time_point_cast<std::chrono::seconds>(now) + std::chrono::seconds(1);
+            wake.wait_until(lock, next, [this]() { return stopping; });
+        }
+    });
+}
+
+void Scheduler::stop() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    wake.notify_all();
+    if (thread.joinable()) {
+        thread.join();
+    }
+}
+
+Stats Scheduler::stats() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return counters;
+}
+
+}  // namespace scheduler
@@ -0,0 +1,164 @@
+#ifndef SCHEDULER_H_
+#define SCHEDULER_H_
+
+#include "../service/service.h"
+#include <sqlite3.h>
+#include <condition_variable>
+#include <cstddef>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+/**
+ * @namespace scheduler
+ * @brief Creates the tasks of recurring schedules when they fall due.
+ *
+ * Every schedule sits in an in-memory TimerWheel keyed on its next due time,
+ * so a tick only looks at the schedules due in that second, however many
+ * there are. Due schedules are advanced in batched transactions through
+ * LocalService::writeAll() with core::runSchedule(), which refuses to create
+ * an occurrence twice. The database stays the source of truth: the wheel is
+ * rebuilt from the schedules table on start, and schedules added since are
+ * picked up by ID.
+ *
+ * ehsd runs a Scheduler for its database; without ehsd, ehs --run-schedules
+ * creates whatever is due and exits, for cron. Two schedulers on one
+ * database never create an occurrence twice, but only one should run.
+ *
+ * Task deadlines are watched the same way by a DeadlineWatcher
+ * (scheduler/deadlines.h), from a heap rather than a wheel.
+ */
+namespace scheduler {
+
+/**
+ * @class TimerWheel
+ * @brief Hierarchical timing wheel with one-second ticks.
+ *
+ * Level 0 has 256 one-second slots; levels 1-3 have 64 slots each, covering
+ * 2^14 s (4.5 hours), 2^20 s (12 days) and 2^26 s (2 years). When a lower
+ * level wraps, the next slot of the level above is cascaded down; entries
+ * further out wait in an overflow list that is re-placed when level 3 wraps.
+ * add() and expiring an entry are O(1); each entry is cascaded at most once
+ * per level.
+ */
+class TimerWheel {
+public:
+    /// @brief A schedule as the wheel tracks it.
+    struct Entry {
+        sqlite3_int64 due = 0;       ///< Unix time the next occurrence is due
+        sqlite3_int64 interval = 0;  ///< Seconds between occurrences
+        int id = 0;                  ///< Schedule ID
+    };
+
+    /// @brief Starts the wheel at Unix time @p now; entries due at or before it expire on the next advance().
+    explicit TimerWheel(sqlite3_int64 now);
+
+    void add(const Entry& entry);
+
+    /**
+     * @brief Moves the wheel to @p now and appends the entries due by then to @p expired.
+     *
+     * Expired entries leave the wheel; add them again with their new due time.
+     */
+    void advance(sqlite3_int64 now, std::vector<Entry>& expired);
+
+    /// @brief Entries in the wheel.
+    size_t size() const { return count; }
+
+private:
+    static const int kNearBits = 8;
+    static const int kFarBits = 6;
+    static const int kFarLevels = 3;
+
+    void place(const Entry& entry);
+    void cascade(std::vector<Entry>& slot);
+
+    sqlite3_int64 current;                          ///< Last second processed
+    std::vector<Entry> near[1 << kNearBits];
+    std::vector<Entry> far[kFarLevels][1 << kFarBits];
+    std::vector<Entry> overflow;                    ///< Due more than 2^26 s ahead
+    std::vector<Entry> overdue;                     ///< Added with a due time already processed
+    size_t count = 0;
+};
+
+/**
+ * @struct Options
+ * @brief Catch-up policy and batching of a Scheduler.
+ */
+struct Options {
+    int maxCatchUp = 10;      ///< Missed occurrences created per schedule after downtime; older ones are skipped
+    int batchSize = 500;      ///< Schedules advanced per transaction
+};
+
+/**
+ * @struct Stats
+ * @brief Counters since the Scheduler was created.
+ */
+struct Stats {
+    size_t schedules = 0;         ///< Schedules in the wheel
+    long long tasksCreated = 0;   ///< Tasks created for due occurrences
+    long long skipped = 0;        ///< Missed occurrences beyond Options::maxCatchUp
+    long long failures = 0;       ///< Schedule advances that failed and will be retried
+};
+
+/**
+ * @class Scheduler
+ * @brief Drives a TimerWheel over the schedules of one database.
+ *
+ * After downtime, a schedule gets one task per missed occurrence, up to
+ * Options::maxCatchUp of the most recent ones, and its next due time moves
+ * to the first occurrence still ahead. Each task carries the schedule's
+ * description and is due (due_at) when the next occurrence is.
+ */
+class Scheduler {
+public:
+    explicit Scheduler(LocalService& service, const Options& options = Options());
+    ~Scheduler();
+    Scheduler(const Scheduler&) = delete;
+    Scheduler& operator=(const Scheduler&) = delete;
+
+    /**
+     * @brief Reads every schedule into the wheel.
+     *
+     * Schedules already due are created by the next runDue().
+     */
+    bool load(std::string& error);
+
+    /**
+     * @brief Picks up new schedules and creates the tasks due by @p now.
+     *
+     * Reads on the calling thread's read connection of the service's pool.
+     */
+    void runDue(sqlite3_int64 now);
+
+    /**
+     * @brief Loads the schedules and calls runDue() once a second on a thread of its own until stop().
+     *
+     * The thread holds one read connection of the pool while it runs.
+     */
+    void start();
+
+    void stop();
+
+    Stats stats() const;
+
+private:
+    void addNew();
+    void fire(const std::vector<TimerWheel::Entry>& due, sqlite3_int64 now);
+
+    LocalService& service;
+    Options options;
+    TimerWheel wheel;
+    int lastId = 0;               ///< Highest schedule ID in the wheel
+
+    mutable std::mutex mutex;     ///< Guards counters and stopping
+    std::condition_variable wake;
+    bool stopping = false;
+    Stats counters;
+    std::thread thread;
+};
+
+}  // namespace scheduler
+
+#endif  // SCHEDULER_H_
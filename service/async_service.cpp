@@ -0,0 +1,176 @@
+/**
+ * @file async_service.cpp
+ * @brief AsyncService: LocalService calls offloaded to the executor's blocking threads.
+ *
+ */
+
+#include "async_service.h"
+
+AsyncService::AsyncService(LocalService& local) : local(local) {}
+
+executor::Task<core::Result> AsyncService::registerUser(const std::string& username, const std::string& password,
+                                                        const std::string& role) {
+    return executor::blocking([this, username, password, role]() { return local.registerUser(username, password, role); });
+}
+
+executor::Task<core::LoginResult> AsyncService::login(const std::string& username, const std::string& password) {
+    return executor::blocking([this, username, password]() { return local.login(username, password); });
+}
+
+executor::Task<core::Rows<core::TaskRecord>> AsyncService::listTasks(int workerId, int afterId, int limit) {
+    return executor::blocking([this, workerId, afterId, limit]() { return local.listTasks(workerId, afterId, limit); });
+}
+
+executor::Task<core::Rows<core::TaskRecord>> AsyncService::listTaskHistory(int workerId, int afterId, int limit) {
+    return executor::blocking([this, workerId, afterId, limit]() {
+        return local.listTaskHistory(workerId, afterId, limit);
+    });
+}
+
+executor::Task<core::Rows<core::TaskRecord>> AsyncService::listOpenTasks(int workerId) {
+    return executor::blocking([this, workerId]() { return local.listOpenTasks(workerId); });
+}
+
+executor::Task<core::Rows<core::TaskRecord>> AsyncService::listTasksByStatus(const std::string& status) {
+    return executor::blocking([this, status]() { return local.listTasksByStatus(status); });
+}
+
+executor::Task<core::Rows<core::WorkerRecord>> AsyncService::listWorkers() {
+    return executor::blocking([this]() { return local.listWorkers(); });
+}
+
+executor::Task<core::Rows<core::RuleRecord>> AsyncService::listRules() {
+    return executor::blocking([this]() { return local.listRules(); });
+}
+
+executor::Task<core::Result> AsyncService::assignTask(int workerId, const std::string& description,
+                                                      sqlite3_int64 dueAt, int priority) {
+    return executor::blocking([this, workerId, description, dueAt, priority]() {
+        return local.assignTask(workerId, description, dueAt, priority);
+    });
+}
+
+executor::Task<core::Result> AsyncService::reportViolation(int taskId, const std::string& status,
+                                                           const std::string& comment) {
+    return executor::blocking([this, taskId, status, comment]() { return local.reportViolation(taskId, status, comment); });
+}
+
+executor::Task<core::Result> AsyncService::addRule(const std::string& text) {
+    return executor::blocking([this, text]() { return local.addRule(text); });
+}
+
+executor::Task<core::Result> AsyncService::deleteRule(int ruleId) {
+    return executor::blocking([this, ruleId]() { return local.deleteRule(ruleId); });
+}
+
+executor::Task<core::Result> AsyncService::deleteTask(int taskId) {
+    return executor::blocking([this, taskId]() { return local.deleteTask(taskId); });
+}
+
+executor::Task<core::Result> AsyncService::submitRuleFeedback(int ruleId, int workerId, int rating,
+                                                              const std::string& text) {
+    return executor::blocking(
+        [this, ruleId, workerId, rating, text]() { return local.submitRuleFeedback(ruleId, workerId, rating, text); });
+}
+
+executor::Task<core::Rows<core::FeedbackSummary>> AsyncService::listFeedbackSummaries() {
+    return executor::blocking([this]() { return local.listFeedbackSummaries(); });
+}
+
+executor::Task<core::Rows<core::FeedbackRecord>> AsyncService::listRuleFeedback(int ruleId, sqlite3_int64 beforeId,
+                                                                                int limit) {
+    return executor::blocking([this, ruleId, beforeId, limit]() { return local.listRuleFeedback(ruleId, beforeId, limit); });
+}
+
+executor::Task<core::SearchResult> AsyncService::search(const std::string& query, int workerId) {
+    return executor::blocking([this, query, workerId]() { return local.search(query, workerId); });
+}
+
+executor::Task<core::Result> AsyncService::addSchedule(int workerId, const std::string& description,
+                                                       sqlite3_int64 intervalSeconds, sqlite3_int64 firstDue) {
+    return executor::blocking([this, workerId, description, intervalSeconds, firstDue]() {
+        return local.addSchedule(workerId, description, intervalSeconds, firstDue);
+    });
+}
+
+executor::Task<core::Rows<core::ScheduleRecord>> AsyncService::listSchedules() {
+    return executor::blocking([this]() { return local.listSchedules(); });
+}
+
+executor::Task<core::Result> AsyncService::deleteSchedule(int scheduleId) {
+    return executor::blocking([this, scheduleId]() { return local.deleteSchedule(scheduleId); });
+}
+
+executor::Task<core::Rows<core::TaskRecord>> AsyncService::listOverdue(int afterPriority, sqlite3_int64 afterDue,
+                                                                        int afterId, int limit) {
+    return executor::blocking([this, afterPriority, afterDue, afterId, limit]() {
+        return local.listOverdue(afterPriority, afterDue, afterId, limit);
+    });
+}
+
+executor::Task<core::Rows<core::TaskRecord>> AsyncService::autoAssignTasks(std::vector<std::string> descriptions,
+                                                                            sqlite3_int64 dueAt, int priority,
+                                                                            const std::string& site) {
+    return executor::blocking([this, descriptions, dueAt, priority, site]() {
+        return local.autoAssignTasks(descriptions, dueAt, priority, site);
+    });
+}
+
+executor::Task<core::Rows<core::WorkerLoad>> AsyncService::listWorkerLoads() {
+    return executor::blocking([this]() { return local.listWorkerLoads(); });
+}
+
+executor::Task<core::Result> AsyncService::setWorkerAvailability(int workerId, bool available, int weight) {
+    return executor::blocking(
+        [this, workerId, available, weight]() { return local.setWorkerAvailability(workerId, available, weight); });
+}
+
+executor::Task<core::Result> AsyncService::addShift(int workerId, const std::string& site, sqlite3_int64 startsAt,
+                                                    sqlite3_int64 endsAt) {
+    return executor::blocking([this, workerId, site, startsAt, endsAt]() {
+        return local.addShift(workerId, site, startsAt, endsAt);
+    });
+}
+
+executor::Task<core::Result> AsyncService::deleteShift(int shiftId) {
+    return executor::blocking([this, shiftId]() { return local.deleteShift(shiftId); });
+}
+
+executor::Task<core::Rows<core::ShiftRecord>> AsyncService::listShifts(int workerId) {
+    return executor::blocking([this, workerId]() { return local.listShifts(workerId); });
+}
+
+executor::Task<core::Rows<core::ShiftRecord>> AsyncService::listOnShift(const std::string& site, sqlite3_int64 from,
+                                                                        sqlite3_int64 to) {
+    return executor::blocking([this, site, from, to]() { return local.listOnShift(site, from, to); });
+}
+
+executor::Task<core::Result> AsyncService::ingestMedia(int taskId, int workerId, const std::string& data) {
+    return executor::blocking([this, taskId, workerId, data]() {
+        core::Result assigned = local.checkAssignment(taskId, workerId);
+        return assigned.ok ? core::storeTaskMedia(taskId, workerId, data) : assigned;
+    });
+}
+
+executor::Task<core::Result> AsyncService::recordReport(int taskId, int workerId, const std::string& report) {
+    return executor::blocking([this, taskId, workerId, report]() { return local.recordReport(taskId, workerId, report); });
+}
+
+executor::Task<core::Result> AsyncService::submitTaskReport(int taskId, int workerId, const std::string& report,
+                                                            const std::string& mediaPath) {
+    return executor::blocking(
+        [this, taskId, workerId, report, mediaPath]() { return local.submitTaskReport(taskId, workerId, report, mediaPath); });
+}
+
+executor::Task<std::vector<core::Result>> AsyncService::writeAll(std::vector<LocalService::WriteOp> writes) {
+    return executor::blocking([this, writes]() { return local.writeAll(writes); });
+}
+
+executor::Task<core::Result> AsyncService::submitTaskReportData(int taskId, int workerId, std::string report,
+                                                                std::string mediaData) {
+    core::Result saved = co_await ingestMedia(taskId, workerId, mediaData);
+    if (!saved.ok) {
+        co_return saved;
+    }
+    co_return co_await recordReport(taskId, workerId, report);
+}
@@ -0,0 +1,95 @@
+#ifndef ASYNC_SERVICE_H_
+#define ASYNC_SERVICE_H_
+
+#include "service.h"
+#include "../executor/task.h"
+#include <string>
+
+/**
+ * @class AsyncService
+ * @brief Non-blocking form of LocalService for front ends with many sessions.
+ *
+ * Every call returns at once with an executor::Task. The SQLite and
+ * filesystem work runs on the executor's blocking threads (executor::offload),
+ * and the continuation (a then() step, or the rest of a coroutine that
+ * co_awaits the Task) runs on the pool, so thousands of in-flight sessions
+ * need no thread each; ehsd drives its sessions this way.
+ * Blocking threads waiting on writes are what the ConnectionPool writer
+ * commits together, so size them (EHS_IO_THREADS) for the expected write
+ * concurrency.
+ */
+class AsyncService {
+public:
+    explicit AsyncService(LocalService& local);
+
+    executor::Task<core::Result> registerUser(const std::string& username, const std::string& password,
+                                              const std::string& role);
+    executor::Task<core::LoginResult> login(const std::string& username, const std::string& password);
+    executor::Task<core::Rows<core::TaskRecord>> listTasks(int workerId, int afterId = 0, int limit = -1);
+    executor::Task<core::Rows<core::TaskRecord>> listTaskHistory(int workerId, int afterId = 0, int limit = -1);
+    executor::Task<core::Rows<core::TaskRecord>> listOpenTasks(int workerId);
+    executor::Task<core::Rows<core::TaskRecord>> listTasksByStatus(const std::string& status);
+    executor::Task<core::Rows<core::WorkerRecord>> listWorkers();
+    executor::Task<core::Rows<core::RuleRecord>> listRules();
+    executor::Task<core::Result> assignTask(int workerId, const std::string& description, sqlite3_int64 dueAt,
+                                            int priority);
+    executor::Task<core::Result> reportViolation(int taskId, const std::string& status, const std::string& comment);
+    executor::Task<core::Result> addRule(const std::string& text);
+    executor::Task<core::Result> deleteRule(int ruleId);
+    executor::Task<core::Result> deleteTask(int taskId);
+    executor::Task<core::Result> submitRuleFeedback(int ruleId, int workerId, int rating, const std::string& text);
+    executor::Task<core::Rows<core::FeedbackSummary>> listFeedbackSummaries();
+    executor::Task<core::Rows<core::FeedbackRecord>> listRuleFeedback(int ruleId, sqlite3_int64 beforeId, int limit);
+    executor::Task<core::SearchResult> search(const std::string& query, int workerId);
+    executor::Task<core::Result> addSchedule(int workerId, const std::string& description,
+                                             sqlite3_int64 intervalSeconds, sqlite3_int64 firstDue);
+    executor::Task<core::Rows<core::ScheduleRecord>> listSchedules();
+    executor::Task<core::Result> deleteSchedule(int scheduleId);
+    executor::Task<core::Rows<core::TaskRecord>> listOverdue(int afterPriority, sqlite3_int64 afterDue, int afterId,
+                                                             int limit);
+    executor::Task<core::Rows<core::TaskRecord>> autoAssignTasks(std::vector<std::string> descriptions,
+                                                                 sqlite3_int64 dueAt, int priority,
+                                                                 const std::string& site);
+    executor::Task<core::Rows<core::WorkerLoad>> listWorkerLoads();
+    executor::Task<core::Result> setWorkerAvailability(int workerId, bool available, int weight);
+    executor::Task<core::Result> addShift(int workerId, const std::string& site, sqlite3_int64 startsAt,
+                                          sqlite3_int64 endsAt);
+    executor::Task<core::Result> deleteShift(int shiftId);
+    executor::Task<core::Rows<core::ShiftRecord>> listShifts(int workerId);
+    executor::Task<core::Rows<core::ShiftRecord>> listOnShift(const std::string& site, sqlite3_int64 from,
+                                                              sqlite3_int64 to);
+
+    /**
+     * @brief Writes uploaded report media to core::taskMediaPath(), once the task is found to be the worker's.
+     */
+    executor::Task<core::Result> ingestMedia(int taskId, int workerId, const std::string& data);
+
+    /**
+     * @brief Records a report whose media was ingested and marks the task completed.
+     */
+    executor::Task<core::Result> recordReport(int taskId, int workerId, const std::string& report);
+
+    /**
+     * @brief Copies media from a local path, then records the report.
+     */
+    executor::Task<core::Result> submitTaskReport(int taskId, int workerId, const std::string& report,
+                                                  const std::string& mediaPath);
+
+    /**
+     * @brief LocalService::writeAll() on a blocking thread.
+     */
+    executor::Task<std::vector<core::Result>> writeAll(std::vector<LocalService::WriteOp> writes);
+
+    /**
+     * @brief ingestMedia() followed by recordReport() if the media was saved.
+     *
+     * A coroutine, so the strings are taken by value.
+     */
+    executor::Task<core::Result> submitTaskReportData(int taskId, int workerId, std::string report,
+                                                      std::string mediaData);
+
+private:
+    LocalService& local;
+};
+
+#endif  // ASYNC_SERVICE_H_
@@ -0,0 +1,193 @@
+/**
+ * @file service.cpp
+ * @brief LocalService: the menu operations over a ConnectionPool.
+ *
+ */
+
+#include "service.h"
+#include "../archive/archive.h"
+#include "../db/ConnectionPool.h"
+#include <ctime>
+
+LocalService::LocalService(ConnectionPool& pool) : pool(pool) {}
+
+core::Result LocalService::registerUser(const std::string& username, const std::string& password,
+                                        const std::string& role) {
+    return pool.write([&](sqlite3* writer) { return core::registerUser(writer, username, password, role); });
+}
+
+core::LoginResult LocalService::login(const std::string& username, const std::string& password) {
+    return core::login(pool.reader(), username, password);
+}
+
+core::Rows<core::TaskRecord> LocalService::listTasks(int workerId, int afterId, int limit) {
+    return core::listTasks(pool.reader(), workerId, afterId, limit);
+}
+
+core::Rows<core::TaskRecord> LocalService::listTaskHistory(int workerId, int afterId, int limit) {
+    return archive::listHistory(pool.reader(), workerId, afterId, limit);
+}
+
+core::Rows<core::TaskRecord> LocalService::listOpenTasks(int workerId) {
+    return core::listOpenTasks(pool.reader(), workerId);
+}
+
+core::Rows<core::TaskRecord> LocalService::listTasksByStatus(const std::string& status) {
+    return core::listTasksByStatus(pool.reader(), status);
+}
+
+core::Rows<core::WorkerRecord> LocalService::listWorkers() {
+    return core::listWorkers(pool.reader());
+}
+
+core::Rows<core::RuleRecord> LocalService::listRules() {
+    return core::listRules(pool.reader());
+}
+
+core::Result LocalService::assignTask(int workerId, const std::string& description, sqlite3_int64 dueAt,
+                                      int priority) {
+    return pool.write([&](sqlite3* writer) {
+        return core::assignTask(writer, workerId, description, dueAt, priority);
+    });
+}
+
+core::Result LocalService::reportViolation(int taskId, const std::string& status, const std::string& comment) {
+    return pool.write([&](sqlite3* writer) { return core::reportViolation(writer, taskId, status, comment); });
+}
+
+core::Result LocalService::submitTaskReport(int taskId, int workerId, const std::string& report,
+                                            const std::string& mediaPath) {
+    core::Result assigned = checkAssignment(taskId, workerId);
+    if (!assigned.ok) {
+        return assigned;
+    }
+    core::Result saved = core::saveTaskMedia(taskId, workerId, mediaPath);
+    return saved.ok ? recordReport(taskId, workerId, report) : saved;
+}
+
+core::Result LocalService::submitTaskReportData(int taskId, int workerId, const std::string& report,
+                                                const std::string& mediaData) {
+    core::Result assigned = checkAssignment(taskId, workerId);
+    if (!assigned.ok) {
+        return assigned;
+    }
+    core::Result saved = core::storeTaskMedia(taskId, workerId, mediaData);
+    return saved.ok ? recordReport(taskId, workerId, report) : saved;
+}
+
+core::Result LocalService::checkAssignment(int taskId, int workerId) {
+    return core::checkTaskAssignment(pool.reader(), taskId, workerId);
+}
+
+core::Result LocalService::recordReport(int taskId, int workerId, const std::string& report) {
+    std::string savedPath = core::taskMediaPath(taskId, workerId);
+    return pool.write([&](sqlite3* writer) {
+        return core::recordTaskReport(writer, taskId, workerId, report, savedPath);
+    });
+}
+
+std::vector<core::Result> LocalService::writeAll(const std::vector<WriteOp>& writes) {
+    return pool.write([&](sqlite3* writer) {
+        // Inside a group commit the writes already share the writer's transaction
+        bool own = sqlite3_get_autocommit(writer) &&
+                   sqlite3_exec(writer, "BEGIN IMMEDIATE;", nullptr, nullptr, nullptr) == SQLITE_OK;
+        std::vector<core::Result> results;
+        results.reserve(writes.size());
+        for (const WriteOp& write : writes) {
+            results.push_back(write(writer));
+        }
+        if (own && sqlite3_exec(writer, "COMMIT;", nullptr, nullptr, nullptr) != SQLITE_OK) {
+            std::string error = std::string("Commit failed: ") + sqlite3_errmsg(writer);
+            sqlite3_exec(writer, "ROLLBACK;", nullptr, nullptr, nullptr);
+            for (core::Result& result : results) {
+                result = core::Result();
+                result.ok = false;
+                result.error = error;
+            }
+        }
+        return results;
+    });
+}
+
+core::Result LocalService::addRule(const std::string& text) {
+    return pool.write([&](sqlite3* writer) { return core::addRule(writer, text); });
+}
+
+core::Result LocalService::deleteRule(int ruleId) {
+    return pool.write([&](sqlite3* writer) { return core::deleteRule(writer, ruleId); });
+}
+
+core::Result LocalService::deleteTask(int taskId) {
+    return pool.write([&](sqlite3* writer) { return core::deleteTask(writer, taskId); });
+}
+
+core::Result LocalService::submitRuleFeedback(int ruleId, int workerId, int rating, const std::string& text) {
+    return pool.write([&](sqlite3* writer) { return core::submitRuleFeedback(writer, ruleId, workerId, rating, text); });
+}
+
+core::Rows<core::FeedbackSummary> LocalService::listFeedbackSummaries() {
+    return core::listFeedbackSummaries(pool.reader());
+}
+
+core::Rows<core::FeedbackRecord> LocalService::listRuleFeedback(int ruleId, sqlite3_int64 beforeId, int limit) {
+    return core::listRuleFeedback(pool.reader(), ruleId, beforeId, limit);
+}
+
+core::SearchResult LocalService::search(const std::string& query, int workerId) {
+    return core::search(pool.reader(), query, workerId);
+}
+
+core::Result LocalService::addSchedule(int workerId, const std::string& description, sqlite3_int64 intervalSeconds,
+                                       sqlite3_int64 firstDue) {
+    return pool.write([&](sqlite3* writer) {
+        return core::addSchedule(writer, workerId, description, intervalSeconds, firstDue);
+    });
+}
+
+core::Rows<core::ScheduleRecord> LocalService::listSchedules() {
+    return core::listSchedules(pool.reader());
+}
+
+core::Result LocalService::deleteSchedule(int scheduleId) {
+    return pool.write([&](sqlite3* writer) { return core::deleteSchedule(writer, scheduleId); });
+}
+
+core::Rows<core::TaskRecord> LocalService::listOverdue(int afterPriority, sqlite3_int64 afterDue, int afterId,
+                                                       int limit) {
+    return core::listOverdue(pool.reader(), std::time(nullptr), afterPriority, afterDue, afterId, limit);
+}
+
+core::Rows<core::TaskRecord> LocalService::autoAssignTasks(const std::vector<std::string>& descriptions,
+                                                           sqlite3_int64 dueAt, int priority, const std::string& site) {
+    sqlite3_int64 now = std::time(nullptr);
+    sqlite3_int64 until = dueAt > now ? dueAt : now + 1;
+    return pool.write([&](sqlite3* writer) {
+        return core::autoAssignTasks(writer, descriptions, dueAt, priority, site, now, until);
+    });
+}
+
+core::Rows<core::WorkerLoad> LocalService::listWorkerLoads() {
+    return core::listWorkerLoads(pool.reader());
+}
+
+core::Result LocalService::setWorkerAvailability(int workerId, bool available, int weight) {
+    return pool.write([&](sqlite3* writer) { return core::setWorkerAvailability(writer, workerId, available, weight); });
+}
+
+core::Result LocalService::addShift(int workerId, const std::string& site, sqlite3_int64 startsAt,
+                                    sqlite3_int64 endsAt) {
+    return pool.write([&](sqlite3* writer) { return core::addShift(writer, workerId, site, startsAt, endsAt); });
+}
+
+core::Result LocalService::deleteShift(int shiftId) {
+    return pool.write([&](sqlite3* writer) { return core::deleteShift(writer, shiftId); });
+}
+
+core::Rows<core::ShiftRecord> LocalService::listShifts(int workerId) {
+    return core::listShifts(pool.reader(), workerId, std::time(nullptr));
+}
+
+core::Rows<core::ShiftRecord> LocalService::listOnShift(const std::string& site, sqlite3_int64 from,
+                                                        sqlite3_int64 to) {
+    return core::listOnShift(pool.reader(), site, from, to);
+}
@@ -0,0 +1,171 @@
+#ifndef SERVICE_H_
+#define SERVICE_H_
+
+#include "../core/core.h"
+#include <functional>
+#include <string>
+#include <vector>
+
+class ConnectionPool;
+
+/**
+ * @class Service
+ * @brief The operations behind the worker and manager menus.
+ *
+ * The menus in User, Worker, Manager and menu/menu.h only talk to this
+ * interface, so the same menus run against the local database
+ * (LocalService) or against the ehsd daemon (RemoteService in
+ * client/client.h). Implementations are safe to call from several threads.
+ */
+class Service {
+public:
+    virtual ~Service() = default;
+
+    virtual core::Result registerUser(const std::string& username, const std::string& password,
+                                      const std::string& role) = 0;
+    virtual core::LoginResult login(const std::string& username, const std::string& password) = 0;
+    /// @brief Tasks of @p workerId (-1 for all) in id order; @p afterId and @p limit page them as in core::listTasks().
+    virtual core::Rows<core::TaskRecord> listTasks(int workerId, int afterId = 0, int limit = -1) = 0;
+    /// @brief Like listTasks(), including tasks moved to the archive (archive/archive.h).
+    virtual core::Rows<core::TaskRecord> listTaskHistory(int workerId, int afterId = 0, int limit = -1) = 0;
+    virtual core::Rows<core::TaskRecord> listOpenTasks(int workerId) = 0;
+    virtual core::Rows<core::TaskRecord> listTasksByStatus(const std::string& status) = 0;
+    virtual core::Rows<core::WorkerRecord> listWorkers() = 0;
+    virtual core::Rows<core::RuleRecord> listRules() = 0;
+    /// @brief Assigns a task; @p dueAt is a Unix time or 0 for no deadline, @p priority 1 (high) to 3 (low).
+    virtual core::Result assignTask(int workerId, const std::string& description, sqlite3_int64 dueAt = 0,
+                                    int priority = 2) = 0;
+    virtual core::Result reportViolation(int taskId, const std::string& status, const std::string& comment) = 0;
+    virtual core::Result submitTaskReport(int taskId, int workerId, const std::string& report,
+                                          const std::string& mediaPath) = 0;
+    virtual core::Result addRule(const std::string& text) = 0;
+    virtual core::Result deleteRule(int ruleId) = 0;
+    virtual core::Result deleteTask(int taskId) = 0;
+    virtual core::Result submitRuleFeedback(int ruleId, int workerId, int rating, const std::string& text) = 0;
+    virtual core::Rows<core::FeedbackSummary> listFeedbackSummaries() = 0;
+    virtual core::Rows<core::FeedbackRecord> listRuleFeedback(int ruleId, sqlite3_int64 beforeId, int limit) = 0;
+    virtual core::SearchResult search(const std::string& query, int workerId) = 0;
+    virtual core::Result addSchedule(int workerId, const std::string& description, sqlite3_int64 intervalSeconds,
+                                     sqlite3_int64 firstDue) = 0;
+    virtual core::Rows<core::ScheduleRecord> listSchedules() = 0;
+    virtual core::Result deleteSchedule(int scheduleId) = 0;
+    /// @brief One page of open tasks past their deadline as of now; see core::listOverdue().
+    virtual core::Rows<core::TaskRecord> listOverdue(int afterPriority, sqlite3_int64 afterDue, int afterId,
+                                                     int limit) = 0;
+    /**
+     * @brief Hands each description to the least-loaded available worker; see core::autoAssignTasks().
+     *
+     * With a @p site, only workers on shift there between now and the
+     * deadline (or now, without one) are considered.
+     */
+    virtual core::Rows<core::TaskRecord> autoAssignTasks(const std::vector<std::string>& descriptions,
+                                                         sqlite3_int64 dueAt = 0, int priority = 2,
+                                                         const std::string& site = std::string()) = 0;
+    virtual core::Rows<core::WorkerLoad> listWorkerLoads() = 0;
+    virtual core::Result setWorkerAvailability(int workerId, bool available, int weight) = 0;
+    virtual core::Result addShift(int workerId, const std::string& site, sqlite3_int64 startsAt,
+                                  sqlite3_int64 endsAt) = 0;
+    virtual core::Result deleteShift(int shiftId) = 0;
+    /// @brief A worker's shifts that have not ended yet.
+    virtual core::Rows<core::ShiftRecord> listShifts(int workerId) = 0;
+    /// @brief Who is on shift at @p site during [@p from, @p to); see core::listOnShift().
+    virtual core::Rows<core::ShiftRecord> listOnShift(const std::string& site, sqlite3_int64 from,
+                                                      sqlite3_int64 to) = 0;
+
+    /**
+     * @brief Ends the logged-in session. LocalService keeps no session, so this does nothing there.
+     */
+    virtual void logout() {}
+};
+
+/**
+ * @class LocalService
+ * @brief Service over a ConnectionPool in this process.
+ *
+ * Reads run on the calling thread's read connection and writes on the pool's
+ * writer thread. Report media is copied before the write is queued, so the
+ * writer never waits for the filesystem.
+ */
+class LocalService : public Service {
+public:
+    explicit LocalService(ConnectionPool& pool);
+
+    core::Result registerUser(const std::string& username, const std::string& password,
+                              const std::string& role) override;
+    core::LoginResult login(const std::string& username, const std::string& password) override;
+    core::Rows<core::TaskRecord> listTasks(int workerId, int afterId = 0, int limit = -1) override;
+    core::Rows<core::TaskRecord> listTaskHistory(int workerId, int afterId = 0, int limit = -1) override;
+    core::Rows<core::TaskRecord> listOpenTasks(int workerId) override;
+    core::Rows<core::TaskRecord> listTasksByStatus(const std::string& status) override;
+    core::Rows<core::WorkerRecord> listWorkers() override;
+    core::Rows<core::RuleRecord> listRules() override;
+    core::Result assignTask(int workerId, const std::string& description, sqlite3_int64 dueAt = 0,
+                            int priority = 2) override;
+    core::Result reportViolation(int taskId, const std::string& status, const std::string& comment) override;
+    core::Result submitTaskReport(int taskId, int workerId, const std::string& report,
+                                  const std::string& mediaPath) override;
+    core::Result addRule(const std::string& text) override;
+    core::Result deleteRule(int ruleId) override;
+    core::Result deleteTask(int taskId) override;
+    core::Result submitRuleFeedback(int ruleId, int workerId, int rating, const std::string& text) override;
+    core::Rows<core::FeedbackSummary> listFeedbackSummaries() override;
+    core::Rows<core::FeedbackRecord> listRuleFeedback(int ruleId, sqlite3_int64 beforeId, int limit) override;
+    core::SearchResult search(const std::string& query, int workerId) override;
+    core::Result addSchedule(int workerId, const std::string& description, sqlite3_int64 intervalSeconds,
+                             sqlite3_int64 firstDue) override;
+    core::Rows<core::ScheduleRecord> listSchedules() override;
+    core::Result deleteSchedule(int scheduleId) override;
+    core::Rows<core::TaskRecord> listOverdue(int afterPriority, sqlite3_int64 afterDue, int afterId,
+                                             int limit) override;
+    core::Rows<core::TaskRecord> autoAssignTasks(const std::vector<std::string>& descriptions, sqlite3_int64 dueAt = 0,
+                                                 int priority = 2, const std::string& site = std::string()) override;
+    core::Rows<core::WorkerLoad> listWorkerLoads() override;
+    core::Result setWorkerAvailability(int workerId, bool available, int weight) override;
+    core::Result addShift(int workerId, const std::string& site, sqlite3_int64 startsAt, sqlite3_int64 endsAt) override;
+    core::Result deleteShift(int shiftId) override;
+    core::Rows<core::ShiftRecord> listShifts(int workerId) override;
+    core::Rows<core::ShiftRecord> listOnShift(const std::string& site, sqlite3_int64 from, sqlite3_int64 to) override;
+
+    /**
+     * @brief Stores uploaded report media, then records the report.
+     *
+     * Used by ehsd, where the media arrives as bytes rather than a local path.
+     */
+    core::Result submitTaskReportData(int taskId, int workerId, const std::string& report,
+                                      const std::string& mediaData);
+
+    /// @brief One write, run on the writer connection.
+    using WriteOp = std::function<core::Result(sqlite3*)>;
+
+    /**
+     * @brief Runs several writes in one transaction with one writer round trip.
+     *
+     * A write that fails does not undo the others. If the commit itself
+     * fails, every result reports it.
+     *
+     * @return One result per write, in order.
+     */
+    std::vector<core::Result> writeAll(const std::vector<WriteOp>& writes);
+
+    /**
+     * @brief Checks that a task is the worker's before their report media is saved.
+     */
+    core::Result checkAssignment(int taskId, int workerId);
+
+    /**
+     * @brief Records a report whose media is already at core::taskMediaPath().
+     *
+     * The media is removed if the task turns out not to be the worker's.
+     */
+    core::Result recordReport(int taskId, int workerId, const std::string& report);
+
+    /**
+     * @brief The pool this service runs on.
+     */
+    ConnectionPool& connections() { return pool; }
+
+private:
+    ConnectionPool& pool;
+};
+
+#endif  // SERVICE_H_
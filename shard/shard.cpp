@@ -0,0 +1,206 @@
+/**
+ * @file shard.cpp
+ * @brief Shard map parsing, opening the shards and the merged violation listing.
+ *
+ * The merge is a k-way merge over per-shard cursors. A cursor holds the page
+ * being merged and, when that page was full, a future for the next one,
+ * requested as soon as the current page arrived (keyset pagination on
+ * violation time and id, so a shard never re-reads rows it already sent).
+ * A max-heap holds the head row of every cursor that still has rows.
+ */
+
+#include "shard.h"
+#include "../logging/logging.h"
+#include "../metrics/metrics.h"
+#include "../trace/trace.h"
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <queue>
+#include <sstream>
+#include <tuple>
+
+namespace shard {
+
+bool loadMap(const std::string& file, std::vector<Plant>& plants, std::string& error) {
+    std::ifstream in(file);
+    if (!in) {
+        error = "Cannot read shard map " + file;
+        return false;
+    }
+
+    plants.clear();
+    std::string line;
+    int lineNumber = 0;
+    while (std::getline(in, line)) {
+        ++lineNumber;
+        line = line.substr(0, line.find('#'));
+        std::istringstream fields(line);
+        Plant plant;
+        if (!(fields >> plant.name)) {
+            continue;
+        }
+        std::getline(fields >> std::ws, plant.path);
+        plant.path.erase(plant.path.find_last_not_of(" \t\r") + 1);
+        if (plant.path.empty()) {
+            error = file + ":" + std::to_string(lineNumber) + ": plant " + plant.name + " has no database file";
+            return false;
+        }
+        for (const Plant& other : plants) {
+            if (other.name == plant.name) {
+                error = file + ":" + std::to_string(lineNumber) + ": plant " + plant.name + " is listed twice";
+                return false;
+            }
+        }
+        plants.push_back(plant);
+    }
+    if (plants.empty()) {
+        error = "Shard map " + file + " lists no plants";
+        return false;
+    }
+    return true;
+}
+
+ShardSet::ShardSet(std::vector<Plant> plants) {
+    for (Plant& plant : plants) {
+        std::unique_ptr<Shard> shard(new Shard);
+        shard->plant = std::move(plant);
+        shards.push_back(std::move(shard));
+    }
+}
+
+ShardSet::~ShardSet() {
+    for (auto& shard : shards) {
+        shard->pool.reset();
+        shard->manager.reset();
+    }
+}
+
+bool ShardSet::open(std::string& error) {
+    trace::Span span("shard.open", "shard");
+    int readers = std::max(1, executor::blockingThreadCount());
+    for (auto& shard : shards) {
+        // Without SQLITE_OPEN_CREATE a mistyped path fails here instead of listing an empty new database
+        std::error_code missing;
+        if (!std::filesystem::exists(shard->plant.path, missing)) {
+            error = "The database of plant " + shard->plant.name + " does not exist: " + shard->plant.path;
+            return false;
+        }
+        shard->manager.reset(new DatabaseManager(shard->plant.path, SQLITE_OPEN_READWRITE));
+        if (!shard->manager->getDB()) {
+            error = "Cannot open the database of plant " + shard->plant.name + ": " + shard->plant.path;
+            return false;
+        }
+        shard->pool.reset(new ConnectionPool(shard->manager->getDB(), shard->plant.path, readers));
+    }
+    logging::info("Opened {} plant databases", shards.size());
+    return true;
+}
+
+int ShardSet::find(const std::string& plant) const {
+    for (size_t i = 0; i < shards.size(); ++i) {
+        if (shards[i]->plant.name == plant) {
+            return static_cast<int>(i);
+        }
+    }
+    return -1;
+}
+
+namespace {
+
+/// @brief Merge state of one shard.
+struct Cursor {
+    std::vector<core::TaskRecord> page;
+    size_t next = 0;                                   ///< Next row of page to merge
+    std::future<core::Rows<core::TaskRecord>> pending; ///< Next page, if one was requested
+};
+
+/// @brief Requests the page of shard @p index that follows (@p beforeTimestamp, @p beforeId).
+std::future<core::Rows<core::TaskRecord>> requestPage(ShardSet& shards, size_t index, const ViolationQuery& query,
+                                                      const std::string& beforeTimestamp, int beforeId) {
+    return shards.read(index, [query, beforeTimestamp, beforeId](sqlite3* db) {
+        if (!db) {
+            core::Rows<core::TaskRecord> rows;
+            rows.ok = false;
+            rows.error = "no read connection";
+            return rows;
+        }
+        return core::listViolations(db, query.from, query.to, beforeTimestamp, beforeId, query.pageRows);
+    });
+}
+
+}  // namespace
+
+ListSummary listViolations(ShardSet& shards, const ViolationQuery& query,
+                           const std::function<bool(const Plant&, const core::TaskRecord&)>& emit) {
+    EHS_MEASURE("shard.listViolations");
+    trace::Span span("shard.listViolations", "shard");
+    ListSummary summary;
+    std::vector<Cursor> cursors(shards.size());
+    for (size_t i = 0; i < cursors.size(); ++i) {
+        cursors[i].pending = requestPage(shards, i, query, "", 0);
+    }
+
+    // Head rows ordered by violation time, then id, then shard: the top is the next row to emit
+    using Head = std::tuple<std::string, int, size_t>;
+    std::priority_queue<Head> heads;
+
+    // Waits for a shard's requested page, asks for the one after it and pushes its first row
+    auto advance = [&](size_t index) {
+        Cursor& cursor = cursors[index];
+        core::Rows<core::TaskRecord> rows;
+        try {
+            rows = cursor.pending.get();
+        } catch (const std::future_error&) {
+            rows.ok = false;
+            rows.error = "shutting down";
+        }
+        if (!rows.ok) {
+            summary.ok = false;
+            summary.error += (summary.error.empty() ? "" : "; ") + shards.plant(index).name + ": " + rows.error;
+            logging::error("Cannot list violations of plant {}: {}", shards.plant(index).name, rows.error);
+            cursor.page.clear();
+            return;
+        }
+        ++summary.pages;
+        cursor.page = std::move(rows.rows);
+        cursor.next = 0;
+        if (cursor.page.size() == static_cast<size_t>(query.pageRows)) {
+            const core::TaskRecord& last = cursor.page.back();
+            cursor.pending = requestPage(shards, index, query, last.violationTimestamp, last.id);
+        }
+        if (!cursor.page.empty()) {
+            heads.emplace(cursor.page[0].violationTimestamp, cursor.page[0].id, index);
+        }
+    };
+
+    for (size_t i = 0; i < cursors.size(); ++i) {
+        advance(i);
+    }
+
+    while (!heads.empty() && (query.limit < 0 || summary.rows < query.limit)) {
+        size_t index = std::get<2>(heads.top());
+        heads.pop();
+        Cursor& cursor = cursors[index];
+        ++summary.rows;
+        if (!emit(shards.plant(index), cursor.page[cursor.next])) {
+            break;
+        }
+        if (++cursor.next < cursor.page.size()) {
+            const core::TaskRecord& task = cursor.page[cursor.next];
+            heads.emplace(task.violationTimestamp, task.id, index);
+        } else if (cursor.pending.valid()) {
+            advance(index);
+        }
+    }
+
+    // Pages still in flight reference the shards; let them finish before returning
+    for (Cursor& cursor : cursors) {
+        if (cursor.pending.valid()) {
+            cursor.pending.wait();
+        }
+    }
+    return summary;
+}
+
+}  // namespace shard
@@ -0,0 +1,147 @@
+#ifndef SHARD_H_
+#define SHARD_H_
+
+#include "../core/core.h"
+#include "../db/ConnectionPool.h"
+#include "../db/Database.h"
+#include "../executor/executor.h"
+#include <cstddef>
+#include <functional>
+#include <future>
+#include <memory>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+/**
+ * @namespace shard
+ * @brief One database per plant, with reads fanned out over all of them.
+ *
+ * A shard map file names each plant and its database file:
+ * @code
+ * # plant    database
+ * hamburg    /srv/ehs/hamburg.db
+ * valencia   /srv/ehs/valencia.db
+ * @endcode
+ *
+ * Writes for a plant go to its database alone (ehs --plant NAME). A ShardSet
+ * opens every shard behind its own ConnectionPool for cross-plant reads,
+ * which run on every shard at once on the executor's blocking threads;
+ * listViolations() merges their sorted pages into one stream.
+ */
+namespace shard {
+
+/// @brief A plant and its database file.
+struct Plant {
+    std::string name;
+    std::string path;
+};
+
+/**
+ * @brief Reads a shard map: one "plant path" pair per line, '#' starts a comment.
+ *
+ * @return False, with @p error set, if the file cannot be read, a line has no
+ *         path, a plant is named twice or no plant is listed.
+ */
+bool loadMap(const std::string& file, std::vector<Plant>& plants, std::string& error);
+
+/**
+ * @class ShardSet
+ * @brief The open databases of a set of plants.
+ */
+class ShardSet {
+public:
+    explicit ShardSet(std::vector<Plant> plants);
+    ~ShardSet();
+    ShardSet(const ShardSet&) = delete;
+    ShardSet& operator=(const ShardSet&) = delete;
+
+    /**
+     * @brief Opens every shard's existing database and starts its ConnectionPool.
+     *
+     * Shards are only read, so a database is never created and its schema
+     * is left as it is; a missing file fails the open, naming its plant.
+     * Each pool allows one read connection per blocking thread, so reads
+     * never wait for a connection; start the executor first.
+     */
+    bool open(std::string& error);
+
+    /// @brief Number of shards.
+    size_t size() const { return shards.size(); }
+
+    /// @brief Plant of shard @p index.
+    const Plant& plant(size_t index) const { return shards[index]->plant; }
+
+    /// @brief Index of the shard of @p plant, or -1 if there is none.
+    int find(const std::string& plant) const;
+
+    /// @brief ConnectionPool of shard @p index.
+    ConnectionPool& pool(size_t index) { return *shards[index]->pool; }
+
+    /**
+     * @brief Runs @p job with a read connection of shard @p index on a blocking thread.
+     *
+     * If the executor is shutting down the future reports std::future_error
+     * (broken_promise) instead of a result.
+     */
+    template <typename F>
+    std::future<std::invoke_result_t<F, sqlite3*>> read(size_t index, F&& job) {
+        using Result = std::invoke_result_t<F, sqlite3*>;
+        auto task = std::make_shared<std::packaged_task<Result(sqlite3*)>>(std::forward<F>(job));
+        std::future<Result> future = task->get_future();
+        ConnectionPool* shardPool = &pool(index);
+        executor::offload([task, shardPool]() { (*task)(shardPool->reader()); });
+        return future;
+    }
+
+private:
+    struct Shard {
+        Plant plant;
+        std::unique_ptr<DatabaseManager> manager;
+        std::unique_ptr<ConnectionPool> pool;   ///< Declared after manager, so it is destroyed first
+    };
+    std::vector<std::unique_ptr<Shard>> shards;
+};
+
+/**
+ * @struct ViolationQuery
+ * @brief Time range and size of a cross-plant violation listing.
+ */
+struct ViolationQuery {
+    std::string from;             ///< Earliest violation time; empty for no bound
+    std::string to;               ///< Latest violation time (a date alone covers the day); empty for no bound
+    long long limit = -1;         ///< Rows to list; -1 for all
+    int pageRows = 500;           ///< Rows fetched from a shard at a time
+};
+
+/**
+ * @struct ListSummary
+ * @brief Outcome of a cross-plant listing.
+ */
+struct ListSummary {
+    bool ok = true;               ///< False if a shard could not be read; the other shards are still listed
+    std::string error;            ///< Errors of the shards that failed
+    long long rows = 0;           ///< Rows passed to the callback
+    int pages = 0;                ///< Pages fetched over all shards
+};
+
+/**
+ * @brief Lists the violations of every plant, newest first, merged into one stream.
+ *
+ * Every shard is read one page at a time on the executor's blocking threads:
+ * the first pages are fetched in parallel, and each shard's next page is
+ * fetched while its current one is being merged. Rows reach @p emit as soon
+ * as their place in the merged order is known, so memory is bounded by two
+ * pages per shard and the first rows come out before any shard is read to
+ * the end.
+ *
+ * @param shards Open shards.
+ * @param query Time range and limit.
+ * @param emit Called with each row and its plant; returning false stops the listing.
+ */
+ListSummary listViolations(ShardSet& shards, const ViolationQuery& query,
+                           const std::function<bool(const Plant&, const core::TaskRecord&)>& emit);
+
+}  // namespace shard
+
+#endif  // SHARD_H_
@@ -0,0 +1,196 @@
+/**
+ * @file ehs_snapshot.cpp
+ * @brief Command-line front end of the columnar task snapshot.
+ *
+ * Compile from the repository root:
+ * @code
+ * g++ -std=c++20 -O2 snapshot/ehs_snapshot.cpp snapshot/snapshot.cpp archive/archive.cpp core/core.cpp db/ConnectionPool.cpp logging/logging.cpp executor/executor.cpp json/json.cpp metrics/metrics.cpp trace/trace.cpp -lsqlite3 -lssl -lcrypto -lz -pthread -o ehs_snapshot
+ * @endcode
+ *
+ * Usage:
+ * @code
+ * ./ehs_snapshot write --db ehs.db --out tasks.snap [--archive FILE]
+ * ./ehs_snapshot query --snapshot tasks.snap [--worker ID] [--status STATUS]
+ *                      [--from TIME] [--to TIME] [--by-status | --by-worker | --list N]
+ * @endcode
+ *
+ * write includes the tasks moved to the archive database, --archive FILE,
+ * EHS_ARCHIVE_DB or the database's default archive (archive::defaultPath),
+ * whichever is given first, when that file exists.
+ *
+ * Times are "YYYY-MM-DD" or "YYYY-MM-DD HH:MM:SS" and bound the violation
+ * time. Query results are printed as NDJSON, one object per line.
+ */
+
+#include "snapshot.h"
+#include "../archive/archive.h"
+#include "../json/json.h"
+#include <chrono>
+#include <cstdlib>
+#include <filesystem>
+#include <iostream>
+#include <string>
+
+namespace {
+
+int usage() {
+    std::cerr << "Usage: ehs_snapshot write --db FILE --out FILE [--archive FILE]\n"
+                 "       ehs_snapshot query --snapshot FILE [--worker ID] [--status STATUS]\n"
+                 "                          [--from TIME] [--to TIME] [--by-status | --by-worker | --list N]\n";
+    return 2;
+}
+
+int writeSnapshot(const std::string& dbPath, const std::string& archivePath, const std::string& out) {
+    sqlite3* db = nullptr;
+    if (sqlite3_open_v2(dbPath.c_str(), &db, SQLITE_OPEN_READONLY, nullptr) != SQLITE_OK) {
+        std::cerr << "Cannot open " << dbPath << ": " << sqlite3_errmsg(db) << "\n";
+        sqlite3_close(db);
+        return 1;
+    }
+    sqlite3_busy_timeout(db, 5000);
+
+    // Completed tasks older than the archive window live only in the archive; leaving it out would undercount
+    std::string archiveFile = archivePath;
+    if (archiveFile.empty()) {
+        const char* archiveEnv = std::getenv("EHS_ARCHIVE_DB");
+        archiveFile = archiveEnv ? archiveEnv : archive::defaultPath(dbPath);
+    }
+    std::error_code missing;
+    std::string archiveError;
+    if (std::filesystem::exists(archiveFile, missing) && !archive::attach(db, archiveFile, false, archiveError)) {
+        std::cerr << archiveError << "\n";
+        sqlite3_close(db);
+        return 1;
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    snapshot::WriteSummary summary = snapshot::write(db, out);
+    sqlite3_close(db);
+    if (!summary.ok) {
+        std::cerr << summary.error << "\n";
+        return 1;
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    std::cerr << "Wrote " << summary.rows << " tasks (last id " << summary.lastTaskId << ") to " << out << " in "
+              << seconds << "s\n";
+    return 0;
+}
+
+void printCounts(const std::vector<std::string>& statuses, const std::vector<long long>& counts) {
+    std::cout << "{";
+    for (size_t i = 0; i < statuses.size(); ++i) {
+        std::cout << (i ? "," : "") << json::quote(statuses[i]) << ":" << counts[i];
+    }
+    std::cout << "}";
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    if (argc < 2) {
+        return usage();
+    }
+    std::string command = argv[1];
+    std::string dbPath, archivePath, out, path;
+    snapshot::Filter filter;
+    enum class Report { Count, ByStatus, ByWorker, List } report = Report::Count;
+    size_t limit = 0;
+
+    for (int i = 2; i < argc; ++i) {
+        std::string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (arg == "--db" && hasValue) {
+            dbPath = argv[++i];
+        } else if (arg == "--archive" && hasValue) {
+            archivePath = argv[++i];
+        } else if (arg == "--out" && hasValue) {
+            out = argv[++i];
+        } else if (arg == "--snapshot" && hasValue) {
+            path = argv[++i];
+        } else if (arg == "--worker" && hasValue) {
+            filter.workerId = std::atoi(argv[++i]);
+        } else if (arg == "--status" && hasValue) {
+            filter.status = argv[++i];
+        } else if ((arg == "--from" || arg == "--to") && hasValue) {
+            long long seconds;
+            if (!snapshot::parseTime(argv[++i], seconds)) {
+                std::cerr << "Bad time: " << argv[i] << "\n";
+                return 2;
+            }
+            // A bare date as the upper bound includes that whole day
+            bool dateOnly = std::string(argv[i]).size() == 10;
+            (arg == "--from" ? filter.from : filter.to) = arg == "--to" && dateOnly ? seconds + 86399 : seconds;
+        } else if (arg == "--by-status") {
+            report = Report::ByStatus;
+        } else if (arg == "--by-worker") {
+            report = Report::ByWorker;
+        } else if (arg == "--list" && hasValue) {
+            report = Report::List;
+            limit = static_cast<size_t>(std::max(0, std::atoi(argv[++i])));
+        } else {
+            return usage();
+        }
+    }
+
+    if (command == "write") {
+        return dbPath.empty() || out.empty() ? usage() : writeSnapshot(dbPath, archivePath, out);
+    }
+    if (command != "query" || path.empty()) {
+        return usage();
+    }
+
+    std::string error;
+    std::unique_ptr<snapshot::Snapshot> snap = snapshot::Snapshot::open(path, error);
+    if (!snap) {
+        std::cerr << error << "\n";
+        return 1;
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    switch (report) {
+        case Report::Count:
+            std::cout << "{\"tasks\":" << snap->count(filter) << "}\n";
+            break;
+        case Report::ByStatus:
+            printCounts(snap->statuses(), snap->countByStatus(filter));
+            std::cout << "\n";
+            break;
+        case Report::ByWorker:
+            for (const snapshot::WorkerCounts& worker : snap->countByWorker(filter)) {
+                std::cout << "{\"worker_id\":" << worker.workerId << ",\"username\":" << json::quote(worker.username)
+                          << ",\"tasks\":" << worker.tasks << ",\"by_status\":";
+                printCounts(snap->statuses(), worker.byStatus);
+                std::cout << "}\n";
+            }
+            break;
+        case Report::List:
+            for (long long row : snap->find(filter, limit)) {
+                snapshot::TaskText text = snap->text(row);
+                long long seconds;
+                std::cout << "{\"id\":" << snap->taskId(row) << ",\"worker_id\":" << snap->workerId(row)
+                          << ",\"status\":" << json::quote(snap->status(row)) << ",\"violation_time\":";
+                if (snap->violationTime(row, seconds)) {
+                    std::cout << seconds;
+                } else {
+                    std::cout << "null";
+                }
+                std::cout << ",\"task_description\":" << json::quote(text.description)
+                          << ",\"violation_comment\":" << json::quote(text.violationComment)
+                          << ",\"worker_report\":" << json::quote(text.workerReport)
+                          << ",\"worker_media\":" << json::quote(text.workerMedia)
+                          << ",\"completed_at\":" << json::quote(text.completedAt)
+                          << ",\"priority\":" << snap->priority(row) << ",\"due_at\":";
+                if (snap->dueAt(row, seconds)) {
+                    std::cout << seconds;
+                } else {
+                    std::cout << "null";
+                }
+                std::cout << "}\n";
+            }
+            break;
+    }
+    double millis = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    std::cerr << "Scanned " << snap->rows() << " tasks (snapshot of id <= " << snap->lastTaskId() << ") in " << millis
+              << " ms\n";
+    return 0;
+}
@@ -0,0 +1,687 @@
+/**
+ * @file snapshot.cpp
+ * @brief Writing and querying columnar task snapshots.
+ *
+ * File layout (offsets in the header, every section 64-byte aligned):
+ * @code
+ * header (4 KiB)
+ * ids        uint32 x rows   task id - idBase
+ * statuses   uint8  x rows   status dictionary code
+ * workers    uint32 x rows   worker dictionary code
+ * times      uint32 x rows   violation time - timeBase + 2^31, 0 if none
+ * priorities uint8  x rows   1 high, 2 normal, 3 low (core::priorityName)
+ * deadlines  int64  x rows   due_at, Unix time, 0 if none
+ * textIndex  uint64 x rows+1 start of each task's record in the text section
+ * text       per task: description, comment, report, media, completed at, each as uint32 length + bytes
+ * dictionary statuses (uint32 length + bytes), then workers (int64 id, uint32 length + bytes)
+ * @endcode
+ *
+ * The writer streams the tasks once, keeping a buffer per column and writing
+ * each column at its own offset; row and id counts are read first so the
+ * column sizes are known up front.
+ *
+ * Queries filter fixed-size blocks of rows into a byte mask, one branch-free
+ * loop per predicate over one narrow column; the loops have a constant trip
+ * count so the compiler vectorizes them. The aggregation then reads the mask.
+ */
+
+#include "snapshot.h"
+#include "../metrics/metrics.h"
+#include "../trace/trace.h"
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <type_traits>
+#include <unordered_map>
+
+namespace snapshot {
+
+namespace {
+
+const char kMagic[8] = {'E', 'H', 'S', 'S', 'N', 'A', 'P', '1'};
+const uint32_t kVersion = 3;  ///< 2 added the completion time to the text record, 3 priorities and deadlines
+const uint32_t kByteOrder = 0x01020304;
+const uint64_t kHeaderSize = 4096;
+const uint32_t kNoTime = 0;
+const long long kTimeBias = 1LL << 31;
+const int kBlock = 4096;              ///< Rows filtered per mask
+const size_t kWriteBuffer = 1 << 20;  ///< Bytes buffered per column while writing
+
+struct FileHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t byteOrder;
+    uint64_t rows;
+    int64_t created;
+    int64_t lastTaskId;
+    int64_t idBase;
+    int64_t timeBase;
+    uint64_t ids;
+    uint64_t statuses;
+    uint64_t workers;
+    uint64_t times;
+    uint64_t priorities;
+    uint64_t deadlines;
+    uint64_t textIndex;
+    uint64_t text;
+    uint64_t textSize;
+    uint64_t dictionary;
+    uint64_t fileSize;
+};
+
+uint64_t align(uint64_t offset) {
+    return (offset + 63) & ~uint64_t(63);
+}
+
+/// @brief Days since 1970-01-01 of a proleptic Gregorian date.
+long long daysFromCivil(long long y, unsigned m, unsigned d) {
+    y -= m <= 2;
+    long long era = (y >= 0 ? y : y - 399) / 400;
+    unsigned yoe = static_cast<unsigned>(y - era * 400);
+    unsigned doy = (153 * (m > 2 ? m - 3 : m + 9) + 2) / 5 + d - 1;
+    unsigned doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+    return era * 146097 + static_cast<long long>(doe) - 719468;
+}
+
+/**
+ * @class Output
+ * @brief Buffered positional writes to one section of the file.
+ */
+class Output {
+public:
+    Output(int fd, uint64_t offset, bool& failed) : fd(fd), offset(offset), failed(failed) {
+        buffer.reserve(kWriteBuffer);
+    }
+
+    void put(const void* data, size_t size) {
+        const char* bytes = static_cast<const char*>(data);
+        buffer.insert(buffer.end(), bytes, bytes + size);
+        if (buffer.size() >= kWriteBuffer) {
+            flush();
+        }
+    }
+
+    template <typename T>
+    void put(T value) {
+        static_assert(std::is_trivially_copyable<T>::value, "raw column values only");
+        put(&value, sizeof(value));
+    }
+
+    void flush() {
+        size_t done = 0;
+        while (done < buffer.size() && !failed) {
+            ssize_t n = ::pwrite(fd, buffer.data() + done, buffer.size() - done, static_cast<off_t>(offset + done));
+            if (n < 0 && errno == EINTR) continue;
+            failed = n <= 0;
+            done += n > 0 ? static_cast<size_t>(n) : 0;
+        }
+        offset += buffer.size();
+        buffer.clear();
+    }
+
+    /// @brief File offset the next byte goes to.
+    uint64_t position() const { return offset + buffer.size(); }
+
+private:
+    int fd;
+    uint64_t offset;
+    bool& failed;
+    std::vector<char> buffer;
+};
+
+/// @brief True if the tasks table has @p column; databases not yet migrated lack the newer ones.
+bool hasTaskColumn(sqlite3* db, const char* column, const char* schema = "main") {
+    sqlite3_stmt* stmt = nullptr;
+    bool found = sqlite3_prepare_v2(db, "SELECT 1 FROM pragma_table_info('tasks', ?) WHERE name = ?;", -1, &stmt,
+                                    nullptr) == SQLITE_OK &&
+                 sqlite3_bind_text(stmt, 1, schema, -1, SQLITE_STATIC) == SQLITE_OK &&
+                 sqlite3_bind_text(stmt, 2, column, -1, SQLITE_STATIC) == SQLITE_OK &&
+                 sqlite3_step(stmt) == SQLITE_ROW;
+    sqlite3_finalize(stmt);
+    return found;
+}
+
+/// @brief The snapshot columns of one schema's tasks table, with defaults for columns older databases lack.
+std::string taskColumns(sqlite3* db, const char* schema, bool compressed) {
+    const char* description = compressed ? "ehs_inflate(task_description)" : "task_description";
+    const char* report = compressed ? "ehs_inflate(worker_report)" : "worker_report";
+    return std::string("SELECT id, worker_id, worker_username, status, violation_timestamp, ") + description +
+           " AS task_description, violation_comment, " + report + " AS worker_report, worker_media, " +
+           (hasTaskColumn(db, "completed_at", schema) ? "completed_at" : "NULL AS completed_at") +
+           (hasTaskColumn(db, "due_at", schema) ? ", due_at, priority" : ", NULL AS due_at, 2 AS priority") +
+           " FROM " + schema + ".tasks";
+}
+
+/**
+ * @brief The tasks to snapshot: main.tasks, plus archive.tasks when an archive is attached as "archive".
+ *
+ * A task copied to the archive but not yet deleted from main.tasks is taken from main.tasks only.
+ */
+std::string taskSource(sqlite3* db) {
+    sqlite3_stmt* stmt = nullptr;
+    bool archived = sqlite3_prepare_v2(db, "SELECT 1 FROM pragma_database_list WHERE name = 'archive';", -1, &stmt,
+                                       nullptr) == SQLITE_OK &&
+                    sqlite3_step(stmt) == SQLITE_ROW;
+    sqlite3_finalize(stmt);
+    std::string source = taskColumns(db, "main", false);
+    if (archived) {
+        source += " UNION ALL " + taskColumns(db, "archive", true) +
+                  " a WHERE NOT EXISTS (SELECT 1 FROM main.tasks t WHERE t.id = a.id)";
+    }
+    return "(" + source + ")";
+}
+
+void putText(Output& out, sqlite3_stmt* stmt, int column) {
+    const void* text = sqlite3_column_text(stmt, column);
+    uint32_t size = static_cast<uint32_t>(sqlite3_column_bytes(stmt, column));
+    out.put(size);
+    out.put(text, size);
+}
+
+/// @brief Reads a uint32 length and that many bytes at @p offset, within @p end.
+bool readString(const unsigned char* base, uint64_t& offset, uint64_t end, std::string& value) {
+    uint32_t size;
+    if (offset + sizeof(size) > end) return false;
+    std::memcpy(&size, base + offset, sizeof(size));
+    offset += sizeof(size);
+    if (offset + size > end) return false;
+    value.assign(reinterpret_cast<const char*>(base + offset), size);
+    offset += size;
+    return true;
+}
+
+/**
+ * @brief Applies every active predicate to @p n rows starting at @p row; Size is constant for full blocks.
+ *
+ * The mask never aliases a column (__restrict), which is what lets the loops vectorize.
+ */
+template <typename Size>
+void filterRows(const uint8_t* __restrict statuses, const uint32_t* __restrict workers,
+                const uint32_t* __restrict times, long long row, Size n, int status, bool byWorker, uint32_t worker,
+                bool byTime, uint32_t lo, uint32_t span, uint8_t* __restrict mask) {
+    for (int j = 0; j < n; ++j) mask[j] = 1;
+    if (status >= 0) {
+        const uint8_t* s = statuses + row;
+        uint8_t code = static_cast<uint8_t>(status);
+        for (int j = 0; j < n; ++j) mask[j] &= s[j] == code;
+    }
+    if (byWorker) {
+        const uint32_t* w = workers + row;
+        for (int j = 0; j < n; ++j) mask[j] &= w[j] == worker;
+    }
+    if (byTime) {
+        const uint32_t* t = times + row;
+        for (int j = 0; j < n; ++j) mask[j] &= static_cast<uint32_t>(t[j] - lo) <= span;
+    }
+}
+
+}  // namespace
+
+bool parseTime(const std::string& text, long long& seconds) {
+    int y = 0, mo = 0, d = 0, h = 0, mi = 0, s = 0;
+    char tail = 0;
+    int fields = std::sscanf(text.c_str(), "%4d-%2d-%2d %2d:%2d:%2d%c", &y, &mo, &d, &h, &mi, &s, &tail);
+    if ((fields != 3 && fields != 6) || mo < 1 || mo > 12 || d < 1 || d > 31 || h > 23 || mi > 59 || s > 60) {
+        return false;
+    }
+    seconds = daysFromCivil(y, static_cast<unsigned>(mo), static_cast<unsigned>(d)) * 86400LL + h * 3600 +
+              mi * 60 + s;
+    return true;
+}
+
+WriteSummary write(sqlite3* db, const std::string& path) {
+    EHS_MEASURE("snapshot.write");
+    trace::Span span("snapshot.write", "snapshot");
+    WriteSummary summary;
+    auto fail = [&summary](const std::string& error) {
+        summary.ok = false;
+        summary.error = error;
+        return summary;
+    };
+
+    // One read transaction: the counts and the rows see the same snapshot
+    if (sqlite3_exec(db, "BEGIN;", nullptr, nullptr, nullptr) != SQLITE_OK) {
+        return fail(std::string("Failed to begin snapshot read: ") + sqlite3_errmsg(db));
+    }
+    struct EndRead {
+        sqlite3* db;
+        ~EndRead() { sqlite3_exec(db, "COMMIT;", nullptr, nullptr, nullptr); }
+    } endRead{db};
+
+    sqlite3_stmt* stmt = nullptr;
+    long long rows = 0;
+    sqlite3_int64 minId = 0, maxId = 0;
+    std::string source = taskSource(db);
+    std::string countSql = "SELECT count(*), IFNULL(min(id), 0), IFNULL(max(id), 0) FROM " + source + ";";
+    if (sqlite3_prepare_v2(db, countSql.c_str(), -1, &stmt, nullptr) != SQLITE_OK ||
+        sqlite3_step(stmt) != SQLITE_ROW) {
+        sqlite3_finalize(stmt);
+        return fail(std::string("Failed to count tasks: ") + sqlite3_errmsg(db));
+    }
+    rows = sqlite3_column_int64(stmt, 0);
+    minId = sqlite3_column_int64(stmt, 1);
+    maxId = sqlite3_column_int64(stmt, 2);
+    sqlite3_finalize(stmt);
+    if (maxId - minId > static_cast<sqlite3_int64>(UINT32_MAX)) {
+        return fail("Task ids span more than 2^32; cannot encode them as offsets.");
+    }
+
+    FileHeader header{};
+    std::memcpy(header.magic, kMagic, sizeof(kMagic));
+    header.version = kVersion;
+    header.byteOrder = kByteOrder;
+    header.rows = static_cast<uint64_t>(rows);
+    header.created = static_cast<int64_t>(std::time(nullptr));
+    header.idBase = minId;
+    header.ids = kHeaderSize;
+    header.statuses = align(header.ids + 4 * header.rows);
+    header.workers = align(header.statuses + header.rows);
+    header.times = align(header.workers + 4 * header.rows);
+    header.priorities = align(header.times + 4 * header.rows);
+    header.deadlines = align(header.priorities + header.rows);
+    header.textIndex = align(header.deadlines + 8 * header.rows);
+    header.text = align(header.textIndex + 8 * (header.rows + 1));
+
+    std::string sql = "SELECT id, CAST(worker_id AS INTEGER), worker_username, status, violation_timestamp, "
+                      "task_description, violation_comment, worker_report, worker_media, completed_at, "
+                      "IFNULL(due_at, 0), priority FROM " + source + " ORDER BY id;";
+    if (sqlite3_prepare_v2(db, sql.c_str(), -1, &stmt, nullptr) != SQLITE_OK) {
+        return fail(std::string("Failed to prepare snapshot query: ") + sqlite3_errmsg(db));
+    }
+
+    std::string tmp = path + ".tmp";
+    int fd = ::open(tmp.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+        sqlite3_finalize(stmt);
+        return fail("Cannot open " + tmp + " for writing.");
+    }
+
+    bool failed = false;
+    Output ids(fd, header.ids, failed), statuses(fd, header.statuses, failed), workers(fd, header.workers, failed),
+        times(fd, header.times, failed), priorities(fd, header.priorities, failed),
+        deadlines(fd, header.deadlines, failed), textIndex(fd, header.textIndex, failed), text(fd, header.text, failed);
+    std::unordered_map<std::string, uint8_t> statusCodes;
+    std::vector<std::string> statusNames;
+    std::unordered_map<sqlite3_int64, uint32_t> workerCodes;
+    std::vector<std::pair<sqlite3_int64, std::string>> workerNames;
+    bool haveTimeBase = false;
+    long long timeBase = 0;
+    long long written = 0;
+    std::string error;
+
+    int rc = SQLITE_OK;
+    while (error.empty() && !failed && (rc = sqlite3_step(stmt)) == SQLITE_ROW) {
+        if (written == rows) {
+            error = "Tasks changed during the snapshot read.";
+            break;
+        }
+        sqlite3_int64 id = sqlite3_column_int64(stmt, 0);
+        ids.put(static_cast<uint32_t>(id - minId));
+
+        const char* statusText = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 3));
+        std::string status = statusText ? statusText : "";
+        auto code = statusCodes.find(status);
+        if (code == statusCodes.end()) {
+            if (statusNames.size() == 256) {
+                error = "More than 256 distinct task statuses.";
+                break;
+            }
+            code = statusCodes.emplace(status, static_cast<uint8_t>(statusNames.size())).first;
+            statusNames.push_back(status);
+        }
+        statuses.put(code->second);
+
+        sqlite3_int64 workerId = sqlite3_column_int64(stmt, 1);
+        auto worker = workerCodes.find(workerId);
+        if (worker == workerCodes.end()) {
+            const char* username = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 2));
+            worker = workerCodes.emplace(workerId, static_cast<uint32_t>(workerNames.size())).first;
+            workerNames.emplace_back(workerId, username ? username : "");
+        }
+        workers.put(worker->second);
+
+        uint32_t time = kNoTime;
+        long long seconds;
+        const char* timestamp = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 4));
+        if (timestamp && parseTime(timestamp, seconds)) {
+            if (!haveTimeBase) {
+                timeBase = seconds;
+                haveTimeBase = true;
+            }
+            long long biased = seconds - timeBase + kTimeBias;
+            if (biased <= 0 || biased > static_cast<long long>(UINT32_MAX)) {
+                error = "Violation times span more than 68 years; cannot encode them as offsets.";
+                break;
+            }
+            time = static_cast<uint32_t>(biased);
+        }
+        times.put(time);
+        priorities.put(static_cast<uint8_t>(sqlite3_column_int(stmt, 11)));
+        deadlines.put(static_cast<int64_t>(sqlite3_column_int64(stmt, 10)));
+
+        textIndex.put(static_cast<uint64_t>(text.position() - header.text));
+        for (int column = 5; column <= 9; ++column) {
+            putText(text, stmt, column);
+        }
+        summary.lastTaskId = id;
+        ++written;
+    }
+    if (error.empty() && !failed && rc != SQLITE_DONE) {
+        error = std::string("Snapshot query failed: ") + sqlite3_errmsg(db);
+    }
+    if (error.empty() && written != rows) {
+        error = "Tasks changed during the snapshot read.";
+    }
+    sqlite3_finalize(stmt);
+
+    header.textSize = text.position() - header.text;
+    textIndex.put(static_cast<uint64_t>(header.textSize));
+    header.timeBase = timeBase;
+    header.lastTaskId = summary.lastTaskId;
+    header.dictionary = align(text.position());
+
+    Output dictionary(fd, header.dictionary, failed);
+    dictionary.put(static_cast<uint32_t>(statusNames.size()));
+    for (const std::string& name : statusNames) {
+        dictionary.put(static_cast<uint32_t>(name.size()));
+        dictionary.put(name.data(), name.size());
+    }
+    dictionary.put(static_cast<uint32_t>(workerNames.size()));
+    for (const auto& entry : workerNames) {
+        dictionary.put(static_cast<int64_t>(entry.first));
+        dictionary.put(static_cast<uint32_t>(entry.second.size()));
+        dictionary.put(entry.second.data(), entry.second.size());
+    }
+    header.fileSize = dictionary.position();
+
+    for (Output* out : {&ids, &statuses, &workers, &times, &priorities, &deadlines, &textIndex, &text, &dictionary}) {
+        out->flush();
+    }
+
+    // The header goes last, so a partly written file never validates
+    Output head(fd, 0, failed);
+    head.put(header);
+    head.flush();
+    failed |= ::ftruncate(fd, static_cast<off_t>(header.fileSize)) != 0;
+    failed |= ::fsync(fd) != 0;
+    failed |= ::close(fd) != 0;
+
+    if (error.empty() && failed) {
+        error = "Failed to write " + tmp + ".";
+    }
+    if (!error.empty()) {
+        std::remove(tmp.c_str());
+        return fail(error);
+    }
+    if (std::rename(tmp.c_str(), path.c_str()) != 0) {
+        std::remove(tmp.c_str());
+        return fail("Failed to rename " + tmp + " to " + path + ".");
+    }
+    summary.rows = written;
+    return summary;
+}
+
+std::unique_ptr<Snapshot> Snapshot::open(const std::string& path, std::string& error) {
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        error = "Cannot open " + path + ".";
+        return nullptr;
+    }
+    struct stat st;
+    if (::fstat(fd, &st) != 0 || static_cast<uint64_t>(st.st_size) < kHeaderSize) {
+        ::close(fd);
+        error = path + " is not a task snapshot.";
+        return nullptr;
+    }
+    void* mapped = ::mmap(nullptr, static_cast<size_t>(st.st_size), PROT_READ, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (mapped == MAP_FAILED) {
+        error = "Cannot map " + path + ".";
+        return nullptr;
+    }
+
+    std::unique_ptr<Snapshot> snapshot(new Snapshot());
+    snapshot->base = static_cast<const unsigned char*>(mapped);
+    snapshot->size = static_cast<size_t>(st.st_size);
+
+    FileHeader header;
+    std::memcpy(&header, snapshot->base, sizeof(header));
+    uint64_t n = header.rows;
+    bool valid = std::memcmp(header.magic, kMagic, sizeof(kMagic)) == 0 && header.version == kVersion &&
+                 header.byteOrder == kByteOrder && header.fileSize == snapshot->size &&
+                 header.ids == kHeaderSize && header.statuses >= header.ids + 4 * n &&
+                 header.workers >= header.statuses + n && header.times >= header.workers + 4 * n &&
+                 header.priorities >= header.times + 4 * n && header.deadlines >= header.priorities + n &&
+                 header.textIndex >= header.deadlines + 8 * n && header.text >= header.textIndex + 8 * (n + 1) &&
+                 header.dictionary >= header.text + header.textSize && header.dictionary <= header.fileSize;
+    if (!valid) {
+        error = path + " is not a task snapshot of this version and byte order.";
+        return nullptr;
+    }
+
+    snapshot->rowCount = static_cast<long long>(n);
+    snapshot->lastId = header.lastTaskId;
+    snapshot->created = header.created;
+    snapshot->idBase = header.idBase;
+    snapshot->timeBase = header.timeBase;
+    snapshot->ids = reinterpret_cast<const uint32_t*>(snapshot->base + header.ids);
+    snapshot->statusCodes = snapshot->base + header.statuses;
+    snapshot->workerCodes = reinterpret_cast<const uint32_t*>(snapshot->base + header.workers);
+    snapshot->times = reinterpret_cast<const uint32_t*>(snapshot->base + header.times);
+    snapshot->priorities = snapshot->base + header.priorities;
+    snapshot->deadlines = reinterpret_cast<const int64_t*>(snapshot->base + header.deadlines);
+    snapshot->textIndex = reinterpret_cast<const uint64_t*>(snapshot->base + header.textIndex);
+    snapshot->textSection = snapshot->base + header.text;
+    snapshot->textSize = static_cast<size_t>(header.textSize);
+
+    uint64_t offset = header.dictionary;
+    uint32_t count;
+    valid = offset + 4 <= header.fileSize;
+    if (valid) {
+        std::memcpy(&count, snapshot->base + offset, 4);
+        offset += 4;
+        snapshot->statusNames.resize(count);
+        for (uint32_t i = 0; i < count && valid; ++i) {
+            valid = readString(snapshot->base, offset, header.fileSize, snapshot->statusNames[i]);
+        }
+    }
+    valid = valid && offset + 4 <= header.fileSize;
+    if (valid) {
+        std::memcpy(&count, snapshot->base + offset, 4);
+        offset += 4;
+        snapshot->workerIds.resize(count);
+        snapshot->workerNames.resize(count);
+        for (uint32_t i = 0; i < count && valid; ++i) {
+            int64_t id;
+            valid = offset + 8 <= header.fileSize;
+            if (valid) {
+                std::memcpy(&id, snapshot->base + offset, 8);
+                offset += 8;
+                snapshot->workerIds[i] = static_cast<int>(id);
+                valid = readString(snapshot->base, offset, header.fileSize, snapshot->workerNames[i]);
+            }
+        }
+    }
+    if (!valid) {
+        error = path + " has a damaged dictionary.";
+        return nullptr;
+    }
+
+    // Dashboards scan the narrow columns front to back
+    ::madvise(const_cast<unsigned char*>(snapshot->base), header.text, MADV_SEQUENTIAL);
+    return snapshot;
+}
+
+Snapshot::~Snapshot() {
+    if (base) {
+        ::munmap(const_cast<unsigned char*>(base), size);
+    }
+}
+
+/// @brief A Filter translated into dictionary codes and biased time offsets.
+struct Snapshot::Predicate {
+    int status = -1;
+    bool byWorker = false;
+    uint32_t worker = 0;
+    bool byTime = false;
+    uint32_t lo = 0;
+    uint32_t span = 0;
+};
+
+bool Snapshot::compile(const Filter& filter, Predicate& predicate) const {
+    if (!filter.status.empty()) {
+        auto found = std::find(statusNames.begin(), statusNames.end(), filter.status);
+        if (found == statusNames.end()) return false;
+        predicate.status = static_cast<int>(found - statusNames.begin());
+    }
+    if (filter.workerId >= 0) {
+        auto found = std::find(workerIds.begin(), workerIds.end(), filter.workerId);
+        if (found == workerIds.end()) return false;
+        predicate.byWorker = true;
+        predicate.worker = static_cast<uint32_t>(found - workerIds.begin());
+    }
+    if (filter.from != std::numeric_limits<long long>::min() || filter.to != std::numeric_limits<long long>::max()) {
+        // Bounds beyond the encodable range saturate
+        long long lo = filter.from <= timeBase - kTimeBias ? 1 : std::max(1LL, filter.from - timeBase + kTimeBias);
+        long long hi = filter.to >= timeBase + kTimeBias ? static_cast<long long>(UINT32_MAX)
+                                                         : filter.to - timeBase + kTimeBias;
+        if (hi < lo) return false;
+        predicate.byTime = true;
+        predicate.lo = static_cast<uint32_t>(lo);
+        predicate.span = static_cast<uint32_t>(hi - lo);
+    }
+    return true;
+}
+
+template <typename Visit>
+void Snapshot::scan(const Predicate& p, Visit visit) const {
+    uint8_t mask[kBlock];
+    long long row = 0;
+    for (; row + kBlock <= rowCount; row += kBlock) {
+        filterRows(statusCodes, workerCodes, times, row, std::integral_constant<int, kBlock>(), p.status,
+                   p.byWorker, p.worker, p.byTime, p.lo, p.span, mask);
+        visit(row, kBlock, mask);
+    }
+    if (row < rowCount) {
+        int n = static_cast<int>(rowCount - row);
+        filterRows(statusCodes, workerCodes, times, row, n, p.status, p.byWorker, p.worker, p.byTime, p.lo, p.span,
+                   mask);
+        visit(row, n, mask);
+    }
+}
+
+long long Snapshot::count(const Filter& filter) const {
+    EHS_MEASURE("snapshot.count");
+    Predicate predicate;
+    if (!compile(filter, predicate)) return 0;
+    long long total = 0;
+    scan(predicate, [&](long long, int n, const uint8_t* mask) {
+        unsigned block = 0;
+        for (int j = 0; j < n; ++j) block += mask[j];
+        total += block;
+    });
+    return total;
+}
+
+std::vector<long long> Snapshot::countByStatus(const Filter& filter) const {
+    EHS_MEASURE("snapshot.countByStatus");
+    std::vector<long long> counts(statusNames.size(), 0);
+    Predicate predicate;
+    if (!compile(filter, predicate)) return counts;
+    scan(predicate, [&](long long row, int n, const uint8_t* mask) {
+        const uint8_t* s = statusCodes + row;
+        for (int j = 0; j < n; ++j) counts[s[j]] += mask[j];
+    });
+    return counts;
+}
+
+std::vector<WorkerCounts> Snapshot::countByWorker(const Filter& filter) const {
+    EHS_MEASURE("snapshot.countByWorker");
+    std::vector<WorkerCounts> result;
+    Predicate predicate;
+    if (!compile(filter, predicate)) return result;
+
+    size_t statusCount = statusNames.size();
+    std::vector<long long> counts(workerIds.size() * statusCount, 0);
+    scan(predicate, [&](long long row, int n, const uint8_t* mask) {
+        const uint8_t* s = statusCodes + row;
+        const uint32_t* w = workerCodes + row;
+        for (int j = 0; j < n; ++j) counts[w[j] * statusCount + s[j]] += mask[j];
+    });
+
+    for (size_t worker = 0; worker < workerIds.size(); ++worker) {
+        WorkerCounts entry;
+        entry.byStatus.assign(counts.begin() + worker * statusCount, counts.begin() + (worker + 1) * statusCount);
+        for (long long c : entry.byStatus) entry.tasks += c;
+        if (entry.tasks == 0) continue;
+        entry.workerId = workerIds[worker];
+        entry.username = workerNames[worker];
+        result.push_back(std::move(entry));
+    }
+    return result;
+}
+
+std::vector<long long> Snapshot::find(const Filter& filter, size_t limit) const {
+    std::vector<long long> rowsFound;
+    Predicate predicate;
+    if (limit == 0 || !compile(filter, predicate)) return rowsFound;
+    // A plain loop rather than scan(), so it can stop at the limit
+    uint8_t mask[kBlock];
+    for (long long row = 0; row < rowCount && rowsFound.size() < limit; row += kBlock) {
+        int n = static_cast<int>(std::min<long long>(kBlock, rowCount - row));
+        filterRows(statusCodes, workerCodes, times, row, n, predicate.status, predicate.byWorker, predicate.worker,
+                   predicate.byTime, predicate.lo, predicate.span, mask);
+        for (int j = 0; j < n && rowsFound.size() < limit; ++j) {
+            if (mask[j]) rowsFound.push_back(row + j);
+        }
+    }
+    return rowsFound;
+}
+
+sqlite3_int64 Snapshot::taskId(long long row) const {
+    return idBase + ids[row];
+}
+
+int Snapshot::workerId(long long row) const {
+    return workerIds[workerCodes[row]];
+}
+
+const std::string& Snapshot::status(long long row) const {
+    return statusNames[statusCodes[row]];
+}
+
+bool Snapshot::violationTime(long long row, long long& seconds) const {
+    if (times[row] == kNoTime) return false;
+    seconds = static_cast<long long>(times[row]) - kTimeBias + timeBase;
+    return true;
+}
+
+int Snapshot::priority(long long row) const {
+    return priorities[row];
+}
+
+bool Snapshot::dueAt(long long row, long long& seconds) const {
+    if (deadlines[row] == 0) return false;
+    seconds = deadlines[row];
+    return true;
+}
+
+TaskText Snapshot::text(long long row) const {
+    TaskText result;
+    uint64_t offset = textIndex[row];
+    uint64_t end = std::min<uint64_t>(textIndex[row + 1], textSize);
+    std::string* fields[] = {&result.description, &result.violationComment, &result.workerReport,
+                             &result.workerMedia, &result.completedAt};
+    for (std::string* field : fields) {
+        if (!readString(textSection, offset, end, *field)) break;
+    }
+    return result;
+}
+
+}  // namespace snapshot
@@ -0,0 +1,176 @@
+#ifndef SNAPSHOT_H_
+#define SNAPSHOT_H_
+
+#include <sqlite3.h>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <string>
+#include <vector>
+
+/**
+ * @namespace snapshot
+ * @brief Columnar, memory-mapped snapshot of task history for analytics.
+ *
+ * write() copies the tasks table, and the tasks moved to an attached archive
+ * (archive/archive.h), into one file laid out column by column:
+ * task ids and violation times as 32-bit offsets from a base, status as an
+ * 8-bit and worker as a 32-bit dictionary code, priority and deadline as
+ * they are stored in the database, and the long text columns
+ * (description, violation comment, report, media, completion time) in a
+ * separate section at the end. A Snapshot maps the file read-only; filters
+ * and aggregations only stream the narrow columns they need, so dashboards
+ * never touch the live database nor page in the text.
+ *
+ * The file is in host byte order and is checked on open.
+ */
+namespace snapshot {
+
+/**
+ * @struct WriteSummary
+ * @brief Outcome of writing a snapshot.
+ */
+struct WriteSummary {
+    bool ok = true;               ///< True if the snapshot was written
+    std::string error;            ///< Error message when ok is false
+    long long rows = 0;           ///< Tasks in the snapshot
+    sqlite3_int64 lastTaskId = 0; ///< Highest task id included
+};
+
+/**
+ * @brief Writes a snapshot of the tasks table.
+ *
+ * If an archive database is attached to @p db as "archive" (archive::attach),
+ * its tasks are included too, with their text decompressed, so the snapshot
+ * covers the whole history.
+ *
+ * The tasks are read inside one read transaction, so the snapshot is
+ * consistent even while the database is being written. The file is written
+ * under a temporary name and renamed into place.
+ *
+ * @param db Connection to read from; only SELECTs are run on it.
+ * @param path Snapshot file to create or replace.
+ */
+WriteSummary write(sqlite3* db, const std::string& path);
+
+/**
+ * @brief Parses "YYYY-MM-DD" or "YYYY-MM-DD HH:MM:SS" as seconds since 1970-01-01 00:00:00.
+ *
+ * Timestamps are stored as written (local time); no time zone is applied.
+ */
+bool parseTime(const std::string& text, long long& seconds);
+
+/**
+ * @struct Filter
+ * @brief Row selection; unset members match every task.
+ */
+struct Filter {
+    int workerId = -1;            ///< Tasks of this worker only
+    std::string status;           ///< Tasks with this status only
+    long long from = std::numeric_limits<long long>::min();  ///< Violation time lower bound (parseTime)
+    long long to = std::numeric_limits<long long>::max();    ///< Violation time upper bound, inclusive
+};
+
+/**
+ * @struct WorkerCounts
+ * @brief Matching tasks of one worker, split by status.
+ */
+struct WorkerCounts {
+    int workerId = 0;
+    std::string username;
+    long long tasks = 0;
+    std::vector<long long> byStatus;  ///< Indexed like Snapshot::statuses()
+};
+
+/**
+ * @struct TaskText
+ * @brief The text columns of one task, read from the text section.
+ */
+struct TaskText {
+    std::string description;
+    std::string violationComment;
+    std::string workerReport;
+    std::string workerMedia;
+    std::string completedAt;      ///< "YYYY-MM-DD HH:MM:SS", empty if not completed
+};
+
+/**
+ * @class Snapshot
+ * @brief A snapshot file mapped into memory.
+ *
+ * Queries are read-only and may run concurrently. Rows are in task id order.
+ * A time bound excludes tasks without a violation time.
+ */
+class Snapshot {
+public:
+    /**
+     * @brief Maps and validates a snapshot file.
+     *
+     * @return The snapshot, or nullptr with @p error set.
+     */
+    static std::unique_ptr<Snapshot> open(const std::string& path, std::string& error);
+    ~Snapshot();
+    Snapshot(const Snapshot&) = delete;
+    Snapshot& operator=(const Snapshot&) = delete;
+
+    long long rows() const { return rowCount; }
+    sqlite3_int64 lastTaskId() const { return lastId; }
+    long long createdAt() const { return created; }  ///< Unix time the snapshot was written
+    const std::vector<std::string>& statuses() const { return statusNames; }
+
+    /// @brief Number of tasks matching @p filter.
+    long long count(const Filter& filter) const;
+
+    /// @brief Matching tasks per status, indexed like statuses().
+    std::vector<long long> countByStatus(const Filter& filter) const;
+
+    /// @brief Matching tasks per worker, for workers with at least one match.
+    std::vector<WorkerCounts> countByWorker(const Filter& filter) const;
+
+    /// @brief Row numbers of the first @p limit matching tasks.
+    std::vector<long long> find(const Filter& filter, size_t limit) const;
+
+    sqlite3_int64 taskId(long long row) const;
+    int workerId(long long row) const;
+    const std::string& status(long long row) const;
+    /// @brief Violation time (parseTime scale), or false if the task has none.
+    bool violationTime(long long row, long long& seconds) const;
+    /// @brief Priority: 1 high, 2 normal, 3 low (see core::priorityName).
+    int priority(long long row) const;
+    /// @brief Deadline (Unix time), or false if the task has none.
+    bool dueAt(long long row, long long& seconds) const;
+    /// @brief Reads the text columns; the only accessor that touches the text section.
+    TaskText text(long long row) const;
+
+private:
+    Snapshot() = default;
+
+    struct Predicate;
+    bool compile(const Filter& filter, Predicate& predicate) const;
+    template <typename Visit>
+    void scan(const Predicate& predicate, Visit visit) const;
+
+    const unsigned char* base = nullptr;
+    size_t size = 0;
+    long long rowCount = 0;
+    sqlite3_int64 lastId = 0;
+    long long created = 0;
+    sqlite3_int64 idBase = 0;
+    long long timeBase = 0;
+    const uint32_t* ids = nullptr;
+    const uint8_t* statusCodes = nullptr;
+    const uint32_t* workerCodes = nullptr;
+    const uint32_t* times = nullptr;
+    const uint8_t* priorities = nullptr;
+    const int64_t* deadlines = nullptr;
+    const uint64_t* textIndex = nullptr;
+    const unsigned char* textSection = nullptr;
+    size_t textSize = 0;
+    std::vector<std::string> statusNames;
+    std::vector<int> workerIds;
+    std::vector<std::string> workerNames;
+};
+
+}  // namespace snapshot
+
+#endif  // SNAPSHOT_H_
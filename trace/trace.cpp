@@ -0,0 +1,256 @@
+/**
+ * @file trace.cpp
+ * @brief Per-thread span buffers and Chrome trace JSON export.
+ *
+ * Each thread owns a ring of kRingCapacity slots and is its only writer: it
+ * fills the next slot and then publishes it by advancing the head with
+ * release ordering. The exporter reads the head, copies the slots, reads the
+ * head again and drops any slot the writer may have reused in between, so it
+ * never blocks or slows the writer.
+ *
+ */
+
+#include "trace.h"
+#include <signal.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <deque>
+#include <fstream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <thread>
+#include <vector>
+
+namespace trace {
+
+namespace {
+
+// Every thread that records a span gets a ring, traced or not, so keep it small: 4096 x 32 bytes is 128 KiB
+const uint64_t kRingCapacity = 1 << 12;      ///< Spans kept per live thread
+const size_t kRetiredCapacity = 1 << 16;     ///< Spans kept from exited threads
+
+struct Slot {
+    std::atomic<const char*> name{nullptr};
+    std::atomic<const char*> category{nullptr};
+    std::atomic<uint64_t> start{0};
+    std::atomic<uint64_t> duration{0};
+};
+
+struct Event {
+    const char* name;
+    const char* category;
+    uint64_t start;
+    uint64_t duration;
+    int tid;
+};
+
+struct ThreadBuffer {
+    int tid = 0;
+    std::unique_ptr<Slot[]> slots{new Slot[kRingCapacity]};
+    std::atomic<uint64_t> head{0};
+
+    /// @brief Copies the spans currently in the ring (safe against a concurrent writer).
+    void snapshot(std::vector<Event>& out) const {
+        uint64_t end = head.load(std::memory_order_acquire);
+        uint64_t begin = end > kRingCapacity ? end - kRingCapacity : 0;
+        std::vector<Event> copied;
+        copied.reserve(end - begin);
+        for (uint64_t i = begin; i < end; ++i) {
+            const Slot& slot = slots[i % kRingCapacity];
+            copied.push_back({slot.name.load(std::memory_order_relaxed), slot.category.load(std::memory_order_relaxed),
+                              slot.start.load(std::memory_order_relaxed),
+                              slot.duration.load(std::memory_order_relaxed), tid});
+        }
+        std::atomic_thread_fence(std::memory_order_acquire);
+
+        // Slots at or below (current head - capacity) may have been overwritten while copying
+        uint64_t now = head.load(std::memory_order_relaxed);
+        uint64_t firstValid = now + 1 > kRingCapacity ? now + 1 - kRingCapacity : 0;
+        for (uint64_t i = std::max(begin, firstValid); i < end; ++i) {
+            out.push_back(copied[i - begin]);
+        }
+    }
+};
+
+struct Registry {
+    std::mutex mutex;
+    std::set<ThreadBuffer*> live;
+    std::deque<Event> retired;
+    std::map<int, std::string> threadNames;
+    int nextTid = 1;
+    std::string path = "ehs_trace.json";
+    std::atomic<bool> enabled{true};
+    std::chrono::steady_clock::time_point epoch = std::chrono::steady_clock::now();
+};
+
+Registry& registry() {
+    static Registry* instance = new Registry();  // never destroyed; threads may exit after main
+    return *instance;
+}
+
+/// @brief Owns the calling thread's ring and moves its spans to the history on exit.
+struct ThreadHandle {
+    ThreadBuffer* buffer = nullptr;
+
+    ThreadBuffer* get() {
+        if (!buffer) {
+            buffer = new ThreadBuffer();
+            Registry& r = registry();
+            std::lock_guard<std::mutex> lock(r.mutex);
+            buffer->tid = r.nextTid++;
+            r.live.insert(buffer);
+        }
+        return buffer;
+    }
+
+    ~ThreadHandle() {
+        if (!buffer) return;
+        std::vector<Event> events;
+        buffer->snapshot(events);
+
+        Registry& r = registry();
+        std::lock_guard<std::mutex> lock(r.mutex);
+        r.retired.insert(r.retired.end(), events.begin(), events.end());
+        while (r.retired.size() > kRetiredCapacity) {
+            r.retired.pop_front();
+        }
+        r.live.erase(buffer);
+        delete buffer;
+    }
+};
+
+thread_local ThreadHandle threadHandle;
+
+std::string escapeJson(const std::string& value) {
+    std::string escaped;
+    for (char c : value) {
+        if (c == '"' || c == '\\') {
+            escaped += '\\';
+            escaped += c;
+        } else if (static_cast<unsigned char>(c) < 0x20) {
+            char buffer[8];
+            std::snprintf(buffer, sizeof(buffer), "\\u%04x", c);
+            escaped += buffer;
+        } else {
+            escaped += c;
+        }
+    }
+    return escaped;
+}
+
+}  // namespace
+
+uint64_t nowMicros() {
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::microseconds>(
+                                     std::chrono::steady_clock::now() - registry().epoch).count());
+}
+
+void recordSpan(const char* name, const char* category, uint64_t startMicros, uint64_t durationMicros) {
+    if (!registry().enabled.load(std::memory_order_relaxed)) return;
+
+    ThreadBuffer* buffer = threadHandle.get();
+    uint64_t index = buffer->head.load(std::memory_order_relaxed);
+    Slot& slot = buffer->slots[index % kRingCapacity];
+    slot.name.store(name, std::memory_order_relaxed);
+    slot.category.store(category, std::memory_order_relaxed);
+    slot.start.store(startMicros, std::memory_order_relaxed);
+    slot.duration.store(durationMicros, std::memory_order_relaxed);
+    buffer->head.store(index + 1, std::memory_order_release);
+}
+
+void setThreadName(const std::string& name) {
+    ThreadBuffer* buffer = threadHandle.get();
+    Registry& r = registry();
+    std::lock_guard<std::mutex> lock(r.mutex);
+    r.threadNames[buffer->tid] = name;
+}
+
+void setEnabled(bool enabled) {
+    registry().enabled.store(enabled, std::memory_order_relaxed);
+}
+
+bool exportChromeTrace(const std::string& path) {
+    std::vector<Event> events;
+    std::map<int, std::string> threadNames;
+    {
+        Registry& r = registry();
+        std::lock_guard<std::mutex> lock(r.mutex);
+        events.assign(r.retired.begin(), r.retired.end());
+        for (ThreadBuffer* buffer : r.live) {
+            buffer->snapshot(events);
+        }
+        threadNames = r.threadNames;
+    }
+    std::sort(events.begin(), events.end(), [](const Event& a, const Event& b) { return a.start < b.start; });
+
+    // The menu and the SIGUSR2 thread may export at once, so each export writes its own temporary file
+    static std::atomic<unsigned> exports{0};
+    int pid = static_cast<int>(getpid());
+    std::string tmp = path + "." + std::to_string(pid) + "." + std::to_string(++exports) + ".tmp";
+    bool written;
+    {
+        std::ofstream out(tmp, std::ios::trunc);
+        if (!out) return false;
+
+        out << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+        bool first = true;
+        for (const auto& [tid, name] : threadNames) {
+            out << (first ? "" : ",\n") << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":" << pid
+                << ",\"tid\":" << tid << ",\"args\":{\"name\":\"" << escapeJson(name) << "\"}}";
+            first = false;
+        }
+        for (const Event& e : events) {
+            if (!e.name) continue;
+            out << (first ? "" : ",\n") << "{\"name\":\"" << escapeJson(e.name) << "\",\"cat\":\""
+                << escapeJson(e.category ? e.category : "") << "\",\"ph\":\"X\",\"ts\":" << e.start
+                << ",\"dur\":" << e.duration << ",\"pid\":" << pid << ",\"tid\":" << e.tid << "}";
+            first = false;
+        }
+        out << "\n]}\n";
+        written = static_cast<bool>(out.flush());
+    }
+    if (!written || std::rename(tmp.c_str(), path.c_str()) != 0) {
+        std::remove(tmp.c_str());
+        return false;
+    }
+    return true;
+}
+
+void setExportPath(const std::string& path) {
+    Registry& r = registry();
+    std::lock_guard<std::mutex> lock(r.mutex);
+    r.path = path;
+}
+
+std::string exportPath() {
+    Registry& r = registry();
+    std::lock_guard<std::mutex> lock(r.mutex);
+    return r.path;
+}
+
+void installExportSignalHandler() {
+    sigset_t set;
+    sigemptyset(&set);
+    sigaddset(&set, SIGUSR2);
+    pthread_sigmask(SIG_BLOCK, &set, nullptr);
+
+    std::thread([set]() {
+        // Other process-directed signals must not land on this thread
+        sigset_t all;
+        sigfillset(&all);
+        pthread_sigmask(SIG_BLOCK, &all, nullptr);
+
+        int signal;
+        while (sigwait(&set, &signal) == 0) {
+            exportChromeTrace(exportPath());
+        }
+    }).detach();
+}
+
+}  // namespace trace
@@ -0,0 +1,94 @@
+#ifndef TRACE_H_
+#define TRACE_H_
+
+#include <cstdint>
+#include <string>
+
+/**
+ * @namespace trace
+ * @brief Scoped trace spans exported as Chrome trace JSON (viewable in Perfetto).
+ *
+ * Every thread writes completed spans into its own fixed-size ring buffer with
+ * no locks; when the ring is full the oldest spans are overwritten. When a
+ * thread exits its spans are moved to a bounded shared history, so short-lived
+ * threads such as the report thread remain visible. exportChromeTrace() reads
+ * all buffers without stopping the writers.
+ *
+ * Span names and categories must be string literals (or otherwise outlive the
+ * export), because only the pointer is stored.
+ */
+namespace trace {
+
+/**
+ * @brief Microseconds since the process started tracing.
+ */
+uint64_t nowMicros();
+
+/**
+ * @brief Appends a completed span to the calling thread's buffer.
+ *
+ * @param name Span name, e.g. "db.step".
+ * @param category Span category, e.g. "db", "menu", "media", "lock".
+ * @param startMicros Start time from nowMicros().
+ * @param durationMicros Duration of the span.
+ */
+void recordSpan(const char* name, const char* category, uint64_t startMicros, uint64_t durationMicros);
+
+/**
+ * @brief Names the calling thread in exported traces.
+ */
+void setThreadName(const std::string& name);
+
+/**
+ * @brief Turns span recording on or off (on by default).
+ */
+void setEnabled(bool enabled);
+
+/**
+ * @class Span
+ * @brief Records the time between construction and destruction as a span.
+ */
+class Span {
+public:
+    Span(const char* name, const char* category) : name(name), category(category), start(nowMicros()) {}
+    ~Span() {
+        if (name) recordSpan(name, category, start, nowMicros() - start);
+    }
+    Span(const Span&) = delete;
+    Span& operator=(const Span&) = delete;
+
+private:
+    const char* name;
+    const char* category;
+    uint64_t start;
+};
+
+/**
+ * @brief Writes every buffered span to a Chrome trace JSON file.
+ *
+ * @param path Output file; written to a temporary name and renamed into place.
+ * @return True if the file was written.
+ */
+bool exportChromeTrace(const std::string& path);
+
+/**
+ * @brief Sets the file written by the SIGUSR2 handler.
+ */
+void setExportPath(const std::string& path);
+
+/**
+ * @brief Returns the file written by the SIGUSR2 handler.
+ */
+std::string exportPath();
+
+/**
+ * @brief Starts a background thread that exports the trace on every SIGUSR2.
+ *
+ * Like metrics::installDumpSignalHandler, call it from main() before any other
+ * thread is started.
+ */
+void installExportSignalHandler();
+
+}  // namespace trace
+
+#endif  // TRACE_H_
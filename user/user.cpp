@@ -1,6 +1,7 @@
 #include "user.h"
+#include "../core/core.h"
+#include "../logging/logging.h"
 #include <iostream>
-#include <openssl/sha.h>
 #include <string>
 #include <iomanip>
 /**
@@ -9,7 +10,8 @@
  *
  * This file contains the definitions for the User class methods, including user registration,
  * login, and helper functions to interact with the SQLite database. It uses object-oriented
- * principles such as encapsulation and abstraction.
+ * principles such as encapsulation and abstraction. The database work itself is done by the
+ * headless functions in core/core.h; these methods handle the terminal output.
  *
  */
 
@@ -26,269 +28,224 @@ User::User(const std::string& role) {
 User::~User() {}
 
 /// @brief Register a new user with hashed password (OOP: Behavior using class method).
-/// @param db SQLite database pointer.
+/// @param service EHS operations, local or over ehsd.
 /// @param username The user's name.
 /// @param password The user's password (plain text).
 /// @return True if registration is successful.
-bool User::registerUser(sqlite3* db, const std::string& username, const std::string& password) {
-    if (username.empty() || password.empty()) {
-        std::cerr << "Username and password cannot be empty.\n";
-        return false;
+bool User::registerUser(Service& service, const std::string& username, const std::string& password) {
+    core::Result result = service.registerUser(username, password, role);
+    if (!result.ok) {
+        logging::error("{}", result.error);
     }
-
-    std::string hashed = hashPassword(password);
-    const char* sql = "INSERT INTO users (username, password, role) VALUES (?, ?, ?);";
-    sqlite3_stmt* stmt;
-
-    if (sqlite3_prepare_v2(db, sql, -1, &stmt, nullptr) != SQLITE_OK) {
-        std::cerr << "Prepare failed: " << sqlite3_errmsg(db) << std::endl;
-        return false;
-    }
-
-    sqlite3_bind_text(stmt, 1, username.c_str(), -1, SQLITE_STATIC);
-    sqlite3_bind_text(stmt, 2, hashed.c_str(), -1, SQLITE_STATIC);
-    sqlite3_bind_text(stmt, 3, role.c_str(), -1, SQLITE_STATIC);
-
-    bool success = sqlite3_step(stmt) == SQLITE_DONE;
-    sqlite3_finalize(stmt);
-    return success;
+    return result.ok;
 }
 
 /// @brief Log in user by checking hashed password and role.
-/// @param db SQLite database pointer.
+/// @param service EHS operations, local or over ehsd.
 /// @param username Username entered.
 /// @param password Password entered.
 /// @return True if login is successful.
-bool User::loginUser(sqlite3* db, const std::string& username, const std::string& password) {
-    if (username.empty() || password.empty()) {
-        std::cerr << "Username and password cannot be empty.\n";
-        return false;
-    }
-
-    std::string hashed = hashPassword(password);
-    const char* sql = "SELECT * FROM users WHERE username=? AND password=? AND role=?;";
-    sqlite3_stmt* stmt;
-
-    if (sqlite3_prepare_v2(db, sql, -1, &stmt, nullptr) != SQLITE_OK) {
-        std::cerr << "Prepare failed: " << sqlite3_errmsg(db) << std::endl;
-        return false;
+bool User::loginUser(Service& service, const std::string& username, const std::string& password) {
+    core::LoginResult result = service.login(username, password);
+    if (!result.error.empty()) {
+        logging::error("{}", result.error);
     }
-
-    sqlite3_bind_text(stmt, 1, username.c_str(), -1, SQLITE_STATIC);
-    sqlite3_bind_text(stmt, 2, hashed.c_str(), -1, SQLITE_STATIC);
-    sqlite3_bind_text(stmt, 3, role.c_str(), -1, SQLITE_STATIC);
-
-    bool success = sqlite3_step(stmt) == SQLITE_ROW;
-    sqlite3_finalize(stmt);
-    return success;
+    return result.ok && result.role == role;
 }
 
 /// @brief Hash a password using SHA-256 (OOP: Abstraction, hides hashing logic).
 /// @param password Plain text password.
 /// @return Hashed password in hex string.
 string User::hashPassword(const string& password) {
-    unsigned char hash[SHA256_DIGEST_LENGTH];
-    SHA256(reinterpret_cast<const unsigned char*>(password.c_str()), password.size(), hash);
-    stringstream ss;
-    for (unsigned char c : hash)
-        ss << hex << setw(2) << setfill('0') << (int)c;
-    return ss.str();
+    return core::hashPassword(password);
 }
 
 /// @brief Get the role of a user after checking login credentials.
-/// @param db SQLite database pointer.
+/// @param service EHS operations, local or over ehsd.
 /// @param username User’s name.
 /// @param password User’s password.
 /// @return Role if found; otherwise "none".
-std::string User::getUserRole(sqlite3* db, const std::string& username, const std::string& password) {
-    std::string role = "none";
-    string hashed = hashPassword(password);
-    const char* sql = "SELECT role FROM users WHERE username = ? AND password = ?;";
-    sqlite3_stmt* stmt = nullptr;
-
-    if (sqlite3_prepare_v2(db, sql, -1, &stmt, nullptr) == SQLITE_OK) {
-        sqlite3_bind_text(stmt, 1, username.c_str(), -1, SQLITE_TRANSIENT);
-        sqlite3_bind_text(stmt, 2, hashed.c_str(), -1, SQLITE_TRANSIENT);
-
-        int stepResult = sqlite3_step(stmt);
-        if (stepResult == SQLITE_ROW) {
-            const unsigned char* roleText = sqlite3_column_text(stmt, 0);
-            if (roleText) {
-                role = reinterpret_cast<const char*>(roleText);
-            }
-        }
-    } else {
-        std::cerr << "SQL error in getUserRole: " << sqlite3_errmsg(db) << "\n";
+std::string User::getUserRole(Service& service, const std::string& username, const std::string& password) {
+    core::LoginResult result = service.login(username, password);
+    if (!result.error.empty()) {
+        logging::error("{}", result.error);
     }
-
-    sqlite3_finalize(stmt);
-    return role;
+    return result.ok ? result.role : "none";
 }
 
 /// @brief Check if user already exists (by username + password).
-/// @param db SQLite database.
+/// @param service EHS operations, local or over ehsd.
 /// @param username Username.
 /// @param password Password.
 /// @return True if user exists.
-bool User::userExists(sqlite3* db, const std::string& username, const std::string& password) {
-    sqlite3_stmt* stmt;
-    string hashed = hashPassword(password);
-    const char* sql = "SELECT id FROM users WHERE username = ? AND password = ?";
-
-    if (sqlite3_prepare_v2(db, sql, -1, &stmt, nullptr) != SQLITE_OK)
-        return false;
-
-    sqlite3_bind_text(stmt, 1, username.c_str(), -1, SQLITE_STATIC);
-    sqlite3_bind_text(stmt, 2, hashed.c_str(), -1, SQLITE_STATIC);
-
-    int result = sqlite3_step(stmt);
-    bool exists = (result == SQLITE_ROW);
-
-    sqlite3_finalize(stmt);
-    return exists;
+bool User::userExists(Service& service, const std::string& username, const std::string& password) {
+    return service.login(username, password).ok;
 }
 
 /// @brief View task details. Manager sees all, worker sees their own tasks.
-/// @param db SQLite DB.
+/// @param service EHS operations, local or over ehsd.
 /// @param userId User's ID.
 /// @param isManager If true, show all tasks.
-void User::viewTaskDetails(sqlite3* db, int userId, bool isManager) {
-    const char* sql = isManager 
-        ? "SELECT id, worker_id, worker_username, task_description, status, violation_comment, violation_timestamp, worker_report, worker_media FROM tasks;"
-        : "SELECT id, worker_username, task_description, status, violation_comment, violation_timestamp, worker_report, worker_media FROM tasks WHERE worker_id = ?;";
-
-    sqlite3_stmt* stmt;
-    if (sqlite3_prepare_v2(db, sql, -1, &stmt, nullptr) != SQLITE_OK) {
-        std::cerr << "Failed to prepare statement: " << sqlite3_errmsg(db) << "\n";
+/// @param includeArchived If true, also show tasks moved to the archive.
+void User::viewTaskDetails(Service& service, int userId, bool isManager, bool includeArchived) {
+    int workerId = isManager ? -1 : userId;
+    core::Rows<core::TaskRecord> tasks =
+        includeArchived ? service.listTaskHistory(workerId) : service.listTasks(workerId);
+    if (!tasks.ok) {
+        logging::error("{}", tasks.error);
         return;
     }
 
-    if (!isManager) {
-        sqlite3_bind_int(stmt, 1, userId);
-    }
+    auto orNone = [](const std::string& value) { return value.empty() ? "None" : value; };
 
-    std::cout << "\n=== Task Details ===\n";
+    std::cout << (includeArchived ? "\n=== Task History ===\n" : "\n=== Task Details ===\n");
     int taskNumber = 1;
 
-    while (sqlite3_step(stmt) == SQLITE_ROW) {
-        int id = sqlite3_column_int(stmt, 0);
-
+    for (const core::TaskRecord& task : tasks.rows) {
         std::cout << taskNumber << ".\n";
 
         if (isManager) {
-            int assignedTo = sqlite3_column_int(stmt, 1);
-            std::string worker_username = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 2));
-            std::string desc = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 3));
-            std::string status = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 4));
-            const char* violationcomment = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 5));
-            const char* violationtimestamp = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 6));
-            const char* worker_report = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 7));
-            const char* worker_media = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 8));
-
-            std::cout << "Task ID: " << id << "\n\n" << "Assigned To: " << worker_username << "\n\n"
-                      << "Task given: " << desc << "\n\n"
-                      << "Status: " << status << "\n\n"
-                      << "Violation Comment: " << (violationcomment ? violationcomment : "None") << "\n\n"
-                      << "Violation Timestamp: " << (violationtimestamp ? violationtimestamp : "None") << "\n\n"
-                      << "Message: " << (worker_report ? worker_report : "None") << "\n\n"
-                      << "Photo attached: " << (worker_media ? worker_media : "None") << "\n\n";
-        } else {
-            std::string worker_username = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 1));
-            std::string desc = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 2));
-            std::string status = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 3));
-            const char* violationcomment = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 4));
-            const char* violationtimestamp = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 5));
-            const char* worker_report = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 6));
-            const char* worker_media = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 7));
-
-            std::cout << "Task given: " << desc << "\n\n"
-                      << "Status: " << status << "\n\n"
-                      << "Violation Comment: " << (violationcomment ? violationcomment : "None") << "\n\n"
-                      << "Violation Timestamp: " << (violationtimestamp ? violationtimestamp : "None") << "\n\n"
-                      << "Message: " << (worker_report ? worker_report : "None") << "\n\n"
-                      << "Photo attached: " << (worker_media ? worker_media : "None") << "\n\n";
+            std::cout << "Task ID: " << task.id << "\n\n" << "Assigned To: " << task.workerUsername << "\n\n";
         }
+        std::cout << "Task given: " << task.description << "\n\n"
+                  << "Status: " << task.status << "\n\n"
+                  << "Priority: " << core::priorityName(task.priority) << "\n\n"
+                  << "Due: " << (task.dueAt ? core::formatLocalTime(task.dueAt) : "None") << "\n\n"
+                  << "Violation Comment: " << orNone(task.violationComment) << "\n\n"
+                  << "Violation Timestamp: " << orNone(task.violationTimestamp) << "\n\n"
+                  << "Message: " << orNone(task.workerReport) << "\n\n"
+                  << "Photo attached: " << orNone(task.workerMedia) << "\n\n";
 
         taskNumber++;
     }
-
-    sqlite3_finalize(stmt);
 }
 
 /// @brief Get the user ID based on username and password.
-/// @param db SQLite DB.
+/// @param service EHS operations, local or over ehsd.
 /// @param username User's name.
 /// @param password User's password.
 /// @return User ID or -1 if not found.
-int User::getUserId(sqlite3* db, const std::string& username, const std::string& password) {
-    const char* sql = "SELECT id FROM users WHERE username = ? AND password = ?;";
-    sqlite3_stmt* stmt;
-    string hashed = hashPassword(password);
-    int userId = -1;
-
-    if (sqlite3_prepare_v2(db, sql, -1, &stmt, nullptr) == SQLITE_OK) {
-        sqlite3_bind_text(stmt, 1, username.c_str(), -1, SQLITE_STATIC);
-        sqlite3_bind_text(stmt, 2, hashed.c_str(), -1, SQLITE_STATIC);
-
-        if (sqlite3_step(stmt) == SQLITE_ROW) {
-            userId = sqlite3_column_int(stmt, 0);
-        } else {
-            std::cerr << "User not found while retrieving ID.\n";
-        }
-    } else {
-        std::cerr << "Failed to prepare statement for getting user ID: " << sqlite3_errmsg(db) << "\n";
+int User::getUserId(Service& service, const std::string& username, const std::string& password) {
+    core::LoginResult result = service.login(username, password);
+    if (!result.ok) {
+        logging::error("{}", result.error.empty() ? "User not found while retrieving ID." : result.error);
     }
-
-    sqlite3_finalize(stmt);
-    return userId;
+    return result.userId;
 }
 
 /// @brief Display all safety rules from the database.
-void User::viewRules(sqlite3* db) {
-    std::string query = "SELECT rule_text, timestamp FROM rules;";
-    sqlite3_stmt* stmt;
-    int rc = sqlite3_prepare_v2(db, query.c_str(), -1, &stmt, 0);
-
-    if (rc != SQLITE_OK) {
-        std::cerr << "SQL error: " << sqlite3_errmsg(db) << std::endl;
+void User::viewRules(Service& service) {
+    core::Rows<core::RuleRecord> rules = service.listRules();
+    if (!rules.ok) {
+        logging::error("{}", rules.error);
         return;
     }
 
     std::cout << "\n--- Safety Rules ---\n";
-    while ((rc = sqlite3_step(stmt)) == SQLITE_ROW) {
-        const char* rule = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 0));
-        const char* timestamp = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 1));
-        std::cout << "Rule: " << rule << timestamp;
-    }
-
-    if (rc != SQLITE_DONE) {
-        std::cerr << "Execution failed: " << sqlite3_errmsg(db) << std::endl;
+    for (const core::RuleRecord& rule : rules.rows) {
+        std::cout << "Rule: " << rule.text << rule.timestamp;
     }
-
-    sqlite3_finalize(stmt);
 }
 
-/// @brief Display feedback (if any) for each rule in the system.
-void User::ViewRuleFeedback(sqlite3* db) {
-    const char* sql = "SELECT id, rule_text, feedback FROM rules";
-    sqlite3_stmt* stmt;
-
-    if (sqlite3_prepare_v2(db, sql, -1, &stmt, nullptr) != SQLITE_OK) {
-        std::cerr << "Failed to prepare statement: " << sqlite3_errmsg(db) << "\n";
+/// @brief Display feedback counts for each rule, then page through a rule's feedback.
+///
+/// Counts and average ratings come from the incrementally maintained
+/// rule_feedback_stats table. Feedback is paged newest first using the
+/// (rule_id, id) index, so each page costs the same however long the history is.
+void User::ViewRuleFeedback(Service& service) {
+    core::Rows<core::FeedbackSummary> summaries = service.listFeedbackSummaries();
+    if (!summaries.ok) {
+        logging::error("{}", summaries.error);
         return;
     }
 
     std::cout << "\n--- Feedback for Rules ---\n";
-    while (sqlite3_step(stmt) == SQLITE_ROW) {
-        int id = sqlite3_column_int(stmt, 0);
-        const unsigned char* ruleText = sqlite3_column_text(stmt, 1);
-        const unsigned char* feedback = sqlite3_column_text(stmt, 2);
+    for (const core::FeedbackSummary& summary : summaries.rows) {
+        std::cout << "Rule ID: " << summary.ruleId << "\n";
+        std::cout << "Rule: " << summary.ruleText << "\n";
+        std::cout << "Feedback: " << summary.feedbackCount << " entries";
+        if (summary.ratingCount > 0) {
+            std::cout << " | Average rating: " << std::fixed << std::setprecision(1)
+                      << static_cast<double>(summary.ratingSum) / summary.ratingCount << "/5";
+        }
+        std::cout << "\n-------------------------------------\n";
+    }
 
-        std::cout << "Rule ID: " << id << "\n";
-        std::cout << "Rule: " << (ruleText ? reinterpret_cast<const char*>(ruleText) : "") << "\n";
-        std::cout << "Feedback: " << (feedback ? reinterpret_cast<const char*>(feedback) : "No feedback yet.") << "\n";
-        std::cout << "-------------------------------------\n";
+    int ruleId;
+    std::cout << "\nEnter Rule ID to read its feedback (0 to go back): ";
+    std::cin >> ruleId;
+    if (std::cin.fail() || ruleId <= 0) {
+        std::cin.clear();
+        std::cin.ignore(10000, '\n');
+        return;
     }
+    std::cin.ignore();
+
+    const int pageSize = 10;
+    sqlite3_int64 lastId = 0;
+    while (true) {
+        core::Rows<core::FeedbackRecord> page = service.listRuleFeedback(ruleId, lastId, pageSize);
+        if (!page.ok) {
+            logging::error("{}", page.error);
+            return;
+        }
+
+        for (const core::FeedbackRecord& feedback : page.rows) {
+            lastId = feedback.id;
+            std::cout << "[" << (feedback.createdAt.empty() ? "unknown time" : feedback.createdAt) << "] ";
+            if (feedback.workerId >= 0) {
+                std::cout << "Worker " << feedback.workerId << " ";
+            }
+            if (feedback.rating > 0) {
+                std::cout << "(rated " << feedback.rating << "/5) ";
+            }
+            std::cout << "\n" << feedback.text << "\n\n";
+        }
 
-    sqlite3_finalize(stmt);
+        if (page.rows.empty()) {
+            std::cout << "No more feedback.\n";
+            break;
+        }
+        if (static_cast<int>(page.rows.size()) < pageSize) {
+            break;
+        }
+
+        std::string more;
+        std::cout << "Press Enter for more, or q to stop: ";
+        std::getline(std::cin, more);
+        if (!more.empty()) {
+            break;
+        }
+    }
 }
+
+/// @brief Full-text search over rules, task descriptions and worker reports.
+///
+/// Results are ranked by relevance (bm25) and shown with a highlighted snippet.
+/// Managers search all tasks, workers only their own.
+/// @param service EHS operations, local or over ehsd.
+/// @param query Search terms, e.g. "confined space".
+/// @param userId User's ID.
+/// @param isManager If true, search all tasks.
+void User::searchRecords(Service& service, const std::string& query, int userId, bool isManager) {
+    core::SearchResult result = service.search(query, isManager ? -1 : userId);
+    if (!result.ok) {
+        logging::error("{}", result.error);
+        return;
+    }
+
+    auto printHits = [](const std::vector<core::SearchHit>& hits) {
+        int matches = 0;
+        for (const core::SearchHit& hit : hits) {
+            std::cout << ++matches << ". ID: " << hit.id << " | " << hit.snippet << "\n";
+        }
+        if (matches == 0) {
+            std::cout << "No matches.\n";
+        }
+    };
+
+    std::cout << "\n--- Matching Rules ---\n";
+    printHits(result.rules);
+    std::cout << "\n--- Matching Tasks ---\n";
+    printHits(result.tasks);
+}
\ No newline at end of file
@@ -1,6 +1,7 @@
 #pragma once
 #include <string>
 #include <sqlite3.h>
+#include "../service/service.h"
 using namespace std;
 
 class User {
@@ -14,14 +15,15 @@ public:
     User();
     ~User();
     string hashPassword(const string& password);
-    bool registerUser(sqlite3* db, const std::string& username, const std::string& password);
-    bool loginUser(sqlite3* db, const std::string& username, const std::string& password);
-    string getUserRole(sqlite3* db, const std::string& username, const std::string& password);
-    bool userExists(sqlite3* db, const std::string& username, const std::string& password);
-    void viewTaskDetails(sqlite3* db, int userId, bool isManager = false);
-    int getUserId(sqlite3* db, const std::string& username, const std::string& password);
-    void viewRules(sqlite3* db);
-    void ViewRuleFeedback(sqlite3* db);
+    bool registerUser(Service& service, const std::string& username, const std::string& password);
+    bool loginUser(Service& service, const std::string& username, const std::string& password);
+    string getUserRole(Service& service, const std::string& username, const std::string& password);
+    bool userExists(Service& service, const std::string& username, const std::string& password);
+    void viewTaskDetails(Service& service, int userId, bool isManager = false, bool includeArchived = false);
+    int getUserId(Service& service, const std::string& username, const std::string& password);
+    void viewRules(Service& service);
+    void ViewRuleFeedback(Service& service);
+    void searchRecords(Service& service, const std::string& query, int userId, bool isManager = false);
 
 
 };
\ No newline at end of file
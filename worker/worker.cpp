@@ -1,28 +1,34 @@
 #include "worker.h"
+#include "../core/core.h"
+#include "../executor/executor.h"
+#include "../logging/logging.h"
+#include "../trace/trace.h"
 #include <iostream>
-#include <filesystem>
-#include <mutex>
 #include <vector>
 #include <algorithm>
 #include <thread>
+#include <memory>
+#include <future>
+#include <chrono>
+#include <ctime>
 
-std::mutex db_mutex; /**< Mutex to ensure safe database access when using threads */
 /**
  * @file worker.cpp
  * @brief Implementation of the Worker class in the EHS Management System.
  *
  * This file defines the behavior of the Worker class, including task reporting and
- * feedback submission functionalities. Workers can report task progress, submit
+ * feedback submission functionalities. The prompts live here; the database and
+ * media work is done through the Service interface (service/service.h). Workers can report task progress, submit
  * media files, and provide feedback on safety rules. Multithreading is used for 
- * concurrent task reporting, and database access is synchronized using mutexes.
+ * concurrent task reporting.
  *
  * OOP Principles:
  * - Inheritance: Worker inherits from User.
  * - Encapsulation: Worker functionalities are organized in class methods.
  *
  * Multithreading:
- * - Task reporting is performed using threads to simulate concurrent workers.
- * - Mutex is used to synchronize database operations.
+ * - Task reporting runs on the executor's blocking threads (executor::offload).
+ * - The Service is safe to call from the pool thread, so no global lock is needed.
  * 
  */
 
@@ -47,7 +53,7 @@ Worker::~Worker() {}
  * It uses threading to handle multiple task reports concurrently, 
  * allowing workers to submit reports simultaneously without waiting for each other.
  *
- * @param db Database connection.
+ * @param service EHS operations, local or over ehsd.
  * @param userId Worker ID.
  *
  * OOP Principles:
@@ -55,43 +61,38 @@ Worker::~Worker() {}
  * behavior like reporting tasks and providing feedback.
  * 
  * Threading:
- * Threads are used to handle task reporting concurrently so multiple workers 
- * can submit reports at the same time.
+ * The report is queued on the executor's blocking threads instead of a thread
+ * of its own, so concurrent reports share them and never hold a pool thread.
  * 
  * Encapsulation:
  * Task reporting is encapsulated within the reportTaskWork function. 
  * The database interactions are isolated inside the method, making it easy to manage 
  * the worker's task reporting logic separately.
  */
-void Worker::reportTaskWork(sqlite3* db, int userId) {
+void Worker::reportTaskWork(Service& service, int userId) {
     int taskId;
     std::string reportDesc, mediaPath;
     std::vector<int> validTaskIds;
 
     // Fetch assigned tasks
-    const char* query = "SELECT id, task_description, status FROM tasks WHERE worker_id = ? AND status != 'completed';";
-    sqlite3_stmt* stmtList;
-
     {
-        std::lock_guard<std::mutex> lock(db_mutex);
-        if (sqlite3_prepare_v2(db, query, -1, &stmtList, nullptr) == SQLITE_OK) {
-            sqlite3_bind_int(stmtList, 1, userId);
-            int count = 1;
-
-            std::cout << "\nAssigned Tasks:\n";
-            while (sqlite3_step(stmtList) == SQLITE_ROW) {
-                int id = sqlite3_column_int(stmtList, 0);
-                std::string desc = reinterpret_cast<const char*>(sqlite3_column_text(stmtList, 1));
-                std::string status = reinterpret_cast<const char*>(sqlite3_column_text(stmtList, 2));
-
-                std::cout << count++ << ". Task ID: " << id << " | Description: " << desc << " | Status: " << status << "\n";
-                validTaskIds.push_back(id);
-            }
-            sqlite3_finalize(stmtList);
-        } else {
-            std::cerr << "Failed to fetch assigned tasks.\n";
+        core::Rows<core::TaskRecord> tasks = service.listOpenTasks(userId);
+        if (!tasks.ok) {
+            logging::error("Failed to fetch assigned tasks.");
             return;
         }
+
+        int count = 1;
+        std::cout << "\nAssigned Tasks:\n";
+        for (const core::TaskRecord& task : tasks.rows) {
+            std::cout << count++ << ". Task ID: " << task.id << " | Description: " << task.description
+                      << " | Status: " << task.status;
+            if (task.dueAt) {
+                std::cout << " | Due: " << core::formatLocalTime(task.dueAt);
+            }
+            std::cout << "\n";
+            validTaskIds.push_back(task.id);
+        }
     }
 
     // Let worker select a task
@@ -116,8 +117,11 @@ void Worker::reportTaskWork(sqlite3* db, int userId) {
     std::cout << "Enter path to media file: ";
     std::getline(std::cin, mediaPath);
 
-    // Threaded task report function
+    // Task report job, run on the executor's blocking threads
+    Service* reports = &service;
     auto reportTask = [=]() {
+        logging::setSessionContext("user=" + std::to_string(userId) + " task=" + std::to_string(taskId) + " job=report");
+        trace::Span span("worker.report_job", "worker");
         auto start = std::chrono::system_clock::to_time_t(std::chrono::system_clock::now());
         std::cout << "\n[Thread] Worker " << userId << " reporting Task " << taskId
                   << " | Start: " << std::ctime(&start);
@@ -125,54 +129,42 @@ void Worker::reportTaskWork(sqlite3* db, int userId) {
         // Simulate a long-running task (e.g., file upload)
         std::this_thread::sleep_for(std::chrono::seconds(180));
 
-        std::string savedFilePath = "./uploads/task_" + std::to_string(taskId) + "_user_" + std::to_string(userId);
-        std::filesystem::create_directories("./uploads");
-
-        try {
-            std::filesystem::copy(mediaPath, savedFilePath, std::filesystem::copy_options::overwrite_existing);
-        } catch (const std::exception& e) {
-            std::cerr << "Failed to save media: " << e.what() << "\n";
-            return;
-        }
-
-        // Update task details in database
-        sqlite3_stmt* stmt = nullptr;
-        const char* sql = "UPDATE tasks SET worker_report = ?, worker_media = ?, status = 'completed' WHERE id = ? AND worker_id = ?;";
-
-        std::lock_guard<std::mutex> lock(db_mutex);
-        if (sqlite3_prepare_v2(db, sql, -1, &stmt, nullptr) == SQLITE_OK) {
-            sqlite3_bind_text(stmt, 1, reportDesc.c_str(), -1, SQLITE_STATIC);
-            sqlite3_bind_text(stmt, 2, savedFilePath.c_str(), -1, SQLITE_STATIC);
-            sqlite3_bind_int(stmt, 3, taskId);
-            sqlite3_bind_int(stmt, 4, userId);
-
-            if (sqlite3_step(stmt) == SQLITE_DONE) {
-                std::cout << "Task report submitted successfully.\n";
-            } else {
-                std::cerr << "Failed to submit report.\n";
-            }
-
-            sqlite3_finalize(stmt);
+        // Media is saved (or uploaded to ehsd) before the UPDATE is queued on the writer thread
+        core::Result result = reports->submitTaskReport(taskId, userId, reportDesc, mediaPath);
+        if (result.ok) {
+            std::cout << "Task report submitted successfully.\n";
         } else {
-            std::cerr << "Failed to prepare statement.\n";
+            logging::error("{}", result.error);
+            logging::setSessionContext("");
+            return;
         }
 
         auto end = std::chrono::system_clock::to_time_t(std::chrono::system_clock::now());
         std::cout << "[Thread] Worker " << userId << " finished Task " << taskId
                   << " | End: " << std::ctime(&end);
+        logging::setSessionContext("");
     };
 
-    // Start the task report thread
-    std::thread reportThread(reportTask);
-    reportThread.join();  // You can remove `.join()` to let threads run in background
+    // The job sleeps and blocks on media I/O and the service, so it runs on the blocking threads and
+    // leaves the pool free; drop `.wait()` to let it finish in the background
+    auto job = std::make_shared<std::packaged_task<void()>>(reportTask);
+    std::future<void> report = job->get_future();
+    if (!executor::offload([job]() { (*job)(); })) {
+        logging::error("Task report not queued: shutting down.");
+        return;
+    }
+    report.wait();
 }
 
 /**
  * @brief Worker provides feedback on a rule.
  * 
- * Workers can select a rule and submit feedback for it.
+ * Workers can select a rule and submit feedback for it, with an optional
+ * 1-5 rating. Each submission is appended to the rule_feedback table, so
+ * earlier feedback on the same rule is kept.
  *
- * @param db Database connection.
+ * @param service EHS operations, local or over ehsd.
+ * @param userId Worker ID.
  *
  * OOP Principles:
  * The feedback functionality is encapsulated in the `GiveRuleFeedback` method, which 
@@ -182,23 +174,17 @@ void Worker::reportTaskWork(sqlite3* db, int userId) {
  * Feedback collection and saving are encapsulated inside the method, providing 
  * a clean interface for workers to give feedback on rules.
  */
-void Worker::GiveRuleFeedback(sqlite3* db) {
-    sqlite3_stmt* stmt = nullptr;
-
+void Worker::GiveRuleFeedback(Service& service, int userId) {
     // Show available rules
     std::cout << "\n--- Available Rules ---\n";
-    const char* listRulesSql = "SELECT id, rule_text FROM rules;";
-    if (sqlite3_prepare_v2(db, listRulesSql, -1, &stmt, nullptr) == SQLITE_OK) {
-        while (sqlite3_step(stmt) == SQLITE_ROW) {
-            int id = sqlite3_column_int(stmt, 0);
-            const char* text = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 1));
-            std::cout << "Rule ID: " << id << " | " << text << "\n";
-        }
-        sqlite3_finalize(stmt);
-    } else {
-        std::cerr << "Failed to load rules.\n";
+    core::Rows<core::RuleRecord> rules = service.listRules();
+    if (!rules.ok) {
+        logging::error("Failed to load rules.");
         return;
     }
+    for (const core::RuleRecord& rule : rules.rows) {
+        std::cout << "Rule ID: " << rule.id << " | " << rule.text << "\n";
+    }
 
     // Let worker provide feedback
     int ruleId;
@@ -222,19 +208,33 @@ void Worker::GiveRuleFeedback(sqlite3* db) {
     std::cout << "Enter your feedback: ";
     std::getline(std::cin, feedback);
 
-    // Save feedback in the database
-    const char* updateSql = "UPDATE rules SET feedback = ? WHERE id = ?";
-    if (sqlite3_prepare_v2(db, updateSql, -1, &stmt, nullptr) == SQLITE_OK) {
-        sqlite3_bind_text(stmt, 1, feedback.c_str(), -1, SQLITE_STATIC);
-        sqlite3_bind_int(stmt, 2, ruleId);
+    if (feedback.empty()) {
+        std::cout << "Feedback cannot be empty.\n";
+        return;
+    }
 
-        if (sqlite3_step(stmt) == SQLITE_DONE) {
-            std::cout << "Feedback submitted successfully.\n";
-        } else {
-            std::cout << "Failed to submit feedback.\n";
+    // Optional 1-5 rating, blank to skip
+    int rating = 0;
+    while (true) {
+        std::string ratingInput;
+        std::cout << "Rate this rule 1-5 (press Enter to skip): ";
+        std::getline(std::cin, ratingInput);
+
+        if (ratingInput.empty()) {
+            break;
         }
-        sqlite3_finalize(stmt);
+        if (ratingInput.size() == 1 && ratingInput[0] >= '1' && ratingInput[0] <= '5') {
+            rating = ratingInput[0] - '0';
+            break;
+        }
+        std::cout << "Invalid rating. Try again.\n";
+    }
+
+    // Append feedback; earlier feedback for the rule is kept
+    core::Result result = service.submitRuleFeedback(ruleId, userId, rating, feedback);
+    if (result.ok) {
+        std::cout << "Feedback submitted successfully.\n";
     } else {
-        std::cerr << "Failed to prepare statement.\n";
+        std::cout << result.error << "\n";
     }
 }
@@ -31,20 +31,21 @@ class Worker : public User {
    * Lists assigned tasks, accepts a report description and media path,
    * saves the media, and updates the task in the database.
    *
-   * @param db Pointer to the SQLite database connection.
+   * @param service EHS operations, local or over ehsd.
    * @param user_id ID of the worker reporting the task.
    */
-  void reportTaskWork(sqlite3* db, int user_id);
+  void reportTaskWork(Service& service, int user_id);
 
   /**
    * @brief Allows a worker to give feedback on a rule.
    *
    * Displays a list of all rules and lets the worker submit feedback
-   * which is saved in the corresponding rule entry.
+   * and an optional rating, appended to the rule's feedback history.
    *
-   * @param db Pointer to the SQLite database connection.
+   * @param service EHS operations, local or over ehsd.
+   * @param user_id ID of the worker giving feedback.
    */
-  void GiveRuleFeedback(sqlite3* db);
+  void GiveRuleFeedback(Service& service, int user_id);
 };
 
 #endif  // WORKER_H_